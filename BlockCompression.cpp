@@ -0,0 +1,886 @@
+#include "BlockCompression.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSION_SSE2
+#endif
+
+namespace
+{
+	// --------------------------------------------------------
+	// A block's 16 pixels, one array per channel, so a register
+	// holds the same channel of 4 pixels
+	// --------------------------------------------------------
+	struct Block
+	{
+		alignas(16) float channels[4][16];
+	};
+
+	// Colors a block's indices can pick from, channels in the same order as Block's
+	struct Palette
+	{
+		float entries[16][4];
+		unsigned int count;
+	};
+
+	// --------------------------------------------------------
+	// Loads the 4x4 block at (blockX, blockY), repeating the
+	// last row and column for pixels past the image's edge
+	// --------------------------------------------------------
+	void LoadBlock(const ImageData& image, unsigned int blockX, unsigned int blockY, Block& block)
+	{
+		for (unsigned int y = 0; y < 4; y++)
+		{
+			unsigned int sourceY = (std::min)(blockY * 4 + y, image.height - 1);
+			for (unsigned int x = 0; x < 4; x++)
+			{
+				unsigned int sourceX = (std::min)(blockX * 4 + x, image.width - 1);
+				const unsigned char* pixel = &image.pixels[((size_t)sourceY * image.width + sourceX) * 4];
+				for (unsigned int c = 0; c < 4; c++)
+					block.channels[c][y * 4 + x] = pixel[c];
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Gives every pixel the nearest palette entry, measured over
+	// channels [first, first + count), and returns the total
+	// squared error
+	// --------------------------------------------------------
+	float AssignIndices(const Block& block, unsigned int first, unsigned int count, const Palette& palette, unsigned char indices[16])
+	{
+		float total = 0;
+#if defined(BLOCK_COMPRESSION_SSE2)
+		for (unsigned int i = 0; i < 16; i += 4)
+		{
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestEntry = _mm_setzero_si128();
+			for (unsigned int e = 0; e < palette.count; e++)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (unsigned int c = first; c < first + count; c++)
+				{
+					__m128 difference = _mm_sub_ps(_mm_load_ps(&block.channels[c][i]), _mm_set1_ps(palette.entries[e][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+				}
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestEntry = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((int)e)), _mm_andnot_si128(closer, bestEntry));
+			}
+
+			alignas(16) int32_t entries[4];
+			alignas(16) float errors[4];
+			_mm_store_si128((__m128i*)entries, bestEntry);
+			_mm_store_ps(errors, best);
+			for (unsigned int lane = 0; lane < 4; lane++)
+			{
+				indices[i + lane] = (unsigned char)entries[lane];
+				total += errors[lane];
+			}
+		}
+#else
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			float best = FLT_MAX;
+			for (unsigned int e = 0; e < palette.count; e++)
+			{
+				float distance = 0;
+				for (unsigned int c = first; c < first + count; c++)
+				{
+					float difference = block.channels[c][i] - palette.entries[e][c];
+					distance += difference * difference;
+				}
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = (unsigned char)e;
+				}
+			}
+			total += best;
+		}
+#endif
+		return total;
+	}
+
+	// --------------------------------------------------------
+	// Starting endpoints: the ends of the block's spread along
+	// its principal axis (over channels [first, first + count))
+	// --------------------------------------------------------
+	void FitEndpoints(const Block& block, unsigned int first, unsigned int count, float start[4], float end[4])
+	{
+		float mean[4] = {};
+		for (unsigned int c = first; c < first + count; c++)
+		{
+			for (unsigned int i = 0; i < 16; i++)
+				mean[c] += block.channels[c][i];
+			mean[c] /= 16;
+		}
+
+		float covariance[4][4] = {};
+		for (unsigned int i = 0; i < 16; i++)
+			for (unsigned int a = first; a < first + count; a++)
+				for (unsigned int b = first; b < first + count; b++)
+					covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+
+		// Power iteration, starting from the row of the channel that varies most
+		unsigned int widest = first;
+		for (unsigned int c = first; c < first + count; c++)
+			if (covariance[c][c] > covariance[widest][widest])
+				widest = c;
+		float axis[4] = {};
+		for (unsigned int c = first; c < first + count; c++)
+			axis[c] = covariance[widest][c];
+
+		for (unsigned int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0;
+			for (unsigned int a = first; a < first + count; a++)
+			{
+				for (unsigned int b = first; b < first + count; b++)
+					next[a] += covariance[a][b] * axis[b];
+				length = (std::max)(length, fabsf(next[a]));
+			}
+			if (length < 1e-6f)
+				break;
+			for (unsigned int c = first; c < first + count; c++)
+				axis[c] = next[c] / length;
+		}
+
+		float squaredLength = 0;
+		for (unsigned int c = first; c < first + count; c++)
+			squaredLength += axis[c] * axis[c];
+
+		float lowest = 0, highest = 0;
+		if (squaredLength > 1e-12f)
+		{
+			lowest = FLT_MAX;
+			highest = -FLT_MAX;
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				float t = 0;
+				for (unsigned int c = first; c < first + count; c++)
+					t += (block.channels[c][i] - mean[c]) * axis[c];
+				t /= squaredLength;
+				lowest = (std::min)(lowest, t);
+				highest = (std::max)(highest, t);
+			}
+		}
+
+		for (unsigned int c = first; c < first + count; c++)
+		{
+			start[c] = (std::clamp)(mean[c] + axis[c] * lowest, 0.0f, 255.0f);
+			end[c] = (std::clamp)(mean[c] + axis[c] * highest, 0.0f, 255.0f);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Least squares endpoints for a fixed choice of indices,
+	// where entry k of the palette is (1 - weights[k]) * start
+	// + weights[k] * end. False when the indices don't pin the
+	// endpoints down (every pixel has the same weight)
+	// --------------------------------------------------------
+	bool RefitEndpoints(const Block& block, unsigned int first, unsigned int count, const unsigned char indices[16],
+		const float* weights, float start[4], float end[4])
+	{
+		float aa = 0, ab = 0, bb = 0;
+		float ax[4] = {}, bx[4] = {};
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			float b = weights[indices[i]];
+			float a = 1 - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (unsigned int c = first; c < first + count; c++)
+			{
+				ax[c] += a * block.channels[c][i];
+				bx[c] += b * block.channels[c][i];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+
+		for (unsigned int c = first; c < first + count; c++)
+		{
+			start[c] = (std::clamp)((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+			end[c] = (std::clamp)((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	// Whether every pixel matches the first over channels [first, first + count)
+	bool IsSingleColor(const Block& block, unsigned int first, unsigned int count)
+	{
+		for (unsigned int c = first; c < first + count; c++)
+			for (unsigned int i = 1; i < 16; i++)
+				if (block.channels[c][i] != block.channels[c][0])
+					return false;
+		return true;
+	}
+
+	// Writes bits into a zeroed block, least significant first
+	struct BitWriter
+	{
+		unsigned char* out;
+		unsigned int position;
+
+		void Write(unsigned int value, unsigned int bits)
+		{
+			for (unsigned int b = 0; b < bits; b++, position++)
+				out[position / 8] |= (unsigned char)(((value >> b) & 1) << (position % 8));
+		}
+	};
+
+	struct BitReader
+	{
+		const unsigned char* data;
+		unsigned int position;
+
+		unsigned int Read(unsigned int bits)
+		{
+			unsigned int value = 0;
+			for (unsigned int b = 0; b < bits; b++, position++)
+				value |= ((data[position / 8] >> (position % 8)) & 1u) << b;
+			return value;
+		}
+	};
+
+	// --------------------------------------------------------
+	// BC1: two RGB565 endpoints and 2-bit indices. With the
+	// first endpoint greater, the palette is the endpoints and
+	// two colors a third of the way between them
+	// --------------------------------------------------------
+	const float BC1Weights[4] = { 0, 1, 1 / 3.0f, 2 / 3.0f };
+
+	unsigned int To565(const float color[4])
+	{
+		unsigned int r = (unsigned int)lroundf(color[0] * 31 / 255);
+		unsigned int g = (unsigned int)lroundf(color[1] * 63 / 255);
+		unsigned int b = (unsigned int)lroundf(color[2] * 31 / 255);
+		return r << 11 | g << 5 | b;
+	}
+
+	void From565(unsigned int color, float out[4])
+	{
+		unsigned int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+		out[0] = (float)(r << 3 | r >> 2);
+		out[1] = (float)(g << 2 | g >> 4);
+		out[2] = (float)(b << 3 | b >> 2);
+		out[3] = 255;
+	}
+
+	void BC1Palette(unsigned int color0, unsigned int color1, Palette& palette)
+	{
+		From565(color0, palette.entries[0]);
+		From565(color1, palette.entries[1]);
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			float e0 = palette.entries[0][c], e1 = palette.entries[1][c];
+			if (color0 > color1)
+			{
+				palette.entries[2][c] = (float)(int)((2 * e0 + e1) / 3 + 0.5f);
+				palette.entries[3][c] = (float)(int)((e0 + 2 * e1) / 3 + 0.5f);
+			}
+			else
+			{
+				palette.entries[2][c] = (float)(int)((e0 + e1) / 2 + 0.5f);
+				palette.entries[3][c] = 0; // Transparent black
+			}
+		}
+		palette.count = 4;
+	}
+
+	// --------------------------------------------------------
+	// Single color BC1 blocks. Fitting gives a flat block one
+	// endpoint, so only RGB565's own colors come out exactly -
+	// but palette entry 2 (2/3 of color0, 1/3 of color1) gets
+	// within 1 of every 8-bit value, and hits most of them. For
+	// each value, the 5 and 6-bit endpoints whose entry 2 comes
+	// closest, preferring endpoints close together (so decoders
+	// that round the thirds differently still agree)
+	// --------------------------------------------------------
+	struct BC1SingleColorTable
+	{
+		unsigned char endpoints[2][256][2]; // [6 bits?][value][color0, color1]
+
+		BC1SingleColorTable()
+		{
+			for (unsigned int wide = 0; wide < 2; wide++)
+			{
+				unsigned int levels = wide ? 64 : 32;
+				for (unsigned int value = 0; value < 256; value++)
+				{
+					int bestScore = INT_MAX;
+					for (unsigned int a = 0; a < levels; a++)
+					{
+						for (unsigned int b = 0; b < levels; b++)
+						{
+							int e0 = wide ? (int)(a << 2 | a >> 4) : (int)(a << 3 | a >> 2);
+							int e1 = wide ? (int)(b << 2 | b >> 4) : (int)(b << 3 | b >> 2);
+							int entry = (int)((2 * e0 + e1) / 3.0f + 0.5f); // As BC1Palette() rounds it
+							int score = abs(entry - (int)value) * 1024 + abs(e0 - e1);
+							if (score < bestScore)
+							{
+								bestScore = score;
+								endpoints[wide][value][0] = (unsigned char)a;
+								endpoints[wide][value][1] = (unsigned char)b;
+							}
+						}
+					}
+				}
+			}
+		}
+	};
+
+	void WriteBC1(unsigned int color0, unsigned int color1, const unsigned char indices[16], unsigned char* out)
+	{
+		out[0] = (unsigned char)color0;
+		out[1] = (unsigned char)(color0 >> 8);
+		out[2] = (unsigned char)color1;
+		out[3] = (unsigned char)(color1 >> 8);
+		uint32_t bits = 0;
+		for (unsigned int i = 0; i < 16; i++)
+			bits |= (uint32_t)indices[i] << (i * 2);
+		memcpy(out + 4, &bits, sizeof(bits));
+	}
+
+	void EncodeBC1SingleColor(const Block& block, unsigned char* out)
+	{
+		static const BC1SingleColorTable table;
+		const unsigned int shifts[3] = { 11, 5, 0 };
+		unsigned int color0 = 0, color1 = 0;
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			const unsigned char* endpoints = table.endpoints[c == 1][(unsigned int)block.channels[c][0]];
+			color0 |= (unsigned int)endpoints[0] << shifts[c];
+			color1 |= (unsigned int)endpoints[1] << shifts[c];
+		}
+
+		// Entry 2 needs the 4 color palette, where color0 is greater; swapped, it's entry 3.
+		// Equal endpoints mean every channel is exact at either end
+		unsigned char index = 2;
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+			index = 3;
+		}
+		else if (color0 == color1)
+			index = 0;
+
+		unsigned char indices[16];
+		memset(indices, index, sizeof(indices));
+		WriteBC1(color0, color1, indices, out);
+	}
+
+	void EncodeBC1(const Block& block, unsigned char* out)
+	{
+		if (IsSingleColor(block, 0, 3))
+		{
+			EncodeBC1SingleColor(block, out);
+			return;
+		}
+
+		float start[4], end[4];
+		FitEndpoints(block, 0, 3, start, end);
+
+		float bestError = FLT_MAX;
+		unsigned int bestColors[2] = {};
+		unsigned char bestIndices[16] = {};
+		for (unsigned int attempt = 0; attempt < 3; attempt++)
+		{
+			// The greater endpoint goes first for the 4 color palette
+			unsigned int color0 = To565(end), color1 = To565(start);
+			if (color0 < color1)
+			{
+				std::swap(color0, color1);
+				std::swap(start, end);
+			}
+
+			Palette palette;
+			BC1Palette(color0, color1, palette);
+			if (color0 == color1)
+				palette.count = 1; // Only index 0 means the same color in both modes
+
+			unsigned char indices[16];
+			float error = AssignIndices(block, 0, 3, palette, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestColors[0] = color0;
+				bestColors[1] = color1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+
+			// Entry 0 (color0) came from end, entry 1 from start
+			if (error == 0 || !RefitEndpoints(block, 0, 3, indices, BC1Weights, end, start))
+				break;
+		}
+
+		WriteBC1(bestColors[0], bestColors[1], bestIndices, out);
+	}
+
+	void DecodeBC1(const unsigned char* data, unsigned char pixels[16][4])
+	{
+		unsigned int color0 = data[0] | data[1] << 8;
+		unsigned int color1 = data[2] | data[3] << 8;
+		Palette palette;
+		BC1Palette(color0, color1, palette);
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int index = (data[4 + i / 4] >> ((i % 4) * 2)) & 3;
+			for (unsigned int c = 0; c < 3; c++)
+				pixels[i][c] = (unsigned char)palette.entries[index][c];
+			pixels[i][3] = color0 <= color1 && index == 3 ? 0 : 255;
+		}
+	}
+
+	// --------------------------------------------------------
+	// BC4: two 8-bit endpoints and 3-bit indices. With the
+	// first endpoint greater there are 6 values between them,
+	// otherwise 4 values plus 0 and 255
+	// --------------------------------------------------------
+	const float BC4Weights8[8] = { 0, 1, 1 / 7.0f, 2 / 7.0f, 3 / 7.0f, 4 / 7.0f, 5 / 7.0f, 6 / 7.0f };
+
+	void BC4Palette(unsigned int value0, unsigned int value1, unsigned int channel, Palette& palette)
+	{
+		float values[8];
+		values[0] = (float)value0;
+		values[1] = (float)value1;
+		if (value0 > value1)
+		{
+			for (unsigned int i = 2; i < 8; i++)
+				values[i] = (float)(int)(((8 - i) * value0 + (i - 1) * value1) / 7.0f + 0.5f);
+		}
+		else
+		{
+			for (unsigned int i = 2; i < 6; i++)
+				values[i] = (float)(int)(((6 - i) * value0 + (i - 1) * value1) / 5.0f + 0.5f);
+			values[6] = 0;
+			values[7] = 255;
+		}
+
+		for (unsigned int e = 0; e < 8; e++)
+			palette.entries[e][channel] = values[e];
+		palette.count = 8;
+	}
+
+	float TryBC4(const Block& block, unsigned int channel, unsigned int value0, unsigned int value1, unsigned char indices[16])
+	{
+		Palette palette;
+		BC4Palette(value0, value1, channel, palette);
+		return AssignIndices(block, channel, 1, palette, indices);
+	}
+
+	void EncodeBC4(const Block& block, unsigned int channel, unsigned char* out)
+	{
+		const float* values = block.channels[channel];
+		float lowest = 255, highest = 0;
+		float innerLowest = 255, innerHighest = 0; // Ignoring 0 and 255, which the 6 value palette has anyway
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			lowest = (std::min)(lowest, values[i]);
+			highest = (std::max)(highest, values[i]);
+			if (values[i] > 0 && values[i] < 255)
+			{
+				innerLowest = (std::min)(innerLowest, values[i]);
+				innerHighest = (std::max)(innerHighest, values[i]);
+			}
+		}
+
+		unsigned int best[2] = { (unsigned int)highest, (unsigned int)lowest };
+		unsigned char bestIndices[16];
+		float bestError = TryBC4(block, channel, best[0], best[1], bestIndices);
+
+		// Refit the 8 value palette to the indices it chose
+		float start[4] = {}, end[4] = {};
+		unsigned char indices[16];
+		memcpy(indices, bestIndices, sizeof(indices));
+		for (unsigned int attempt = 0; attempt < 2 && bestError > 0 && highest > lowest; attempt++)
+		{
+			if (!RefitEndpoints(block, channel, 1, indices, BC4Weights8, start, end))
+				break;
+			unsigned int value0 = (unsigned int)lroundf(start[channel]);
+			unsigned int value1 = (unsigned int)lroundf(end[channel]);
+			if (value0 <= value1)
+				break;
+
+			float error = TryBC4(block, channel, value0, value1, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				best[0] = value0;
+				best[1] = value1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+
+		if (innerLowest <= innerHighest)
+		{
+			unsigned int value0 = (unsigned int)innerLowest, value1 = (unsigned int)innerHighest;
+			float error = TryBC4(block, channel, value0, value1, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				best[0] = value0;
+				best[1] = value1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+		}
+
+		out[0] = (unsigned char)best[0];
+		out[1] = (unsigned char)best[1];
+		uint64_t bits = 0;
+		for (unsigned int i = 0; i < 16; i++)
+			bits |= (uint64_t)bestIndices[i] << (i * 3);
+		for (unsigned int b = 0; b < 6; b++)
+			out[2 + b] = (unsigned char)(bits >> (b * 8));
+	}
+
+	void DecodeBC4(const unsigned char* data, unsigned int channel, unsigned char pixels[16][4])
+	{
+		Palette palette;
+		BC4Palette(data[0], data[1], channel, palette);
+		uint64_t bits = 0;
+		for (unsigned int b = 0; b < 6; b++)
+			bits |= (uint64_t)data[2 + b] << (b * 8);
+		for (unsigned int i = 0; i < 16; i++)
+			pixels[i][channel] = (unsigned char)palette.entries[(bits >> (i * 3)) & 7][channel];
+	}
+
+	// --------------------------------------------------------
+	// BC7 mode 6: 7-bit RGBA endpoints, each with a p-bit as
+	// its lowest bit, and 4-bit indices. Pixel 0's index drops
+	// its top bit, so it must be in the first half
+	// --------------------------------------------------------
+	const unsigned int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	const float BC7WeightsFloat[16] = {
+		0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+		34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f };
+
+	void BC7Palette(const unsigned int endpoint0[4], const unsigned int endpoint1[4], Palette& palette)
+	{
+		for (unsigned int e = 0; e < 16; e++)
+			for (unsigned int c = 0; c < 4; c++)
+				palette.entries[e][c] = (float)(((64 - BC7Weights[e]) * endpoint0[c] + BC7Weights[e] * endpoint1[c] + 32) >> 6);
+		palette.count = 16;
+	}
+
+	// The 7 bits that, with p-bit p below them, come closest to value
+	unsigned int QuantizeBC7(float value, unsigned int p)
+	{
+		return (unsigned int)(std::clamp)((int)lroundf((value - p) / 2), 0, 127);
+	}
+
+	// --------------------------------------------------------
+	// Single color BC7 blocks: for each p-bit pair, palette index
+	// (up to 7, which pixel 0 can use without swapping) and 8-bit
+	// value, the 7-bit endpoints whose entry comes closest, built
+	// once. Each choice of p-bits and index hits all but 0 or 255,
+	// so a flat block is exact unless it has both
+	// --------------------------------------------------------
+	struct BC7SingleColorTable
+	{
+		unsigned char endpoints[4][8][256][2]; // [p-bits][index][value][endpoint 0, endpoint 1]
+		unsigned char errors[4][8][256];
+
+		BC7SingleColorTable()
+		{
+			for (unsigned int p = 0; p < 4; p++)
+			{
+				for (unsigned int index = 0; index < 8; index++)
+				{
+					// Every value reachable, from the endpoints closest together
+					int spread[256];
+					for (int& s : spread)
+						s = INT_MAX;
+					for (unsigned int q0 = 0; q0 < 128; q0++)
+					{
+						for (unsigned int q1 = 0; q1 < 128; q1++)
+						{
+							unsigned int e0 = q0 << 1 | (p & 1), e1 = q1 << 1 | p >> 1;
+							unsigned int value = ((64 - BC7Weights[index]) * e0 + BC7Weights[index] * e1 + 32) >> 6;
+							int s = abs((int)e0 - (int)e1);
+							if (s < spread[value])
+							{
+								spread[value] = s;
+								endpoints[p][index][value][0] = (unsigned char)q0;
+								endpoints[p][index][value][1] = (unsigned char)q1;
+							}
+						}
+					}
+
+					// The rest take the nearest value that is
+					for (int value = 0; value < 256; value++)
+					{
+						int nearest = value;
+						for (int distance = 1; spread[nearest] == INT_MAX; distance++)
+							nearest = value - distance >= 0 && spread[value - distance] != INT_MAX ? value - distance : (std::min)(value + distance, 255);
+						errors[p][index][value] = (unsigned char)abs(nearest - value);
+						if (nearest != value)
+							memcpy(endpoints[p][index][value], endpoints[p][index][nearest], 2);
+					}
+				}
+			}
+		}
+	};
+
+	void WriteBC7(unsigned int endpoints[2][4], unsigned int p[2], unsigned char indices[16], unsigned char* out)
+	{
+		// Swap the endpoints if pixel 0's index needs its top bit
+		if (indices[0] >= 8)
+		{
+			std::swap(endpoints[0], endpoints[1]);
+			std::swap(p[0], p[1]);
+			for (unsigned int i = 0; i < 16; i++)
+				indices[i] = (unsigned char)(15 - indices[i]);
+		}
+
+		memset(out, 0, 16);
+		BitWriter bits = { out, 0 };
+		bits.Write(1 << 6, 7); // Mode 6
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			bits.Write(endpoints[0][c] >> 1, 7);
+			bits.Write(endpoints[1][c] >> 1, 7);
+		}
+		bits.Write(p[0], 1);
+		bits.Write(p[1], 1);
+		bits.Write(indices[0], 3);
+		for (unsigned int i = 1; i < 16; i++)
+			bits.Write(indices[i], 4);
+	}
+
+	void EncodeBC7SingleColor(const Block& block, unsigned char* out)
+	{
+		static const BC7SingleColorTable table;
+		unsigned int bestP = 0, bestIndex = 0, bestError = UINT_MAX;
+		for (unsigned int p = 0; p < 4; p++)
+		{
+			for (unsigned int index = 0; index < 8; index++)
+			{
+				unsigned int error = 0;
+				for (unsigned int c = 0; c < 4; c++)
+				{
+					unsigned int difference = table.errors[p][index][(unsigned int)block.channels[c][0]];
+					error += difference * difference;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestP = p;
+					bestIndex = index;
+				}
+			}
+		}
+
+		unsigned int endpoints[2][4];
+		unsigned int p[2] = { bestP & 1, bestP >> 1 };
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			const unsigned char* quantized = table.endpoints[bestP][bestIndex][(unsigned int)block.channels[c][0]];
+			endpoints[0][c] = (unsigned int)quantized[0] << 1 | p[0];
+			endpoints[1][c] = (unsigned int)quantized[1] << 1 | p[1];
+		}
+		unsigned char indices[16];
+		memset(indices, (int)bestIndex, sizeof(indices));
+		WriteBC7(endpoints, p, indices, out);
+	}
+
+	void EncodeBC7(const Block& block, unsigned char* out)
+	{
+		if (IsSingleColor(block, 0, 4))
+		{
+			EncodeBC7SingleColor(block, out);
+			return;
+		}
+
+		float start[4], end[4];
+		FitEndpoints(block, 0, 4, start, end);
+
+		float bestError = FLT_MAX;
+		unsigned int best[2][4] = {};
+		unsigned int bestP[2] = {};
+		unsigned char bestIndices[16] = {};
+		for (unsigned int attempt = 0; attempt < 3; attempt++)
+		{
+			float attemptError = FLT_MAX;
+			unsigned char attemptIndices[16] = {};
+			for (unsigned int p = 0; p < 4; p++)
+			{
+				unsigned int p0 = p & 1, p1 = p >> 1;
+				unsigned int endpoint0[4], endpoint1[4];
+				for (unsigned int c = 0; c < 4; c++)
+				{
+					endpoint0[c] = QuantizeBC7(start[c], p0) << 1 | p0;
+					endpoint1[c] = QuantizeBC7(end[c], p1) << 1 | p1;
+				}
+
+				Palette palette;
+				BC7Palette(endpoint0, endpoint1, palette);
+				unsigned char indices[16];
+				float error = AssignIndices(block, 0, 4, palette, indices);
+				if (error < attemptError)
+				{
+					attemptError = error;
+					memcpy(attemptIndices, indices, sizeof(indices));
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					memcpy(best[0], endpoint0, sizeof(endpoint0));
+					memcpy(best[1], endpoint1, sizeof(endpoint1));
+					bestP[0] = p0;
+					bestP[1] = p1;
+					memcpy(bestIndices, indices, sizeof(indices));
+				}
+			}
+
+			if (bestError == 0 || !RefitEndpoints(block, 0, 4, attemptIndices, BC7WeightsFloat, start, end))
+				break;
+		}
+
+		WriteBC7(best, bestP, bestIndices, out);
+	}
+
+	void DecodeBC7(const unsigned char* data, unsigned char pixels[16][4])
+	{
+		BitReader bits = { data, 0 };
+		if (bits.Read(7) != 1 << 6)
+			throw std::invalid_argument("Only BC7 mode 6 blocks can be decoded");
+
+		unsigned int endpoint0[4], endpoint1[4];
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			endpoint0[c] = bits.Read(7) << 1;
+			endpoint1[c] = bits.Read(7) << 1;
+		}
+		unsigned int p0 = bits.Read(1), p1 = bits.Read(1);
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			endpoint0[c] |= p0;
+			endpoint1[c] |= p1;
+		}
+
+		Palette palette;
+		BC7Palette(endpoint0, endpoint1, palette);
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			unsigned int index = bits.Read(i == 0 ? 3 : 4);
+			for (unsigned int c = 0; c < 4; c++)
+				pixels[i][c] = (unsigned char)palette.entries[index][c];
+		}
+	}
+
+	void EncodeBlock(BlockFormat format, const Block& block, unsigned char* out)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: EncodeBC1(block, out); break;
+		case BlockFormat::BC4: EncodeBC4(block, 0, out); break;
+		case BlockFormat::BC5: EncodeBC4(block, 0, out); EncodeBC4(block, 1, out + 8); break;
+		case BlockFormat::BC7: EncodeBC7(block, out); break;
+		}
+	}
+
+	// Returns how many channels (from red) the format keeps
+	unsigned int DecodeBlock(BlockFormat format, const unsigned char* data, unsigned char pixels[16][4])
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: DecodeBC1(data, pixels); return 3;
+		case BlockFormat::BC4: DecodeBC4(data, 0, pixels); return 1;
+		case BlockFormat::BC5: DecodeBC4(data, 0, pixels); DecodeBC4(data + 8, 1, pixels); return 2;
+		case BlockFormat::BC7: DecodeBC7(data, pixels); return 4;
+		}
+		return 0;
+	}
+
+	void ValidateImage(const ImageData& image)
+	{
+		if (image.width == 0 || image.height == 0 || image.pixels.size() != (size_t)image.width * image.height * 4)
+			throw std::invalid_argument("Images need RGBA pixels for every texel");
+	}
+}
+
+unsigned int BlockCompression::GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+size_t BlockCompression::GetEncodedSize(BlockFormat format, unsigned int width, unsigned int height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+void BlockCompression::Encode(const ImageData& image, BlockFormat format, std::vector<unsigned char>& out)
+{
+	ValidateImage(image);
+
+	unsigned int blocksX = (image.width + 3) / 4;
+	unsigned int blocksY = (image.height + 3) / 4;
+	unsigned int blockBytes = GetBlockBytes(format);
+	out.assign(GetEncodedSize(format, image.width, image.height), 0);
+
+	ThreadPool::Shared().ParallelFor(blocksY, [&](unsigned int blockY)
+		{
+			Block block;
+			for (unsigned int blockX = 0; blockX < blocksX; blockX++)
+			{
+				LoadBlock(image, blockX, blockY, block);
+				EncodeBlock(format, block, &out[((size_t)blockY * blocksX + blockX) * blockBytes]);
+			}
+		});
+}
+
+double BlockCompression::MeasurePsnr(const ImageData& image, BlockFormat format, const unsigned char* encoded)
+{
+	ValidateImage(image);
+
+	unsigned int blocksX = (image.width + 3) / 4;
+	unsigned int blocksY = (image.height + 3) / 4;
+	unsigned int blockBytes = GetBlockBytes(format);
+
+	double squaredError = 0;
+	unsigned int channels = 0;
+	for (unsigned int blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (unsigned int blockX = 0; blockX < blocksX; blockX++)
+		{
+			unsigned char pixels[16][4] = {};
+			channels = DecodeBlock(format, encoded + ((size_t)blockY * blocksX + blockX) * blockBytes, pixels);
+
+			// Only pixels inside the image count
+			for (unsigned int i = 0; i < 16; i++)
+			{
+				unsigned int x = blockX * 4 + i % 4, y = blockY * 4 + i / 4;
+				if (x >= image.width || y >= image.height)
+					continue;
+				const unsigned char* source = &image.pixels[((size_t)y * image.width + x) * 4];
+				for (unsigned int c = 0; c < channels; c++)
+				{
+					double difference = (double)pixels[i][c] - source[c];
+					squaredError += difference * difference;
+				}
+			}
+		}
+	}
+
+	double meanSquaredError = squaredError / ((double)image.width * image.height * channels);
+	if (meanSquaredError == 0)
+		return std::numeric_limits<double>::infinity();
+	return 10 * log10(255.0 * 255.0 / meanSquaredError);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "ImageData.h"
+
+// --------------------------------------------------------
+// The block compressed formats the encoder can write, each
+// one 4x4 pixel block at a time
+//
+// - BC1: RGB, 8 bytes per block (alpha is dropped)
+// - BC4: One channel (red), 8 bytes per block
+// - BC5: Two channels (red and green), 16 bytes per block
+// - BC7: RGBA, 16 bytes per block
+// --------------------------------------------------------
+enum class BlockFormat
+{
+	BC1,
+	BC4,
+	BC5,
+	BC7
+};
+
+/*
+* A CPU encoder for block compressed textures, plus just enough decoding to measure its quality.
+*
+* Every block is fit the same way: the principal axis of its colors (by power iteration on their
+* covariance) gives the starting endpoints, each pixel takes the nearest palette entry, and the
+* endpoints are refit to those choices by least squares and requantized, keeping whichever
+* attempt has the least error. Palette searches test 4 pixels at a time with SSE2.
+* BC7 blocks are all written in mode 6 - one subset, 7-bit endpoints with a p-bit each and 4-bit
+* indices - trying every p-bit combination. BC4 blocks try both the 8 and 6 value palettes.
+*
+* Images whose size isn't a multiple of 4 have their edge pixels repeated to fill the last
+* blocks. Rows of blocks are encoded in parallel on the shared ThreadPool.
+*
+* GetBlockBytes(): Bytes per 4x4 block in a format
+* GetEncodedSize(): Bytes of a whole image in a format
+* Encode(): Compresses an image, replacing the contents of out
+* MeasurePsnr(): Peak signal to noise ratio (dB) of encoded data against its source, over the
+*                channels the format keeps. Infinite when they match exactly
+*/
+namespace BlockCompression
+{
+	unsigned int GetBlockBytes(BlockFormat format);
+	size_t GetEncodedSize(BlockFormat format, unsigned int width, unsigned int height);
+
+	void Encode(const ImageData& image, BlockFormat format, std::vector<unsigned char>& out);
+	double MeasurePsnr(const ImageData& image, BlockFormat format, const unsigned char* encoded);
+}
@@ -20,11 +20,20 @@ struct VSConstantsEach
 	DirectX::XMFLOAT4X4 world;
 	DirectX::XMFLOAT4X4 worldInv;
 
+	// Only used when the mesh has compact vertices (positions are relative to its bounds)
+	DirectX::XMFLOAT3 boundsMin;
+	unsigned int compactVertices;
+	DirectX::XMFLOAT3 boundsSize;
+	unsigned int splitPositions;
+
+	// Only used when positions are their own stream (which starts at vsVertexByteOffset)
+	unsigned int attributeByteOffset;
+	DirectX::XMFLOAT3 padding;
 };
 
 // In a given frame for the pixel shader
 // Same across all - cameraWorldPos, lightCount, lights -  no point writing the same piece of data for each when it can be shared by all!
-// Different - albedo, normal, roughness, metalness, UVScale, UVOffset
+// Different - albedo, normal, occlusion/roughness/metalness (packed), UVScale, UVOffset
 
 struct PSConstantsAll 
 {
@@ -38,8 +47,8 @@ struct PSConstantsEach
 {
 	unsigned int albedoIndex;
 	unsigned int normalIndex;
-	unsigned int roughnessIndex;
-	unsigned int metalnessIndex;
+	unsigned int ormIndex;
+	unsigned int padding; // Keeps UVScale in its own 16 bytes, as HLSL packs it
 
 	DirectX::XMFLOAT2 UVScale;
 	DirectX::XMFLOAT2 UVOffset;
@@ -56,4 +65,7 @@ struct DrawingIndices
 	unsigned int vsConstEachIndex;
 	unsigned int psConstAllIndex;
 	unsigned int psConstEachIndex;
+
+	// Where the mesh's vertices start in the shared vertex buffer
+	unsigned int vsVertexByteOffset;
 };
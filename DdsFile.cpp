@@ -0,0 +1,80 @@
+#include "DdsFile.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+	const unsigned int DdsdCaps = 0x1;
+	const unsigned int DdsdHeight = 0x2;
+	const unsigned int DdsdWidth = 0x4;
+	const unsigned int DdsdPixelFormat = 0x1000;
+	const unsigned int DdsdMipMapCount = 0x20000;
+	const unsigned int DdsdLinearSize = 0x80000;
+	const unsigned int DdsCapsComplex = 0x8;
+	const unsigned int DdsCapsTexture = 0x1000;
+	const unsigned int DdsCapsMipMap = 0x400000;
+}
+
+// --------------------------------------------------------
+// DXGI_FORMAT_BC*_UNORM values - not sRGB, since the pixel
+// shader removes gamma from colors itself
+// --------------------------------------------------------
+unsigned int DdsFile::GetDxgiFormat(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return 71;
+	case BlockFormat::BC4: return 80;
+	case BlockFormat::BC5: return 83;
+	case BlockFormat::BC7: return 98;
+	}
+	return 0;
+}
+
+bool DdsFile::Write(const char* ddsFilePath, BlockFormat format, unsigned int width, unsigned int height,
+	const std::vector<std::vector<unsigned char>>& mips)
+{
+	if (width == 0 || height == 0 || mips.empty())
+		return false;
+
+	// Every level must be exactly the size its dimensions call for
+	unsigned int mipWidth = width, mipHeight = height;
+	for (const std::vector<unsigned char>& mip : mips)
+	{
+		if (mip.size() != BlockCompression::GetEncodedSize(format, mipWidth, mipHeight))
+			return false;
+		mipWidth = (std::max)(mipWidth / 2, 1u);
+		mipHeight = (std::max)(mipHeight / 2, 1u);
+	}
+
+	DdsHeader header = {};
+	header.size = sizeof(DdsHeader);
+	header.flags = DdsdCaps | DdsdHeight | DdsdWidth | DdsdPixelFormat | DdsdMipMapCount | DdsdLinearSize;
+	header.height = height;
+	header.width = width;
+	header.pitchOrLinearSize = (unsigned int)mips[0].size();
+	header.mipMapCount = (unsigned int)mips.size();
+	header.pixelFormat.size = sizeof(DdsPixelFormat);
+	header.pixelFormat.flags = DdsFile::PixelFormatFourCC;
+	header.pixelFormat.fourCC = DdsFile::MakeFourCC('D', 'X', '1', '0');
+	header.caps = DdsCapsTexture;
+	if (mips.size() > 1)
+		header.caps |= DdsCapsComplex | DdsCapsMipMap;
+
+	DdsHeaderDX10 extension = {};
+	extension.dxgiFormat = GetDxgiFormat(format);
+	extension.resourceDimension = DdsFile::ResourceDimensionTexture2D;
+	extension.arraySize = 1;
+
+	std::ofstream out(ddsFilePath, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	out.write(DdsFile::Magic, 4);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)&extension, sizeof(extension));
+	for (const std::vector<unsigned char>& mip : mips)
+		out.write((const char*)mip.data(), mip.size());
+	return out.good();
+}
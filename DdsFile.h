@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include "BlockCompression.h"
+
+// --------------------------------------------------------
+// Layout of a .dds file:
+//   "DDS "
+//   DdsHeader
+//   DdsHeaderDX10    (only when pixelFormat.fourCC is "DX10")
+//   Every mip level, largest first, each one's rows (of
+//   pixels, or of 4x4 blocks) back to back with no padding
+// --------------------------------------------------------
+struct DdsPixelFormat
+{
+	unsigned int size;
+	unsigned int flags;			// DdsFile::PixelFormat* flags
+	unsigned int fourCC;
+	unsigned int rgbBitCount;
+	unsigned int rBitMask;
+	unsigned int gBitMask;
+	unsigned int bBitMask;
+	unsigned int aBitMask;
+};
+
+struct DdsHeader
+{
+	unsigned int size;			// Always 124
+	unsigned int flags;
+	unsigned int height;
+	unsigned int width;
+	unsigned int pitchOrLinearSize;
+	unsigned int depth;
+	unsigned int mipMapCount;	// 0 or 1 when there are no mips
+	unsigned int reserved1[11];
+	DdsPixelFormat pixelFormat;
+	unsigned int caps;
+	unsigned int caps2;			// Cube map and volume flags
+	unsigned int caps3;
+	unsigned int caps4;
+	unsigned int reserved2;
+};
+
+struct DdsHeaderDX10
+{
+	unsigned int dxgiFormat;
+	unsigned int resourceDimension;
+	unsigned int miscFlag;		// 0x4 for cube maps
+	unsigned int arraySize;
+	unsigned int miscFlags2;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "DDS headers are 124 bytes");
+static_assert(sizeof(DdsHeaderDX10) == 20, "DX10 header extensions are 20 bytes");
+
+/*
+* Writes block compressed textures as .dds files, which Graphics::LoadTexture() maps and
+* uploads as stored (see TextureFile).
+*
+* Files always use the DX10 header extension, which names the format with its DXGI value
+* (BC1/BC4/BC5/BC7 _UNORM) - the values are spelled out here so the writer doesn't need any
+* Windows headers.
+*
+* MakeFourCC(): The four character code for a, b, c and d, as stored in DdsPixelFormat
+* GetDxgiFormat(): The DXGI_FORMAT value stored for a block format
+* Write(): Writes a 2D texture whose mip levels are mips[0] (width x height) down to
+*          mips.back(), each already encoded in the given format. Returns false if the file
+*          can't be written or the mip sizes don't match the format
+*/
+namespace DdsFile
+{
+	inline const char Magic[4] = { 'D', 'D', 'S', ' ' };
+
+	const unsigned int PixelFormatFourCC = 0x4;
+	const unsigned int PixelFormatRgb = 0x40;
+	const unsigned int PixelFormatLuminance = 0x20000;
+	const unsigned int Caps2CubeMap = 0x200;
+	const unsigned int Caps2Volume = 0x200000;
+	const unsigned int ResourceDimensionTexture2D = 3;
+	const unsigned int MiscTextureCube = 0x4;
+
+	inline unsigned int MakeFourCC(char a, char b, char c, char d)
+	{
+		return (unsigned int)(unsigned char)a | (unsigned int)(unsigned char)b << 8 |
+			(unsigned int)(unsigned char)c << 16 | (unsigned int)(unsigned char)d << 24;
+	}
+
+	unsigned int GetDxgiFormat(BlockFormat format);
+	bool Write(const char* ddsFilePath, BlockFormat format, unsigned int width, unsigned int height,
+		const std::vector<std::vector<unsigned char>>& mips);
+}
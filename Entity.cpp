@@ -1,6 +1,7 @@
 #include "Entity.h"
+#include <stdexcept>
 
-Entity::Entity(std::shared_ptr<Mesh> inMesh, std::shared_ptr<Material> inMaterial) 
+Entity::Entity(std::shared_ptr<Mesh> inMesh, std::shared_ptr<Material> inMaterial) : lod(0), worldBounds{}, worldBoundsVersion(0), worldBoundsValid(false)
 {
 	mesh = inMesh;
 	material = inMaterial;
@@ -10,4 +11,43 @@ void Entity::SetMaterial(std::shared_ptr<Material> m) { material = m; }
 
 std::shared_ptr<Mesh> Entity::GetMesh() { return mesh; }
 std::shared_ptr<Material> Entity::GetMaterial() { return material; }
-Transform* Entity::GetTransform() { return &transform;  }
\ No newline at end of file
+
+std::shared_ptr<Material> Entity::GetMaterial(unsigned int submesh)
+{
+	if (submesh < submeshMaterials.size() && submeshMaterials[submesh])
+		return submeshMaterials[submesh];
+	return material;
+}
+
+void Entity::SetSubmeshMaterial(unsigned int submesh, std::shared_ptr<Material> m)
+{
+	if (submesh >= mesh->GetSubmeshCount())
+		throw std::invalid_argument("Submesh index is out of range for this entity's mesh");
+
+	submeshMaterials.resize(mesh->GetSubmeshCount());
+	submeshMaterials[submesh] = m;
+}
+
+void Entity::SetSubmeshMaterial(const char* meshMaterial, std::shared_ptr<Material> m)
+{
+	int submesh = mesh->FindSubmesh(meshMaterial);
+	if (submesh < 0)
+		throw std::invalid_argument("This entity's mesh has no submesh with that material");
+
+	SetSubmeshMaterial((unsigned int)submesh, m);
+}
+Transform* Entity::GetTransform() { return &transform;  }
+unsigned int Entity::GetLod() { return lod; }
+void Entity::SetLod(unsigned int l) { lod = l; }
+
+const MeshBounds& Entity::GetWorldBounds()
+{
+	if (!worldBoundsValid || worldBoundsVersion != transform.GetVersion())
+	{
+		DirectX::XMFLOAT4X4 world = transform.GetWorldMatrix();
+		BoundingVolumes::Transform(&worldBounds, mesh->GetBounds(), DirectX::XMLoadFloat4x4(&world));
+		worldBoundsVersion = transform.GetVersion();
+		worldBoundsValid = true;
+	}
+	return worldBounds;
+}
@@ -3,6 +3,7 @@
 #include "Material.h"
 #include "Transform.h"
 #include <memory>
+#include <vector>
 class Entity
 {
 public:
@@ -10,11 +11,31 @@ public:
 	std::shared_ptr<Mesh> GetMesh();
 	std::shared_ptr<Material> GetMaterial();
 	void SetMaterial(std::shared_ptr<Material> m);
+
+	// Materials for individual submeshes (by index, or by the mesh's
+	// usemtl name). Submeshes without one use the entity's material
+	std::shared_ptr<Material> GetMaterial(unsigned int submesh);
+	void SetSubmeshMaterial(unsigned int submesh, std::shared_ptr<Material> m);
+	void SetSubmeshMaterial(const char* meshMaterial, std::shared_ptr<Material> m);
 	Transform* GetTransform();
 
+	// The mesh LOD drawn last frame, kept for LOD hysteresis
+	unsigned int GetLod();
+	void SetLod(unsigned int lod);
+
+	// The mesh's bounds moved into world space, recomputed
+	// only after the transform has changed
+	const MeshBounds& GetWorldBounds();
+
 private:
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
+	std::vector<std::shared_ptr<Material>> submeshMaterials;
 	Transform transform;
+	unsigned int lod;
+
+	MeshBounds worldBounds;
+	unsigned int worldBoundsVersion;
+	bool worldBoundsValid;
 };
 
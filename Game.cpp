@@ -6,10 +6,17 @@
 #include "PathHelpers.h"
 #include "Window.h"
 #include "Mesh.h"
+#include "MeshRegistry.h"
 #include "Entity.h"
 #include "Camera.h"
+#include "PngDecoder.h"
+#include "TextureCompressor.h"
+#include "DdsFile.h"
 
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <algorithm>
+#include <iterator>
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
@@ -21,6 +28,9 @@ using namespace DirectX;
 std::vector<std::shared_ptr<Entity>> entities;
 std::shared_ptr<Material> wood, onyx, diamond, metal46, metal49;
 std::shared_ptr<Camera> camera;
+MeshRegistry meshes; // Every mesh the game can use, loaded on first use
+std::vector<unsigned int> visibleMeshlets; // Reused every draw to avoid reallocating
+const float MaxLodPixelError = 1.0f; // How far (in pixels) a simplified LOD may stray from the full mesh on screen
 unsigned int lightCount = 0;
 
 float RandomRange(float min, float max) 
@@ -51,7 +61,8 @@ Game::Game()
 // --------------------------------------------------------
 Game::~Game()
 {
-	// Wait for GPU before shut down
+	// Wait for GPU (and any uploads still in flight) before shut down
+	Graphics::FlushUploadBatch();
 	Graphics::WaitForGPU();
 }
 
@@ -229,19 +240,36 @@ void Game::CreateRootSigAndPipelineState()
 // --------------------------------------------------------
 void Game::CreateGeometry()
 {
-	CreateMaterials();
+	// Every texture and mesh below is uploaded together. Textures are ready
+	// once the batch ends, while meshes finish on the copy queue in the
+	// background and are skipped when drawing until they do
+	Graphics::BeginUploadBatch();
 
-	std::shared_ptr<Mesh> cube = std::make_shared<Mesh>("Cube", FixPath("../../Assets/Meshes/cube.obj").c_str());
-	std::shared_ptr<Mesh> cylinder = std::make_shared<Mesh>("Cylinder", FixPath("../../Assets/Meshes/cylinder.obj").c_str());
-	std::shared_ptr<Mesh> helix = std::make_shared<Mesh>("Helix", FixPath("../../Assets/Meshes/helix.obj").c_str());
-	std::shared_ptr<Mesh> plane = std::make_shared<Mesh>("Plane", FixPath("../../Assets/Meshes/quad.obj").c_str());
-	std::shared_ptr<Mesh> quad = std::make_shared<Mesh>("Quad", FixPath("../../Assets/Meshes/quad_double_sided.obj").c_str());
-	std::shared_ptr<Mesh> sphere = std::make_shared<Mesh>("Sphere", FixPath("../../Assets/Meshes/sphere.obj").c_str());
-	std::shared_ptr<Mesh> torus = std::make_shared<Mesh>("Torus", FixPath("../../Assets/Meshes/torus.obj").c_str());
+	CreateMaterials();
 
-	entities.push_back(std::make_shared<Entity>(helix, wood));
-	entities.push_back(std::make_shared<Entity>(sphere, metal46));
-	entities.push_back(std::make_shared<Entity>(torus, onyx));
+	// All of these fit comfortably in 16-bit positions and get half float
+	// UVs where theirs stay within +-2 (the sphere's wrap twice around it,
+	// but the helix's repeat ~20 times along its length, so it keeps full
+	// vertices), are split into meshlets so hidden parts can be skipped,
+	// and get simplified LODs at roughly 50/25/12.5% of their triangles
+	MeshOptions meshOptions = {};
+	meshOptions.compactVertices = true;
+	meshOptions.buildMeshlets = true;
+	meshOptions.lodCount = 3;
+
+	// The primitives are generated rather than parsed from their OBJ files
+	meshes.Register("Cube", ProceduralMesh::Default(ProceduralShape::Cube), meshOptions);
+	meshes.Register("Cylinder", ProceduralMesh::Default(ProceduralShape::Cylinder), meshOptions);
+	meshes.Register("Helix", ProceduralMesh::Default(ProceduralShape::Helix), meshOptions);
+	meshes.Register("Plane", ProceduralMesh::Default(ProceduralShape::Plane), meshOptions);
+	meshes.Register("Quad", ProceduralMesh::Default(ProceduralShape::DoubleSidedPlane), meshOptions);
+	meshes.Register("Sphere", ProceduralMesh::Default(ProceduralShape::Sphere), meshOptions);
+	meshes.Register("Torus", ProceduralMesh::Default(ProceduralShape::Torus), meshOptions);
+
+	// Only the meshes entities actually use get loaded and uploaded
+	entities.push_back(std::make_shared<Entity>(meshes.Get("Helix"), wood));
+	entities.push_back(std::make_shared<Entity>(meshes.Get("Sphere"), metal46));
+	entities.push_back(std::make_shared<Entity>(meshes.Get("Torus"), onyx));
 
 	entities[0]->GetTransform()->SetPosition(0, 0, 0);
 
@@ -249,61 +277,135 @@ void Game::CreateGeometry()
 
 	entities[2]->GetTransform()->SetPosition(3, 0, 0);
 
+	Graphics::EndUploadBatch(false);
+
+#if defined(DEBUG) | defined(_DEBUG)
+	for (const std::string& name : meshes.GetUnreferenced())
+		printf("Mesh %s is loaded but not used by any entity\n", name.c_str());
+#endif
 }
 
 void Game::CreateMaterials() 
 {
-	unsigned int woodAlbedo = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/wood_albedo.png").c_str());
-	unsigned int woodNormal = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/wood_normal.png").c_str());
-	unsigned int woodRoughness = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/wood_roughness.png").c_str());
+	// Each material's textures are <name>_albedo, _normal, _roughness and (for
+	// metals) _metalness PNGs. Roughness and metalness are packed into a single
+	// <name>_orm texture, with no occlusion (and no metalness for non-metals)
+	struct MaterialFiles
+	{
+		const char* name;
+		bool hasMetalness;
+		std::shared_ptr<Material>* material;
+	};
+	const MaterialFiles materialFiles[] = {
+		{ "wood", false, &wood }, { "onyx", false, &onyx }, { "diamond", true, &diamond },
+		{ "metal46", true, &metal46 }, { "metal49", true, &metal49 },
+	};
+
+	// A texture and the PNGs (names without the extension) it's built from. Packed
+	// textures list roughness, then the normal map its mips depend on, then metalness
+	struct TextureBuild
+	{
+		std::string ddsPath;
+		TextureUsage usage;
+		std::vector<std::string> sources;
+		unsigned int index;
+	};
+	auto texturePath = [](const std::string& name, const char* extension) { return FixPath("../../Assets/Textures/" + name + extension); };
+
+	std::vector<TextureBuild> builds;
+	for (const MaterialFiles& files : materialFiles)
+	{
+		std::string name = files.name;
+		builds.push_back({ texturePath(name + "_albedo", ".dds"), TextureUsage::Color, { name + "_albedo" } });
+		builds.push_back({ texturePath(name + "_normal", ".dds"), TextureUsage::NormalMap, { name + "_normal" } });
+		builds.push_back({ texturePath(name + "_orm", ".dds"), TextureUsage::PackedOrm, { name + "_roughness", name + "_normal" } });
+		if (files.hasMetalness)
+			builds.back().sources.push_back(name + "_metalness");
+	}
 
-	unsigned int onyxAlbedo = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/onyx_albedo.png").c_str());
-	unsigned int onyxNormal = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/onyx_normal.png").c_str());
-	unsigned int onyxRoughness = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/onyx_roughness.png").c_str());
-	
-	unsigned int diamondAlbedo = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/diamond_albedo.png").c_str());
-	unsigned int diamondNormal = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/diamond_normal.png").c_str());
-	unsigned int diamondRoughness = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/diamond_roughness.png").c_str());
-	unsigned int diamondMetalness = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/diamond_metalness.png").c_str());
-
-	unsigned int metal46_Albedo = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/metal46_albedo.png").c_str());
-	unsigned int metal46_Normal = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/metal46_normal.png").c_str());
-	unsigned int metal46_Roughness = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/metal46_roughness.png").c_str());
-	unsigned int metal46_Metalness = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/metal46_metalness.png").c_str());
-
-	unsigned int metal49_Albedo = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/metal49_albedo.png").c_str());
-	unsigned int metal49_Normal = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/metal49_normal.png").c_str());
-	unsigned int metal49_Roughness = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/metal49_roughness.png").c_str());
-	unsigned int metal49_Metalness = Graphics::LoadTexture(FixPath(L"../../Assets/Textures/metal49_metalness.png").c_str());
-
-	wood = std::make_shared<Material>(pipelineState, DirectX::XMFLOAT3(1,1,1));
-	wood->SetAlbedoIndex(woodAlbedo);
-	wood->SetNormalMapIndex(woodNormal);
-	wood->SetRoughnessIndex(woodRoughness);
-
-	onyx = std::make_shared<Material>(pipelineState, DirectX::XMFLOAT3(1, 1, 1));
-	onyx->SetAlbedoIndex(onyxAlbedo);
-	onyx->SetNormalMapIndex(onyxNormal);
-	onyx->SetRoughnessIndex(onyxRoughness);
-
-	diamond = std::make_shared<Material>(pipelineState, DirectX::XMFLOAT3(1, 1, 1));
-	diamond->SetAlbedoIndex(diamondAlbedo);
-	diamond->SetNormalMapIndex(diamondNormal);
-	diamond->SetRoughnessIndex(diamondRoughness);
-	diamond->SetMetalnessIndex(diamondMetalness);
-
-	metal46 = std::make_shared<Material>(pipelineState, DirectX::XMFLOAT3(1, 1, 1));
-	metal46->SetAlbedoIndex(metal46_Albedo);
-	metal46->SetNormalMapIndex(metal46_Normal);
-	metal46->SetRoughnessIndex(metal46_Roughness);
-	metal46->SetMetalnessIndex(metal46_Metalness);
-
-	metal49 = std::make_shared<Material>(pipelineState, DirectX::XMFLOAT3(1, 1, 1));
-	metal49->SetAlbedoIndex(metal49_Albedo);
-	metal49->SetNormalMapIndex(metal49_Normal);
-	metal49->SetRoughnessIndex(metal49_Roughness);
-	metal49->SetMetalnessIndex(metal49_Metalness);
+	// Textures are loaded from block compressed .dds files with their mips baked
+	// in. Any that are missing or older than one of their PNGs are rebuilt first -
+	// the PNGs they need are all decoded at once on the thread pool, then each
+	// texture is filtered and compressed in turn (each one spread across the pool
+	// by itself)
+	std::vector<bool> upToDate;
+	std::vector<std::string> decodeNames;
+	for (const TextureBuild& build : builds)
+	{
+		bool fresh = true;
+		for (const std::string& source : build.sources)
+			fresh = fresh && TextureCompressor::IsUpToDate(texturePath(source, ".png").c_str(), build.ddsPath.c_str());
+		upToDate.push_back(fresh);
+		if (!fresh)
+			decodeNames.insert(decodeNames.end(), build.sources.begin(), build.sources.end());
+	}
+	std::sort(decodeNames.begin(), decodeNames.end());
+	decodeNames.erase(std::unique(decodeNames.begin(), decodeNames.end()), decodeNames.end());
+
+	std::vector<std::string> decodePaths;
+	for (const std::string& name : decodeNames)
+		decodePaths.push_back(texturePath(name, ".png"));
+	std::vector<ImageData> images;
+	PngDecoder::LoadAll(decodePaths, images);
+	auto findImage = [&](const std::string& name) -> const ImageData*
+	{
+		auto found = std::lower_bound(decodeNames.begin(), decodeNames.end(), name);
+		return found != decodeNames.end() && *found == name ? &images[found - decodeNames.begin()] : 0;
+	};
 
+	// They all join the upload batch CreateGeometry() opened
+	for (size_t b = 0; b < builds.size(); b++)
+	{
+		TextureBuild& build = builds[b];
+		if (upToDate[b])
+		{
+			build.index = Graphics::LoadTexture(NarrowToWide(build.ddsPath).c_str());
+			continue;
+		}
+
+		std::vector<ImageData> levels;
+		if (build.usage == TextureUsage::PackedOrm)
+		{
+			ImageData packed;
+			const ImageData* metalness = build.sources.size() > 2 ? findImage(build.sources[2]) : 0;
+			TextureCompressor::PackOrm(0, findImage(build.sources[0]), metalness, packed);
+			TextureCompressor::GenerateMips(packed, build.usage, levels, findImage(build.sources[1]));
+		}
+		else
+		{
+			TextureCompressor::GenerateMips(*findImage(build.sources[0]), build.usage, levels);
+		}
+
+		std::vector<std::vector<unsigned char>> mips;
+		TextureCompressionReport report = {};
+		TextureCompressor::Compress(levels, build.usage, mips, &report);
+		if (DdsFile::Write(build.ddsPath.c_str(), report.format, levels[0].width, levels[0].height, mips))
+		{
+#if defined(DEBUG) | defined(_DEBUG)
+			const char* formatNames[] = { "BC1", "BC4", "BC5", "BC7" };
+			printf("Compressed %s to %s: %.2f dB PSNR, %.1f megapixels/s, %zu KB -> %zu KB\n",
+				build.ddsPath.c_str(), formatNames[(int)report.format], report.psnr, report.megapixelsPerSecond,
+				report.uncompressedBytes / 1024, report.compressedBytes / 1024);
+#endif
+			build.index = Graphics::LoadTexture(NarrowToWide(build.ddsPath).c_str());
+		}
+		else
+		{
+			// The .dds is only a cache - if it can't be written, use the mips
+			// uncompressed (the shader only reads X and Y of normals either way)
+			build.index = Graphics::CreateTexture(levels);
+		}
+	}
+
+	// Three textures per material, in the order they were added above
+	for (size_t m = 0; m < std::size(materialFiles); m++)
+	{
+		std::shared_ptr<Material> material = std::make_shared<Material>(pipelineState, DirectX::XMFLOAT3(1, 1, 1));
+		material->SetAlbedoIndex(builds[m * 3].index);
+		material->SetNormalMapIndex(builds[m * 3 + 1].index);
+		material->SetOrmIndex(builds[m * 3 + 2].index);
+		*materialFiles[m].material = material;
+	}
 }
 
 void Game::CreateLights() 
@@ -494,14 +596,28 @@ void Game::Draw(float deltaTime, float totalTime)
 			drawData.psConstAllIndex = Graphics::GetDescriptorIndex(psDataInCBHandle);
 		}
 
+		// The camera's view frustum in world space, for skipping
+		// entities that are entirely off screen
+		BoundingFrustum frustum;
+		{
+			XMFLOAT4X4 proj = camera->GetProj();
+			XMFLOAT4X4 view = camera->GetView();
+			BoundingFrustum::CreateFromMatrix(frustum, XMLoadFloat4x4(&proj));
+			frustum.Transform(frustum, XMMatrixInverse(0, XMLoadFloat4x4(&view)));
+		}
+
+		D3D12_INDEX_BUFFER_VIEW boundIBView = {};
 		for (auto& e : entities) 
 		{
 			std::shared_ptr<Mesh> mesh = e->GetMesh();
 
-			// -- Set Pipeline State --
-			// Each entity may have a different pipeline state -> Set it!
-			// Pipeline state is accessed through an entity's material
-			Graphics::CommandList->SetPipelineState(e->GetMaterial()->GetPipelineState().Get());
+			// Still being copied in on the copy queue - it'll show up in a later frame
+			if (!mesh->IsReady())
+				continue;
+
+			const MeshBounds& worldBounds = e->GetWorldBounds();
+			if (!frustum.Intersects(worldBounds.orientedBox))
+				continue;
 
 			// -- Set VS Constants for this entity -- 
 			{
@@ -510,6 +626,15 @@ void Game::Draw(float deltaTime, float totalTime)
 				vsData.world = e->GetTransform()->GetWorldMatrix();
 				vsData.worldInv = e->GetTransform()->GetWorldInverseTransposeMatrix();
 
+				// Compact vertices are decoded relative to the mesh's bounds
+				XMFLOAT3 boundsMin = mesh->GetBoundsMin();
+				XMFLOAT3 boundsMax = mesh->GetBoundsMax();
+				vsData.boundsMin = boundsMin;
+				vsData.boundsSize = XMFLOAT3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z);
+				vsData.compactVertices = mesh->HasCompactVertices();
+				vsData.splitPositions = mesh->HasSplitPositions();
+				vsData.attributeByteOffset = mesh->GetAttributeByteOffset();
+
 
 				D3D12_GPU_DESCRIPTOR_HANDLE vsDataInCBHandle = Graphics::FillNextConstantBufferAndGetGPUDescriptorHandle(
 					(void*)&vsData, sizeof(VSConstantsEach)
@@ -520,37 +645,117 @@ void Game::Draw(float deltaTime, float totalTime)
 
 			// -- Provide Vertex Buffer Index for this entity--
 			drawData.vsVertexBufferIndex = Graphics::GetDescriptorIndex(mesh->GetVertexBufferGPUDescriptorHandle());
-			
-			{
-				PSConstantsEach psData = {};
-				psData.albedoIndex = e->GetMaterial()->GetAlbedoIndex();
-				psData.normalIndex = e->GetMaterial()->GetNormalMapIndex();
-				psData.roughnessIndex = e->GetMaterial()->GetRoughnessIndex();
-				psData.metalnessIndex = e->GetMaterial()->GetMetalnessIndex();
-				psData.UVOffset = e->GetMaterial()->GetOffset();
-				psData.UVScale = e->GetMaterial()->GetScale();
-				
-				D3D12_GPU_DESCRIPTOR_HANDLE psDataInCBHandle = Graphics::FillNextConstantBufferAndGetGPUDescriptorHandle(
-					(void*)&psData, sizeof(PSConstantsEach)
-				);
-
-				drawData.psConstEachIndex = Graphics::GetDescriptorIndex(psDataInCBHandle);
-			}
+			drawData.vsVertexByteOffset = mesh->GetVertexByteOffset();
 
-			// -- Set the root parameters! --
-			Graphics::CommandList->SetGraphicsRoot32BitConstants(
-				0,
-				sizeof(DrawingIndices) / sizeof(unsigned int),
-				&drawData,
-				0);
-			
 			//No need for vertex buffer view anymore 
 			
+			// Every mesh shares one index buffer, so it only needs
+			// setting again when the index format changes
 			D3D12_INDEX_BUFFER_VIEW ibView = mesh->GetIBView();
-			Graphics::CommandList->IASetIndexBuffer(&ibView);
+			if (ibView.BufferLocation != boundIBView.BufferLocation || ibView.Format != boundIBView.Format)
+			{
+				Graphics::CommandList->IASetIndexBuffer(&ibView);
+				boundIBView = ibView;
+			}
+			UINT firstIndex = mesh->GetFirstIndex();
 			
 
-			Graphics::CommandList->DrawIndexedInstanced((UINT)mesh->GetIndexCount(), 1, 0, 0, 0);
+			// -- Pick a level of detail from the mesh's projected error --
+			if (mesh->GetLodCount() > 1)
+			{
+				XMFLOAT4X4 world = e->GetTransform()->GetWorldMatrix();
+				XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+
+				// Errors scale with the largest axis of the world matrix
+				float maxScale = (std::max)({
+					XMVectorGetX(XMVector3Length(worldMatrix.r[0])),
+					XMVectorGetX(XMVector3Length(worldMatrix.r[1])),
+					XMVectorGetX(XMVector3Length(worldMatrix.r[2])) });
+
+				// Distance to the nearest point of the world space bounding sphere
+				XMFLOAT3 cameraPos = camera->GetPos();
+				float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&worldBounds.sphere.Center), XMLoadFloat3(&cameraPos))));
+				distance = (std::max)(distance - worldBounds.sphere.Radius, 0.01f);
+
+				// Projection's _22 is 1 / tan(fovY / 2)
+				XMFLOAT4X4 proj = camera->GetProj();
+				float pixelsPerUnit = maxScale * proj._22 * 0.5f * Window::Height() / distance;
+				e->SetLod(mesh->SelectLod(pixelsPerUnit, e->GetLod(), MaxLodPixelError));
+			}
+
+			// Only draw the meshlets the camera can see (they're culled once
+			// for the whole mesh, and come back sorted, so submesh by submesh)
+			bool drawMeshlets = e->GetLod() == 0 && mesh->HasMeshlets();
+			const MeshletData& meshlets = mesh->GetMeshlets();
+			if (drawMeshlets)
+			{
+				Meshlets::Cull(visibleMeshlets, meshlets,
+					e->GetTransform()->GetWorldMatrix(), camera->GetView(), camera->GetProj(), camera->GetPos());
+			}
+			size_t m = 0;
+
+			// -- One draw (or one per run of visible meshlets) per submesh --
+			// All of them share the entity's vertex constants, and only
+			// need their own pixel constants when the material changes
+			std::shared_ptr<Material> boundMaterial;
+			for (unsigned int s = 0; s < mesh->GetSubmeshCount(); s++)
+			{
+				const Submesh& submesh = mesh->GetSubmesh(s);
+				if (drawMeshlets && (m == visibleMeshlets.size() || visibleMeshlets[m] >= submesh.firstMeshlet + submesh.meshletCount))
+					continue; // None of this submesh's meshlets are visible
+
+				std::shared_ptr<Material> material = e->GetMaterial(s);
+				if (material != boundMaterial)
+				{
+					// Pipeline state is accessed through the material
+					Graphics::CommandList->SetPipelineState(material->GetPipelineState().Get());
+
+					PSConstantsEach psData = {};
+					psData.albedoIndex = material->GetAlbedoIndex();
+					psData.normalIndex = material->GetNormalMapIndex();
+					psData.ormIndex = material->GetOrmIndex();
+					psData.UVOffset = material->GetOffset();
+					psData.UVScale = material->GetScale();
+
+					D3D12_GPU_DESCRIPTOR_HANDLE psDataInCBHandle = Graphics::FillNextConstantBufferAndGetGPUDescriptorHandle(
+						(void*)&psData, sizeof(PSConstantsEach)
+					);
+
+					drawData.psConstEachIndex = Graphics::GetDescriptorIndex(psDataInCBHandle);
+
+					// -- Set the root parameters! --
+					Graphics::CommandList->SetGraphicsRoot32BitConstants(
+						0,
+						sizeof(DrawingIndices) / sizeof(unsigned int),
+						&drawData,
+						0);
+					boundMaterial = material;
+				}
+
+				if (drawMeshlets)
+				{
+					// Merge runs of neighboring meshlets into a single draw
+					unsigned int submeshEnd = submesh.firstMeshlet + submesh.meshletCount;
+					while (m < visibleMeshlets.size() && visibleMeshlets[m] < submeshEnd)
+					{
+						UINT startIndex = meshlets.meshlets[visibleMeshlets[m]].triangleOffset;
+						UINT count = 0;
+						while (m < visibleMeshlets.size() && visibleMeshlets[m] < submeshEnd &&
+							meshlets.meshlets[visibleMeshlets[m]].triangleOffset == startIndex + count)
+						{
+							count += meshlets.meshlets[visibleMeshlets[m]].triangleCount * 3;
+							m++;
+						}
+
+						Graphics::CommandList->DrawIndexedInstanced(count, 1, firstIndex + startIndex, 0, 0);
+					}
+				}
+				else
+				{
+					MeshLod lod = mesh->GetLod(s, e->GetLod());
+					Graphics::CommandList->DrawIndexedInstanced(lod.indexCount, 1, firstIndex + lod.firstIndex, 0, 0);
+				}
+			}
 		}
 		
 	}
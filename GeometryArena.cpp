@@ -0,0 +1,305 @@
+#include "GeometryArena.h"
+#include "Graphics.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+
+namespace
+{
+	// Starting sizes - enough for every mesh in the demo scene without growing
+	const unsigned int InitialVertexBytes = 16 << 20;
+	const unsigned int InitialIndexBytes = 8 << 20;
+
+	const unsigned int WordSize = 4;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(D3D12_HEAP_TYPE heapType, UINT64 size, D3D12_RESOURCE_STATES state)
+	{
+		D3D12_HEAP_PROPERTIES props = {};
+		props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		props.CreationNodeMask = 1;
+		props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		props.Type = heapType;
+		props.VisibleNodeMask = 1;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.DepthOrArraySize = 1;
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.Height = 1;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.MipLevels = 1;
+		desc.SampleDesc.Count = 1;
+		desc.Width = size;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+		HRESULT hr = Graphics::Device->CreateCommittedResource(
+			&props, D3D12_HEAP_FLAG_NONE, &desc, state, 0, IID_PPV_ARGS(buffer.GetAddressOf()));
+		if (FAILED(hr))
+			throw std::runtime_error("Could not create a geometry arena buffer");
+		return buffer;
+	}
+
+	// --------------------------------------------------------
+	// A temporary allocator and list for rebuilds, so arena
+	// work doesn't disturb the frame's list
+	// --------------------------------------------------------
+	struct LocalCommandList
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> list;
+
+		LocalCommandList()
+		{
+			Graphics::Device->CreateCommandAllocator(
+				D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(allocator.GetAddressOf()));
+			Graphics::Device->CreateCommandList(
+				0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), 0, IID_PPV_ARGS(list.GetAddressOf()));
+		}
+
+		void ExecuteAndWait()
+		{
+			list->Close();
+			ID3D12CommandList* lists[] = { list.Get() };
+			Graphics::CommandQueue->ExecuteCommandLists(1, lists);
+			Graphics::WaitForGPU();
+		}
+	};
+}
+
+std::shared_ptr<GeometryArena> GeometryArena::Shared()
+{
+	static std::shared_ptr<GeometryArena> arena = std::make_shared<GeometryArena>(InitialVertexBytes, InitialIndexBytes);
+	return arena;
+}
+
+GeometryArena::GeometryArena(unsigned int vertexBytes, unsigned int indexBytes) :
+	vertexSRVCPUHandle{},
+	vertexSRVGPUHandle{}
+{
+	// Both buffers stay in the common state for good, so the copy queue can write
+	// them - reads on the direct queue promote them, and they decay back after
+	vertices.ranges.Grow(vertexBytes / WordSize);
+	vertices.buffer = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, vertices.ranges.GetCapacity() * (UINT64)WordSize, D3D12_RESOURCE_STATE_COMMON);
+	indices.ranges.Grow(indexBytes / WordSize);
+	indices.buffer = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, indices.ranges.GetCapacity() * (UINT64)WordSize, D3D12_RESOURCE_STATE_COMMON);
+
+	// Compaction rewrites the descriptor in place; growth moves to a new one
+	Graphics::ReserveDescriptorHeapSlot(&vertexSRVCPUHandle, &vertexSRVGPUHandle);
+	CreateVertexBufferView();
+}
+
+GeometryArena::Allocation GeometryArena::AllocateVertices(const void* data, size_t stride, size_t count)
+{
+	if (stride % WordSize != 0)
+		throw std::invalid_argument("Vertex strides must be a multiple of 4 bytes");
+	return Upload(vertices, false, data, stride * count, 0);
+}
+
+GeometryArena::Allocation GeometryArena::AllocateIndices(const void* data, size_t indexSize, size_t count)
+{
+	if (indexSize != 2 && indexSize != 4)
+		throw std::invalid_argument("Indices must be 16 or 32-bit");
+	return Upload(indices, true, data, indexSize * count, (unsigned int)indexSize);
+}
+
+void GeometryArena::Free(Allocation allocation)
+{
+	Record& record = Find(allocation);
+	(record.indices ? indices : vertices).ranges.Free(record.offset);
+	record.inUse = false;
+	freeRecords.push_back(allocation);
+}
+
+void GeometryArena::Compact()
+{
+	Rebuild(vertices, false, vertices.ranges.GetCapacity());
+	Rebuild(indices, true, indices.ranges.GetCapacity());
+}
+
+unsigned int GeometryArena::GetVertexByteOffset(Allocation allocation) { return Find(allocation).offset * WordSize; }
+unsigned int GeometryArena::GetFirstIndex(Allocation allocation)
+{
+	Record& record = Find(allocation);
+	return record.offset * WordSize / record.indexSize;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> GeometryArena::GetVertexBuffer() { return vertices.buffer; }
+Microsoft::WRL::ComPtr<ID3D12Resource> GeometryArena::GetIndexBuffer() { return indices.buffer; }
+D3D12_GPU_DESCRIPTOR_HANDLE GeometryArena::GetVertexBufferGPUDescriptorHandle() { return vertexSRVGPUHandle; }
+
+D3D12_INDEX_BUFFER_VIEW GeometryArena::GetIndexBufferView(DXGI_FORMAT format)
+{
+	D3D12_INDEX_BUFFER_VIEW view = {};
+	view.BufferLocation = indices.buffer->GetGPUVirtualAddress();
+	view.SizeInBytes = indices.ranges.GetCapacity() * WordSize;
+	view.Format = format;
+	return view;
+}
+
+// --------------------------------------------------------
+// Reserves a range and copies data into it through the
+// staging ring (part of the current upload batch, if any)
+// --------------------------------------------------------
+GeometryArena::Allocation GeometryArena::Upload(Region& region, bool isIndices, const void* data, size_t bytes, unsigned int indexSize)
+{
+	if (bytes == 0)
+		throw std::invalid_argument("Geometry allocations can't be empty");
+
+	// Rounded up to whole words (an odd number of 16-bit indices)
+	unsigned int words = (unsigned int)((bytes + WordSize - 1) / WordSize);
+	unsigned int offset = Reserve(region, words);
+
+	Graphics::UploadBuffer(region.buffer.Get(), offset * (UINT64)WordSize, data, bytes);
+
+	Allocation allocation;
+	if (!freeRecords.empty())
+	{
+		allocation = freeRecords.back();
+		freeRecords.pop_back();
+	}
+	else
+	{
+		allocation = (Allocation)records.size();
+		records.push_back({});
+	}
+	records[allocation] = { true, isIndices, offset, indexSize };
+	return allocation;
+}
+
+// --------------------------------------------------------
+// Finds room for a range, growing the region when there's
+// none. Fragmented free space isn't compacted here, since
+// that moves ranges draws may already have been recorded
+// with - see Compact()
+// --------------------------------------------------------
+unsigned int GeometryArena::Reserve(Region& region, unsigned int words)
+{
+	unsigned int offset = region.ranges.Allocate(words);
+	if (offset != RangeAllocator::InvalidOffset)
+		return offset;
+
+	unsigned int capacity = region.ranges.GetCapacity();
+	unsigned long long grown = (std::max)((unsigned long long)capacity * 2, (unsigned long long)capacity + words);
+	// Index buffer views measure their size in a UINT
+	if (grown * WordSize > UINT_MAX)
+		throw std::runtime_error("Geometry arena is out of memory");
+
+	Grow(region, &region == &indices, (unsigned int)grown);
+	return region.ranges.Allocate(words);
+}
+
+// --------------------------------------------------------
+// Moves a region into a bigger buffer, keeping every range
+// at its offset, without waiting for anything: the copy runs
+// on the copy queue and the direct queue waits for it on the
+// GPU, while draws recorded before this (and frames still in
+// flight) keep using the old buffer and descriptor until
+// they're done with them
+// --------------------------------------------------------
+void GeometryArena::Grow(Region& region, bool isIndices, unsigned int capacity)
+{
+#if defined(DEBUG) | defined(_DEBUG)
+	printf("Growing %s arena: %u of %u bytes used, %u bytes after\n", isIndices ? "index" : "vertex",
+		region.ranges.GetUsed() * WordSize, region.ranges.GetCapacity() * WordSize, capacity * WordSize);
+#endif
+
+	std::vector<Graphics::BufferCopy> copies;
+	for (const Record& record : records)
+	{
+		if (!record.inUse || record.indices != isIndices)
+			continue;
+		UINT64 offset = record.offset * (UINT64)WordSize;
+		copies.push_back({ offset, offset, region.ranges.GetSize(record.offset) * (UINT64)WordSize });
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> oldBuffer = region.buffer;
+	region.ranges.Grow(capacity);
+	region.buffer = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, capacity * (UINT64)WordSize, D3D12_RESOURCE_STATE_COMMON);
+
+	// Meshes that are already drawable don't check a ticket again, so
+	// nothing may read the new buffer until it's filled in
+	UploadTicket ticket = Graphics::CopyBufferRegions(region.buffer.Get(), oldBuffer.Get(), copies);
+	Graphics::WaitForUploadOnDirectQueue(ticket);
+	Graphics::ReleaseAfterFrame(oldBuffer);
+
+	// The old descriptor may still be read by frames in flight, so the new
+	// buffer gets a slot of its own (growth doubles, so there are few of these)
+	if (!isIndices)
+	{
+		Graphics::ReserveDescriptorHeapSlot(&vertexSRVCPUHandle, &vertexSRVGPUHandle);
+		CreateVertexBufferView();
+	}
+}
+
+// --------------------------------------------------------
+// Copies every live range of a region into a new buffer of
+// the given capacity, packed to the front. Waits for the GPU
+// and rewrites the descriptor in place, so it's only safe
+// between frames
+// --------------------------------------------------------
+void GeometryArena::Rebuild(Region& region, bool isIndices, unsigned int capacity)
+{
+#if defined(DEBUG) | defined(_DEBUG)
+	printf("Rebuilding %s arena: %u of %u bytes used, %u bytes after\n", isIndices ? "index" : "vertex",
+		region.ranges.GetUsed() * WordSize, region.ranges.GetCapacity() * WordSize, capacity * WordSize);
+#endif
+
+	// Uploads into the old buffer (batched or still on the copy queue) have to land
+	// before it's copied, and nothing may still be reading it or the descriptor
+	// we're about to rewrite
+	Graphics::FlushUploadBatch();
+	Graphics::WaitForGPU();
+
+	region.ranges.Grow(capacity);
+	std::vector<RangeMove> moves = region.ranges.Compact();
+	std::map<unsigned int, unsigned int> moved;
+	for (const RangeMove& move : moves)
+		moved.emplace(move.from, move.to);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> oldBuffer = region.buffer;
+	region.buffer = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, capacity * (UINT64)WordSize, D3D12_RESOURCE_STATE_COMMON);
+
+	LocalCommandList local;
+	for (Record& record : records)
+	{
+		if (!record.inUse || record.indices != isIndices)
+			continue;
+
+		unsigned int from = record.offset;
+		auto move = moved.find(from);
+		if (move != moved.end())
+			record.offset = move->second;
+
+		UINT64 size = region.ranges.GetSize(record.offset) * (UINT64)WordSize;
+		local.list->CopyBufferRegion(region.buffer.Get(), record.offset * (UINT64)WordSize, oldBuffer.Get(), from * (UINT64)WordSize, size);
+	}
+
+	// Copies implicitly promote the new buffer from common to copy dest,
+	// and it decays back to common once they're done
+	local.ExecuteAndWait();
+
+	if (!isIndices)
+		CreateVertexBufferView();
+}
+
+void GeometryArena::CreateVertexBufferView()
+{
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_R32_TYPELESS; // Raw buffers are viewed as 32-bit words
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = vertices.ranges.GetCapacity();
+	srvDesc.Buffer.StructureByteStride = 0;
+	srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
+	Graphics::Device->CreateShaderResourceView(vertices.buffer.Get(), &srvDesc, vertexSRVCPUHandle);
+}
+
+GeometryArena::Record& GeometryArena::Find(Allocation allocation)
+{
+	if (allocation >= records.size() || !records[allocation].inUse)
+		throw std::invalid_argument("Unknown geometry allocation");
+	return records[allocation];
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include "RangeAllocator.h"
+
+/*
+* Every mesh's vertices and indices, sub-allocated from one vertex buffer and one index buffer.
+*
+* Draws all bind the same two buffers, so there's one vertex buffer SRV in the descriptor heap
+* instead of one per mesh. The vertex buffer is raw (a ByteAddressBuffer in HLSL) since meshes
+* mix Vertex and CompactVertex layouts; shaders read a mesh's vertices from its byte offset.
+* The index buffer holds both 16 and 32-bit indices - each mesh binds it with its own format,
+* and since ranges are 4-byte aligned every offset is a whole number of either size.
+*
+* Ranges are managed by a RangeAllocator (in 4-byte words). When one doesn't fit, the buffer is
+* grown: live ranges are copied into a bigger buffer at the same offsets on the copy queue, the
+* direct queue waits for that on the GPU, and the old buffer is only released once the frame
+* being recorded is done with it - so meshes can be created mid-frame without stalling or
+* disturbing draws already recorded. Fragmented free space is only packed by Compact(), which
+* moves ranges and waits for the GPU, so call it between frames (before recording any draws).
+* Meshes keep an Allocation handle and look up their offsets, buffers and descriptor when drawing.
+* Uploads join the current upload batch (see Graphics::BeginUploadBatch()) on the copy queue, so
+* a range can't be drawn until the batch's ticket completes; outside of a batch they wait for it.
+*
+* Shared(): The arena meshes use. Meshes hold on to it, so it outlives them
+* AllocateVertices() / AllocateIndices(): Uploads data into a new range
+* Free(): Releases a range (its contents stay valid for work already submitted)
+* Compact(): Packs both buffers, leaving all their free space in one range at the end. Between frames only
+* GetVertexByteOffset(): Where an allocation's first vertex starts in the vertex buffer
+* GetFirstIndex(): The StartIndexLocation of an allocation's first index
+* GetVertexBufferGPUDescriptorHandle(): Raw SRV of the whole vertex buffer (a new one after growing)
+* GetIndexBufferView(): The whole index buffer, read as 16 or 32-bit indices
+*/
+class GeometryArena
+{
+public:
+	typedef unsigned int Allocation;
+
+	static std::shared_ptr<GeometryArena> Shared();
+
+	GeometryArena(unsigned int vertexBytes, unsigned int indexBytes);
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	Allocation AllocateVertices(const void* data, size_t stride, size_t count);
+	Allocation AllocateIndices(const void* data, size_t indexSize, size_t count);
+	void Free(Allocation allocation);
+	void Compact();
+
+	unsigned int GetVertexByteOffset(Allocation allocation);
+	unsigned int GetFirstIndex(Allocation allocation);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> GetVertexBuffer();
+	Microsoft::WRL::ComPtr<ID3D12Resource> GetIndexBuffer();
+	D3D12_GPU_DESCRIPTOR_HANDLE GetVertexBufferGPUDescriptorHandle();
+	D3D12_INDEX_BUFFER_VIEW GetIndexBufferView(DXGI_FORMAT format);
+
+private:
+	struct Region
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+		RangeAllocator ranges;	// In 4-byte words
+	};
+
+	struct Record
+	{
+		bool inUse;
+		bool indices;			// Which region it's in
+		unsigned int offset;	// In words
+		unsigned int indexSize;
+	};
+
+	Allocation Upload(Region& region, bool indices, const void* data, size_t bytes, unsigned int indexSize);
+	unsigned int Reserve(Region& region, unsigned int words);
+	void Grow(Region& region, bool indices, unsigned int capacity);
+	void Rebuild(Region& region, bool indices, unsigned int capacity);
+	void CreateVertexBufferView();
+	Record& Find(Allocation allocation);
+
+	Region vertices;
+	Region indices;
+
+	std::vector<Record> records;
+	std::vector<Allocation> freeRecords;
+
+	D3D12_CPU_DESCRIPTOR_HANDLE vertexSRVCPUHandle;
+	D3D12_GPU_DESCRIPTOR_HANDLE vertexSRVGPUHandle;
+};
@@ -0,0 +1,640 @@
+#include "GlbLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+	const unsigned int GlbMagic = 0x46546C67;		// "glTF"
+	const unsigned int JsonChunkType = 0x4E4F534A;	// "JSON"
+	const unsigned int BinChunkType = 0x004E4942;	// "BIN\0"
+
+	// glTF accessor component types
+	const int ComponentByte = 5120;
+	const int ComponentUnsignedByte = 5121;
+	const int ComponentShort = 5122;
+	const int ComponentUnsignedShort = 5123;
+	const int ComponentUnsignedInt = 5125;
+	const int ComponentFloat = 5126;
+
+	const int TriangleMode = 4;
+
+	// glTF's limit on bufferView.byteStride (which also has to be a multiple of 4)
+	const size_t MaxByteStride = 252;
+
+	// --------------------------------------------------------
+	// Just enough JSON for a glTF document
+	// --------------------------------------------------------
+	struct JsonValue
+	{
+		enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+		bool boolean = false;
+		double number = 0;
+		std::string string;
+		std::vector<JsonValue> array;
+		std::vector<std::pair<std::string, JsonValue>> object;
+
+		const JsonValue* Find(const char* key) const
+		{
+			for (auto& [name, value] : object)
+				if (name == key)
+					return &value;
+			return 0;
+		}
+
+		// Member as a number, or a fallback when it's missing
+		double NumberOr(const char* key, double fallback) const
+		{
+			const JsonValue* value = Find(key);
+			return value && value->type == Number ? value->number : fallback;
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* text, size_t length) : p(text), end(text + length) {}
+
+		JsonValue ParseDocument()
+		{
+			JsonValue value = ParseValue(0);
+			SkipWhitespace();
+			if (p != end && *p != '\0')
+				Fail();
+			return value;
+		}
+
+	private:
+		// Deeper than any real glTF document, shallow enough to never overflow the stack
+		static const int MaxDepth = 64;
+
+		const char* p;
+		const char* end;
+
+		[[noreturn]] void Fail() { throw std::runtime_error("Error reading GLB: malformed JSON chunk"); }
+
+		void SkipWhitespace()
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+				p++;
+		}
+
+		void Expect(char c)
+		{
+			SkipWhitespace();
+			if (p == end || *p != c)
+				Fail();
+			p++;
+		}
+
+		bool Consume(const char* word)
+		{
+			size_t length = strlen(word);
+			if ((size_t)(end - p) < length || memcmp(p, word, length) != 0)
+				return false;
+			p += length;
+			return true;
+		}
+
+		JsonValue ParseValue(int depth)
+		{
+			if (depth > MaxDepth)
+				Fail();
+
+			SkipWhitespace();
+			if (p == end)
+				Fail();
+
+			JsonValue value;
+			if (*p == '{')
+			{
+				value.type = JsonValue::Object;
+				p++;
+				SkipWhitespace();
+				if (p < end && *p == '}')
+				{
+					p++;
+					return value;
+				}
+				for (;;)
+				{
+					SkipWhitespace();
+					std::string key = ParseString();
+					Expect(':');
+					value.object.emplace_back(std::move(key), ParseValue(depth + 1));
+					SkipWhitespace();
+					if (p == end || *p != ',')
+						break;
+					p++;
+				}
+				Expect('}');
+			}
+			else if (*p == '[')
+			{
+				value.type = JsonValue::Array;
+				p++;
+				SkipWhitespace();
+				if (p < end && *p == ']')
+				{
+					p++;
+					return value;
+				}
+				for (;;)
+				{
+					value.array.push_back(ParseValue(depth + 1));
+					SkipWhitespace();
+					if (p == end || *p != ',')
+						break;
+					p++;
+				}
+				Expect(']');
+			}
+			else if (*p == '"')
+			{
+				value.type = JsonValue::String;
+				value.string = ParseString();
+			}
+			else if (Consume("true"))
+			{
+				value.type = JsonValue::Bool;
+				value.boolean = true;
+			}
+			else if (Consume("false"))
+			{
+				value.type = JsonValue::Bool;
+			}
+			else if (Consume("null"))
+			{
+				value.type = JsonValue::Null;
+			}
+			else
+			{
+				value.type = JsonValue::Number;
+				value.number = ParseNumber();
+			}
+			return value;
+		}
+
+		std::string ParseString()
+		{
+			if (p == end || *p != '"')
+				Fail();
+			p++;
+
+			std::string result;
+			while (p < end && *p != '"')
+			{
+				if (*p != '\\')
+				{
+					result += *p++;
+					continue;
+				}
+
+				if (++p == end)
+					Fail();
+				char escaped = *p++;
+				switch (escaped)
+				{
+				case 'b': result += '\b'; break;
+				case 'f': result += '\f'; break;
+				case 'n': result += '\n'; break;
+				case 'r': result += '\r'; break;
+				case 't': result += '\t'; break;
+				case 'u':
+				{
+					if (end - p < 4)
+						Fail();
+					unsigned int code = 0;
+					for (int h = 0; h < 4; h++, p++)
+					{
+						char c = *p;
+						code <<= 4;
+						if (c >= '0' && c <= '9') code |= c - '0';
+						else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+						else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+						else Fail();
+					}
+
+					// UTF-8 encode (surrogate pairs stay as two separate code points - names are all we read)
+					if (code < 0x80)
+						result += (char)code;
+					else if (code < 0x800)
+					{
+						result += (char)(0xC0 | (code >> 6));
+						result += (char)(0x80 | (code & 0x3F));
+					}
+					else
+					{
+						result += (char)(0xE0 | (code >> 12));
+						result += (char)(0x80 | ((code >> 6) & 0x3F));
+						result += (char)(0x80 | (code & 0x3F));
+					}
+					break;
+				}
+				default: result += escaped; break; // \" \\ and \/
+				}
+			}
+
+			if (p == end)
+				Fail();
+			p++;
+			return result;
+		}
+
+		double ParseNumber()
+		{
+			// strtod needs a terminator, so copy the (short) number out first
+			char buffer[64];
+			size_t length = 0;
+			while (p < end && length < sizeof(buffer) - 1 && *p != '\0' && strchr("+-0123456789.eE", *p))
+				buffer[length++] = *p++;
+			buffer[length] = '\0';
+
+			char* parsedEnd = 0;
+			double number = strtod(buffer, &parsedEnd);
+			if (length == 0 || parsedEnd != buffer + length)
+				Fail();
+			return number;
+		}
+	};
+
+	// --------------------------------------------------------
+	// Where an accessor's elements are in the mapped file
+	// --------------------------------------------------------
+	struct AccessorView
+	{
+		const unsigned char* data;
+		size_t stride;
+		size_t count;
+		int componentType;
+		bool normalized;
+	};
+
+	size_t ComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case ComponentByte: case ComponentUnsignedByte: return 1;
+		case ComponentShort: case ComponentUnsignedShort: return 2;
+		case ComponentUnsignedInt: case ComponentFloat: return 4;
+		default: throw std::runtime_error("Error reading GLB: unknown accessor component type");
+		}
+	}
+
+	size_t ComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		throw std::runtime_error("Error reading GLB: unsupported accessor type");
+	}
+
+	// --------------------------------------------------------
+	// A member that has to be a whole number in [0, limit], or
+	// a fallback when it's missing - checked before converting,
+	// since negative, fractional or huge doubles don't convert
+	// to integers safely
+	// --------------------------------------------------------
+	size_t ReadSize(const JsonValue& object, const char* key, size_t fallback, size_t limit)
+	{
+		const JsonValue* value = object.Find(key);
+		if (!value)
+			return fallback;
+		if (value->type != JsonValue::Number || !(value->number >= 0 && value->number <= (double)limit) || value->number != std::floor(value->number))
+			throw std::runtime_error("Error reading GLB: invalid number in the JSON chunk");
+		return (size_t)value->number;
+	}
+
+	const JsonValue& Element(const JsonValue& document, const char* arrayName, double index)
+	{
+		const JsonValue* array = document.Find(arrayName);
+		if (!array || array->type != JsonValue::Array || !(index >= 0 && index < array->array.size()) || index != std::floor(index))
+			throw std::runtime_error("Error reading GLB: reference to a missing element");
+		return array->array[(size_t)index];
+	}
+
+	// --------------------------------------------------------
+	// Resolves an accessor to the bytes it covers in the BIN
+	// chunk, checking that all of them are in range
+	// --------------------------------------------------------
+	AccessorView GetAccessor(const JsonValue& document, double accessorIndex, size_t minComponents, size_t maxComponents,
+		const unsigned char* bin, size_t binSize)
+	{
+		const JsonValue& accessor = Element(document, "accessors", accessorIndex);
+		if (accessor.Find("sparse"))
+			throw std::runtime_error("Error reading GLB: sparse accessors are not supported");
+
+		const JsonValue* type = accessor.Find("type");
+		size_t components = ComponentCount(type ? type->string : "");
+		if (components < minComponents || components > maxComponents)
+			throw std::runtime_error("Error reading GLB: accessor has the wrong number of components");
+
+		// Nothing can be bigger than the BIN chunk, so in-range numbers can't overflow below
+		AccessorView view = {};
+		view.componentType = (int)ReadSize(accessor, "componentType", 0, INT_MAX);
+		view.count = ReadSize(accessor, "count", 0, binSize);
+		const JsonValue* normalized = accessor.Find("normalized");
+		view.normalized = normalized && normalized->boolean;
+
+		size_t elementSize = ComponentSize(view.componentType) * components;
+		const JsonValue* bufferViewIndex = accessor.Find("bufferView");
+		if (!bufferViewIndex)
+			throw std::runtime_error("Error reading GLB: accessors without buffer views are not supported");
+
+		const JsonValue& bufferView = Element(document, "bufferViews", bufferViewIndex->number);
+		if (bufferView.NumberOr("buffer", 0) != 0 || !bin)
+			throw std::runtime_error("Error reading GLB: only the embedded binary buffer is supported");
+
+		size_t viewOffset = ReadSize(bufferView, "byteOffset", 0, binSize);
+		size_t viewLength = ReadSize(bufferView, "byteLength", 0, binSize);
+		view.stride = ReadSize(bufferView, "byteStride", 0, MaxByteStride);
+		if (view.stride % 4 != 0 || (view.stride > 0 && view.stride < elementSize))
+			throw std::runtime_error("Error reading GLB: invalid buffer view stride");
+		if (view.stride == 0)
+			view.stride = elementSize;
+
+		// The last element has to end inside the view, worked out without
+		// multiplying anything that could wrap
+		size_t offset = ReadSize(accessor, "byteOffset", 0, binSize);
+		if (viewLength > binSize - viewOffset || offset > viewLength)
+			throw std::runtime_error("Error reading GLB: accessor reaches outside its buffer");
+		if (view.count > 0 && (elementSize > viewLength - offset || view.count - 1 > (viewLength - offset - elementSize) / view.stride))
+			throw std::runtime_error("Error reading GLB: accessor reaches outside its buffer");
+
+		view.data = bin + viewOffset + offset;
+		return view;
+	}
+
+	// --------------------------------------------------------
+	// Reads one component as a float, applying normalization
+	// for integer types (memcpy, since glTF data may be unaligned)
+	// --------------------------------------------------------
+	float ReadFloat(const AccessorView& view, size_t element, size_t component)
+	{
+		const unsigned char* p = view.data + element * view.stride + component * ComponentSize(view.componentType);
+		switch (view.componentType)
+		{
+		case ComponentFloat: { float f; memcpy(&f, p, 4); return f; }
+		case ComponentUnsignedByte: return view.normalized ? *p / 255.0f : *p;
+		case ComponentByte: { signed char b = (signed char)*p; return view.normalized ? (std::max)(b / 127.0f, -1.0f) : b; }
+		case ComponentUnsignedShort: { unsigned short s; memcpy(&s, p, 2); return view.normalized ? s / 65535.0f : s; }
+		case ComponentShort: { short s; memcpy(&s, p, 2); return view.normalized ? (std::max)(s / 32767.0f, -1.0f) : s; }
+		default: { unsigned int u; memcpy(&u, p, 4); return (float)u; }
+		}
+	}
+
+	unsigned int ReadIndex(const AccessorView& view, size_t element)
+	{
+		const unsigned char* p = view.data + element * view.stride;
+		switch (view.componentType)
+		{
+		case ComponentUnsignedByte: return *p;
+		case ComponentUnsignedShort: { unsigned short s; memcpy(&s, p, 2); return s; }
+		case ComponentUnsignedInt: { unsigned int u; memcpy(&u, p, 4); return u; }
+		default: throw std::runtime_error("Error reading GLB: indices must be unsigned integers");
+		}
+	}
+
+	XMFLOAT3 ReadFloat3(const AccessorView& view, size_t element)
+	{
+		// Fast path for the overwhelmingly common tightly packed floats
+		if (view.componentType == ComponentFloat)
+		{
+			XMFLOAT3 f;
+			memcpy(&f, view.data + element * view.stride, sizeof(f));
+			return f;
+		}
+		return XMFLOAT3(ReadFloat(view, element, 0), ReadFloat(view, element, 1), ReadFloat(view, element, 2));
+	}
+
+	// --------------------------------------------------------
+	// Area weighted vertex normals, for primitives without any
+	// (indices are already in DirectX winding order)
+	// --------------------------------------------------------
+	void GenerateNormals(MeshData& data)
+	{
+		std::vector<XMFLOAT3> sums(data.vertices.size(), XMFLOAT3(0, 0, 0));
+		for (size_t t = 0; t + 2 < data.indices.size(); t += 3)
+		{
+			unsigned int corners[3] = { data.indices[t], data.indices[t + 1], data.indices[t + 2] };
+			XMVECTOR p0 = XMLoadFloat3(&data.vertices[corners[0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&data.vertices[corners[1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&data.vertices[corners[2]].Position);
+			XMVECTOR faceNormal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			for (unsigned int corner : corners)
+				XMStoreFloat3(&sums[corner], XMVectorAdd(XMLoadFloat3(&sums[corner]), faceNormal));
+		}
+
+		for (size_t v = 0; v < data.vertices.size(); v++)
+		{
+			XMVECTOR sum = XMLoadFloat3(&sums[v]);
+			if (XMVectorGetX(XMVector3LengthSq(sum)) > 0.0f)
+				XMStoreFloat3(&data.vertices[v].Normal, XMVector3Normalize(sum));
+			else
+				data.vertices[v].Normal = XMFLOAT3(0, 1, 0);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Converts one primitive into welded DirectX-space geometry
+	// --------------------------------------------------------
+	bool LoadPrimitive(const JsonValue& document, const JsonValue& primitive, const unsigned char* bin, size_t binSize, GlbPrimitive& out)
+	{
+		if (primitive.NumberOr("mode", TriangleMode) != TriangleMode)
+			return false;
+
+		const JsonValue* attributes = primitive.Find("attributes");
+		const JsonValue* position = attributes ? attributes->Find("POSITION") : 0;
+		if (!position)
+			return false;
+
+		AccessorView positions = GetAccessor(document, position->number, 3, 3, bin, binSize);
+		size_t vertexCount = positions.count;
+
+		// Optional attributes must cover every vertex
+		auto optional = [&](const char* name, size_t minComponents, size_t maxComponents, AccessorView* view)
+		{
+			const JsonValue* index = attributes->Find(name);
+			if (!index)
+				return false;
+			*view = GetAccessor(document, index->number, minComponents, maxComponents, bin, binSize);
+			if (view->count != vertexCount)
+				throw std::runtime_error("Error reading GLB: attribute counts don't match");
+			return true;
+		};
+
+		AccessorView normals = {}, tangents = {}, uvs = {};
+		bool hasNormals = optional("NORMAL", 3, 3, &normals);
+		bool hasTangents = optional("TANGENT", 4, 4, &tangents);
+		bool hasUVs = optional("TEXCOORD_0", 2, 2, &uvs);
+
+		// Everything is read straight from the mapped file into the final vertices
+		// - Z is negated to go from right to left-handed
+		out.data.vertices.resize(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			Vertex& vertex = out.data.vertices[v];
+			vertex.Position = ReadFloat3(positions, v);
+			vertex.Position.z = -vertex.Position.z;
+
+			if (hasNormals)
+			{
+				vertex.Normal = ReadFloat3(normals, v);
+				vertex.Normal.z = -vertex.Normal.z;
+			}
+
+			// The handedness in w isn't stored (Vertex has no room for it) - it's
+			// the same convention CalculateTangents() produces
+			if (hasTangents)
+			{
+				vertex.Tangent = ReadFloat3(tangents, v);
+				vertex.Tangent.z = -vertex.Tangent.z;
+			}
+			else
+			{
+				vertex.Tangent = XMFLOAT3(0, 0, 0);
+			}
+
+			vertex.UV = hasUVs ? XMFLOAT2(ReadFloat(uvs, v, 0), ReadFloat(uvs, v, 1)) : XMFLOAT2(0, 0);
+		}
+
+		// Indices, flipping each triangle's winding order for the handedness change
+		const JsonValue* indicesIndex = primitive.Find("indices");
+		if (indicesIndex)
+		{
+			AccessorView indices = GetAccessor(document, indicesIndex->number, 1, 1, bin, binSize);
+			size_t indexCount = indices.count - indices.count % 3;
+			out.data.indices.resize(indexCount);
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				out.data.indices[i] = ReadIndex(indices, i);
+				out.data.indices[i + 1] = ReadIndex(indices, i + 2);
+				out.data.indices[i + 2] = ReadIndex(indices, i + 1);
+			}
+		}
+		else
+		{
+			size_t indexCount = vertexCount - vertexCount % 3;
+			out.data.indices.resize(indexCount);
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				out.data.indices[i] = (unsigned int)i;
+				out.data.indices[i + 1] = (unsigned int)i + 2;
+				out.data.indices[i + 2] = (unsigned int)i + 1;
+			}
+		}
+
+		for (unsigned int index : out.data.indices)
+			if (index >= vertexCount)
+				throw std::runtime_error("Error reading GLB: index out of range");
+
+		if (out.data.indices.empty())
+			return false;
+
+		if (!hasNormals)
+			GenerateNormals(out.data);
+
+		out.hasTangents = hasTangents;
+		out.material = primitive.Find("material") ? (int)ReadSize(primitive, "material", 0, INT_MAX) : -1;
+		return true;
+	}
+}
+
+// --------------------------------------------------------
+// Reads every triangle primitive of every mesh in a .glb
+// - Primitives are named after their mesh, with "/<index>"
+//   appended when a mesh has more than one
+// --------------------------------------------------------
+void GlbLoader::Load(const char* glbFilePath, std::vector<GlbPrimitive>& out)
+{
+	MappedFile file(glbFilePath);
+	if (!file.IsOpen())
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	const unsigned char* bytes = (const unsigned char*)file.GetData();
+	size_t size = file.GetSize();
+
+	// 12 byte header, then chunks of (length, type, data) padded to 4 bytes
+	unsigned int header[3] = {};
+	if (size >= sizeof(header))
+		memcpy(header, bytes, sizeof(header));
+	if (header[0] != GlbMagic || header[1] != 2)
+		throw std::invalid_argument("Error reading GLB: not a glTF 2.0 binary file");
+
+	const char* json = 0;
+	size_t jsonSize = 0;
+	const unsigned char* bin = 0;
+	size_t binSize = 0;
+	for (size_t offset = sizeof(header); offset + 8 <= size;)
+	{
+		unsigned int chunk[2];
+		memcpy(chunk, bytes + offset, sizeof(chunk));
+		offset += sizeof(chunk);
+		if (chunk[0] > size - offset)
+			throw std::runtime_error("Error reading GLB: chunk runs past the end of the file");
+
+		if (chunk[1] == JsonChunkType && !json)
+		{
+			json = (const char*)bytes + offset;
+			jsonSize = chunk[0];
+		}
+		else if (chunk[1] == BinChunkType && !bin)
+		{
+			bin = bytes + offset;
+			binSize = chunk[0];
+		}
+		offset += (chunk[0] + 3) & ~3u;
+	}
+
+	if (!json)
+		throw std::runtime_error("Error reading GLB: missing JSON chunk");
+
+	JsonValue document = JsonParser(json, jsonSize).ParseDocument();
+	const JsonValue* meshes = document.Find("meshes");
+	if (!meshes || meshes->type != JsonValue::Array)
+		throw std::invalid_argument("Error reading GLB: file contains no meshes");
+
+	size_t loaded = 0;
+	for (size_t m = 0; m < meshes->array.size(); m++)
+	{
+		const JsonValue& mesh = meshes->array[m];
+		const JsonValue* name = mesh.Find("name");
+		std::string meshName = name && name->type == JsonValue::String ? name->string : "mesh" + std::to_string(m);
+
+		const JsonValue* primitives = mesh.Find("primitives");
+		if (!primitives)
+			continue;
+
+		for (size_t p = 0; p < primitives->array.size(); p++)
+		{
+			GlbPrimitive primitive = {};
+			if (!LoadPrimitive(document, primitives->array[p], bin, binSize, primitive))
+			{
+#if defined(DEBUG) | defined(_DEBUG)
+				printf("Skipping primitive %zu of %s: not an indexable triangle list\n", p, meshName.c_str());
+#endif
+				continue;
+			}
+
+			primitive.name = primitives->array.size() > 1 ? meshName + "/" + std::to_string(p) : meshName;
+			out.push_back(std::move(primitive));
+			loaded++;
+		}
+	}
+
+	if (loaded == 0)
+		throw std::invalid_argument("Error reading GLB: file contains no triangles");
+
+#if defined(DEBUG) | defined(_DEBUG)
+	printf("Loaded %s: %zu primitives\n", glbFilePath, loaded);
+#endif
+}
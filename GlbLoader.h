@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// One triangle primitive of a glTF mesh
+//
+// - hasTangents is true when the file supplied TANGENT,
+//   in which case they're already in data.vertices
+// - material is the glTF material index, or -1 if none
+// --------------------------------------------------------
+struct GlbPrimitive
+{
+	std::string name;
+	MeshData data;
+	bool hasTangents;
+	int material;
+};
+
+/*
+* Reads binary glTF 2.0 (.glb) files.
+*
+* The file is memory-mapped. Only the JSON chunk is parsed as text - every accessor is read
+* in place from the mapped BIN chunk (honoring byte strides), straight into the final Vertex
+* and index arrays, so there's no intermediate copy of the binary data.
+*
+* Supported: every triangle-list primitive of every mesh, 8/16/32-bit indices (or none),
+* float POSITION/NORMAL/TANGENT and float or normalized integer TEXCOORD_0.
+* Missing normals are generated (area weighted); missing UVs are 0.
+* Positions, normals and tangents are converted from glTF's right-handed space to DirectX's
+* left-handed one, and the winding order is flipped to match. glTF UVs are already top-left.
+* Node transforms are ignored: primitives are in their mesh's own space.
+*
+* Load(): Appends every triangle primitive in the file to out
+*/
+namespace GlbLoader
+{
+	void Load(const char* glbFilePath, std::vector<GlbPrimitive>& out);
+}
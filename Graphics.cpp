@@ -1,7 +1,12 @@
 #include "Graphics.h"
+#include <algorithm>
 #include <dxgi1_6.h>
+#include <memory>
+#include <stdexcept>
 #include "WICTextureLoader.h"
 #include "ResourceUploadBatch.h"
+#include "PathHelpers.h"
+#include "TextureFile.h"
 
 
 // Tell the drivers to use high-performance GPU in multi-GPU systems (like laptops)
@@ -47,6 +52,229 @@ namespace Graphics
 		// Texture resources we need to keep alive
 		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> textures;
 
+		// Upload batching: one persistently mapped ring of staging memory and
+		// one list for buffer and texture file copies on the copy queue, plus
+		// DirectXTK's batch for textures made from pixels. The tracker keeps
+		// staging memory and command allocators from being reused until the
+		// batches that used them are done
+		const size_t StagingBufferBytes = 32 << 20;
+		const size_t StagingAlignment = 16;
+		UploadTracker uploads(StagingBufferBytes);
+		Microsoft::WRL::ComPtr<ID3D12Resource> stagingBuffer;
+		unsigned char* stagingAddress = 0;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> uploadAllocators;
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> uploadList;
+		int uploadAllocator = -1; // The allocator the open list records into, or -1 if it's closed
+		unsigned int uploadBatchDepth = 0;
+		std::unique_ptr<DirectX::ResourceUploadBatch> textureUploads;
+
+		// Uploads too big for the ring get their own staging buffer until their batch is done
+		struct OversizedUpload
+		{
+			UploadTicket ticket;
+			Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+		};
+		std::vector<OversizedUpload> oversizedUploads;
+
+		// The last ticket the direct queue has to wait for (texture file copies, geometry
+		// arena growth) that it hasn't been told to wait for yet
+		UploadTicket pendingDirectQueueTicket = 0;
+
+		// Resources kept alive until the direct queue is done with them. Ones retired
+		// since the last command list get their fence value when the next one executes
+		struct RetiredResource
+		{
+			UINT64 fenceValue;
+			Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		};
+		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> retiring;
+		std::vector<RetiredResource> retired;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> CreateUploadBuffer(UINT64 size)
+		{
+			D3D12_HEAP_PROPERTIES uploadProps = {};
+			uploadProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			uploadProps.CreationNodeMask = 1;
+			uploadProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			uploadProps.Type = D3D12_HEAP_TYPE_UPLOAD;
+			uploadProps.VisibleNodeMask = 1;
+
+			D3D12_RESOURCE_DESC desc = {};
+			desc.DepthOrArraySize = 1;
+			desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			desc.Format = DXGI_FORMAT_UNKNOWN;
+			desc.Height = 1;
+			desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			desc.MipLevels = 1;
+			desc.SampleDesc.Count = 1;
+			desc.Width = size;
+
+			Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+			HRESULT hr = Device->CreateCommittedResource(
+				&uploadProps, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, 0, IID_PPV_ARGS(buffer.GetAddressOf()));
+			if (FAILED(hr))
+				throw std::runtime_error("Could not create an upload buffer");
+			return buffer;
+		}
+
+		// Catches up with the copy fence, releasing whatever finished batches held on to
+		void UpdateUploads()
+		{
+			uploads.Update(CopyFence->GetCompletedValue());
+			std::erase_if(oversizedUploads, [](const OversizedUpload& upload) { return uploads.IsComplete(upload.ticket); });
+		}
+
+		// Starts recording buffer copies, creating the ring on first use. The list
+		// records into any allocator the copy queue is done with, or a new one
+		void OpenUploadList()
+		{
+			if (uploadAllocator >= 0)
+				return;
+
+			if (!stagingBuffer)
+			{
+				stagingBuffer = CreateUploadBuffer(StagingBufferBytes);
+				stagingBuffer->Map(0, &range, (void**)&stagingAddress); // Stays mapped for good
+			}
+
+			UpdateUploads();
+			uploadAllocator = uploads.AcquireAllocator();
+			if (uploadAllocator < 0)
+			{
+				uploadAllocator = (int)uploads.AddAllocator();
+				uploadAllocators.emplace_back();
+				Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(uploadAllocators.back().GetAddressOf()));
+			}
+			else
+			{
+				uploadAllocators[uploadAllocator]->Reset();
+			}
+
+			if (!uploadList)
+				Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, uploadAllocators[uploadAllocator].Get(), 0, IID_PPV_ARGS(uploadList.GetAddressOf()));
+			else
+				uploadList->Reset(uploadAllocators[uploadAllocator].Get(), 0);
+		}
+
+		// Sends the open list to the copy queue without waiting, returning its
+		// ticket (or the last one submitted, if there's nothing to send)
+		UploadTicket SubmitUploadList()
+		{
+			if (uploadAllocator < 0)
+				return uploads.GetLastSubmitted();
+
+			// Freed geometry ranges may still be read by frames in flight on the
+			// direct queue, so the copies start after everything already there
+			WaitFenceCounter++;
+			CommandQueue->Signal(WaitFence.Get(), WaitFenceCounter);
+			CopyQueue->Wait(WaitFence.Get(), WaitFenceCounter);
+
+			uploadList->Close();
+			ID3D12CommandList* lists[] = { uploadList.Get() };
+			CopyQueue->ExecuteCommandLists(1, lists);
+
+			UploadTicket ticket = uploads.Submit((unsigned int)uploadAllocator);
+			CopyQueue->Signal(CopyFence.Get(), ticket);
+			uploadAllocator = -1;
+			return ticket;
+		}
+
+		// Space for size bytes of the open batch's copies, returning the buffer
+		// and offset they go at. When the ring is full, makes room by catching
+		// up with the copy queue, then by sending this batch's copies and
+		// waiting for the oldest batches. Anything bigger than the whole ring
+		// gets its own buffer, kept until the batch is done
+		ID3D12Resource* AllocateStaging(size_t size, size_t alignment, unsigned char** address, UINT64* offset)
+		{
+			size_t staged = uploads.AllocateStaging(size, alignment);
+			if (staged == StagingAllocator::InvalidOffset && size <= uploads.GetStagingCapacity())
+			{
+				UpdateUploads();
+				staged = uploads.AllocateStaging(size, alignment);
+			}
+			if (staged == StagingAllocator::InvalidOffset && size <= uploads.GetStagingCapacity())
+			{
+				SubmitUploadList();
+				OpenUploadList();
+				while ((staged = uploads.AllocateStaging(size, alignment)) == StagingAllocator::InvalidOffset)
+					WaitForUpload(uploads.GetCompleted() + 1);
+			}
+
+			if (staged != StagingAllocator::InvalidOffset)
+			{
+				*address = stagingAddress + staged;
+				*offset = staged;
+				return stagingBuffer.Get();
+			}
+
+			Microsoft::WRL::ComPtr<ID3D12Resource> oversized = CreateUploadBuffer(size);
+			oversized->Map(0, &range, (void**)address); // Released with the buffer
+			*offset = 0;
+			oversizedUploads.push_back({ uploads.GetOpenTicket(), oversized });
+			return oversized.Get();
+		}
+
+		// Keeps a texture alive and gives it the next SRV slot, returning the slot's index
+		unsigned int AddTexture(Microsoft::WRL::ComPtr<ID3D12Resource> texture)
+		{
+			// Save the ComPtr so it doesnt get cleaned up
+			textures.push_back(texture);
+			// Save the index of this descriptor and increment the overall offset
+			unsigned int srvIndex = srvDescriptorOffset;
+			srvDescriptorOffset++;
+
+			// Create the SRV in the descriptor heap at the appropriate offset . When calling
+			// CreateShaderResourceView(), you can use null (zero) for the SRV_DESC param
+			// to get a default SRV that can see all potential subresources of the texture.
+			D3D12_CPU_DESCRIPTOR_HANDLE textureCPUHandle = CBVSRVDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+			textureCPUHandle.ptr += srvIndex * cbvSrvDescriptorHeapIncrementSize;
+			Device->CreateShaderResourceView(texture.Get(), 0, textureCPUHandle);
+			return srvIndex;
+		}
+
+		// An RGBA8 texture in COPY_DEST, ready to upload into through the DirectXTK batch (opened if needed)
+		Microsoft::WRL::ComPtr<ID3D12Resource> CreateTextureResource(unsigned int width, unsigned int height, UINT16 mipLevels)
+		{
+			if (!textureUploads)
+			{
+				textureUploads = std::make_unique<DirectX::ResourceUploadBatch>(Device.Get());
+				textureUploads->Begin();
+			}
+
+			D3D12_HEAP_PROPERTIES props = {};
+			props.Type = D3D12_HEAP_TYPE_DEFAULT;
+			props.CreationNodeMask = 1;
+			props.VisibleNodeMask = 1;
+
+			D3D12_RESOURCE_DESC desc = {};
+			desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+			desc.Width = width;
+			desc.Height = height;
+			desc.DepthOrArraySize = 1;
+			desc.MipLevels = mipLevels;
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // Like the WIC loader - the pixel shader undoes gamma itself
+			desc.SampleDesc.Count = 1;
+			desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+
+			Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+			HRESULT hr = Device->CreateCommittedResource(
+				&props, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COPY_DEST, 0, IID_PPV_ARGS(texture.GetAddressOf()));
+			if (FAILED(hr))
+				throw std::runtime_error("Could not create a texture");
+			return texture;
+		}
+
+		// Textures go through DirectXTK on the direct queue and are always waited on
+		void FinishTextureUploads()
+		{
+			if (!textureUploads)
+				return;
+
+			std::future<void> texturesDone = textureUploads->End(CommandQueue.Get());
+			WaitForGPU();
+			texturesDone.wait(); // Already signaled - this just lets DirectXTK clean up
+			textureUploads.reset();
+		}
 	}
 }
 
@@ -203,6 +431,16 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 		WaitFenceCounter = 0;
 	}
 
+	// Create the copy queue and its fence for asynchronous uploads
+	{
+		D3D12_COMMAND_QUEUE_DESC copyDesc = {};
+		copyDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+		copyDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+		Device->CreateCommandQueue(&copyDesc, IID_PPV_ARGS(CopyQueue.GetAddressOf()));
+		Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(CopyFence.GetAddressOf()));
+		CopyFenceEvent = CreateEventEx(0, 0, 0, EVENT_ALL_ACCESS);
+	}
+
 	// Create fence for multi frame sync
 	{
 		Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(FrameSyncFence.GetAddressOf()));
@@ -423,28 +661,8 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 // data - Pointer to the data itself
 // --------------------------------------------------------
 Microsoft::WRL::ComPtr <ID3D12Resource > Graphics::CreateStaticBuffer(
-	size_t dataStride, size_t dataCount, void* data)
+	size_t dataStride, size_t dataCount, const void* data)
 {
-	// Creates a temporary command allocator and list so we don't
-	// screw up any other ongoing work (since resetting a command allocator
-	// cannot happen while its list is being executed). These ComPtrs will
-	// be cleaned up automatically when they go out of scope.
-	// Note: This certainly isn't efficient, but hopefully this only
-	// happens during start - up. Otherwise, refactor this to use
-	// the existing list and allocator(s).
-	Microsoft::WRL::ComPtr <ID3D12CommandAllocator > localAllocator;
-	Microsoft::WRL::ComPtr <ID3D12GraphicsCommandList > localList;
-	
-	Device -> CreateCommandAllocator(
-		D3D12_COMMAND_LIST_TYPE_DIRECT,
-		IID_PPV_ARGS(localAllocator.GetAddressOf()));
-	Device -> CreateCommandList(
-		0, // Which physical GPU will handle these tasks? 0 for single GPU setup
-		D3D12_COMMAND_LIST_TYPE_DIRECT, // Type of command list
-		localAllocator.Get(), // The allocator for this list (to start)
-		0, // Initial pipeline state - none for now
-		IID_PPV_ARGS(localList.GetAddressOf()));
-	
 	// The overall buffer we'll be creating
 	Microsoft::WRL::ComPtr <ID3D12Resource > finalBuffer;
 	// Describes the final heap
@@ -466,10 +684,6 @@ Microsoft::WRL::ComPtr <ID3D12Resource > Graphics::CreateStaticBuffer(
 	desc.SampleDesc.Count = 1;
 	desc.SampleDesc.Quality = 0;
 	desc.Width = dataStride * dataCount; // Size of the buffer
-	// Note that even though we're starting this buffer in the "common" resource
-	// state, it will be implicitly transitioned to the "copy destination" state
-	// when used for a copy operation below. For more info, see:
-	// https://learn.microsoft.com/en - us/windows/win32/direct3d12/user - mode- heap - synchronization#multi - queue - resource - access
 	Device -> CreateCommittedResource(
 		&props,
 		D3D12_HEAP_FLAG_NONE,
@@ -478,51 +692,17 @@ Microsoft::WRL::ComPtr <ID3D12Resource > Graphics::CreateStaticBuffer(
 		0,
 		IID_PPV_ARGS(finalBuffer.GetAddressOf()));
 	
-	// Now create an intermediate upload heap for CPU - >GPU copy of initial data
-	D3D12_HEAP_PROPERTIES uploadProps = {};
-	uploadProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-	uploadProps.CreationNodeMask = 1;
-	uploadProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-	uploadProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-	uploadProps.VisibleNodeMask = 1;
-	Microsoft::WRL::ComPtr <ID3D12Resource > uploadBuffer;
-	Device -> CreateCommittedResource(
-		&uploadProps,
-		D3D12_HEAP_FLAG_NONE,
-		&desc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		0,
-		IID_PPV_ARGS(uploadBuffer.GetAddressOf()));
-	
-	// Do a straight map/memcpy/unmap
-	void* gpuAddress = 0;
-	uploadBuffer -> Map(0, 0, &gpuAddress);
-	memcpy(gpuAddress, data, dataStride * dataCount);
-	uploadBuffer -> Unmap(0, 0);
-	// Copy the whole buffer from uploadheap to vert buffer
-	localList -> CopyResource(finalBuffer.Get(), uploadBuffer.Get());
-	
-	// Transition the buffer to generic read (was implicitly transitioned to copy_dest above)
-	D3D12_RESOURCE_BARRIER rb = {};
-	rb.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	rb.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-	rb.Transition.pResource = finalBuffer.Get();
-	rb.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST; // Implicitly copy_dest now!
-	rb.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
-	rb.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-	localList -> ResourceBarrier(1, &rb);
-	
-	// Execute the local command list and wait for it to complete
-	// before returning the final buffer
-	localList -> Close();
-	ID3D12CommandList* list[] = { localList.Get() };
-	CommandQueue -> ExecuteCommandLists(1, list);
-	WaitForGPU();
+	// Stage the data and copy it over - part of the current upload
+	// batch if there is one, otherwise submitted and waited on here.
+	// The buffer stays in the common state, which reads promote from
+	UploadBuffer(finalBuffer.Get(), 0, data, dataStride * dataCount);
 	return finalBuffer;
 }
 
 // --------------------------------------------------------
-// Uses the directtk library to load in texture files
+// Loads a texture file - .dds and .ktx2 files are copied to
+// the GPU as stored (see LoadTextureFile()), anything else
+// goes through DirectXTK's WIC loader
 // --------------------------------------------------------
 unsigned int Graphics::LoadTexture(const wchar_t* file, bool generateMips) 
 {
@@ -530,35 +710,171 @@ unsigned int Graphics::LoadTexture(const wchar_t* file, bool generateMips)
 	// Right now, the entire buffer is a ring buffer - we want to segment the buffer such that all our SRVs are not overwritten
 	// | CBV - Ring and rewritten | | SRV- Not overwritable| -> Assuming SRVs begin after all constant buffers
 	// The srvDescriptorOffset marks the offset from the beginning to the end of the space reserved for SRVs
-
-	// Helper function from DXTK for uploading a resource
-	// (like a texture) to the appropriate GPU memory
-	DirectX::ResourceUploadBatch upload(Device.Get());
-	upload.Begin();
+	std::wstring path(file);
+	size_t dot = path.find_last_of(L'.');
+	if (dot != std::wstring::npos && (_wcsicmp(path.c_str() + dot, L".dds") == 0 || _wcsicmp(path.c_str() + dot, L".ktx2") == 0))
+		return LoadTextureFile(file);
+
+	// Helper class from DXTK for uploading a resource
+	// (like a texture) to the appropriate GPU memory. Inside an
+	// upload batch, every texture goes into the same one
+	if (!textureUploads)
+	{
+		textureUploads = std::make_unique<DirectX::ResourceUploadBatch>(Device.Get());
+		textureUploads->Begin();
+	}
 	
 	// Attempt to create the texture
 	Microsoft::WRL::ComPtr <ID3D12Resource > texture;
 	DirectX::CreateWICTextureFromFile(
-		Device.Get(), upload, file, texture.GetAddressOf(), generateMips);
-	// Perform the upload and wait for it to finish before moving on
-	auto finish = upload.End(CommandQueue.Get());
-	finish.wait();
-	
-	// Now that we have the texture, save the ComPtr so it doesnt get cleaned up
-	textures.push_back(texture);
-	// Save the index of this descriptor and increment the overall offset
-	unsigned int srvIndex = srvDescriptorOffset;
-	srvDescriptorOffset++;
-	
-	// Create the SRV in the descriptor heap at the appropriate offset . When calling
-	// CreateShaderResourceView(), you can use null (zero) for the SRV_DESC param
-	// to get a default SRV that can see all potential subresources of the texture.
-	D3D12_CPU_DESCRIPTOR_HANDLE textureCPUHandle = Graphics::CBVSRVDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-	textureCPUHandle.ptr += srvIndex * cbvSrvDescriptorHeapIncrementSize;
-	Graphics::Device->CreateShaderResourceView(texture.Get(), 0, textureCPUHandle);
+		Device.Get(), *textureUploads, file, texture.GetAddressOf(), generateMips);
+	// Outside of a batch, perform the upload and wait for it to finish before moving on
+	if (uploadBatchDepth == 0)
+		FlushUploadBatch();
 	
-	// Send back the index of the descriptor
-	return srvIndex;
+	// Send back the index of its descriptor
+	return AddTexture(texture);
+}
+
+// --------------------------------------------------------
+// Loads a .dds or .ktx2 file (see TextureFile) without
+// decoding or converting anything: the file is mapped, each
+// mip level is copied from it straight into the staging ring
+// at the layout D3D12 wants, and the copy queue does the
+// rest. The texture stays in the common state, so no barriers
+// are needed - the direct queue waits on the copy fence (on
+// the GPU) before it next executes, in case the batch isn't
+// waited on. Mips must already be in the file
+// --------------------------------------------------------
+unsigned int Graphics::LoadTextureFile(const wchar_t* file)
+{
+	TextureFile textureFile(WideToNarrow(file).c_str());
+	std::vector<TextureFootprint> footprints;
+	UINT64 stagingBytes = textureFile.ComputeFootprints(footprints);
+
+	D3D12_HEAP_PROPERTIES props = {};
+	props.Type = D3D12_HEAP_TYPE_DEFAULT;
+	props.CreationNodeMask = 1;
+	props.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC desc = {};
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	desc.Width = textureFile.GetWidth();
+	desc.Height = textureFile.GetHeight();
+	desc.DepthOrArraySize = 1;
+	desc.MipLevels = (UINT16)textureFile.GetMipCount();
+	desc.Format = (DXGI_FORMAT)textureFile.GetDxgiFormat();
+	desc.SampleDesc.Count = 1;
+	desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+	HRESULT hr = Device->CreateCommittedResource(
+		&props, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COMMON, 0, IID_PPV_ARGS(texture.GetAddressOf()));
+	if (FAILED(hr))
+		throw std::runtime_error("Could not create a texture for " + WideToNarrow(file));
+
+	BeginUploadBatch();
+	OpenUploadList();
+
+	// The only copy of the data the CPU makes: from the mapping into staging memory
+	unsigned char* address = 0;
+	UINT64 offset = 0;
+	ID3D12Resource* source = AllocateStaging((size_t)stagingBytes, TextureFile::PlacementAlignment, &address, &offset);
+	textureFile.CopyLevels(footprints, address);
+
+	// The copies promote the texture to copy dest, and it decays back to
+	// common when they're done, where the pixel shader's reads promote it
+	for (UINT i = 0; i < (UINT)footprints.size(); i++)
+	{
+		D3D12_TEXTURE_COPY_LOCATION from = {};
+		from.pResource = source;
+		from.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		from.PlacedFootprint.Offset = offset + footprints[i].offset;
+		from.PlacedFootprint.Footprint.Format = desc.Format;
+		from.PlacedFootprint.Footprint.Width = footprints[i].width;
+		from.PlacedFootprint.Footprint.Height = footprints[i].height;
+		from.PlacedFootprint.Footprint.Depth = 1;
+		from.PlacedFootprint.Footprint.RowPitch = footprints[i].rowPitch;
+
+		D3D12_TEXTURE_COPY_LOCATION to = {};
+		to.pResource = texture.Get();
+		to.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		to.SubresourceIndex = i;
+
+		uploadList->CopyTextureRegion(&to, 0, 0, 0, &from, 0);
+	}
+	WaitForUploadOnDirectQueue(uploads.GetOpenTicket());
+
+	EndUploadBatch();
+	return AddTexture(texture);
+}
+
+// --------------------------------------------------------
+// Creates a texture from already decoded pixels, uploading
+// it through the same DirectXTK batch as LoadTexture(). The
+// image can be freed as soon as this returns
+// --------------------------------------------------------
+unsigned int Graphics::CreateTexture(const ImageData& image, bool generateMips)
+{
+	if (image.width == 0 || image.height == 0 || image.pixels.size() != (size_t)image.width * image.height * 4)
+		throw std::invalid_argument("Textures need RGBA pixels for every texel");
+
+	// A full mip chain, down to 1x1
+	UINT16 mipLevels = 1;
+	if (generateMips)
+		for (unsigned int size = (std::max)(image.width, image.height); size > 1; size /= 2)
+			mipLevels++;
+
+	// DirectXTK copies the pixels into its own staging memory right away
+	Microsoft::WRL::ComPtr<ID3D12Resource> texture = CreateTextureResource(image.width, image.height, mipLevels);
+	D3D12_SUBRESOURCE_DATA top = {};
+	top.pData = &image.pixels[0];
+	top.RowPitch = (LONG_PTR)image.width * 4;
+	top.SlicePitch = top.RowPitch * image.height;
+	textureUploads->Upload(texture.Get(), 0, &top, 1);
+	textureUploads->Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	if (mipLevels > 1)
+		textureUploads->GenerateMips(texture.Get());
+
+	if (uploadBatchDepth == 0)
+		FlushUploadBatch();
+
+	return AddTexture(texture);
+}
+
+// --------------------------------------------------------
+// Creates a texture from a mip chain built on the CPU (see
+// MipGenerator), uploading every level as given - no GPU
+// mip generation pass. Each level must be half the size of
+// the one before it (rounded down, to at least 1)
+// --------------------------------------------------------
+unsigned int Graphics::CreateTexture(const std::vector<ImageData>& mips)
+{
+	if (mips.empty() || mips.size() > D3D12_REQ_MIP_LEVELS)
+		throw std::invalid_argument("Textures need between 1 and 16 mip levels");
+
+	std::vector<D3D12_SUBRESOURCE_DATA> levels(mips.size());
+	for (size_t i = 0; i < mips.size(); i++)
+	{
+		const ImageData& mip = mips[i];
+		unsigned int width = (std::max)(mips[0].width >> i, 1u);
+		unsigned int height = (std::max)(mips[0].height >> i, 1u);
+		if (mip.width != width || mip.height != height || mip.pixels.size() != (size_t)width * height * 4)
+			throw std::invalid_argument("Mip levels must each be half the size of the one before");
+
+		levels[i].pData = &mip.pixels[0];
+		levels[i].RowPitch = (LONG_PTR)width * 4;
+		levels[i].SlicePitch = levels[i].RowPitch * height;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> texture = CreateTextureResource(mips[0].width, mips[0].height, (UINT16)mips.size());
+	textureUploads->Upload(texture.Get(), 0, levels.data(), (UINT)levels.size());
+	textureUploads->Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+	if (uploadBatchDepth == 0)
+		FlushUploadBatch();
+
+	return AddTexture(texture);
 }
 
 
@@ -599,6 +915,150 @@ void Graphics::AdvanceSwapChainIndex()
 
 }
 
+// --------------------------------------------------------
+// Starts (or nests) an upload batch
+// --------------------------------------------------------
+void Graphics::BeginUploadBatch()
+{
+	uploadBatchDepth++;
+}
+
+// --------------------------------------------------------
+// Ends an upload batch - the outermost End submits the
+// queued buffer copies and returns their ticket, waiting
+// for them first unless waitForCompletion is false.
+// Inner Ends return the ticket their copies will have.
+// --------------------------------------------------------
+UploadTicket Graphics::EndUploadBatch(bool waitForCompletion)
+{
+	if (uploadBatchDepth == 0)
+		throw std::logic_error("EndUploadBatch() without a matching BeginUploadBatch()");
+
+	if (--uploadBatchDepth > 0)
+		return uploadAllocator >= 0 ? uploads.GetOpenTicket() : uploads.GetLastSubmitted();
+
+	UploadTicket ticket = SubmitUploadList();
+	FinishTextureUploads();
+	if (waitForCompletion)
+		WaitForUpload(ticket);
+	return ticket;
+}
+
+// --------------------------------------------------------
+// Submits every copy queued so far and waits for it, along
+// with anything still in flight, leaving any batch open for
+// more. Needed before anything reads a destination on the
+// direct queue without checking its ticket (like
+// GeometryArena copying a buffer it's about to replace).
+// --------------------------------------------------------
+void Graphics::FlushUploadBatch()
+{
+	WaitForUpload(SubmitUploadList());
+	FinishTextureUploads();
+}
+
+// --------------------------------------------------------
+// Copies data into part of a buffer, through the staging ring,
+// and returns the ticket the copy completes with
+//
+// destination - The buffer to copy into, in the common state
+//               (the copy queue can't use most others)
+// destinationOffset - Where in it the data goes, in bytes
+// --------------------------------------------------------
+UploadTicket Graphics::UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, size_t size)
+{
+	if (size == 0)
+		return 0;
+
+	BeginUploadBatch();
+	OpenUploadList();
+
+	unsigned char* address = 0;
+	UINT64 offset = 0;
+	ID3D12Resource* source = AllocateStaging(size, StagingAlignment, &address, &offset);
+	memcpy(address, data, size);
+
+	// The copy promotes the buffer from common to copy dest, and it decays
+	// back once the list is done, so no barriers are needed on either queue
+	uploadList->CopyBufferRegion(destination, destinationOffset, source, offset, size);
+
+	return EndUploadBatch();
+}
+
+// --------------------------------------------------------
+// Copies ranges of one buffer into another on the copy queue,
+// after every upload queued so far and before any queued
+// later, and returns the ticket the copies complete with
+//
+// Both buffers must be in the common state, like UploadBuffer()
+// --------------------------------------------------------
+UploadTicket Graphics::CopyBufferRegions(ID3D12Resource* destination, ID3D12Resource* source, const std::vector<BufferCopy>& copies)
+{
+	BeginUploadBatch();
+
+	// The copies get a list of their own: lists on one queue run one after
+	// another, so uploads into source finish before they read it, and uploads
+	// into destination made after this can't overlap them
+	SubmitUploadList();
+	OpenUploadList();
+	for (const BufferCopy& copy : copies)
+		uploadList->CopyBufferRegion(destination, copy.destinationOffset, source, copy.sourceOffset, copy.size);
+	UploadTicket ticket = SubmitUploadList();
+
+	EndUploadBatch();
+	return ticket;
+}
+
+// --------------------------------------------------------
+// Has the direct queue wait (on the GPU) for the copies with
+// this ticket before it executes the next command list, for
+// resources that are used without checking a ticket first
+// --------------------------------------------------------
+void Graphics::WaitForUploadOnDirectQueue(UploadTicket ticket)
+{
+	pendingDirectQueueTicket = (std::max)(pendingDirectQueueTicket, ticket);
+}
+
+// --------------------------------------------------------
+// Keeps a resource alive until the direct queue has finished
+// the command list being recorded (and everything before it),
+// for resources replaced while frames may still use them
+// --------------------------------------------------------
+void Graphics::ReleaseAfterFrame(Microsoft::WRL::ComPtr<ID3D12Resource> resource)
+{
+	retiring.push_back(resource);
+}
+
+// --------------------------------------------------------
+// Whether the copies with this ticket have finished, so the
+// buffers they wrote can be used on the direct queue
+// --------------------------------------------------------
+bool Graphics::IsUploadComplete(UploadTicket ticket)
+{
+	if (!uploads.IsComplete(ticket))
+		UpdateUploads();
+	return uploads.IsComplete(ticket);
+}
+
+// --------------------------------------------------------
+// Blocks until the copies with this ticket have finished,
+// submitting the open batch first if the ticket is its own
+// --------------------------------------------------------
+void Graphics::WaitForUpload(UploadTicket ticket)
+{
+	if (ticket > uploads.GetLastSubmitted())
+		SubmitUploadList();
+	if (ticket > uploads.GetLastSubmitted())
+		throw std::invalid_argument("No upload batch has that ticket");
+
+	if (CopyFence->GetCompletedValue() < ticket)
+	{
+		CopyFence->SetEventOnCompletion(ticket, CopyFenceEvent);
+		WaitForSingleObject(CopyFenceEvent, INFINITE);
+	}
+	UpdateUploads();
+}
+
 // --------------------------------------------------------
 // Resets the command allocator and list
 //
@@ -622,10 +1082,33 @@ void Graphics::ResetAllocatorAndCommandList(int swapChainIndex)
 // --------------------------------------------------------
 void Graphics::CloseAndExecuteCommandList()
 {
+	// Textures loaded (or geometry buffers grown) since last time may still
+	// be copying - have the direct queue wait for them on the GPU, rather
+	// than stalling here
+	if (pendingDirectQueueTicket > 0)
+	{
+		if (pendingDirectQueueTicket > uploads.GetLastSubmitted())
+			SubmitUploadList();
+		CommandQueue->Wait(CopyFence.Get(), pendingDirectQueueTicket);
+		pendingDirectQueueTicket = 0;
+	}
+
 	// Close the current list and execute it as our only list
 	CommandList -> Close();
 	ID3D12CommandList* lists[] = { CommandList.Get() };
 	CommandQueue -> ExecuteCommandLists(1, lists);
+
+	// Release what earlier lists were holding on to, and hold on to whatever
+	// was retired while recording this one until it's done
+	std::erase_if(retired, [](const RetiredResource& r) { return WaitFence->GetCompletedValue() >= r.fenceValue; });
+	if (!retiring.empty())
+	{
+		WaitFenceCounter++;
+		CommandQueue->Signal(WaitFence.Get(), WaitFenceCounter);
+		for (Microsoft::WRL::ComPtr<ID3D12Resource>& resource : retiring)
+			retired.push_back({ WaitFenceCounter, resource });
+		retiring.clear();
+	}
 }
 
 // --------------------------------------------------------
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 #include <wrl/client.h>
+#include "ImageData.h"
+#include "UploadTracker.h"
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -38,6 +40,10 @@ namespace Graphics
 	inline Microsoft::WRL::ComPtr <ID3D12Fence > WaitFence;
 	inline HANDLE WaitFenceEvent = 0;
 	inline UINT64 WaitFenceCounter = 0;
+	// Asynchronous uploads - the copy fence's value is the last finished UploadTicket
+	inline Microsoft::WRL::ComPtr <ID3D12CommandQueue > CopyQueue;
+	inline Microsoft::WRL::ComPtr <ID3D12Fence > CopyFence;
+	inline HANDLE CopyFenceEvent = 0;
 	// Frame Syncing 
 	inline Microsoft::WRL::ComPtr <ID3D12Fence > FrameSyncFence;
 	inline HANDLE FrameSyncFenceEvent = 0;
@@ -67,10 +73,51 @@ namespace Graphics
 	
 	// Resource creation
 	Microsoft::WRL::ComPtr <ID3D12Resource > CreateStaticBuffer(
-		size_t dataStride, size_t dataCount, void* data);
+		size_t dataStride, size_t dataCount, const void* data);
 	
-	// Loading textures
+	// Loading textures - from a file (.dds and .ktx2 files mapped and copied
+	// as stored, including block compressed ones from TextureCompressor,
+	// anything else through WIC), or from pixels decoded elsewhere (like
+	// PngDecoder, which can decode many files in parallel). Mips are
+	// generated on the GPU, unless they're already in the file or given as a
+	// whole chain (see MipGenerator)
 	unsigned int LoadTexture(const wchar_t* file, bool generateMips = true);
+	unsigned int LoadTextureFile(const wchar_t* file);
+	unsigned int CreateTexture(const ImageData& image, bool generateMips = true);
+	unsigned int CreateTexture(const std::vector<ImageData>& mips);
+
+	// Upload batching - buffer copies made between Begin and End are recorded
+	// into one list on the copy queue (staged through one ring buffer) and
+	// submitted together at the outermost End, which returns the batch's
+	// ticket. Batches may nest; inner Ends return the ticket their copies will
+	// complete with. Buffers can't be read by the GPU until their ticket is
+	// complete - End waits for it unless told not to, and otherwise it can be
+	// polled with IsUploadComplete(). Outside of a batch, every upload is
+	// submitted and waited on by itself. Textures from .dds and .ktx2 files
+	// are copied the same way, but the direct queue waits for them on the GPU
+	// before executing anything else; other textures are copied on the direct
+	// queue (mip generation needs it) and are always ready once End returns.
+	void BeginUploadBatch();
+	UploadTicket EndUploadBatch(bool waitForCompletion = true);
+	void FlushUploadBatch();
+	UploadTicket UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, size_t size);
+	bool IsUploadComplete(UploadTicket ticket);
+	void WaitForUpload(UploadTicket ticket);
+
+	// Buffer to buffer copies on the copy queue, ordered after every upload
+	// before them (like growing a buffer that's still being uploaded into).
+	// Anything drawn from the destination without checking the ticket needs
+	// WaitForUploadOnDirectQueue(), and a buffer being replaced can be handed
+	// to ReleaseAfterFrame() rather than waiting for the GPU to let it go
+	struct BufferCopy
+	{
+		UINT64 destinationOffset;
+		UINT64 sourceOffset;
+		UINT64 size;
+	};
+	UploadTicket CopyBufferRegions(ID3D12Resource* destination, ID3D12Resource* source, const std::vector<BufferCopy>& copies);
+	void WaitForUploadOnDirectQueue(UploadTicket ticket);
+	void ReleaseAfterFrame(Microsoft::WRL::ComPtr<ID3D12Resource> resource);
 	
 	// Command list & synchronization
 	void ResetAllocatorAndCommandList(int index);
@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+
+// --------------------------------------------------------
+// CPU-side pixels produced by the image decoders, ready to
+// be handed to Graphics::CreateTexture() for uploading
+//
+// - pixels are 8-bit RGBA, rows top to bottom with no
+//   padding between them (width * 4 bytes per row)
+// - Single channel images have the channel copied into
+//   red, green and blue, with an opaque alpha
+// --------------------------------------------------------
+struct ImageData
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	std::vector<unsigned char> pixels;
+};
@@ -0,0 +1,86 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const char* path) :
+	data(0),
+	size(0),
+	open(false),
+	fileHandle(0),
+	mappingHandle(0)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	fileHandle = file;
+	open = true;
+
+	LARGE_INTEGER fileSize{};
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+
+	// Windows refuses to map an empty file, so there's nothing more to do
+	if (size == 0)
+		return;
+
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping == 0)
+	{
+		size = 0;
+		return;
+	}
+	mappingHandle = mapping;
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == 0)
+		size = 0;
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+
+	// Stash the descriptor in the handle (offset by one so 0 still means "none")
+	fileHandle = (void*)(intptr_t)(fd + 1);
+	open = true;
+
+	struct stat info {};
+	fstat(fd, &info);
+	size = (size_t)info.st_size;
+	if (size == 0)
+		return;
+
+	void* mapped = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED)
+	{
+		size = 0;
+		return;
+	}
+	madvise(mapped, size, MADV_SEQUENTIAL);
+	data = (const char*)mapped;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle) CloseHandle((HANDLE)fileHandle);
+#else
+	if (data) munmap((void*)data, size);
+	if (fileHandle) close((int)(intptr_t)fileHandle - 1);
+#endif
+}
+
+bool MappedFile::IsOpen() { return open; }
+const char* MappedFile::GetData() { return data; }
+size_t MappedFile::GetSize() { return size; }
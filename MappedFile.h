@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+/*
+* A read-only view of an entire file on disk, backed by the OS's memory mapping
+* (CreateFileMapping on Windows, mmap everywhere else).
+* 
+* The file's bytes are paged in on demand, so nothing is copied into our own
+* buffers until we actually read it. The mapping is released when this goes out of scope.
+*
+* IsOpen(): Whether the file could be opened (an empty file is open but has no data)
+* GetData(): Returns a pointer to the first byte of the file
+* GetSize(): Returns the size of the file in bytes
+*/
+class MappedFile
+{
+public:
+	MappedFile(const char* path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete; // Remove copy constructor
+	MappedFile& operator=(const MappedFile&) = delete; // Remove copy-assignment operator
+
+	bool IsOpen();
+	const char* GetData();
+	size_t GetSize();
+
+private:
+	const char* data;
+	size_t size;
+	bool open;
+
+	// OS handles (file + mapping on Windows, file descriptor elsewhere)
+	void* fileHandle;
+	void* mappingHandle;
+};
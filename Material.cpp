@@ -11,8 +11,7 @@ Material::Material(Microsoft::WRL::ComPtr<ID3D12PipelineState> inPipelineState,
 	offset(UVOffset),
 	albedoIndex(-1),
 	normalMapIndex(-1),
-	roughnessIndex(-1),
-	metalnessIndex(-1)
+	ormIndex(-1)
 {
 }
 
@@ -21,8 +20,7 @@ DirectX::XMFLOAT2 Material::GetScale() { return scale; }
 DirectX::XMFLOAT2 Material::GetOffset() { return offset; }
 unsigned int Material::GetAlbedoIndex() { return albedoIndex; }
 unsigned int Material::GetNormalMapIndex() { return normalMapIndex; }
-unsigned int Material::GetRoughnessIndex() { return roughnessIndex; }
-unsigned int Material::GetMetalnessIndex() { return metalnessIndex; }
+unsigned int Material::GetOrmIndex() { return ormIndex; }
 
 Microsoft::WRL::ComPtr<ID3D12PipelineState> Material::GetPipelineState() { return pipelineState; }
 void Material::SetPipelineState(Microsoft::WRL::ComPtr<ID3D12PipelineState> p) { pipelineState = p; }
@@ -33,5 +31,4 @@ void Material::SetOffset(DirectX::XMFLOAT2 o) { offset = o; }
 
 void Material::SetAlbedoIndex(unsigned int i) { albedoIndex = i; }
 void Material::SetNormalMapIndex(unsigned int i) { normalMapIndex = i; }
-void Material::SetRoughnessIndex(unsigned int i) { roughnessIndex = i; }
-void Material::SetMetalnessIndex(unsigned int i) { metalnessIndex = i; }
\ No newline at end of file
+void Material::SetOrmIndex(unsigned int i) { ormIndex = i; }
\ No newline at end of file
@@ -18,11 +18,11 @@ private:
 	// Pipeline state object includes the shaders binded
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState;
 
-	// Assuming only four textures are in use at any given time
+	// Three textures: albedo, normals, and occlusion/roughness/metalness
+	// packed into one (see TextureCompressor::PackOrm())
 	unsigned int albedoIndex;
 	unsigned int normalMapIndex;
-	unsigned int roughnessIndex;
-	unsigned int metalnessIndex;
+	unsigned int ormIndex;
 
 public:
 	Material(Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState, 
@@ -40,13 +40,11 @@ public:
 
 	void SetAlbedoIndex(unsigned int i);
 	void SetNormalMapIndex(unsigned int i);
-	void SetRoughnessIndex(unsigned int i);
-	void SetMetalnessIndex(unsigned int i);
+	void SetOrmIndex(unsigned int i);
 
 	unsigned int GetAlbedoIndex();
 	unsigned int GetNormalMapIndex();
-	unsigned int GetRoughnessIndex();
-	unsigned int GetMetalnessIndex();
+	unsigned int GetOrmIndex();
 
 	void SetPipelineState(Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState);
 	Microsoft::WRL::ComPtr<ID3D12PipelineState> GetPipelineState();
@@ -1,412 +1,490 @@
 #include "Mesh.h"
+#include "GlbLoader.h"
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
+#include "TangentGenerator.h"
+#include "VertexQuantization.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	// How far below the pixel limit a coarser LOD's error must be before
+	// switching to it, so meshes sitting right at a boundary don't flicker
+	const float LodHysteresis = 0.2f;
+
+	// Files with this extension hold MeshCodec output instead of OBJ text
+	bool IsCompressedMeshPath(const char* path)
+	{
+		size_t length = strlen(path);
+		return length >= 6 && strcmp(path + length - 6, ".meshz") == 0;
+	}
+
+	// --------------------------------------------------------
+	// Runs an OBJ file through the import pipeline, leaving the
+	// final vertices and indices in data
+	// --------------------------------------------------------
+	void ImportObj(const char* objFilePath, const MeshOptions& options, MeshData& data)
+	{
+		// Parse the file into welded vertices and indices (large files are
+		// split across all hardware threads)
+		ObjLoader::Load(objFilePath, data, 0);
+
+		// Reorder triangles and vertices for the GPU's vertex cache and fewer overdrawn pixels
+		MeshOptimizer::Optimize(data);
+
+		// Tangents are calculated exactly once, on the final vertex order
+		TangentOptions tangentOptions;
+		tangentOptions.angleWeighted = options.angleWeightedTangents;
+		TangentGenerator::Generate(&data.vertices[0], data.vertices.size(), &data.indices[0], data.indices.size(), tangentOptions);
+	}
+
+	// --------------------------------------------------------
+	// Generates tangents for each block a streaming loader hands
+	// over, then passes it on. Only the block's own vertices and
+	// the triangles wholly made of them are seen, so a vertex
+	// shared with a later block misses that block's triangles.
+	// --------------------------------------------------------
+	class TangentSink : public MeshSink
+	{
+	public:
+		TangentSink(MeshSink& next, TangentOptions options) : next(next), options(options), vertexCount(0) {}
+
+		void Append(Vertex* vertices, size_t count, const unsigned int* indices, size_t indexCount) override
+		{
+			// Renumbered from the block's first vertex
+			localIndices.clear();
+			for (size_t i = 0; i + 2 < indexCount; i += 3)
+				if (indices[i] >= vertexCount && indices[i + 1] >= vertexCount && indices[i + 2] >= vertexCount)
+					for (size_t corner = i; corner < i + 3; corner++)
+						localIndices.push_back(indices[corner] - vertexCount);
+
+			if (count > 0)
+				TangentGenerator::Generate(vertices, count, localIndices.data(), localIndices.size(), options);
+			vertexCount += (unsigned int)count;
+			next.Append(vertices, count, indices, indexCount);
+		}
+
+		void BeginSubmesh(const char* material) override { next.BeginSubmesh(material); }
+
+		// The local indices (with room to double) and TangentGenerator's x/y/z sums
+		size_t GetScratchPerCorner() const override { return 2 * sizeof(unsigned int) + 3 * sizeof(float) + next.GetScratchPerCorner(); }
+
+	private:
+		MeshSink& next;
+		TangentOptions options;
+		unsigned int vertexCount;
+		std::vector<unsigned int> localIndices;
+	};
 
+	// --------------------------------------------------------
+	// Streams an OBJ file straight into its .meshbin cache, within
+	// options.importScratchBudget, so the mesh is never in memory as
+	// a whole. Triangles stay in file order (optimizing needs all of
+	// them at once) and tangents are made a block at a time.
+	//
+	// Returns false if the cache couldn't be written
+	// --------------------------------------------------------
+	bool StreamObjToCache(const char* objFilePath, const char* cachePath, unsigned long long sourceHash, unsigned long long sourceSize,
+		unsigned int importFlags, const MeshOptions& options)
+	{
+		MeshCacheSink cache(cachePath, sourceHash, sourceSize, importFlags);
+		if (!cache.IsOpen())
+			return false;
+
+		TangentOptions tangentOptions;
+		tangentOptions.angleWeighted = options.angleWeightedTangents;
+		TangentSink sink(cache, tangentOptions);
+		ObjLoader::LoadStreaming(objFilePath, sink, options.importScratchBudget);
+		return cache.Finish();
+	}
+
+	// --------------------------------------------------------
+	// Splits interleaved vertices (Vertex or CompactVertex) into
+	// a position stream and a stream of everything else
+	// --------------------------------------------------------
+	template<typename Position, typename Attributes, typename V>
+	void SplitStreams(const V* vertices, size_t count, std::vector<Position>* positions, std::vector<Attributes>* attributes)
+	{
+		positions->resize(count);
+		attributes->resize(count);
+		for (size_t v = 0; v < count; v++)
+		{
+			(*positions)[v] = vertices[v].Position;
+			(*attributes)[v] = { vertices[v].UV, vertices[v].Normal, vertices[v].Tangent };
+		}
+	}
+}
 
-Mesh::Mesh(const char* n, Vertex* v, int vCount, unsigned int* i, int iCount) : vbView{}, ibView {}
+Mesh::Mesh(const char* n, Vertex* v, int vCount, unsigned int* i, int iCount, MeshOptions options) : options(options)
 {
 	name = n;
 	
+	Mesh::CalculateTangents(v, vCount, i, iCount);
 	Mesh::CreateBuffers(v, vCount, i, iCount);
 }
 
-Mesh::Mesh(const char* n, const char* objFilePath) : vbView{}, ibView{}, vbGPUDescriptorHandle{}
+Mesh::Mesh(const char* n, const char* objFilePath, MeshOptions options) : options(options)
 {
 	name = n;
 
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-	// 
-	// - You are allowed to directly copy/paste this into your code base
-	//   for assignments, given that you clearly cite that this is not
-	//   code of your own design.
-
-	// *************************************
-	//      IMPLEMENTATION NOTES (1/2)
-	//
-	//  - You'll need to #include both
-	//      <fstream> and <stdexcept>
-	//
-	//  - You will need to integrate
-	//      this code into a function or
-	//      constructor of your own making
-	//
-	//  - There is MORE TO DO after pasting 
-	//      this code in - see the bottom for
-	//      what to do *after* including 
-	//      this code in your mesh class
-	//
-	// *************************************
-
-	// File input object
-	std::ifstream obj(objFilePath);
-
-	// Check for successful open
-	if (!obj.is_open())
-		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
-
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
+	// Compressed assets already went through the import pipeline
+	if (IsCompressedMeshPath(objFilePath))
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+		MeshData data;
+		MeshCodec::Read(objFilePath, data);
+		Mesh::CreateBuffers(&data.vertices[0], (int)data.vertices.size(), &data.indices[0], (int)data.indices.size(),
+			data.submeshes.data(), data.submeshes.size());
+		return;
+	}
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
+	// Is there an up-to-date binary cache of this file? If so, the
+	// final vertices and indices go straight from the mapped file
+	// into the upload heap - no parsing, no tangents, no copies
+	std::string cachePath = MeshCacheFile::GetPathFor(objFilePath);
+	unsigned long long sourceHash = 0, sourceSize = 0;
+	bool sourceReadable = MeshCacheFile::HashFile(objFilePath, &sourceHash, &sourceSize);
+	unsigned int importFlags = (options.angleWeightedTangents ? MeshImportAngleWeightedTangents : 0) |
+		(options.importScratchBudget > 0 ? MeshImportStreamed : 0);
+	auto createFromCache = [&]()
 		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
-		}
+			MeshCacheFile cache(cachePath.c_str(), sourceHash, sourceSize, importFlags);
+			if (!cache.IsValid())
+				return false;
+
+			const MeshCacheHeader* header = cache.GetHeader();
+			const std::vector<SubmeshRange>& cachedSubmeshes = cache.GetSubmeshes();
+			Mesh::CreateBuffers(cache.GetVertices(), (int)header->vertexCount, cache.GetIndices(), (int)header->indexCount,
+				cachedSubmeshes.data(), cachedSubmeshes.size());
+			return true;
+		};
+	if (sourceReadable && createFromCache())
+		return;
+
+	// Streamed imports are uploaded from the cache they were written into.
+	// If it can't be written, the file is imported in memory after all.
+	if (sourceReadable && options.importScratchBudget > 0)
+	{
+		if (StreamObjToCache(objFilePath, cachePath.c_str(), sourceHash, sourceSize, importFlags, options) && createFromCache())
+			return;
+		importFlags &= ~MeshImportStreamed;
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
-
-	// *************************************
-	//      IMPLEMENTATION NOTES (2/2)
-	//
-	// - At this point, "verts" is a std::vector 
-	//     of Vertex structs, and can be used
-	//     to create your mesh's vertex buffer
-	//
-	// - NOTE: Use &verts[0] for the address of 
-	//     the first vertx, NOT JUST &verts
-	//
-	// - The vector "indices" is similar. It's 
-	//     a std::vector of unsigned ints and
-	//     can be used to create the index 
-	//     buffer (again, &indices[0] is the 
-	//     address of the first integer)
-	//
-	// - Make sure your mesh class actually SAVES
-	//     the number of vertices and indices, or
-	//     drawing may have unintended problems.
-	//     - "vertCounter" is the number of vertices
-	//     - "indexCounter" is the number of indices
-	//
-	// - If you dig into the code, you may notice 
-	//     that  "vertCounter" and "indexCounter" 
-	//     end up being the same.  Recall that OBJs 
-	//     do not index entire vertices, making
-	//     it complex to detect duplicate vertices.
-	//     This also means an index buffer isn't
-	//     doing much for us.  We could try to 
-	//     detect duplicate vertices ourselves, 
-	//     but at that point it would be better 
-	//     to use a more sophisticated mesh loading
-	//     library like TinyOBJLoader or 
-	//     The Open Asset Importer Library, both
-	//     of which are unnecessary for now.
-	//
-	// *************************************
+	MeshData data;
+	ImportObj(objFilePath, options, data);
+	int vertCounter = (int)data.vertices.size();
+	int indexCounter = (int)data.indices.size();
 
-	// Calling the Tangent calculation 
-	Mesh::CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
+	// Save the final data so the next run can skip all of the above
+	if (sourceReadable)
+		MeshCacheFile::Write(cachePath.c_str(), data, sourceHash, sourceSize, importFlags);
 
 	// Creating the buffer
-	Mesh::CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
+	Mesh::CreateBuffers(&data.vertices[0], vertCounter, &data.indices[0], indexCounter, data.submeshes.data(), data.submeshes.size());
+}
+
+// --------------------------------------------------------
+// Runs an OBJ file through the import pipeline and saves the
+// result as a compressed .meshz file, which loads with nothing
+// but a decode - see MeshCodec.h
+// - Compressing needs the whole mesh, so it's always imported
+//   in memory, whatever importScratchBudget says
+//
+// Returns false if the file couldn't be written
+// --------------------------------------------------------
+bool Mesh::ExportCompressed(const char* objFilePath, const char* meshzFilePath, MeshOptions options)
+{
+	MeshData data;
+	ImportObj(objFilePath, options, data);
+
+	unsigned int importFlags = options.angleWeightedTangents ? MeshImportAngleWeightedTangents : 0;
+	return MeshCodec::Write(meshzFilePath, data, importFlags);
+}
+
+// --------------------------------------------------------
+// Creates a mesh from already loaded geometry
+// - Tangents are only calculated if the source didn't have them
+// --------------------------------------------------------
+Mesh::Mesh(const char* n, MeshData& data, bool hasTangents, MeshOptions options) : options(options)
+{
+	name = n;
+
+	MeshOptimizer::Optimize(data);
+	if (!hasTangents)
+		Mesh::CalculateTangents(&data.vertices[0], (int)data.vertices.size(), &data.indices[0], (int)data.indices.size());
+
+	Mesh::CreateBuffers(&data.vertices[0], (int)data.vertices.size(), &data.indices[0], (int)data.indices.size(),
+		data.submeshes.data(), data.submeshes.size());
+}
+
+// --------------------------------------------------------
+// Loads every triangle primitive of a .glb file as its own
+// mesh, named "<mesh name>" or "<mesh name>/<primitive>"
+// --------------------------------------------------------
+std::vector<std::shared_ptr<Mesh>> Mesh::LoadGlb(const char* glbFilePath, MeshOptions options)
+{
+	std::vector<GlbPrimitive> primitives;
+	GlbLoader::Load(glbFilePath, primitives);
+
+	std::vector<std::shared_ptr<Mesh>> result;
+	for (GlbPrimitive& primitive : primitives)
+		result.push_back(std::make_shared<Mesh>(primitive.name.c_str(), primitive.data, primitive.hasTangents, options));
+	return result;
 }
 
-void Mesh::CreateBuffers(Vertex* v, int vCount, unsigned int* i, int iCount)
+// --------------------------------------------------------
+// Uploads the final vertex and index data to the GPU
+// - Tangents must already be calculated at this point
+// - Vertices are quantized here if the mesh was created with
+//   compactVertices (and its UVs fit in half floats), and
+//   indices are narrowed to 16 bits
+//   whenever every index fits
+// - submeshRanges must cover the indices in order (none means
+//   the whole mesh is one submesh)
+// - With buildMeshlets, indices are uploaded in meshlet order
+// - Simplified LODs are appended after the full mesh's indices
+// --------------------------------------------------------
+void Mesh::CreateBuffers(const Vertex* v, int vCount, const unsigned int* i, int iCount, const SubmeshRange* submeshRanges, size_t submeshRangeCount)
 {
 	vertexCount = vCount;
 	indexCount = iCount;
 
-	CalculateTangents(v, vCount, i, iCount);
+	std::vector<SubmeshRange> ranges = GetSubmeshRanges(submeshRanges, submeshRangeCount, (unsigned int)iCount);
+	submeshes.clear();
+	for (const SubmeshRange& range : ranges)
+		submeshes.push_back({ range.material, 0, 0, { { range.firstIndex, range.indexCount, 0.0f } } });
+
+	std::vector<unsigned int> meshletIndices;
+	if (options.buildMeshlets)
+	{
+		// Submeshes get meshlets of their own, appended one after another,
+		// so unpacking them leaves each submesh's triangles in its own range
+		meshlets = {};
+		MeshletData part;
+		for (Submesh& submesh : submeshes)
+		{
+			Meshlets::Build(part, v, vCount, i + submesh.lods[0].firstIndex, submesh.lods[0].indexCount);
+			submesh.firstMeshlet = (unsigned int)meshlets.meshlets.size();
+			submesh.meshletCount = (unsigned int)part.meshlets.size();
+			for (Meshlet meshlet : part.meshlets)
+			{
+				meshlet.vertexOffset += (unsigned int)meshlets.vertices.size();
+				meshlet.triangleOffset += (unsigned int)meshlets.triangles.size();
+				meshlets.meshlets.push_back(meshlet);
+			}
+			meshlets.vertices.insert(meshlets.vertices.end(), part.vertices.begin(), part.vertices.end());
+			meshlets.triangles.insert(meshlets.triangles.end(), part.triangles.begin(), part.triangles.end());
+		}
+
+		meshletIndices.resize(meshlets.triangles.size());
+		Meshlets::Unpack(&meshletIndices[0], meshlets);
+		i = &meshletIndices[0];
+
+#if defined(DEBUG) | defined(_DEBUG)
+		printf("  Meshlets: %zu (avg %.1f vertices, %.1f triangles)\n", meshlets.meshlets.size(),
+			meshlets.vertices.size() / (float)meshlets.meshlets.size(), iCount / 3.0f / meshlets.meshlets.size());
+#endif
+	}
+
+	// LOD 0 is the full mesh, and every other level shares its vertices.
+	// Each submesh is simplified on its own, so materials never mix
+	std::vector<unsigned int> lodIndices;
+	if (options.lodCount > 0)
+	{
+		lodIndices.assign(i, i + iCount);
+		for (Submesh& submesh : submeshes)
+		{
+			MeshLod full = submesh.lods[0];
+			std::vector<MeshSimplifier::Lod> chain = MeshSimplifier::BuildLodChain(i + full.firstIndex, full.indexCount, v, vCount, options.lodCount);
+
+			for (const MeshSimplifier::Lod& lod : chain)
+			{
+				submesh.lods.push_back({ (unsigned int)lodIndices.size(), (unsigned int)lod.indices.size(), lod.error });
+				lodIndices.insert(lodIndices.end(), lod.indices.begin(), lod.indices.end());
+
+#if defined(DEBUG) | defined(_DEBUG)
+				printf("  LOD %zu: %zu triangles, error %f%s%s\n", submesh.lods.size() - 1, lod.indices.size() / 3, lod.error,
+					submesh.material.empty() ? "" : " - ", submesh.material.c_str());
+#endif
+			}
+		}
+
+		i = &lodIndices[0];
+		iCount = (int)lodIndices.size();
+	}
+
+	// A mesh level is as far off as its worst submesh
+	size_t levels = 0;
+	for (const Submesh& submesh : submeshes)
+		levels = (std::max)(levels, submesh.lods.size());
+	lodErrors.assign(levels, 0.0f);
+	for (const Submesh& submesh : submeshes)
+		for (size_t level = 0; level < levels; level++)
+			lodErrors[level] = (std::max)(lodErrors[level], submesh.lods[(std::min)(level, submesh.lods.size() - 1)].error);
+
+	// Object space bounds for culling, LOD selection and quantization
+	BoundingVolumes::Compute(&bounds, v, vCount);
+
+	arena = GeometryArena::Shared();
+
+	// Every range goes in one batch, so one ticket says when the mesh is ready
+	Graphics::BeginUploadBatch();
+
+	// Half float UVs are only precise enough close to [0, 1], so meshes
+	// with tiled UVs keep full vertices rather than letting textures swim
+	compactVertices = options.compactVertices && VertexQuantization::FitsHalfPrecisionUVs(v, vCount);
+#if defined(DEBUG) | defined(_DEBUG)
+	if (options.compactVertices && !compactVertices)
+		printf("  Compact vertices: skipped, UVs go past +-%.0f\n", MaxHalfPrecisionUV);
+#endif
+
+	size_t vertexStride = sizeof(Vertex);
+	if (compactVertices)
+	{
+		std::vector<CompactVertex> compact(vCount);
+		VertexQuantization::Encode(&compact[0], v, vCount, bounds.min, bounds.max);
+
+		vertexStride = sizeof(CompactVertex);
+		if (options.splitPositionStream)
+		{
+			std::vector<DirectX::PackedVector::XMUSHORTN4> compactPositions;
+			std::vector<CompactVertexAttributes> compactAttributes;
+			SplitStreams(&compact[0], vCount, &compactPositions, &compactAttributes);
+
+			vertexAllocation = arena->AllocateVertices(&compactPositions[0], sizeof(compactPositions[0]), vCount);
+			attributeAllocation = arena->AllocateVertices(&compactAttributes[0], sizeof(CompactVertexAttributes), vCount);
+		}
+		else
+		{
+			vertexAllocation = arena->AllocateVertices(&compact[0], vertexStride, vCount);
+		}
 
-	vertexBuffer = Graphics::CreateStaticBuffer(sizeof(Vertex), vCount, v);
-	indexBuffer = Graphics::CreateStaticBuffer(sizeof(unsigned int), iCount, i);
+#if defined(DEBUG) | defined(_DEBUG)
+		QuantizationError error = VertexQuantization::MeasureError(v, vCount);
+		printf("  Compact vertices: max error position %f, UV %f, normal %.3f deg, tangent %.3f deg\n",
+			error.position, error.uv, error.normalDegrees, error.tangentDegrees);
+#endif
+	}
+	else if (options.splitPositionStream)
+	{
+		std::vector<VertexAttributes> attributes;
+		SplitStreams(v, vCount, &positions, &attributes);
 
-	// Set up the views
-	vbView.StrideInBytes = (UINT)sizeof(Vertex);
-	vbView.SizeInBytes = (UINT)sizeof(Vertex) * vCount;
-	vbView.BufferLocation = vertexBuffer->GetGPUVirtualAddress();
+		vertexAllocation = arena->AllocateVertices(&positions[0], sizeof(XMFLOAT3), vCount);
+		attributeAllocation = arena->AllocateVertices(&attributes[0], sizeof(VertexAttributes), vCount);
+	}
+	else
+	{
+		vertexAllocation = arena->AllocateVertices(v, vertexStride, vCount);
+	}
 
-	ibView.Format = DXGI_FORMAT_R32_UINT;
-	ibView.SizeInBytes = (UINT)(sizeof(unsigned int) * iCount);
-	ibView.BufferLocation = indexBuffer->GetGPUVirtualAddress();
+	// CPU side geometry passes get full precision positions either way
+	if (options.splitPositionStream && positions.empty())
+	{
+		positions.resize(vCount);
+		for (int p = 0; p < vCount; p++)
+			positions[p] = v[p].Position;
+	}
 
-	// -- Bindless --
-	//Set up an SRV for the vertices
-	D3D12_CPU_DESCRIPTOR_HANDLE vbCPUHandle;
-	Graphics::ReserveDescriptorHeapSlot(&vbCPUHandle, &vbGPUDescriptorHandle);
+	size_t indexStride = sizeof(unsigned int);
+	if (vCount < 65536)
+	{
+		std::vector<unsigned short> shortIndices(i, i + iCount);
 
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
-	srvDesc.Format = DXGI_FORMAT_UNKNOWN; // No format since vertices are structs
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER; // Dimension buffer - ?
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING; // ?
-	srvDesc.Buffer.FirstElement = 0; // ?
-	srvDesc.Buffer.NumElements = (unsigned int)vertexCount; // Number of vertices
-	srvDesc.Buffer.StructureByteStride = sizeof(Vertex); // Size of one vertex
-	srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE; // ?
-	Graphics::Device->CreateShaderResourceView(vertexBuffer.Get(), &srvDesc, vbCPUHandle);
+		indexStride = sizeof(unsigned short);
+		indexAllocation = arena->AllocateIndices(&shortIndices[0], indexStride, iCount);
+	}
+	else
+	{
+		indexAllocation = arena->AllocateIndices(i, indexStride, iCount);
+	}
 
+	indexFormat = indexStride == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	uploadTicket = Graphics::EndUploadBatch(false);
 }
 
 
-Mesh::~Mesh() {}
+Mesh::~Mesh()
+{
+	arena->Free(vertexAllocation);
+	arena->Free(indexAllocation);
+	if (options.splitPositionStream)
+		arena->Free(attributeAllocation);
+}
 
-const char* Mesh::GetName() { return name; }
-Microsoft::WRL::ComPtr<ID3D12Resource> Mesh::GetVertexBuffer() { return vertexBuffer; };
-Microsoft::WRL::ComPtr<ID3D12Resource> Mesh::GetIndexBuffer() { return indexBuffer; };
-D3D12_GPU_DESCRIPTOR_HANDLE Mesh::GetVertexBufferGPUDescriptorHandle() { return vbGPUDescriptorHandle;  }
+const char* Mesh::GetName() { return name.c_str(); }
+bool Mesh::IsReady() { return Graphics::IsUploadComplete(uploadTicket); }
+Microsoft::WRL::ComPtr<ID3D12Resource> Mesh::GetVertexBuffer() { return arena->GetVertexBuffer(); };
+Microsoft::WRL::ComPtr<ID3D12Resource> Mesh::GetIndexBuffer() { return arena->GetIndexBuffer(); };
+D3D12_GPU_DESCRIPTOR_HANDLE Mesh::GetVertexBufferGPUDescriptorHandle() { return arena->GetVertexBufferGPUDescriptorHandle();  }
 int Mesh::GetIndexCount() { return indexCount; }
 int Mesh::GetVertexCount() { return vertexCount; }
-D3D12_VERTEX_BUFFER_VIEW Mesh::GetVBView() { return vbView; }
-D3D12_INDEX_BUFFER_VIEW Mesh::GetIBView() { return ibView; }
+bool Mesh::HasCompactVertices() { return compactVertices; }
+XMFLOAT3 Mesh::GetBoundsMin() { return bounds.min; }
+XMFLOAT3 Mesh::GetBoundsMax() { return bounds.max; }
+const MeshBounds& Mesh::GetBounds() { return bounds; }
+bool Mesh::HasMeshlets() { return !meshlets.meshlets.empty(); }
+const MeshletData& Mesh::GetMeshlets() { return meshlets; }
+unsigned int Mesh::GetSubmeshCount() { return (unsigned int)submeshes.size(); }
+const Submesh& Mesh::GetSubmesh(unsigned int submesh) { return submeshes[submesh]; }
+unsigned int Mesh::GetLodCount() { return (unsigned int)lodErrors.size(); }
+
+int Mesh::FindSubmesh(const char* material) { return FindSubmeshByMaterial(submeshes, material); }
+
+// Submeshes with fewer levels than the mesh use their coarsest one
+MeshLod Mesh::GetLod(unsigned int submesh, unsigned int lod)
+{
+	const std::vector<MeshLod>& lods = submeshes[submesh].lods;
+	return lods[(std::min)((size_t)lod, lods.size() - 1)];
+}
 
 // --------------------------------------------------------
-// Author: Chris Cascioli
-// Purpose: Calculates the tangents of the vertices in a mesh
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+// Picks the coarsest LOD whose error, projected to the screen,
+// is at most maxPixelError
 //
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
-//
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// pixelsPerUnit - Pixels covered by one object space unit at the mesh's distance
+// currentLod - The LOD drawn last frame, for hysteresis
 // --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+unsigned int Mesh::SelectLod(float pixelsPerUnit, unsigned int currentLod, float maxPixelError)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	unsigned int selected = 0;
+	for (unsigned int lod = 1; lod < lodErrors.size(); lod++)
 	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
+		float limit = lod > currentLod ? maxPixelError * (1.0f - LodHysteresis) : maxPixelError;
+		if (lodErrors[lod] * pixelsPerUnit > limit)
+			break;
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
+		selected = lod;
 	}
+	return selected;
+}
+D3D12_INDEX_BUFFER_VIEW Mesh::GetIBView() { return arena->GetIndexBufferView(indexFormat); }
+unsigned int Mesh::GetVertexByteOffset() { return arena->GetVertexByteOffset(vertexAllocation); }
+bool Mesh::HasSplitPositions() { return options.splitPositionStream; }
+unsigned int Mesh::GetAttributeByteOffset() { return options.splitPositionStream ? arena->GetVertexByteOffset(attributeAllocation) : 0; }
+std::span<const XMFLOAT3> Mesh::GetPositions() { return positions; }
+unsigned int Mesh::GetFirstIndex() { return arena->GetFirstIndex(indexAllocation); }
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
-	}
+// --------------------------------------------------------
+// Calculates the tangents of the vertices in a mesh
+// 
+// - The math is Lengyel's (originally adapted by Chris Cascioli from
+//   http://www.terathon.com/code/tangent.html, listing 7.4 of
+//   http://foundationsofgameenginedev.com/FGED2-sample.pdf)
+// - The work happens in TangentGenerator, which runs it in a single
+//   pass, 8 triangles at a time on CPUs with AVX2
+// - Triangles with degenerate UVs are skipped instead of adding
+//   infinities to their vertices
+//
+// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// --------------------------------------------------------
+void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	TangentOptions tangentOptions;
+	tangentOptions.angleWeighted = options.angleWeightedTangents;
+	TangentGenerator::Generate(verts, (size_t)numVerts, indices, (size_t)numIndices, tangentOptions);
 }
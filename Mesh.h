@@ -2,21 +2,95 @@
 #include <d3d12.h>
 #include<wrl/client.h>
 #include "Vertex.h"
+#include "GeometryArena.h"
 #include "Graphics.h"
+#include "MeshBounds.h"
+#include "MeshData.h"
+#include "Meshlets.h"
 #include <DirectXMath.h>
-#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
 #include <stdexcept>
 #include <vector>
 
+// --------------------------------------------------------
+// How a mesh's data is stored on the GPU
+// --------------------------------------------------------
+struct MeshOptions
+{
+	bool compactVertices = false;	// CompactVertex (20 bytes) instead of Vertex (44 bytes) where the UVs allow - see VertexQuantization.h
+	bool buildMeshlets = false;		// Split into meshlets for per-cluster culling, with indices stored in meshlet order
+	unsigned int lodCount = 0;		// Simplified levels of detail to generate, each with about half the triangles of the last
+	bool angleWeightedTangents = false;	// Weight each triangle's tangent by its corner angle instead of its area - see TangentGenerator.h
+	size_t importScratchBudget = 0;		// When not 0, OBJ files are streamed into their .meshbin cache holding at most this many bytes (unoptimized, tangents per block) - see ObjLoader::LoadStreaming
+	bool splitPositionStream = false;	// Store positions apart from the other attributes, and keep a CPU copy of them
+
+	bool operator==(const MeshOptions&) const = default;
+};
+
+// --------------------------------------------------------
+// A level of detail: a range of the mesh's index buffer
+// --------------------------------------------------------
+struct MeshLod
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	float error;	// Object space distance from the full detail surface
+};
+
+// --------------------------------------------------------
+// The part of a mesh drawn with one material
+//
+// - lods[0] is the submesh at full detail, and every level
+//   after it is a range of the index buffer too. Submeshes
+//   may run out of levels before the mesh does, in which
+//   case their coarsest one stands in for the rest
+// - Its meshlets (if built) are meshlets [firstMeshlet,
+//   firstMeshlet + meshletCount), which never mix submeshes
+// --------------------------------------------------------
+struct Submesh
+{
+	std::string material;	// Name from the source file's usemtl (empty if none)
+	unsigned int firstMeshlet;
+	unsigned int meshletCount;
+	std::vector<MeshLod> lods;
+};
+
 /*
 * This Mesh class makes use of the predefined Vertex struct.
 * If you want to draw images that use vertices of a different format, e.g, only RGBA or some depth factor, or some shade value, need to rework this class/
 *
 *
-* GetVertexBuffer(): Returns the vertex buffer ComPtr
-* GetIndexBuffer(): Returns the index buffer ComPtr
+* IsReady(): Whether the mesh's data has finished uploading - meshes created inside an upload batch
+*            that ends without waiting are copied in the background, and can't be drawn until then
+* GetVertexBuffer(): Returns the vertex buffer ComPtr (shared by every mesh - see GeometryArena.h)
+* GetIndexBuffer(): Returns the index buffer ComPtr (also shared)
+* GetVertexByteOffset(): Where this mesh's vertices (or just positions, if split) start in the vertex buffer
+* HasSplitPositions(): Whether positions are a separate stream - float3 (or 8-byte quantized, if compact),
+*                      followed elsewhere by VertexAttributes (or CompactVertexAttributes)
+* GetAttributeByteOffset(): Where the non-position stream starts, when split
+* GetPositions(): Full precision object space positions, one per vertex (empty unless split)
+* GetFirstIndex(): Where this mesh's indices start in the index buffer - add it to every StartIndexLocation
 * GetIndexCount(): Returns the number of indices this mesh contains
 * GetVertexCount(): Returns the number of vertices this mesh contains
+* HasCompactVertices(): Whether the vertex buffer holds CompactVertex rather than Vertex (which it doesn't,
+*                       even when asked for, if the UVs go past MaxHalfPrecisionUV)
+* GetBoundsMin() / GetBoundsMax(): Object space bounds, which compact positions are relative to
+* GetBounds(): Object space AABB, sphere and oriented box, fit once at load time
+* HasMeshlets() / GetMeshlets(): The mesh's meshlets, if built. Each one's triangles can be drawn on their
+*                                own starting at index meshlet.triangleOffset
+* GetSubmeshCount() / GetSubmesh(): Ranges of the shared buffers, one per material, each drawn on its own.
+*                                   Meshes without materials have a single submesh covering everything
+* FindSubmesh(): The submesh using a given material name, or -1
+* GetLodCount() / GetLod(): Levels of detail, where 0 is the full mesh (meshlets only cover LOD 0). GetLod()
+*                           gives one submesh's index range at a level
+* SelectLod(): Picks the coarsest LOD whose error (the worst of all submeshes') stays under a pixel limit on screen
+* LoadGlb(): Creates a mesh for every triangle primitive in a binary glTF file - see GlbLoader.h
+* ExportCompressed(): Imports an OBJ file and saves the result as a .meshz file, which the
+*                     file constructor then loads in place of the OBJ - see MeshCodec.h
+*
+* Index buffers are 16-bit whenever the mesh has few enough vertices, 32-bit otherwise
 * Draw(): Sets the buffers and draws using the correct number of indices
 * Refer to Game::Draw() to see the code necessary for setting buffers and drawing
 */
@@ -29,40 +103,70 @@ class Mesh
 public:
 
 	// ~ Constructor, Copy Constructor, Copy Assignment, Destructor
-	Mesh(const char* name, Vertex* v, int vCount, unsigned int* i, int iCount); // Constructor
-	Mesh(const char* name, const char* objFilePath);
+	Mesh(const char* name, Vertex* v, int vCount, unsigned int* i, int iCount, MeshOptions options = {}); // Constructor
+	Mesh(const char* name, const char* objFilePath, MeshOptions options = {});
+	Mesh(const char* name, MeshData& data, bool hasTangents, MeshOptions options = {});
 
-	void CreateBuffers(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	static std::vector<std::shared_ptr<Mesh>> LoadGlb(const char* glbFilePath, MeshOptions options = {});
+	static bool ExportCompressed(const char* objFilePath, const char* meshzFilePath, MeshOptions options = {});
 
-	//Mesh(const Mesh& other); // Copy Constructor
-	//Mesh& operator= (const Mesh& other); // Copy Assignment
+	void CreateBuffers(const Vertex* verts, int numVerts, const unsigned int* indices, int numIndices,
+		const SubmeshRange* submeshRanges = 0, size_t submeshRangeCount = 0);
+
+	Mesh(const Mesh& other) = delete; // Copy Constructor - a copy would free the arena ranges twice
+	Mesh& operator= (const Mesh& other) = delete; // Copy Assignment
 	~Mesh();
 	const char* GetName();
+	bool IsReady();
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D12Resource> GetIndexBuffer();
 
 	D3D12_GPU_DESCRIPTOR_HANDLE GetVertexBufferGPUDescriptorHandle();
 
-	D3D12_VERTEX_BUFFER_VIEW GetVBView();
 	D3D12_INDEX_BUFFER_VIEW GetIBView();
+	unsigned int GetVertexByteOffset();
+	bool HasSplitPositions();
+	unsigned int GetAttributeByteOffset();
+	std::span<const DirectX::XMFLOAT3> GetPositions();
+	unsigned int GetFirstIndex();
 	
 
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 	
 	int GetIndexCount();
 	int GetVertexCount();
+	bool HasCompactVertices();
+	DirectX::XMFLOAT3 GetBoundsMin();
+	DirectX::XMFLOAT3 GetBoundsMax();
+	const MeshBounds& GetBounds();
+	bool HasMeshlets();
+	const MeshletData& GetMeshlets();
+	unsigned int GetSubmeshCount();
+	const Submesh& GetSubmesh(unsigned int submesh);
+	int FindSubmesh(const char* material);
+	unsigned int GetLodCount();
+	MeshLod GetLod(unsigned int submesh, unsigned int lod);
+	unsigned int SelectLod(float pixelsPerUnit, unsigned int currentLod, float maxPixelError);
 	
 
 private:
-	Microsoft::WRL::ComPtr<ID3D12Resource> vertexBuffer; // Contains all the necessary vertices
-	Microsoft::WRL::ComPtr<ID3D12Resource> indexBuffer; // Contains all the indices - drawn in groups of 3 (triangle drawing mode)
-	D3D12_VERTEX_BUFFER_VIEW vbView;
-	D3D12_INDEX_BUFFER_VIEW ibView;
-
-	//Bindless
-	D3D12_GPU_DESCRIPTOR_HANDLE vbGPUDescriptorHandle;
+	// Ranges of the shared vertex and index buffers
+	std::shared_ptr<GeometryArena> arena;
+	GeometryArena::Allocation vertexAllocation; // Or positions, when split
+	GeometryArena::Allocation attributeAllocation;
+	GeometryArena::Allocation indexAllocation; // Drawn in groups of 3 (triangle drawing mode)
+	DXGI_FORMAT indexFormat;
+	UploadTicket uploadTicket; // Copies into the ranges above, which can't be drawn until it's complete
 
-	const char* name;
+	std::string name;
 	int indexCount, vertexCount;
+
+	MeshOptions options;
+	bool compactVertices; // options.compactVertices, unless the UVs need more than half floats
+	MeshBounds bounds;
+	std::vector<DirectX::XMFLOAT3> positions;
+	MeshletData meshlets;
+	std::vector<Submesh> submeshes;
+	std::vector<float> lodErrors; // Worst error of any submesh, per level
 };
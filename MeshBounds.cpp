@@ -0,0 +1,372 @@
+#include "MeshBounds.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Jacobi sweeps are quadratic, so 3x3 matrices settle in a handful;
+	// this is only a cap for pathological input
+	const int MaxJacobiSweeps = 32;
+
+	const XMFLOAT3& PointAt(const XMFLOAT3* points, size_t index, size_t stride)
+	{
+		return *(const XMFLOAT3*)((const char*)points + index * stride);
+	}
+
+	float Volume(const XMFLOAT3& extents)
+	{
+		return extents.x * extents.y * extents.z;
+	}
+
+	// --------------------------------------------------------
+	// Eigenvectors of a symmetric 3x3 matrix by cyclic Jacobi
+	// rotations. The columns of vectors are the eigenvectors,
+	// and the matrix is left (nearly) diagonal
+	// --------------------------------------------------------
+	void SymmetricEigenvectors(double matrix[3][3], double vectors[3][3])
+	{
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				vectors[r][c] = r == c ? 1.0 : 0.0;
+
+		for (int sweep = 0; sweep < MaxJacobiSweeps; sweep++)
+		{
+			double offDiagonal = matrix[0][1] * matrix[0][1] + matrix[0][2] * matrix[0][2] + matrix[1][2] * matrix[1][2];
+			double diagonal = matrix[0][0] * matrix[0][0] + matrix[1][1] * matrix[1][1] + matrix[2][2] * matrix[2][2];
+			if (offDiagonal <= diagonal * 1e-24)
+				break;
+
+			for (int p = 0; p < 2; p++)
+			{
+				for (int q = p + 1; q < 3; q++)
+				{
+					if (matrix[p][q] == 0.0)
+						continue;
+
+					// Rotation that zeroes matrix[p][q]
+					double theta = (matrix[q][q] - matrix[p][p]) / (2.0 * matrix[p][q]);
+					double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+					double c = 1.0 / std::sqrt(t * t + 1.0);
+					double s = t * c;
+
+					for (int k = 0; k < 3; k++)
+					{
+						double kp = matrix[k][p], kq = matrix[k][q];
+						matrix[k][p] = c * kp - s * kq;
+						matrix[k][q] = s * kp + c * kq;
+					}
+					for (int k = 0; k < 3; k++)
+					{
+						double pk = matrix[p][k], qk = matrix[q][k];
+						matrix[p][k] = c * pk - s * qk;
+						matrix[q][k] = s * pk + c * qk;
+					}
+					for (int k = 0; k < 3; k++)
+					{
+						double kp = vectors[k][p], kq = vectors[k][q];
+						vectors[k][p] = c * kp - s * kq;
+						vectors[k][q] = s * kp + c * kq;
+					}
+				}
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// The most a matrix can lengthen any vector: its largest
+	// singular value. The longest row undershoots this when a
+	// non-uniform scale sits between two rotations
+	// --------------------------------------------------------
+	float MaxStretch(FXMMATRIX m)
+	{
+		double gram[3][3];
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				gram[r][c] = (double)XMVectorGetX(XMVector3Dot(m.r[r], m.r[c]));
+
+		double vectors[3][3];
+		SymmetricEigenvectors(gram, vectors);
+		double largest = std::fmax(gram[0][0], std::fmax(gram[1][1], gram[2][2]));
+		return (float)std::sqrt(std::fmax(largest, 0.0));
+	}
+}
+
+// --------------------------------------------------------
+// Fits every bounding volume to a mesh's positions
+// --------------------------------------------------------
+void BoundingVolumes::Compute(MeshBounds* bounds, const Vertex* vertices, size_t count)
+{
+	*bounds = {};
+	if (count == 0)
+		return;
+
+	const XMFLOAT3* positions = &vertices[0].Position;
+	ComputeMinMax(positions, count, sizeof(Vertex), &bounds->min, &bounds->max);
+
+	XMVECTOR minimum = XMLoadFloat3(&bounds->min);
+	XMVECTOR maximum = XMLoadFloat3(&bounds->max);
+	XMVECTOR boxCenter = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+	XMStoreFloat3(&bounds->box.Center, boxCenter);
+	XMStoreFloat3(&bounds->box.Extents, XMVectorScale(XMVectorSubtract(maximum, minimum), 0.5f));
+
+	// Ritter's sphere is usually the smaller one, but the box's
+	// circumscribed center wins on long, symmetric shapes
+	ComputeSphere(positions, count, sizeof(Vertex), &bounds->sphere);
+	float boxRadiusSq = 0.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&vertices[i].Position), boxCenter);
+		boxRadiusSq = std::fmax(boxRadiusSq, XMVectorGetX(XMVector3LengthSq(offset)));
+	}
+	if (std::sqrt(boxRadiusSq) < bounds->sphere.Radius)
+	{
+		XMStoreFloat3(&bounds->sphere.Center, boxCenter);
+		bounds->sphere.Radius = std::sqrt(boxRadiusSq);
+	}
+
+	// PCA does poorly on shapes whose covariance is nearly
+	// isotropic (cubes, for one), so fall back to the AABB
+	ComputeOrientedBox(positions, count, sizeof(Vertex), &bounds->orientedBox);
+	if (Volume(bounds->box.Extents) <= Volume(bounds->orientedBox.Extents))
+	{
+		bounds->orientedBox.Center = bounds->box.Center;
+		bounds->orientedBox.Extents = bounds->box.Extents;
+		bounds->orientedBox.Orientation = XMFLOAT4(0, 0, 0, 1);
+	}
+}
+
+// --------------------------------------------------------
+// Component-wise min and max of a set of points
+// - Four independent accumulators keep the vector min/max
+//   units busy instead of waiting on one dependency chain
+// --------------------------------------------------------
+void BoundingVolumes::ComputeMinMax(const XMFLOAT3* points, size_t count, size_t stride, XMFLOAT3* min, XMFLOAT3* max)
+{
+	if (count == 0)
+	{
+		*min = XMFLOAT3(0, 0, 0);
+		*max = XMFLOAT3(0, 0, 0);
+		return;
+	}
+
+	XMVECTOR first = XMLoadFloat3(&PointAt(points, 0, stride));
+	XMVECTOR min0 = first, min1 = first, min2 = first, min3 = first;
+	XMVECTOR max0 = first, max1 = first, max2 = first, max3 = first;
+
+	size_t i = 1;
+	for (; i + 4 <= count; i += 4)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&PointAt(points, i + 0, stride));
+		XMVECTOR p1 = XMLoadFloat3(&PointAt(points, i + 1, stride));
+		XMVECTOR p2 = XMLoadFloat3(&PointAt(points, i + 2, stride));
+		XMVECTOR p3 = XMLoadFloat3(&PointAt(points, i + 3, stride));
+		min0 = XMVectorMin(min0, p0); max0 = XMVectorMax(max0, p0);
+		min1 = XMVectorMin(min1, p1); max1 = XMVectorMax(max1, p1);
+		min2 = XMVectorMin(min2, p2); max2 = XMVectorMax(max2, p2);
+		min3 = XMVectorMin(min3, p3); max3 = XMVectorMax(max3, p3);
+	}
+	for (; i < count; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&PointAt(points, i, stride));
+		min0 = XMVectorMin(min0, p);
+		max0 = XMVectorMax(max0, p);
+	}
+
+	XMStoreFloat3(min, XMVectorMin(XMVectorMin(min0, min1), XMVectorMin(min2, min3)));
+	XMStoreFloat3(max, XMVectorMax(XMVectorMax(max0, max1), XMVectorMax(max2, max3)));
+}
+
+// --------------------------------------------------------
+// Ritter's bounding sphere: start from the most distant pair of
+// axis extremes, then grow to include every point
+// --------------------------------------------------------
+void BoundingVolumes::ComputeSphere(const XMFLOAT3* points, size_t count, size_t stride, BoundingSphere* sphere)
+{
+	sphere->Center = XMFLOAT3(0, 0, 0);
+	sphere->Radius = 0.0f;
+	if (count == 0)
+		return;
+
+	size_t extremes[6] = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		const XMFLOAT3& p = PointAt(points, i, stride);
+		if (p.x < PointAt(points, extremes[0], stride).x) extremes[0] = i;
+		if (p.x > PointAt(points, extremes[1], stride).x) extremes[1] = i;
+		if (p.y < PointAt(points, extremes[2], stride).y) extremes[2] = i;
+		if (p.y > PointAt(points, extremes[3], stride).y) extremes[3] = i;
+		if (p.z < PointAt(points, extremes[4], stride).z) extremes[4] = i;
+		if (p.z > PointAt(points, extremes[5], stride).z) extremes[5] = i;
+	}
+
+	XMVECTOR a = XMVectorZero(), b = XMVectorZero();
+	float longest = -1.0f;
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&PointAt(points, extremes[axis * 2], stride));
+		XMVECTOR p1 = XMLoadFloat3(&PointAt(points, extremes[axis * 2 + 1], stride));
+		float distance = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p1, p0)));
+		if (distance > longest)
+		{
+			longest = distance;
+			a = p0;
+			b = p1;
+		}
+	}
+
+	XMVECTOR c = XMVectorScale(XMVectorAdd(a, b), 0.5f);
+	float r = std::sqrt(longest) * 0.5f;
+	for (size_t i = 0; i < count; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&PointAt(points, i, stride));
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(p, c)));
+		if (distance > r)
+		{
+			// Move the center toward the point just enough to touch it
+			float grown = (r + distance) * 0.5f;
+			c = XMVectorAdd(c, XMVectorScale(XMVectorSubtract(p, c), (grown - r) / distance));
+			r = grown;
+		}
+	}
+
+	XMStoreFloat3(&sphere->Center, c);
+	sphere->Radius = r;
+}
+
+// --------------------------------------------------------
+// Oriented box along the eigenvectors of the points' covariance
+// - Sums are in doubles, since large meshes far from the
+//   origin lose most of a float's precision to the mean
+// --------------------------------------------------------
+void BoundingVolumes::ComputeOrientedBox(const XMFLOAT3* points, size_t count, size_t stride, BoundingOrientedBox* box)
+{
+	box->Center = XMFLOAT3(0, 0, 0);
+	box->Extents = XMFLOAT3(0, 0, 0);
+	box->Orientation = XMFLOAT4(0, 0, 0, 1);
+	if (count == 0)
+		return;
+
+	double mean[3] = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		const XMFLOAT3& p = PointAt(points, i, stride);
+		mean[0] += p.x;
+		mean[1] += p.y;
+		mean[2] += p.z;
+	}
+	for (int k = 0; k < 3; k++)
+		mean[k] /= (double)count;
+
+	double covariance[3][3] = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		const XMFLOAT3& p = PointAt(points, i, stride);
+		double d[3] = { p.x - mean[0], p.y - mean[1], p.z - mean[2] };
+		for (int r = 0; r < 3; r++)
+			for (int c = r; c < 3; c++)
+				covariance[r][c] += d[r] * d[c];
+	}
+	for (int r = 0; r < 3; r++)
+		for (int c = 0; c < r; c++)
+			covariance[r][c] = covariance[c][r];
+
+	double eigenvectors[3][3];
+	SymmetricEigenvectors(covariance, eigenvectors);
+
+	// Build a right handed frame so the axes form a proper rotation
+	XMVECTOR axes[3];
+	axes[0] = XMVector3Normalize(XMVectorSet((float)eigenvectors[0][0], (float)eigenvectors[1][0], (float)eigenvectors[2][0], 0));
+	axes[1] = XMVector3Normalize(XMVectorSet((float)eigenvectors[0][1], (float)eigenvectors[1][1], (float)eigenvectors[2][1], 0));
+	axes[1] = XMVector3Normalize(XMVectorSubtract(axes[1], XMVectorScale(axes[0], XMVectorGetX(XMVector3Dot(axes[0], axes[1])))));
+	axes[2] = XMVector3Cross(axes[0], axes[1]);
+
+	// Extent of the points along each axis
+	XMMATRIX rotation(axes[0], axes[1], axes[2], XMVectorSet(0, 0, 0, 1));
+	XMMATRIX toLocal = XMMatrixTranspose(rotation);
+	XMVECTOR first = XMVector3TransformNormal(XMLoadFloat3(&PointAt(points, 0, stride)), toLocal);
+	XMVECTOR localMin = first, localMax = first;
+	for (size_t i = 1; i < count; i++)
+	{
+		XMVECTOR local = XMVector3TransformNormal(XMLoadFloat3(&PointAt(points, i, stride)), toLocal);
+		localMin = XMVectorMin(localMin, local);
+		localMax = XMVectorMax(localMax, local);
+	}
+
+	XMVECTOR localCenter = XMVectorScale(XMVectorAdd(localMin, localMax), 0.5f);
+	XMStoreFloat3(&box->Center, XMVector3TransformNormal(localCenter, rotation));
+	XMStoreFloat3(&box->Extents, XMVectorScale(XMVectorSubtract(localMax, localMin), 0.5f));
+	XMStoreFloat4(&box->Orientation, XMQuaternionNormalize(XMQuaternionRotationMatrix(rotation)));
+}
+
+// --------------------------------------------------------
+// Moves a mesh's bounds into world space
+// - The oriented box's axes are carried through the matrix. Under
+//   shear (non-uniform scale across a rotated box) they stop being
+//   perpendicular, so the result is the tightest box in a frame
+//   built from the first two, which still contains every corner
+// - The AABB is the overlap of the transformed AABB and the
+//   AABB of the new oriented box
+// - The sphere is the smaller of the sphere scaled by the
+//   matrix's largest stretch and the oriented box's
+//   circumscribed sphere
+// --------------------------------------------------------
+void BoundingVolumes::Transform(MeshBounds* result, const MeshBounds& bounds, FXMMATRIX world)
+{
+	// Oriented box
+	XMVECTOR orientation = XMLoadFloat4(&bounds.orientedBox.Orientation);
+	XMFLOAT3 localExtents = bounds.orientedBox.Extents;
+	XMVECTOR directions[3] = {
+		XMVector3TransformNormal(XMVector3Rotate(XMVectorSet(1, 0, 0, 0), orientation), world),
+		XMVector3TransformNormal(XMVector3Rotate(XMVectorSet(0, 1, 0, 0), orientation), world),
+		XMVector3TransformNormal(XMVector3Rotate(XMVectorSet(0, 0, 1, 0), orientation), world) };
+	float extents[3] = { localExtents.x, localExtents.y, localExtents.z };
+
+	XMVECTOR frame[3];
+	frame[0] = XMVector3Normalize(directions[0]);
+	frame[1] = XMVector3Normalize(XMVectorSubtract(directions[1], XMVectorScale(frame[0], XMVectorGetX(XMVector3Dot(frame[0], directions[1])))));
+	frame[2] = XMVector3Cross(frame[0], frame[1]);
+
+	float worldExtents[3] = {};
+	for (int j = 0; j < 3; j++)
+		for (int k = 0; k < 3; k++)
+			worldExtents[j] += extents[k] * std::fabs(XMVectorGetX(XMVector3Dot(directions[k], frame[j])));
+
+	XMMATRIX frameMatrix(frame[0], frame[1], frame[2], XMVectorSet(0, 0, 0, 1));
+	XMVECTOR obbCenter = XMVector3Transform(XMLoadFloat3(&bounds.orientedBox.Center), world);
+	XMStoreFloat3(&result->orientedBox.Center, obbCenter);
+	result->orientedBox.Extents = XMFLOAT3(worldExtents[0], worldExtents[1], worldExtents[2]);
+	XMStoreFloat4(&result->orientedBox.Orientation, XMQuaternionNormalize(XMQuaternionRotationMatrix(frameMatrix)));
+
+	// Axis aligned box, from both the old box and the new oriented box
+	XMVECTOR boxCenter = XMVector3Transform(XMLoadFloat3(&bounds.box.Center), world);
+	XMVECTOR boxExtents = XMVectorAdd(XMVectorAdd(
+		XMVectorScale(XMVectorAbs(world.r[0]), bounds.box.Extents.x),
+		XMVectorScale(XMVectorAbs(world.r[1]), bounds.box.Extents.y)),
+		XMVectorScale(XMVectorAbs(world.r[2]), bounds.box.Extents.z));
+	XMVECTOR obbExtents = XMVectorAdd(XMVectorAdd(
+		XMVectorScale(XMVectorAbs(frame[0]), worldExtents[0]),
+		XMVectorScale(XMVectorAbs(frame[1]), worldExtents[1])),
+		XMVectorScale(XMVectorAbs(frame[2]), worldExtents[2]));
+
+	XMVECTOR minimum = XMVectorMax(XMVectorSubtract(boxCenter, boxExtents), XMVectorSubtract(obbCenter, obbExtents));
+	XMVECTOR maximum = XMVectorMin(XMVectorAdd(boxCenter, boxExtents), XMVectorAdd(obbCenter, obbExtents));
+	XMStoreFloat3(&result->min, minimum);
+	XMStoreFloat3(&result->max, maximum);
+	XMStoreFloat3(&result->box.Center, XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f));
+	XMStoreFloat3(&result->box.Extents, XMVectorScale(XMVectorSubtract(maximum, minimum), 0.5f));
+
+	// Sphere
+	float scaledRadius = bounds.sphere.Radius * MaxStretch(world);
+	float obbRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&result->orientedBox.Extents)));
+	if (scaledRadius <= obbRadius)
+	{
+		XMStoreFloat3(&result->sphere.Center, XMVector3Transform(XMLoadFloat3(&bounds.sphere.Center), world));
+		result->sphere.Radius = scaledRadius;
+	}
+	else
+	{
+		result->sphere.Center = result->orientedBox.Center;
+		result->sphere.Radius = obbRadius;
+	}
+}
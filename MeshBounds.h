@@ -0,0 +1,47 @@
+#pragma once
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Bounding volumes of a mesh, all fit to the same points
+//
+// - min/max are the exact extremes of the positions (compact
+//   vertices are quantized relative to these)
+// - box is the same AABB as a DirectXCollision volume
+// - sphere is the smaller of Ritter's sphere and the sphere
+//   around the box's center
+// - orientedBox is fit along the positions' principal axes,
+//   or matches box when that turns out to be smaller
+// --------------------------------------------------------
+struct MeshBounds
+{
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 max;
+	DirectX::BoundingBox box;
+	DirectX::BoundingSphere sphere;
+	DirectX::BoundingOrientedBox orientedBox;
+};
+
+/*
+* Fits bounding volumes to points, and moves them into world space.
+*
+* Points are read with a byte stride, so positions can be used straight from a Vertex array.
+*
+* Compute(): All of a mesh's bounds at once
+* ComputeMinMax(): Component-wise extremes of a set of points
+* ComputeSphere(): Ritter's bounding sphere (within a few percent of the smallest sphere)
+* ComputeOrientedBox(): A box along the points' principal axes (PCA of their covariance)
+* Transform(): World space versions of every volume. The oriented box stays tight under
+*              non-uniform scale, and the box is re-fit around the transformed box
+*/
+namespace BoundingVolumes
+{
+	void Compute(MeshBounds* bounds, const Vertex* vertices, size_t count);
+
+	void ComputeMinMax(const DirectX::XMFLOAT3* points, size_t count, size_t stride, DirectX::XMFLOAT3* min, DirectX::XMFLOAT3* max);
+	void ComputeSphere(const DirectX::XMFLOAT3* points, size_t count, size_t stride, DirectX::BoundingSphere* sphere);
+	void ComputeOrientedBox(const DirectX::XMFLOAT3* points, size_t count, size_t stride, DirectX::BoundingOrientedBox* box);
+
+	void Transform(MeshBounds* result, const MeshBounds& bounds, DirectX::FXMMATRIX world);
+}
@@ -0,0 +1,321 @@
+#include "MeshCache.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const char Magic[4] = { 'M', 'B', 'I', 'N' };
+	const unsigned int Version = 5; // 2: indices and vertices are optimized by MeshOptimizer, 3: TangentGenerator, 4: submeshes, 5: 64-bit offsets
+}
+
+// --------------------------------------------------------
+// Maps the cache and validates it. The data is only
+// accessible while this object is alive.
+// --------------------------------------------------------
+MeshCacheFile::MeshCacheFile(const char* cachePath, unsigned long long sourceHash, unsigned long long sourceSize, unsigned int importFlags) :
+	file(cachePath),
+	header(0)
+{
+	if (file.GetSize() < sizeof(MeshCacheHeader))
+		return;
+
+	const MeshCacheHeader* h = (const MeshCacheHeader*)file.GetData();
+	if (memcmp(h->magic, Magic, sizeof(Magic)) != 0 ||
+		h->version != Version ||
+		h->vertexStride != sizeof(Vertex) ||
+		h->sourceHash != sourceHash ||
+		h->sourceSize != sourceSize ||
+		h->importFlags != importFlags ||
+		h->vertexCount == 0 ||
+		h->indexCount == 0)
+		return;
+
+	// Make sure both arrays are really there (guards against truncated writes)
+	// (each offset is checked on its own first, so adding a size to it can't wrap)
+	unsigned long long size = file.GetSize();
+	if (h->vertexOffset > size || h->indexOffset > size || h->submeshOffset > size)
+		return;
+	if ((unsigned long long)h->vertexCount * sizeof(Vertex) > size - h->vertexOffset ||
+		(unsigned long long)h->indexCount * sizeof(unsigned int) > size - h->indexOffset ||
+		h->submeshBytes > size - h->submeshOffset ||
+		h->indexOffset % sizeof(unsigned int) != 0)
+		return;
+
+	if (!ReadSubmeshTable(submeshes, file.GetData() + h->submeshOffset, h->submeshBytes, h->submeshCount, h->indexCount))
+		return;
+
+	header = h;
+}
+
+bool MeshCacheFile::IsValid() { return header != 0; }
+const MeshCacheHeader* MeshCacheFile::GetHeader() { return header; }
+const Vertex* MeshCacheFile::GetVertices() { return header ? (const Vertex*)(file.GetData() + header->vertexOffset) : 0; }
+const unsigned int* MeshCacheFile::GetIndices() { return header ? (const unsigned int*)(file.GetData() + header->indexOffset) : 0; }
+const std::vector<SubmeshRange>& MeshCacheFile::GetSubmeshes() { return submeshes; }
+
+std::string MeshCacheFile::GetPathFor(const char* sourcePath) { return std::string(sourcePath) + ".meshbin"; }
+
+// --------------------------------------------------------
+// Writes the final vertices and indices of a mesh to a cache file
+// 
+// Returns false if the file couldn't be written (the cache is
+// only an optimization, so callers are free to ignore this)
+// --------------------------------------------------------
+bool MeshCacheFile::Write(const char* cachePath, const MeshData& data, unsigned long long sourceHash, unsigned long long sourceSize, unsigned int importFlags)
+{
+	if (data.vertices.empty() || data.indices.empty())
+		return false;
+
+	// Counts are 32-bit, like the index buffer's entries
+	if (data.vertices.size() > UINT_MAX || data.indices.size() > UINT_MAX)
+		return false;
+
+	MeshCacheHeader h = {};
+	memcpy(h.magic, Magic, sizeof(Magic));
+	h.version = Version;
+	h.vertexStride = sizeof(Vertex);
+	h.vertexCount = (unsigned int)data.vertices.size();
+	h.indexCount = (unsigned int)data.indices.size();
+	h.vertexOffset = sizeof(MeshCacheHeader);
+	h.indexOffset = h.vertexOffset + (unsigned long long)h.vertexCount * sizeof(Vertex);
+
+	std::vector<char> submeshTable;
+	WriteSubmeshTable(submeshTable, data.submeshes);
+	h.submeshCount = (unsigned int)data.submeshes.size();
+	h.submeshOffset = h.indexOffset + (unsigned long long)h.indexCount * sizeof(unsigned int);
+	h.submeshBytes = (unsigned int)submeshTable.size();
+	h.sourceHash = sourceHash;
+	h.sourceSize = sourceSize;
+	h.importFlags = importFlags;
+
+	// Bounds of the final (left-handed) positions
+	DirectX::XMVECTOR minV = DirectX::XMLoadFloat3(&data.vertices[0].Position);
+	DirectX::XMVECTOR maxV = minV;
+	for (const Vertex& v : data.vertices)
+	{
+		DirectX::XMVECTOR p = DirectX::XMLoadFloat3(&v.Position);
+		minV = DirectX::XMVectorMin(minV, p);
+		maxV = DirectX::XMVectorMax(maxV, p);
+	}
+	DirectX::XMStoreFloat3(&h.boundsMin, minV);
+	DirectX::XMStoreFloat3(&h.boundsMax, maxV);
+
+	std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	out.write((const char*)&h, sizeof(h));
+	out.write((const char*)&data.vertices[0], sizeof(Vertex) * data.vertices.size());
+	out.write((const char*)&data.indices[0], sizeof(unsigned int) * data.indices.size());
+	if (!submeshTable.empty())
+		out.write(&submeshTable[0], submeshTable.size());
+	return out.good();
+}
+
+// --------------------------------------------------------
+// Appends submeshes to out in the table format described
+// in MeshCache.h (nothing at all if there are none)
+// --------------------------------------------------------
+void MeshCacheFile::WriteSubmeshTable(std::vector<char>& out, const std::vector<SubmeshRange>& submeshes)
+{
+	for (const SubmeshRange& submesh : submeshes)
+	{
+		MeshCacheSubmesh entry = { submesh.firstIndex, submesh.indexCount, (unsigned int)submesh.material.size() };
+		out.insert(out.end(), (const char*)&entry, (const char*)&entry + sizeof(entry));
+	}
+	for (const SubmeshRange& submesh : submeshes)
+		out.insert(out.end(), submesh.material.begin(), submesh.material.end());
+}
+
+// --------------------------------------------------------
+// Reads a submesh table back, returning false if it's truncated
+// or its ranges don't cover [0, indexCount) in order, in whole
+// (and at least one) triangles
+// --------------------------------------------------------
+bool MeshCacheFile::ReadSubmeshTable(std::vector<SubmeshRange>& out, const char* table, size_t size, unsigned int submeshCount, unsigned int indexCount)
+{
+	out.clear();
+	if ((unsigned long long)submeshCount * sizeof(MeshCacheSubmesh) > size)
+		return false;
+
+	const char* name = table + submeshCount * sizeof(MeshCacheSubmesh);
+	const char* end = table + size;
+	unsigned int nextIndex = 0;
+	for (unsigned int s = 0; s < submeshCount; s++)
+	{
+		MeshCacheSubmesh entry;
+		memcpy(&entry, table + s * sizeof(MeshCacheSubmesh), sizeof(entry));
+		if (entry.nameLength > (size_t)(end - name) || entry.firstIndex != nextIndex ||
+			entry.indexCount == 0 || entry.indexCount % 3 != 0 || entry.indexCount > indexCount - nextIndex)
+			return false;
+
+		out.push_back({ std::string(name, entry.nameLength), entry.firstIndex, entry.indexCount });
+		name += entry.nameLength;
+		nextIndex += entry.indexCount;
+	}
+
+	return submeshCount == 0 || nextIndex == indexCount;
+}
+
+// --------------------------------------------------------
+// Hashes a whole file through a memory mapping
+// 
+// Returns false if the file can't be opened
+// --------------------------------------------------------
+bool MeshCacheFile::HashFile(const char* path, unsigned long long* hash, unsigned long long* size)
+{
+	MappedFile source(path);
+	if (!source.IsOpen())
+		return false;
+
+	*hash = HashBytes(source.GetData(), source.GetSize());
+	*size = source.GetSize();
+	return true;
+}
+
+// --------------------------------------------------------
+// A fast 64-bit content hash (8 bytes per step, multiply/xor-shift
+// mixing). Not cryptographic - it only needs to notice edits.
+// --------------------------------------------------------
+unsigned long long MeshCacheFile::HashBytes(const void* data, size_t size)
+{
+	const unsigned long long prime = 0x9E3779B97F4A7C15ull;
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = 0xCBF29CE484222325ull ^ (size * prime);
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+
+	unsigned long long tail = 0;
+	if (size > i)
+		memcpy(&tail, bytes + i, size - i);
+	hash = (hash ^ tail) * prime;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+// --------------------------------------------------------
+// Creates the cache file (with a blank header for now) and
+// the file its indices wait in
+// --------------------------------------------------------
+MeshCacheSink::MeshCacheSink(const char* cachePath, unsigned long long sourceHash, unsigned long long sourceSize, unsigned int importFlags) :
+	indexPath(std::string(cachePath) + ".indices"),
+	out(cachePath, std::ios::binary | std::ios::trunc),
+	indexFile(indexPath, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc),
+	header(),
+	vertexTotal(0),
+	indexTotal(0)
+{
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.importFlags = importFlags;
+
+	MeshCacheHeader blank = {};
+	out.write((const char*)&blank, sizeof(blank));
+}
+
+MeshCacheSink::~MeshCacheSink()
+{
+	if (indexFile.is_open())
+	{
+		indexFile.close();
+		std::remove(indexPath.c_str());
+	}
+}
+
+bool MeshCacheSink::IsOpen() { return out.is_open() && indexFile.is_open() && out.good() && indexFile.good(); }
+
+void MeshCacheSink::Append(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	out.write((const char*)vertices, sizeof(Vertex) * vertexCount);
+	indexFile.write((const char*)indices, sizeof(unsigned int) * indexCount);
+
+	// Bounds of the final (left-handed) positions, like Write()'s
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		DirectX::XMVECTOR p = DirectX::XMLoadFloat3(&vertices[v].Position);
+		DirectX::XMVECTOR minV = vertexTotal + v == 0 ? p : DirectX::XMLoadFloat3(&header.boundsMin);
+		DirectX::XMVECTOR maxV = vertexTotal + v == 0 ? p : DirectX::XMLoadFloat3(&header.boundsMax);
+		DirectX::XMStoreFloat3(&header.boundsMin, DirectX::XMVectorMin(minV, p));
+		DirectX::XMStoreFloat3(&header.boundsMax, DirectX::XMVectorMax(maxV, p));
+	}
+
+	vertexTotal += vertexCount;
+	indexTotal += indexCount;
+	if (!submeshes.empty())
+		submeshes.back().indexCount += (unsigned int)indexCount;
+}
+
+void MeshCacheSink::BeginSubmesh(const char* material)
+{
+	// Faces before the first usemtl get a range of their own
+	if (submeshes.empty() && indexTotal > 0)
+		submeshes.push_back({ "", 0, (unsigned int)indexTotal });
+
+	// Runs without faces are dropped, which may leave two runs of one material to merge
+	if (!submeshes.empty() && submeshes.back().indexCount == 0)
+		submeshes.pop_back();
+	if (!submeshes.empty() && submeshes.back().material == material)
+		return;
+	submeshes.push_back({ material, (unsigned int)indexTotal, 0 });
+}
+
+// --------------------------------------------------------
+// Copies the indices in after the vertices, then writes the
+// submesh table and the real header
+//
+// Returns false if the cache couldn't be completed (it's left
+// with its blank header, so it won't load)
+// --------------------------------------------------------
+bool MeshCacheSink::Finish()
+{
+	// Counts are 32-bit, like the index buffer's entries
+	if (!IsOpen() || vertexTotal == 0 || indexTotal == 0 || vertexTotal > UINT_MAX || indexTotal > UINT_MAX)
+		return false;
+
+	if (!submeshes.empty() && submeshes.back().indexCount == 0)
+		submeshes.pop_back();
+
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.vertexStride = sizeof(Vertex);
+	header.vertexCount = (unsigned int)vertexTotal;
+	header.indexCount = (unsigned int)indexTotal;
+	header.vertexOffset = sizeof(MeshCacheHeader);
+	header.indexOffset = header.vertexOffset + vertexTotal * sizeof(Vertex);
+
+	// A piece at a time, so copying doesn't need the indices in memory either
+	std::vector<char> buffer(1 << 16);
+	unsigned long long remaining = indexTotal * sizeof(unsigned int);
+	indexFile.seekg(0);
+	while (remaining > 0)
+	{
+		size_t piece = (size_t)(std::min)((unsigned long long)buffer.size(), remaining);
+		if (!indexFile.read(&buffer[0], piece))
+			return false;
+		out.write(&buffer[0], piece);
+		remaining -= piece;
+	}
+
+	std::vector<char> submeshTable;
+	MeshCacheFile::WriteSubmeshTable(submeshTable, submeshes);
+	header.submeshCount = (unsigned int)submeshes.size();
+	header.submeshOffset = header.indexOffset + indexTotal * sizeof(unsigned int);
+	header.submeshBytes = (unsigned int)submeshTable.size();
+	if (!submeshTable.empty())
+		out.write(&submeshTable[0], submeshTable.size());
+
+	out.seekp(0);
+	out.write((const char*)&header, sizeof(header));
+	out.close();
+	return !out.fail();
+}
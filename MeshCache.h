@@ -0,0 +1,135 @@
+#pragma once
+#include <DirectXMath.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// Layout of a .meshbin file:
+//   MeshCacheHeader
+//   Vertex[vertexCount]        (at vertexOffset)
+//   unsigned int[indexCount]   (at indexOffset)
+//   Submesh table              (submeshBytes at submeshOffset)
+//
+// The arrays hold the final, ready-to-upload data, so a
+// valid cache can be handed to the GPU straight from the
+// mapped file.
+// --------------------------------------------------------
+// --------------------------------------------------------
+// Import options that change the cached data, so a cache
+// written with different options is treated as stale
+// --------------------------------------------------------
+enum MeshImportFlags : unsigned int
+{
+	MeshImportAngleWeightedTangents = 1 << 0,
+	MeshImportStreamed = 1 << 1,	// Written by MeshCacheSink: welded per window, in file order, unoptimized
+};
+
+struct MeshCacheHeader
+{
+	char magic[4];				// "MBIN"
+	unsigned int version;		// Bumped whenever the layout or the import pipeline changes
+	unsigned int vertexStride;	// sizeof(Vertex) when written
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	unsigned int importFlags;	// MeshImportFlags the data was produced with
+	unsigned long long vertexOffset;	// Byte offsets from the start of the file (64-bit, since
+	unsigned long long indexOffset;		// big scans make caches well over 4 GB)
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+	unsigned long long sourceHash;	// Hash of the source file's contents
+	unsigned long long sourceSize;
+	unsigned int submeshCount;		// 0 when the whole mesh is one material
+	unsigned int submeshBytes;
+	unsigned long long submeshOffset;
+};
+
+static_assert(sizeof(MeshCacheHeader) == 96, "The cache header has no padding, so it reads the same everywhere");
+
+// --------------------------------------------------------
+// A submesh table (shared with .meshz files) is submeshCount
+// of these, followed by the material names back to back
+// --------------------------------------------------------
+struct MeshCacheSubmesh
+{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	unsigned int nameLength;	// Bytes of name, without a terminator
+};
+
+/*
+* A binary cache of an imported mesh, memory-mapped on load.
+*
+* The constructor maps the cache file and checks it against the given source hash
+* and import flags;
+* if anything is off (missing, wrong version, truncated, stale) IsValid() is false
+* and the caller should re-import the source and Write() a new cache.
+*
+* HashFile(): Hashes the contents of a file, for comparing against the cache
+* GetPathFor(): The cache path used for a given source file
+* GetSubmeshes(): The cached submesh ranges (empty for single material meshes)
+* WriteSubmeshTable() / ReadSubmeshTable(): Convert submeshes to and from the table format
+*                                          above, checking ranges against the index count
+*/
+class MeshCacheFile
+{
+public:
+	MeshCacheFile(const char* cachePath, unsigned long long sourceHash, unsigned long long sourceSize, unsigned int importFlags = 0);
+
+	bool IsValid();
+	const MeshCacheHeader* GetHeader();
+	const Vertex* GetVertices();
+	const unsigned int* GetIndices();
+	const std::vector<SubmeshRange>& GetSubmeshes();
+
+	static bool Write(const char* cachePath, const MeshData& data, unsigned long long sourceHash, unsigned long long sourceSize, unsigned int importFlags = 0);
+	static bool HashFile(const char* path, unsigned long long* hash, unsigned long long* size);
+	static unsigned long long HashBytes(const void* data, size_t size);
+	static std::string GetPathFor(const char* sourcePath);
+
+	static void WriteSubmeshTable(std::vector<char>& out, const std::vector<SubmeshRange>& submeshes);
+	static bool ReadSubmeshTable(std::vector<SubmeshRange>& out, const char* table, size_t size, unsigned int submeshCount, unsigned int indexCount);
+
+private:
+	MappedFile file;
+	const MeshCacheHeader* header;
+	std::vector<SubmeshRange> submeshes;
+};
+
+/*
+* Writes a .meshbin file as a streaming loader hands it blocks, so the mesh never has to
+* be in memory all at once.
+*
+* Vertices go straight into the cache file. Indices have to come after every vertex, so they
+* wait in a file of their own (the cache path plus ".indices") until Finish() copies them
+* over, adds the submesh table and fills in the header. Until then the header is all zeros,
+* so a cache that never got finished is simply invalid. Submeshes stay in the order their
+* usemtl records came in; only back-to-back runs of the same material are merged.
+*
+* IsOpen(): Whether both files could be created
+* Finish(): Completes the cache, returning false if anything couldn't be written
+*/
+class MeshCacheSink : public MeshSink
+{
+public:
+	MeshCacheSink(const char* cachePath, unsigned long long sourceHash, unsigned long long sourceSize, unsigned int importFlags = 0);
+	~MeshCacheSink();
+	MeshCacheSink(const MeshCacheSink&) = delete; // Remove copy constructor
+	MeshCacheSink& operator=(const MeshCacheSink&) = delete; // Remove copy-assignment operator
+
+	bool IsOpen();
+	void Append(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) override;
+	void BeginSubmesh(const char* material) override;
+	bool Finish();
+
+private:
+	std::string indexPath;
+	std::ofstream out;
+	std::fstream indexFile;
+	MeshCacheHeader header;
+	unsigned long long vertexTotal;
+	unsigned long long indexTotal;
+	std::vector<SubmeshRange> submeshes;
+};
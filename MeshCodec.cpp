@@ -0,0 +1,280 @@
+#include "MeshCodec.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// Defining MESH_CODEC_NO_SIMD leaves only the plain C++ decoder (the tests build both)
+#if !defined(MESH_CODEC_NO_SIMD) && (defined(_M_X64) || defined(_M_IX86) || defined(__SSSE3__))
+#include <tmmintrin.h>
+#define MESH_CODEC_SSSE3
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace
+{
+	const char Magic[4] = { 'M', 'S', 'H', 'Z' };
+	const unsigned int Version = 2; // 2: submeshes
+
+	// Words per element: a Vertex is 11 floats, an index is 1 word
+	const size_t VertexWords = sizeof(Vertex) / sizeof(uint32_t);
+	static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "Vertices must be whole words");
+
+	// Zeros after the packed data, so decoding can always load 16 bytes at a time
+	const size_t Padding = 16;
+
+	// --------------------------------------------------------
+	// Per control byte: how many data bytes its 4 words use,
+	// and the shuffle that moves them into 4 32-bit lanes
+	// --------------------------------------------------------
+	struct ControlTables
+	{
+		std::array<unsigned char, 256> lengths;
+		std::array<std::array<unsigned char, 16>, 256> shuffles;
+	};
+
+	constexpr ControlTables MakeControlTables()
+	{
+		ControlTables tables = {};
+		for (unsigned int control = 0; control < 256; control++)
+		{
+			unsigned char source = 0;
+			for (unsigned int lane = 0; lane < 4; lane++)
+			{
+				unsigned int length = ((control >> (lane * 2)) & 3) + 1;
+				for (unsigned int byte = 0; byte < 4; byte++)
+					tables.shuffles[control][lane * 4 + byte] = byte < length ? source++ : 0x80; // 0x80 zeroes the byte
+			}
+			tables.lengths[control] = source;
+		}
+		return tables;
+	}
+
+	constexpr ControlTables Tables = MakeControlTables();
+
+	uint32_t ZigZag(uint32_t delta) { return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31); }
+	uint32_t UnZigZag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+	// --------------------------------------------------------
+	// Encodes count words, each relative to the word distance
+	// earlier (or 0), as: control bytes, data bytes, padding
+	// --------------------------------------------------------
+	void EncodeWords(std::vector<unsigned char>& out, const uint32_t* words, size_t count, size_t distance)
+	{
+		size_t controlStart = out.size();
+		out.resize(controlStart + (count + 3) / 4, 0);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t previous = i >= distance ? words[i - distance] : 0;
+			uint32_t value = ZigZag(words[i] - previous);
+
+			unsigned int length = value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+			out[controlStart + i / 4] |= (unsigned char)((length - 1) << ((i % 4) * 2));
+			for (unsigned int byte = 0; byte < length; byte++)
+				out.push_back((unsigned char)(value >> (byte * 8)));
+		}
+
+		out.insert(out.end(), Padding, 0);
+	}
+
+#if defined(MESH_CODEC_SSSE3)
+	bool HasSSSE3()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 9)) != 0;
+#else
+		return __builtin_cpu_supports("ssse3");
+#endif
+	}
+
+	const bool UseSSSE3 = HasSSSE3();
+#endif
+
+	// --------------------------------------------------------
+	// Reverses EncodeWords(). Distance must be 1 (a running sum)
+	// or at least 4 (so each group of 4 only depends on words
+	// that are already decoded)
+	// --------------------------------------------------------
+	void DecodeWords(uint32_t* destination, size_t count, const unsigned char* data, size_t size, size_t distance)
+	{
+		size_t controlBytes = (count + 3) / 4;
+		if (size < controlBytes + Padding)
+			throw std::runtime_error("Error decoding mesh: encoded data is truncated");
+
+		// Validate the data length up front, so the loops below can't read past the end
+		const unsigned char* control = data;
+		size_t dataBytes = 0;
+		for (size_t c = 0; c < count / 4; c++)
+			dataBytes += Tables.lengths[control[c]];
+		for (size_t i = count & ~(size_t)3; i < count; i++)
+			dataBytes += ((control[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+		if (dataBytes != size - controlBytes - Padding)
+			throw std::runtime_error("Error decoding mesh: encoded data has the wrong length");
+
+		const unsigned char* packed = data + controlBytes;
+		size_t i = 0;
+
+#if defined(MESH_CODEC_SSSE3)
+		if (UseSSSE3)
+		{
+			const __m128i one = _mm_set1_epi32(1);
+			__m128i running = _mm_setzero_si128();
+			for (; i + 4 <= count; i += 4)
+			{
+				unsigned char c = control[i / 4];
+				__m128i shuffle = _mm_loadu_si128((const __m128i*)Tables.shuffles[c].data());
+				__m128i value = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)packed), shuffle);
+				packed += Tables.lengths[c];
+
+				__m128i delta = _mm_xor_si128(_mm_srli_epi32(value, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, one)));
+				if (distance == 1)
+				{
+					// Prefix sum across the 4 lanes, plus the last word so far
+					delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+					delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+					running = _mm_add_epi32(delta, _mm_shuffle_epi32(running, 0xFF));
+					_mm_storeu_si128((__m128i*)(destination + i), running);
+				}
+				else if (i >= distance)
+				{
+					__m128i previous = _mm_loadu_si128((const __m128i*)(destination + i - distance));
+					_mm_storeu_si128((__m128i*)(destination + i), _mm_add_epi32(delta, previous));
+				}
+				else
+				{
+					// Only the first element's words, some of which have nothing before them
+					_mm_storeu_si128((__m128i*)(destination + i), delta);
+					for (size_t lane = 0; lane < 4; lane++)
+						if (i + lane >= distance)
+							destination[i + lane] += destination[i + lane - distance];
+				}
+			}
+		}
+#endif
+
+		// Whatever's left (everything, without SSSE3) one word at a time
+		for (; i < count; i++)
+		{
+			unsigned int length = ((control[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+			uint32_t value = 0;
+			for (unsigned int byte = 0; byte < length; byte++)
+				value |= (uint32_t)packed[byte] << (byte * 8);
+			packed += length;
+
+			uint32_t previous = i >= distance ? destination[i - distance] : 0;
+			destination[i] = UnZigZag(value) + previous;
+		}
+	}
+}
+
+void MeshCodec::EncodeVertices(std::vector<unsigned char>& out, const Vertex* vertices, size_t count)
+{
+	EncodeWords(out, (const uint32_t*)vertices, count * VertexWords, VertexWords);
+}
+
+void MeshCodec::EncodeIndices(std::vector<unsigned char>& out, const unsigned int* indices, size_t count)
+{
+	EncodeWords(out, indices, count, 1);
+}
+
+void MeshCodec::DecodeVertices(Vertex* destination, size_t count, const unsigned char* data, size_t size)
+{
+	DecodeWords((uint32_t*)destination, count * VertexWords, data, size, VertexWords);
+}
+
+void MeshCodec::DecodeIndices(unsigned int* destination, size_t count, const unsigned char* data, size_t size)
+{
+	DecodeWords(destination, count, data, size, 1);
+}
+
+// --------------------------------------------------------
+// Encodes a mesh's final vertices and indices to a file
+//
+// Returns false if the file couldn't be written
+// --------------------------------------------------------
+bool MeshCodec::Write(const char* path, const MeshData& data, unsigned int importFlags)
+{
+	if (data.vertices.empty() || data.indices.empty())
+		return false;
+
+	std::vector<unsigned char> encoded;
+	EncodeVertices(encoded, &data.vertices[0], data.vertices.size());
+	size_t vertexBytes = encoded.size();
+	EncodeIndices(encoded, &data.indices[0], data.indices.size());
+
+	std::vector<char> submeshTable;
+	MeshCacheFile::WriteSubmeshTable(submeshTable, data.submeshes);
+
+	MeshCodecHeader h = {};
+	memcpy(h.magic, Magic, sizeof(Magic));
+	h.version = Version;
+	h.vertexStride = sizeof(Vertex);
+	h.vertexCount = (unsigned int)data.vertices.size();
+	h.indexCount = (unsigned int)data.indices.size();
+	h.vertexBytes = (unsigned int)vertexBytes;
+	h.indexBytes = (unsigned int)(encoded.size() - vertexBytes);
+	h.importFlags = importFlags;
+	h.submeshCount = (unsigned int)data.submeshes.size();
+	h.submeshBytes = (unsigned int)submeshTable.size();
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	out.write((const char*)&h, sizeof(h));
+	out.write((const char*)&encoded[0], encoded.size());
+	if (!submeshTable.empty())
+		out.write(&submeshTable[0], submeshTable.size());
+
+#if defined(DEBUG) | defined(_DEBUG)
+	size_t rawBytes = data.vertices.size() * sizeof(Vertex) + data.indices.size() * sizeof(unsigned int);
+	printf("Wrote %s: %zu bytes encoded to %zu (%.2f:1)\n", path, rawBytes, encoded.size(), rawBytes / (double)encoded.size());
+#endif
+	return out.good();
+}
+
+// --------------------------------------------------------
+// Decodes a .meshz file straight from its memory mapping
+// into data's vertices and indices
+// --------------------------------------------------------
+void MeshCodec::Read(const char* path, MeshData& data, unsigned int* importFlags)
+{
+	MappedFile file(path);
+	if (!file.IsOpen())
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	MeshCodecHeader h = {};
+	if (file.GetSize() >= sizeof(h))
+		memcpy(&h, file.GetData(), sizeof(h));
+	if (memcmp(h.magic, Magic, sizeof(Magic)) != 0 || h.version != Version || h.vertexStride != sizeof(Vertex))
+		throw std::invalid_argument("Error reading mesh: not a compatible .meshz file");
+	if ((unsigned long long)h.vertexBytes + h.indexBytes + h.submeshBytes > file.GetSize() - sizeof(h) || h.vertexCount == 0 || h.indexCount == 0)
+		throw std::runtime_error("Error reading mesh: .meshz file is truncated");
+
+	const unsigned char* encoded = (const unsigned char*)file.GetData() + sizeof(h);
+	data.vertices.resize(h.vertexCount);
+	data.indices.resize(h.indexCount);
+	DecodeVertices(&data.vertices[0], h.vertexCount, encoded, h.vertexBytes);
+	DecodeIndices(&data.indices[0], h.indexCount, encoded + h.vertexBytes, h.indexBytes);
+
+	for (unsigned int index : data.indices)
+		if (index >= h.vertexCount)
+			throw std::runtime_error("Error reading mesh: index out of range");
+
+	const char* submeshTable = (const char*)encoded + h.vertexBytes + h.indexBytes;
+	if (!MeshCacheFile::ReadSubmeshTable(data.submeshes, submeshTable, h.submeshBytes, h.submeshCount, h.indexCount))
+		throw std::runtime_error("Error reading mesh: submesh table is malformed");
+
+	if (importFlags)
+		*importFlags = h.importFlags;
+}
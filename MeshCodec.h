@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// Layout of a .meshz file:
+//   MeshCodecHeader
+//   Encoded vertices   (vertexBytes, at sizeof(MeshCodecHeader))
+//   Encoded indices    (indexBytes, right after the vertices)
+//   Submesh table      (submeshBytes, right after the indices -
+//                       same format as a .meshbin's, see MeshCache.h)
+//
+// Like a .meshbin cache, it holds the final vertices and
+// indices of the mesh pipeline (optimized, with tangents),
+// so decoding it is all a load has to do.
+// --------------------------------------------------------
+struct MeshCodecHeader
+{
+	char magic[4];				// "MSHZ"
+	unsigned int version;
+	unsigned int vertexStride;	// sizeof(Vertex) when written
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	unsigned int vertexBytes;
+	unsigned int indexBytes;
+	unsigned int importFlags;	// MeshImportFlags the data was produced with
+	unsigned int submeshCount;	// 0 when the whole mesh is one material
+	unsigned int submeshBytes;
+};
+
+/*
+* A lossless codec for final vertex and index arrays, built for decode speed.
+*
+* Both are handled as streams of 32-bit words: each word is stored as the difference from
+* the same word one element earlier (the previous index, or the same member of the previous
+* vertex), zigzag encoded so small negative differences stay small, then packed with
+* Stream VByte - 2-bit lengths for 4 words in a control byte, and 1-4 bytes per word.
+* Decoding expands 4 words at a time with one SSSE3 shuffle and undoes the differences with
+* SSE2 adds (falling back to plain C++ on CPUs without SSSE3).
+*
+* Vertices are compared bit for bit, so decoding is exact - including -0 and NaNs. They
+* compress best after MeshOptimizer::OptimizeVertexFetch(), which puts neighbors together.
+*
+* EncodeVertices() / EncodeIndices(): Append an encoded array to a byte vector
+* DecodeVertices() / DecodeIndices(): Expand an encoded array, throwing if it's malformed
+* Write(): Saves a mesh (and its submeshes) as a .meshz file
+* Read(): Loads a .meshz file
+*/
+namespace MeshCodec
+{
+	void EncodeVertices(std::vector<unsigned char>& out, const Vertex* vertices, size_t count);
+	void EncodeIndices(std::vector<unsigned char>& out, const unsigned int* indices, size_t count);
+
+	void DecodeVertices(Vertex* destination, size_t count, const unsigned char* data, size_t size);
+	void DecodeIndices(unsigned int* destination, size_t count, const unsigned char* data, size_t size);
+
+	bool Write(const char* path, const MeshData& data, unsigned int importFlags = 0);
+	void Read(const char* path, MeshData& data, unsigned int* importFlags = 0);
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A run of triangles drawn with the same material
+//
+// - material is the name from the OBJ's usemtl line (empty
+//   for faces that come before any usemtl)
+// --------------------------------------------------------
+struct SubmeshRange
+{
+	std::string material;
+	unsigned int firstIndex;
+	unsigned int indexCount;
+};
+
+// --------------------------------------------------------
+// CPU-side geometry produced by the mesh loaders, ready
+// to be handed to a Mesh for uploading
+//
+// - indices are a triangle list into vertices
+// - submeshes split the indices up by material. Empty means
+//   the whole mesh uses one material. Loaders may leave
+//   several runs with the same material, which
+//   MeshOptimizer::GroupByMaterial() merges
+// --------------------------------------------------------
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<SubmeshRange> submeshes;
+};
+
+// --------------------------------------------------------
+// The submeshes a mesh is drawn as: the given ranges, or one
+// unnamed range covering every index when there are none
+//
+// - Throws unless the ranges cover the indices in order, in
+//   whole triangles, with none of them empty
+// --------------------------------------------------------
+inline std::vector<SubmeshRange> GetSubmeshRanges(const SubmeshRange* ranges, size_t rangeCount, unsigned int indexCount)
+{
+	std::vector<SubmeshRange> submeshes(ranges, ranges + rangeCount);
+	if (submeshes.empty())
+		submeshes.push_back({ "", 0, indexCount });
+
+	unsigned int nextIndex = 0;
+	for (const SubmeshRange& range : submeshes)
+	{
+		if (range.firstIndex != nextIndex || range.indexCount == 0 || range.indexCount % 3 != 0 || range.indexCount > indexCount - nextIndex)
+			throw std::invalid_argument("Submesh ranges must cover the index buffer in order, in whole triangles");
+		nextIndex += range.indexCount;
+	}
+	if (nextIndex != indexCount)
+		throw std::invalid_argument("Submesh ranges must cover the index buffer in order, in whole triangles");
+	return submeshes;
+}
+
+// --------------------------------------------------------
+// Position of the first submesh using the named material, or
+// -1 - for anything with a material string, so Mesh's own
+// submeshes as well as SubmeshRanges
+// --------------------------------------------------------
+template <typename SubmeshType>
+int FindSubmeshByMaterial(const std::vector<SubmeshType>& submeshes, const char* material)
+{
+	for (size_t s = 0; s < submeshes.size(); s++)
+		if (submeshes[s].material == material)
+			return (int)s;
+	return -1;
+}
+
+// --------------------------------------------------------
+// Receives geometry from a streaming loader a block at a time
+//
+// - Each block's indices refer to every vertex appended so
+//   far, not just the ones in the same block
+// - The block is the loader's scratch, so a sink may change
+//   the vertices in place, but mustn't keep the pointers
+// --------------------------------------------------------
+class MeshSink
+{
+public:
+	virtual ~MeshSink() {}
+	virtual void Append(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) = 0;
+
+	// Every index appended after this uses the named material
+	virtual void BeginSubmesh(const char* /*material*/) {}
+
+	// Bytes the sink holds per corner of the block it's handling,
+	// which the loader counts against its own budget
+	virtual size_t GetScratchPerCorner() const { return 0; }
+};
+
+// --------------------------------------------------------
+// A sink that collects everything into a MeshData, so the
+// whole mesh ends up in memory, outside the loader's budget
+// (for meshes that fit anyway - MeshCacheSink is the one
+// that keeps memory bounded)
+// --------------------------------------------------------
+class MeshDataSink : public MeshSink
+{
+public:
+	MeshDataSink(MeshData& data) : data(data) {}
+
+	void Append(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) override
+	{
+		data.vertices.insert(data.vertices.end(), vertices, vertices + vertexCount);
+		data.indices.insert(data.indices.end(), indices, indices + indexCount);
+		if (!data.submeshes.empty())
+			data.submeshes.back().indexCount += (unsigned int)indexCount;
+	}
+
+	void BeginSubmesh(const char* material) override
+	{
+		// Faces before the first usemtl get a range of their own
+		if (data.submeshes.empty() && !data.indices.empty())
+			data.submeshes.push_back({ "", 0, (unsigned int)data.indices.size() });
+		data.submeshes.push_back({ material, (unsigned int)data.indices.size(), 0 });
+	}
+
+private:
+	MeshData& data;
+};
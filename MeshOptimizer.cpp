@@ -0,0 +1,383 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace
+{
+	// For each vertex, the list of triangles that use it
+	struct TriangleAdjacency
+	{
+		std::vector<unsigned int> offsets; // Start of each vertex's list in triangles
+		std::vector<unsigned int> counts;
+		std::vector<unsigned int> triangles;
+	};
+
+	void BuildAdjacency(TriangleAdjacency& adjacency, const unsigned int* indices, size_t indexCount, size_t vertexCount)
+	{
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.assign(vertexCount, 0);
+		adjacency.triangles.resize(indexCount);
+
+		for (size_t i = 0; i < indexCount; i++)
+			adjacency.counts[indices[i]]++;
+
+		unsigned int offset = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacency.offsets[v] = offset;
+			offset += adjacency.counts[v];
+		}
+
+		std::vector<unsigned int> fill(adjacency.offsets);
+		for (size_t i = 0; i < indexCount; i++)
+			adjacency.triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	// Simulated FIFO cache: a vertex is resident if it was
+	// loaded within the last cacheSize loads
+	struct CacheSimulator
+	{
+		std::vector<unsigned int> cacheTime;
+		unsigned int cacheSize;
+		unsigned int timestamp;
+
+		CacheSimulator(size_t vertexCount, unsigned int cacheSize) :
+			cacheTime(vertexCount, 0), cacheSize(cacheSize), timestamp(cacheSize + 1) { }
+
+		// Returns the number of vertices the triangle had to load
+		unsigned int Triangle(const unsigned int* tri)
+		{
+			unsigned int misses = 0;
+			for (size_t k = 0; k < 3; k++)
+			{
+				if (timestamp - cacheTime[tri[k]] > cacheSize)
+				{
+					cacheTime[tri[k]] = timestamp++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+		void Flush() { timestamp += cacheSize + 1; }
+	};
+}
+
+// --------------------------------------------------------
+// Counts vertex shader invocations for an index buffer using
+// a FIFO cache of the given size (the model most GPUs follow)
+// --------------------------------------------------------
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	CacheSimulator cache(vertexCount, cacheSize);
+	VertexCacheStatistics stats = {};
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+		stats.vertexTransforms += cache.Triangle(&indices[i]);
+
+	stats.acmr = indexCount ? stats.vertexTransforms / (indexCount / 3.0f) : 0.0f;
+	stats.atvr = vertexCount ? stats.vertexTransforms / (float)vertexCount : 0.0f;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Tipsify (Sander, Nehab & Barczak, "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw", 2007)
+//
+// Walks the mesh fanning out around one vertex at a time, always
+// moving next to the vertex most likely to still be in the cache.
+// Runs in linear time.
+//
+// destination - Receives the reordered indices (must not alias indices)
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	TriangleAdjacency adjacency;
+	BuildAdjacency(adjacency, indices, indexCount, vertexCount);
+
+	std::vector<unsigned int> live(adjacency.counts); // Triangles still waiting to be emitted, per vertex
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd; // Recently used vertices, to resume from when we get stuck
+	std::vector<unsigned int> candidates;
+	deadEnd.reserve(indexCount);
+	candidates.reserve(64);
+
+	unsigned int timestamp = cacheSize + 1;
+	unsigned int cursor = 0; // Next vertex to try when the dead-end stack runs dry
+	size_t written = 0;
+	int fanning = (int)indices[0];
+
+	while (fanning >= 0)
+	{
+		// Emit every remaining triangle around this vertex
+		candidates.clear();
+		unsigned int* tris = &adjacency.triangles[0] + adjacency.offsets[fanning];
+		for (unsigned int i = 0; i < adjacency.counts[fanning]; i++)
+		{
+			unsigned int t = tris[i];
+			if (emitted[t])
+				continue;
+
+			for (size_t k = 0; k < 3; k++)
+			{
+				unsigned int v = indices[t * 3 + k];
+				destination[written++] = v;
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				if (timestamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timestamp++;
+			}
+			emitted[t] = true;
+		}
+
+		// Pick the candidate that will still be in the cache after its
+		// remaining triangles are emitted, preferring the oldest one
+		int best = -1;
+		unsigned int bestPriority = 0;
+		for (unsigned int v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+
+			unsigned int priority = 0;
+			if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = timestamp - cacheTime[v];
+
+			if (best < 0 || priority > bestPriority)
+			{
+				best = (int)v;
+				bestPriority = priority;
+			}
+		}
+
+		// Stuck: back up through recently used vertices, then fall back to a linear scan
+		while (best < 0 && !deadEnd.empty())
+		{
+			unsigned int v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0)
+				best = (int)v;
+		}
+		while (best < 0 && cursor < vertexCount)
+		{
+			if (live[cursor] > 0)
+				best = (int)cursor;
+			cursor++;
+		}
+
+		fanning = best;
+	}
+}
+
+// --------------------------------------------------------
+// Overdraw reduction on top of a cache-optimized index buffer
+// (the clustering half of the Tipsify paper):
+//  - Hard boundaries: triangles where the cache was fully missed
+//  - Soft boundaries: split hard clusters further wherever the running
+//    ACMR is within threshold of the cluster's ACMR
+//  - Sort clusters so the ones facing away from the mesh's center
+//    (likely occluders) are drawn first
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(unsigned int* destination, const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold, unsigned int cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	CacheSimulator cache(vertexCount, cacheSize);
+
+	// Hard boundaries
+	std::vector<unsigned int> hardClusters;
+	for (size_t t = 0; t < triangleCount; t++)
+		if (cache.Triangle(&indices[t * 3]) == 3 || t == 0)
+			hardClusters.push_back((unsigned int)t);
+	hardClusters.push_back((unsigned int)triangleCount);
+
+	// Soft boundaries - each cluster is measured starting from an empty cache,
+	// since once sorted it will follow some unrelated cluster
+	std::vector<unsigned int> clusters;
+	for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+	{
+		unsigned int start = hardClusters[c], end = hardClusters[c + 1];
+
+		cache.Flush();
+		unsigned int clusterMisses = 0;
+		for (unsigned int t = start; t < end; t++)
+			clusterMisses += cache.Triangle(&indices[t * 3]);
+		float clusterThreshold = threshold * clusterMisses / (float)(end - start);
+
+		clusters.push_back(start);
+		cache.Flush();
+		unsigned int runningMisses = 0, runningStart = start;
+		for (unsigned int t = start; t < end; t++)
+		{
+			runningMisses += cache.Triangle(&indices[t * 3]);
+			if (t + 1 < end && runningMisses <= (t - runningStart + 1) * clusterThreshold)
+			{
+				clusters.push_back(t + 1);
+				cache.Flush();
+				runningMisses = 0;
+				runningStart = t + 1;
+			}
+		}
+	}
+	clusters.push_back((unsigned int)triangleCount);
+	size_t clusterCount = clusters.size() - 1;
+
+	// Mesh centroid
+	XMVECTOR meshCenter = XMVectorZero();
+	for (size_t i = 0; i < indexCount; i++)
+		meshCenter = XMVectorAdd(meshCenter, XMLoadFloat3(&vertices[indices[i]].Position));
+	meshCenter = XMVectorScale(meshCenter, 1.0f / indexCount);
+
+	// Sort key: how much each cluster faces away from the center
+	std::vector<float> sortKey(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		XMVECTOR center = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for (unsigned int t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3 + 0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+
+			// Length of the cross product is twice the area, so this is area weighted
+			XMVECTOR cross = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			float triangleArea = XMVectorGetX(XMVector3Length(cross));
+
+			center = XMVectorAdd(center, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), triangleArea / 3.0f));
+			normal = XMVectorAdd(normal, cross);
+			area += triangleArea;
+		}
+
+		center = area > 0.0f ? XMVectorScale(center, 1.0f / area) : meshCenter;
+		normal = XMVector3Normalize(normal);
+		sortKey[c] = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, meshCenter), normal));
+	}
+
+	std::vector<unsigned int> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = (unsigned int)c;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+	size_t written = 0;
+	for (unsigned int c : order)
+		for (size_t i = clusters[c] * 3; i < clusters[c + 1] * 3; i++)
+			destination[written++] = indices[i];
+}
+
+// --------------------------------------------------------
+// Renumbers vertices in the order the index buffer first uses
+// them, so vertex fetches walk memory (mostly) forwards
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexFetch(MeshData& data)
+{
+	const unsigned int unused = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(data.vertices.size(), unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(data.vertices.size());
+
+	for (unsigned int& index : data.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (unsigned int)reordered.size();
+			reordered.push_back(data.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	data.vertices.swap(reordered);
+}
+
+// --------------------------------------------------------
+// The full optimization stage: cache, overdraw, then fetch order
+// --------------------------------------------------------
+// --------------------------------------------------------
+// Merges every run of the same material into one range. Runs
+// are moved as a whole, so nothing inside them is reordered.
+// Empty runs are dropped.
+// --------------------------------------------------------
+void MeshOptimizer::GroupByMaterial(MeshData& data)
+{
+	if (data.submeshes.empty())
+		return;
+
+	// Each material's runs, with materials in order of first appearance
+	std::vector<std::vector<const SubmeshRange*>> groups;
+	for (const SubmeshRange& run : data.submeshes)
+	{
+		if (run.indexCount == 0)
+			continue;
+
+		auto group = std::find_if(groups.begin(), groups.end(),
+			[&](const std::vector<const SubmeshRange*>& g) { return g[0]->material == run.material; });
+		if (group == groups.end())
+			groups.push_back({ &run });
+		else
+			group->push_back(&run);
+	}
+
+	std::vector<unsigned int> grouped;
+	std::vector<SubmeshRange> submeshes;
+	grouped.reserve(data.indices.size());
+	for (const std::vector<const SubmeshRange*>& group : groups)
+	{
+		SubmeshRange submesh = { group[0]->material, (unsigned int)grouped.size(), 0 };
+		for (const SubmeshRange* run : group)
+			grouped.insert(grouped.end(), data.indices.begin() + run->firstIndex, data.indices.begin() + run->firstIndex + run->indexCount);
+		submesh.indexCount = (unsigned int)grouped.size() - submesh.firstIndex;
+		submeshes.push_back(submesh);
+	}
+
+	data.indices.swap(grouped);
+	data.submeshes.swap(submeshes);
+}
+
+void MeshOptimizer::Optimize(MeshData& data, bool reduceOverdraw)
+{
+	if (data.indices.empty())
+		return;
+
+	GroupByMaterial(data);
+
+	size_t indexCount = data.indices.size();
+	size_t vertexCount = data.vertices.size();
+	VertexCacheStatistics before = AnalyzeVertexCache(&data.indices[0], indexCount, vertexCount);
+
+	// Each submesh is drawn on its own, so triangles can't cross between them
+	std::vector<SubmeshRange> ranges = data.submeshes;
+	if (ranges.empty())
+		ranges.push_back({ "", 0, (unsigned int)indexCount });
+
+	std::vector<unsigned int> reordered(indexCount);
+	for (const SubmeshRange& range : ranges)
+	{
+		unsigned int* indices = &data.indices[0] + range.firstIndex;
+		unsigned int* destination = &reordered[0] + range.firstIndex;
+		OptimizeVertexCache(destination, indices, range.indexCount, vertexCount);
+		if (reduceOverdraw)
+			OptimizeOverdraw(indices, destination, range.indexCount, &data.vertices[0], vertexCount);
+		else
+			std::copy(destination, destination + range.indexCount, indices);
+	}
+
+	OptimizeVertexFetch(data);
+
+#if defined(DEBUG) | defined(_DEBUG)
+	VertexCacheStatistics after = AnalyzeVertexCache(&data.indices[0], indexCount, data.vertices.size());
+	printf("  Vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+#else
+	(void)before;
+#endif
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// Results of running an index buffer through a simulated
+// FIFO post-transform vertex cache
+//
+// - ACMR: vertex shader runs per triangle (0.5 - 3.0, lower is better)
+// - ATVR: vertex shader runs per vertex (1.0 is ideal)
+// --------------------------------------------------------
+struct VertexCacheStatistics
+{
+	unsigned int vertexTransforms;
+	float acmr;
+	float atvr;
+};
+
+/*
+* Triangle and vertex reordering for faster rendering. Nothing here touches the GPU,
+* so all of it can be measured on the CPU with AnalyzeVertexCache().
+*
+* OptimizeVertexCache(): Reorders triangles for post-transform cache reuse (Tipsify)
+* OptimizeOverdraw(): Splits the cache-optimized order into clusters and sorts them so
+*                     outward-facing clusters draw first, within an ACMR threshold
+* OptimizeVertexFetch(): Renumbers vertices in the order they're first used (and drops unused ones)
+* GroupByMaterial(): Moves each material's triangles together, so every submesh is one range
+*                    (materials keep the order they first appear in, triangles keep their order)
+* Optimize(): Groups submeshes, then runs the three optimizations - triangles are only reordered
+*             within their submesh. Prints before/after statistics in debug builds
+*/
+namespace MeshOptimizer
+{
+	const unsigned int DefaultCacheSize = 16;
+
+	VertexCacheStatistics AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DefaultCacheSize);
+
+	void OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DefaultCacheSize);
+	void OptimizeOverdraw(unsigned int* destination, const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold = 1.05f, unsigned int cacheSize = DefaultCacheSize);
+	void OptimizeVertexFetch(MeshData& data);
+	void GroupByMaterial(MeshData& data);
+
+	void Optimize(MeshData& data, bool reduceOverdraw = true);
+}
@@ -0,0 +1,156 @@
+#include "MeshRegistry.h"
+#include "MeshCache.h"
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+// --------------------------------------------------------
+// Records a mesh's source without loading anything
+// - Registering a name again with the same source and options
+//   does nothing; with a different one it throws
+// --------------------------------------------------------
+void MeshRegistry::Register(const std::string& name, const std::string& objFilePath, MeshOptions options)
+{
+	if (objFilePath.empty())
+		throw std::invalid_argument("Mesh file path is empty");
+
+	// Different spellings of the same file ("a/../b.obj", "b.obj") share one key
+	std::error_code error;
+	std::string path = std::filesystem::weakly_canonical(objFilePath, error).string();
+	if (error)
+		path = objFilePath;
+
+	Entry entry = {};
+	entry.path = path;
+	entry.options = options;
+	Add(name, entry);
+}
+
+// --------------------------------------------------------
+// Records a procedurally generated mesh, which is tessellated
+// on first use (see ProceduralMesh.h)
+// --------------------------------------------------------
+void MeshRegistry::Register(const std::string& name, const ProceduralDesc& shape, MeshOptions options)
+{
+	Entry entry = {};
+	entry.shape = shape;
+	entry.options = options;
+	Add(name, entry);
+}
+
+// --------------------------------------------------------
+// Returns the named mesh, loading it (or sharing an already
+// loaded copy of the same file) the first time it's asked for
+// --------------------------------------------------------
+std::shared_ptr<Mesh> MeshRegistry::Get(const std::string& name)
+{
+	auto found = entries.find(name);
+	if (found == entries.end())
+		throw std::invalid_argument("Mesh name has not been registered");
+
+	Entry& entry = found->second;
+	if (entry.mesh)
+		return entry.mesh;
+
+	bool procedural = entry.path.empty();
+	if (!procedural)
+		entry.hashed = MeshCacheFile::HashFile(entry.path.c_str(), &entry.contentHash, &entry.contentSize);
+
+	for (auto& [otherName, other] : entries)
+	{
+		if (!other.mesh || other.options != entry.options)
+			continue;
+
+		// Procedural entries only ever match each other (their paths are both empty)
+		bool samePath = other.path == entry.path && (!procedural || other.shape == entry.shape);
+		bool sameContents = entry.hashed && other.hashed &&
+			other.contentHash == entry.contentHash && other.contentSize == entry.contentSize;
+		if (samePath || sameContents)
+		{
+#if defined(DEBUG) | defined(_DEBUG)
+			printf("Mesh %s shares the already loaded %s\n", name.c_str(), otherName.c_str());
+#endif
+			entry.mesh = other.mesh;
+			return entry.mesh;
+		}
+	}
+
+	if (procedural)
+	{
+		// Mesh creation reorders its input, so it gets its own copy of the shared tessellation
+		MeshData data = *ProceduralMesh::Get(entry.shape);
+		entry.mesh = std::make_shared<Mesh>(name.c_str(), data, true, entry.options);
+	}
+	else
+	{
+		entry.mesh = std::make_shared<Mesh>(name.c_str(), entry.path.c_str(), entry.options);
+	}
+	return entry.mesh;
+}
+
+bool MeshRegistry::IsLoaded(const std::string& name) { return Find(name).mesh != 0; }
+
+// --------------------------------------------------------
+// Names of loaded meshes that nothing outside the registry
+// holds on to anymore (so they're only costing memory)
+// --------------------------------------------------------
+std::vector<std::string> MeshRegistry::GetUnreferenced()
+{
+	std::vector<std::string> unreferenced;
+	for (auto& [name, entry] : entries)
+		if (entry.mesh && entry.mesh.use_count() == RegistryReferences(entry.mesh))
+			unreferenced.push_back(name);
+	return unreferenced;
+}
+
+// --------------------------------------------------------
+// Frees every unreferenced mesh, returning how many names
+// were unloaded
+// --------------------------------------------------------
+size_t MeshRegistry::ReleaseUnreferenced()
+{
+	std::vector<std::string> unreferenced = GetUnreferenced();
+	for (const std::string& name : unreferenced)
+	{
+#if defined(DEBUG) | defined(_DEBUG)
+		printf("Releasing unreferenced mesh %s\n", name.c_str());
+#endif
+		entries[name].mesh.reset();
+	}
+	return unreferenced.size();
+}
+
+// --------------------------------------------------------
+// Adds an entry, or checks that a repeat registration of a
+// name describes the same mesh
+// --------------------------------------------------------
+void MeshRegistry::Add(const std::string& name, const Entry& entry)
+{
+	auto existing = entries.find(name);
+	if (existing != entries.end())
+	{
+		const Entry& current = existing->second;
+		if (current.path != entry.path || current.shape != entry.shape || current.options != entry.options)
+			throw std::invalid_argument("Mesh name is already registered with a different source");
+		return;
+	}
+
+	entries.emplace(name, entry);
+}
+
+MeshRegistry::Entry& MeshRegistry::Find(const std::string& name)
+{
+	auto found = entries.find(name);
+	if (found == entries.end())
+		throw std::invalid_argument("Mesh name has not been registered");
+	return found->second;
+}
+
+// How many of the mesh's owners are registry entries
+long MeshRegistry::RegistryReferences(const std::shared_ptr<Mesh>& mesh)
+{
+	long references = 0;
+	for (auto& [name, entry] : entries)
+		references += entry.mesh == mesh;
+	return references;
+}
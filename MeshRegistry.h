@@ -0,0 +1,57 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Mesh.h"
+#include "ProceduralMesh.h"
+
+/*
+* A library of meshes that are only loaded when something asks for them.
+*
+* Meshes are registered by name up front, which only records where they come from.
+* The first Get() of a name loads it; later calls return the same shared Mesh.
+* Loads are deduplicated: if another name with the same options already loaded the
+* same file (by canonical path, or by contents when the path differs), the Mesh is shared.
+* Procedural shapes can be registered too; they're generated instead of loaded, and names
+* with the same shape, tessellation and options share a Mesh.
+*
+* Register(): Adds a mesh (from a file or a ProceduralDesc) to the library without loading it
+* Get(): Returns the mesh, loading it on first use
+* IsLoaded(): Whether a name's mesh is currently in memory
+* GetUnreferenced(): Names whose mesh is loaded but held by nothing outside the registry
+* ReleaseUnreferenced(): Frees those meshes (they load again on the next Get()). Only call
+*                        this while the GPU isn't using them, e.g. between scene loads
+*/
+class MeshRegistry
+{
+public:
+	void Register(const std::string& name, const std::string& objFilePath, MeshOptions options = {});
+	void Register(const std::string& name, const ProceduralDesc& shape, MeshOptions options = {});
+
+	std::shared_ptr<Mesh> Get(const std::string& name);
+	bool IsLoaded(const std::string& name);
+
+	std::vector<std::string> GetUnreferenced();
+	size_t ReleaseUnreferenced();
+
+private:
+	struct Entry
+	{
+		std::string path;	// Canonical, or empty for procedural meshes
+		ProceduralDesc shape;
+		MeshOptions options;
+		std::shared_ptr<Mesh> mesh;
+
+		// Filled in when loaded, to spot the same file under another path
+		bool hashed;
+		unsigned long long contentHash;
+		unsigned long long contentSize;
+	};
+
+	void Add(const std::string& name, const Entry& entry);
+	Entry& Find(const std::string& name);
+	long RegistryReferences(const std::shared_ptr<Mesh>& mesh);
+
+	std::unordered_map<std::string, Entry> entries;
+};
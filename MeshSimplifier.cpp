@@ -0,0 +1,425 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Symmetric 4x4 matrix measuring the (area weighted) squared
+	// distance of a point from a set of planes
+	// --------------------------------------------------------
+	struct Quadric
+	{
+		double a00, a11, a22, a01, a02, a12;
+		double b0, b1, b2;
+		double c;
+		double weight;
+
+		void AddPlane(double nx, double ny, double nz, double d, double w)
+		{
+			a00 += w * nx * nx; a11 += w * ny * ny; a22 += w * nz * nz;
+			a01 += w * nx * ny; a02 += w * nx * nz; a12 += w * ny * nz;
+			b0 += w * nx * d; b1 += w * ny * d; b2 += w * nz * d;
+			c += w * d * d;
+			weight += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a00 += q.a00; a11 += q.a11; a22 += q.a22;
+			a01 += q.a01; a02 += q.a02; a12 += q.a12;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			weight += q.weight;
+		}
+
+		// Average squared distance to the planes
+		double Error(const XMFLOAT3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double e =
+				a00 * x * x + a11 * y * y + a22 * z * z +
+				2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+				2 * (b0 * x + b1 * y + b2 * z) + c;
+			return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double error;
+	};
+
+	// Face normal direction (not normalized)
+	XMVECTOR XM_CALLCONV FaceNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		XMVECTOR a = XMLoadFloat3(&p0);
+		return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), a), XMVectorSubtract(XMLoadFloat3(&p2), a));
+	}
+
+	// --------------------------------------------------------
+	// Groups vertices that share an exact position, since they
+	// have to move together to keep the surface closed
+	// --------------------------------------------------------
+	struct PositionGroups
+	{
+		std::vector<unsigned int> groupOf;		// Per vertex
+		std::vector<XMFLOAT3> positions;		// Per group
+		std::vector<unsigned int> offsets;		// Start of each group's vertices in members
+		std::vector<unsigned int> members;
+	};
+
+	void BuildPositionGroups(PositionGroups& groups, const Vertex* vertices, size_t vertexCount)
+	{
+		struct PositionHash
+		{
+			size_t operator()(const XMFLOAT3& p) const
+			{
+				unsigned int bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+		};
+
+		std::unordered_map<XMFLOAT3, unsigned int, PositionHash, PositionEqual> ids;
+		ids.reserve(vertexCount);
+		groups.groupOf.resize(vertexCount);
+		groups.positions.clear();
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			auto inserted = ids.emplace(vertices[v].Position, (unsigned int)groups.positions.size());
+			if (inserted.second)
+				groups.positions.push_back(vertices[v].Position);
+			groups.groupOf[v] = inserted.first->second;
+		}
+
+		groups.offsets.assign(groups.positions.size() + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+			groups.offsets[groups.groupOf[v] + 1]++;
+		for (size_t g = 0; g < groups.positions.size(); g++)
+			groups.offsets[g + 1] += groups.offsets[g];
+
+		groups.members.resize(vertexCount);
+		std::vector<unsigned int> fill(groups.offsets.begin(), groups.offsets.end() - 1);
+		for (size_t v = 0; v < vertexCount; v++)
+			groups.members[fill[groups.groupOf[v]]++] = (unsigned int)v;
+	}
+
+	// --------------------------------------------------------
+	// Positions on open borders or non-manifold edges (edges not
+	// shared by exactly two triangles) are locked in place
+	// --------------------------------------------------------
+	void FindLockedGroups(std::vector<bool>& locked, const PositionGroups& groups, const unsigned int* indices, size_t indexCount)
+	{
+		std::unordered_map<unsigned long long, unsigned int> edgeUses;
+		edgeUses.reserve(indexCount);
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (size_t k = 0; k < 3; k++)
+			{
+				unsigned long long a = groups.groupOf[indices[i + k]];
+				unsigned long long b = groups.groupOf[indices[i + (k + 1) % 3]];
+				edgeUses[std::min(a, b) << 32 | std::max(a, b)]++;
+			}
+		}
+
+		locked.assign(groups.positions.size(), false);
+		for (const auto& edge : edgeUses)
+		{
+			if (edge.second != 2)
+			{
+				locked[edge.first >> 32] = true;
+				locked[edge.first & 0xFFFFFFFF] = true;
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// When a vertex's position collapses onto another position
+	// without an edge to one of that position's vertices, it may
+	// only take over a vertex with (nearly) the same attributes -
+	// otherwise it's sitting on a real UV or hard normal seam
+	// --------------------------------------------------------
+	bool SimilarAttributes(const Vertex& a, const Vertex& b)
+	{
+		const float UVTolerance = 1e-3f;
+		const float NormalTolerance = 0.9f; // Cosine, about 25 degrees
+
+		return
+			std::fabs(a.UV.x - b.UV.x) <= UVTolerance &&
+			std::fabs(a.UV.y - b.UV.y) <= UVTolerance &&
+			XMVectorGetX(XMVector3Dot(XMLoadFloat3(&a.Normal), XMLoadFloat3(&b.Normal))) >= NormalTolerance;
+	}
+}
+
+// --------------------------------------------------------
+// Simplifies a triangle list by repeated passes of edge collapses
+//
+// Collapses work on positions: every vertex at the collapsing
+// position moves onto a vertex at the target position, so meshes
+// with split normals or UVs stay closed. Each pass gathers every
+// legal collapse, sorts them by quadric error and applies the
+// cheapest ones, never touching a position twice in one pass.
+// --------------------------------------------------------
+size_t MeshSimplifier::Simplify(unsigned int* destination, const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+	size_t targetIndexCount, float maxError, float* resultError)
+{
+	std::vector<unsigned int> current(indices, indices + indexCount);
+	float finalError = 0.0f;
+
+	if (indexCount > 0)
+	{
+		PositionGroups groups;
+		BuildPositionGroups(groups, vertices, vertexCount);
+		size_t groupCount = groups.positions.size();
+
+		std::vector<bool> locked;
+		FindLockedGroups(locked, groups, indices, indexCount);
+
+		// Scale the error limit to the mesh
+		XMVECTOR minimum = XMLoadFloat3(&groups.positions[0]), maximum = minimum;
+		for (const XMFLOAT3& position : groups.positions)
+		{
+			minimum = XMVectorMin(minimum, XMLoadFloat3(&position));
+			maximum = XMVectorMax(maximum, XMLoadFloat3(&position));
+		}
+		XMVECTOR extent = XMVectorSubtract(maximum, minimum);
+		double meshSize = std::max({ XMVectorGetX(extent), XMVectorGetY(extent), XMVectorGetZ(extent) });
+		double maxSquaredError = (maxError * meshSize) * (maxError * meshSize);
+
+		// Plane quadrics per position, weighted by triangle area
+		std::vector<Quadric> quadrics(groupCount, Quadric{});
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			XMVECTOR normal = FaceNormal(vertices[indices[i]].Position, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position);
+			float length = XMVectorGetX(XMVector3Length(normal));
+			if (length <= 0.0f)
+				continue;
+
+			XMFLOAT3 n;
+			XMStoreFloat3(&n, XMVectorScale(normal, 1.0f / length));
+			const XMFLOAT3& p = vertices[indices[i]].Position;
+			double d = -(n.x * (double)p.x + n.y * (double)p.y + n.z * (double)p.z);
+			for (size_t k = 0; k < 3; k++)
+				quadrics[groups.groupOf[indices[i + k]]].AddPlane(n.x, n.y, n.z, d, length * 0.5);
+		}
+
+		std::vector<std::vector<unsigned int>> groupTriangles(groupCount);
+		std::vector<Collapse> collapses;
+		std::vector<unsigned int> remap(vertexCount);
+		std::vector<unsigned int> targets(vertexCount);
+		std::vector<bool> touched(groupCount);
+		double worstError = 0.0;
+
+		while (current.size() > targetIndexCount)
+		{
+			for (auto& list : groupTriangles)
+				list.clear();
+			for (size_t i = 0; i < current.size(); i++)
+				groupTriangles[groups.groupOf[current[i]]].push_back((unsigned int)(i / 3));
+
+			// Every directed edge is a possible collapse of its first position onto its second
+			collapses.clear();
+			for (size_t i = 0; i < current.size(); i += 3)
+			{
+				for (size_t k = 0; k < 3; k++)
+				{
+					unsigned int a = groups.groupOf[current[i + k]];
+					unsigned int b = groups.groupOf[current[i + (k + 1) % 3]];
+					if (!locked[a])
+						collapses.push_back({ a, b, 0.0 });
+					if (!locked[b])
+						collapses.push_back({ b, a, 0.0 });
+				}
+			}
+
+			for (Collapse& c : collapses)
+			{
+				Quadric q = quadrics[c.from];
+				q.Add(quadrics[c.to]);
+				c.error = q.Error(groups.positions[c.to]);
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			for (size_t v = 0; v < vertexCount; v++)
+				remap[v] = (unsigned int)v;
+			std::fill(touched.begin(), touched.end(), false);
+
+			// Apply the cheapest collapses, up to what the target needs
+			size_t trianglesToRemove = (current.size() - targetIndexCount) / 3;
+			size_t removed = 0;
+			size_t applied = 0;
+			for (const Collapse& c : collapses)
+			{
+				if (c.error > maxSquaredError || removed >= trianglesToRemove)
+					break;
+				if (touched[c.from] || touched[c.to])
+					continue;
+
+				const std::vector<unsigned int>& around = groupTriangles[c.from];
+				bool legal = true;
+				unsigned int collapsing = 0;
+
+				// Pick a target for each vertex at "from": preferably one it shares an
+				// edge with, otherwise one with matching attributes
+				for (unsigned int m = groups.offsets[c.from]; m < groups.offsets[c.from + 1]; m++)
+					targets[groups.members[m]] = UINT_MAX;
+				for (unsigned int t : around)
+				{
+					const unsigned int* tri = &current[t * 3];
+					for (size_t k = 0; k < 3; k++)
+						if (groups.groupOf[tri[k]] == c.from)
+							for (size_t j = 0; j < 3; j++)
+								if (groups.groupOf[tri[j]] == c.to)
+									targets[tri[k]] = tri[j];
+				}
+				for (unsigned int t : around)
+				{
+					const unsigned int* tri = &current[t * 3];
+					for (size_t k = 0; k < 3 && legal; k++)
+					{
+						unsigned int v = tri[k];
+						if (groups.groupOf[v] != c.from || targets[v] != UINT_MAX)
+							continue;
+
+						for (unsigned int m = groups.offsets[c.to]; m < groups.offsets[c.to + 1]; m++)
+						{
+							if (SimilarAttributes(vertices[v], vertices[groups.members[m]]))
+							{
+								targets[v] = groups.members[m];
+								break;
+							}
+						}
+						legal = targets[v] != UINT_MAX;
+					}
+				}
+
+				// Surviving triangles must not flip
+				for (unsigned int t : around)
+				{
+					if (!legal)
+						break;
+
+					const unsigned int* tri = &current[t * 3];
+					XMFLOAT3 before[3], after[3];
+					bool survives = true;
+					for (size_t k = 0; k < 3; k++)
+					{
+						unsigned int group = groups.groupOf[tri[k]];
+						survives &= group != c.to;
+						before[k] = groups.positions[group];
+						after[k] = group == c.from ? groups.positions[c.to] : before[k];
+					}
+
+					if (!survives)
+					{
+						collapsing++;
+						continue;
+					}
+
+					XMVECTOR n0 = FaceNormal(before[0], before[1], before[2]);
+					XMVECTOR n1 = FaceNormal(after[0], after[1], after[2]);
+					legal = XMVectorGetX(XMVector3Dot(n0, n1)) > 0.0f;
+				}
+
+				if (!legal)
+					continue;
+
+				for (unsigned int m = groups.offsets[c.from]; m < groups.offsets[c.from + 1]; m++)
+					if (targets[groups.members[m]] != UINT_MAX)
+						remap[groups.members[m]] = targets[groups.members[m]];
+				quadrics[c.to].Add(quadrics[c.from]);
+
+				// Every position around either end is now out of date
+				for (unsigned int t : around)
+					for (size_t k = 0; k < 3; k++)
+						touched[groups.groupOf[current[t * 3 + k]]] = true;
+				for (unsigned int t : groupTriangles[c.to])
+					for (size_t k = 0; k < 3; k++)
+						touched[groups.groupOf[current[t * 3 + k]]] = true;
+
+				removed += collapsing;
+				worstError = std::max(worstError, c.error);
+				applied++;
+			}
+
+			if (applied == 0)
+				break;
+
+			// Apply the remap and drop the triangles that collapsed
+			size_t written = 0;
+			for (size_t i = 0; i < current.size(); i += 3)
+			{
+				unsigned int a = remap[current[i]], b = remap[current[i + 1]], c = remap[current[i + 2]];
+				unsigned int ga = groups.groupOf[a], gb = groups.groupOf[b], gc = groups.groupOf[c];
+				if (ga == gb || gb == gc || ga == gc)
+					continue;
+
+				current[written++] = a;
+				current[written++] = b;
+				current[written++] = c;
+			}
+			current.resize(written);
+		}
+
+		finalError = (float)std::sqrt(worstError);
+	}
+
+	std::copy(current.begin(), current.end(), destination);
+	if (resultError)
+		*resultError = finalError;
+	return current.size();
+}
+
+// --------------------------------------------------------
+// Halves the triangle count level by level, each level starting
+// from the previous one so errors accumulate sensibly
+// --------------------------------------------------------
+std::vector<MeshSimplifier::Lod> MeshSimplifier::BuildLodChain(const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+	unsigned int levelCount, float maxError)
+{
+	std::vector<Lod> lods;
+	std::vector<unsigned int> previous(indices, indices + indexCount);
+	float previousError = 0.0f;
+
+	for (unsigned int level = 0; level < levelCount; level++)
+	{
+		size_t target = (previous.size() / 3 / 2) * 3;
+
+		Lod lod;
+		lod.indices.resize(previous.size());
+		float error = 0.0f;
+		size_t count = Simplify(&lod.indices[0], &previous[0], previous.size(), vertices, vertexCount, target, maxError, &error);
+
+		// Not worth another level if it barely shrank
+		if (count == 0 || count > previous.size() * 3 / 4)
+			break;
+
+		// Simplification scrambles triangle order, so fix up the cache behavior
+		lod.indices.resize(count);
+		std::vector<unsigned int> optimized(count);
+		MeshOptimizer::OptimizeVertexCache(&optimized[0], &lod.indices[0], count, vertexCount);
+		lod.indices.swap(optimized);
+
+		// Errors are measured from the previous level; keep them cumulative
+		lod.error = previousError + error;
+		previousError = lod.error;
+
+		previous = lod.indices;
+		lods.push_back(std::move(lod));
+	}
+
+	return lods;
+}
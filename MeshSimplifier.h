@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+/*
+* Quadric error metric mesh simplification (Garland & Heckbert), by edge collapse
+* onto existing vertices - the output is a new index buffer that reuses the same
+* vertex buffer, so LODs can share one set of vertices.
+*
+* Vertices on open borders and on attribute seams (where several vertices share a
+* position but differ in UV/normal) are locked in place, which keeps the silhouette
+* and texture mapping intact at the cost of some reduction on heavily split meshes.
+*
+* Simplify(): Collapses edges until the target index count or the error limit is reached
+* BuildLodChain(): Repeatedly halves the triangle count, returning each level's indices and error
+*/
+namespace MeshSimplifier
+{
+	// --------------------------------------------------------
+	// destination - Receives the simplified indices (room for indexCount)
+	// targetIndexCount - Stop once the mesh has this many indices or fewer
+	// maxError - Largest allowed error, as a fraction of the mesh's size
+	// resultError - (Optional) Receives the final error in object space units
+	// Returns the number of indices written
+	// --------------------------------------------------------
+	size_t Simplify(unsigned int* destination, const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+		size_t targetIndexCount, float maxError, float* resultError = nullptr);
+
+	// --------------------------------------------------------
+	// One level of a LOD chain
+	// --------------------------------------------------------
+	struct Lod
+	{
+		std::vector<unsigned int> indices;
+		float error; // Object space units
+	};
+
+	// --------------------------------------------------------
+	// Builds up to levelCount levels, each targeting half of the
+	// previous level's triangles. Stops early when a level can't
+	// get meaningfully smaller within maxError.
+	// --------------------------------------------------------
+	std::vector<Lod> BuildLodChain(const unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+		unsigned int levelCount, float maxError = 0.02f);
+}
@@ -0,0 +1,271 @@
+#include "Meshlets.h"
+#include "MeshBounds.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace DirectX;
+
+namespace
+{
+	// Cones wider than this (about 84 degrees from the axis) almost never cull
+	const float MinConeDot = 0.1f;
+
+	// Local triangle indices are bytes, which caps the vertex count
+	const unsigned int VertexLimit = 256;
+	const unsigned int TriangleLimit = 512;
+
+	// --------------------------------------------------------
+	// Fills in a finished meshlet's sphere and normal cone
+	// --------------------------------------------------------
+	void ComputeBounds(Meshlet& meshlet, const MeshletData& data, const Vertex* vertices)
+	{
+		XMFLOAT3 positions[VertexLimit];
+		for (unsigned int i = 0; i < meshlet.vertexCount; i++)
+			positions[i] = vertices[data.vertices[meshlet.vertexOffset + i]].Position;
+
+		BoundingSphere sphere;
+		BoundingVolumes::ComputeSphere(positions, meshlet.vertexCount, sizeof(XMFLOAT3), &sphere);
+		meshlet.center = sphere.Center;
+		meshlet.radius = sphere.Radius;
+
+		// Face normals (outward for clockwise triangles in our left handed space)
+		XMVECTOR normals[TriangleLimit];
+		XMVECTOR firstCorners[TriangleLimit];
+		unsigned int normalCount = 0;
+		XMVECTOR axis = XMVectorZero();
+		for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+		{
+			const unsigned char* tri = &data.triangles[meshlet.triangleOffset + t * 3];
+			XMVECTOR p0 = XMLoadFloat3(&positions[tri[0]]);
+			XMVECTOR p1 = XMLoadFloat3(&positions[tri[1]]);
+			XMVECTOR p2 = XMLoadFloat3(&positions[tri[2]]);
+
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			float length = XMVectorGetX(XMVector3Length(normal));
+			if (length <= 0.0f)
+				continue; // Degenerate triangles can't be seen either way
+
+			normals[normalCount] = XMVectorScale(normal, 1.0f / length);
+			firstCorners[normalCount] = p0;
+			axis = XMVectorAdd(axis, normals[normalCount]);
+			normalCount++;
+		}
+
+		meshlet.coneApex = meshlet.center;
+		meshlet.coneAxis = XMFLOAT3(0, 0, 0);
+		meshlet.coneCutoff = 1.0f;
+
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		if (normalCount == 0 || axisLength <= 0.0f)
+			return;
+		axis = XMVectorScale(axis, 1.0f / axisLength);
+
+		// The widest normal decides the cone's angle
+		float minDot = 1.0f;
+		for (unsigned int i = 0; i < normalCount; i++)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(normals[i], axis)));
+
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		if (minDot <= MinConeDot)
+			return;
+
+		// Slide the apex back along the axis until it's behind every
+		// triangle's plane, so the test holds for the whole meshlet
+		XMVECTOR center = XMLoadFloat3(&meshlet.center);
+		float maxT = 0.0f;
+		for (unsigned int i = 0; i < normalCount; i++)
+		{
+			float distance = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, firstCorners[i]), normals[i]));
+			float along = XMVectorGetX(XMVector3Dot(axis, normals[i]));
+			maxT = std::max(maxT, distance / along);
+		}
+
+		XMStoreFloat3(&meshlet.coneApex, XMVectorSubtract(center, XMVectorScale(axis, maxT)));
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+// --------------------------------------------------------
+// Splits a mesh into meshlets of at most maxVertices vertices
+// and maxTriangles triangles
+//
+// Each meshlet grows from a seed triangle by repeatedly adding
+// the neighboring triangle that needs the fewest new vertices,
+// starting a new meshlet when the next one doesn't fit. Seeds are
+// taken in index buffer order, so run MeshOptimizer first for
+// spatially coherent meshlets.
+// --------------------------------------------------------
+void Meshlets::Build(MeshletData& out, const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, unsigned int maxVertices, unsigned int maxTriangles)
+{
+	if (maxVertices < 3 || maxVertices > VertexLimit || maxTriangles < 1 || maxTriangles > TriangleLimit)
+		throw std::invalid_argument("Meshlet limits must be 3-256 vertices and 1-512 triangles");
+
+	out.meshlets.clear();
+	out.vertices.clear();
+	out.triangles.clear();
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles around each vertex
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		adjacencyOffsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	{
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<int> localIndex(vertexCount, -1); // Slot of each vertex in the current meshlet
+	size_t nextSeed = 0;
+
+	Meshlet current = {};
+	auto finish = [&]()
+	{
+		ComputeBounds(current, out, vertices);
+		out.meshlets.push_back(current);
+
+		for (unsigned int i = 0; i < current.vertexCount; i++)
+			localIndex[out.vertices[current.vertexOffset + i]] = -1;
+
+		current = {};
+		current.vertexOffset = (unsigned int)out.vertices.size();
+		current.triangleOffset = (unsigned int)out.triangles.size();
+	};
+	auto newVertexCount = [&](size_t t)
+	{
+		return (localIndex[indices[t * 3 + 0]] < 0) + (localIndex[indices[t * 3 + 1]] < 0) + (localIndex[indices[t * 3 + 2]] < 0);
+	};
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		// Best neighbor of the current meshlet
+		long long best = -1;
+		int bestNew = 4;
+		for (unsigned int i = 0; i < current.vertexCount && bestNew > 0; i++)
+		{
+			unsigned int v = out.vertices[current.vertexOffset + i];
+			for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+			{
+				unsigned int t = adjacency[a];
+				if (emitted[t])
+					continue;
+
+				int extra = newVertexCount(t);
+				if (extra < bestNew)
+				{
+					best = t;
+					bestNew = extra;
+				}
+			}
+		}
+
+		// No neighbors left - seed from the next unused triangle instead
+		if (best < 0)
+		{
+			while (emitted[nextSeed])
+				nextSeed++;
+			best = (long long)nextSeed;
+			bestNew = newVertexCount(nextSeed);
+		}
+
+		if (current.vertexCount + bestNew > maxVertices || current.triangleCount + 1 > maxTriangles)
+		{
+			finish();
+			bestNew = 3;
+		}
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[best * 3 + k];
+			if (localIndex[v] < 0)
+			{
+				localIndex[v] = (int)current.vertexCount++;
+				out.vertices.push_back(v);
+			}
+			out.triangles.push_back((unsigned char)localIndex[v]);
+		}
+		current.triangleCount++;
+		emitted[best] = true;
+	}
+
+	if (current.triangleCount > 0)
+		finish();
+}
+
+// --------------------------------------------------------
+// Expands meshlet triangles back into mesh-wide indices
+// - destination needs room for data.triangles.size() indices
+// --------------------------------------------------------
+void Meshlets::Unpack(unsigned int* destination, const MeshletData& data)
+{
+	for (const Meshlet& m : data.meshlets)
+		for (unsigned int i = 0; i < m.triangleCount * 3; i++)
+			destination[m.triangleOffset + i] = data.vertices[m.vertexOffset + data.triangles[m.triangleOffset + i]];
+}
+
+// --------------------------------------------------------
+// Finds the meshlets a camera can see
+//
+// Everything happens in the mesh's object space: frustum planes come
+// straight from the combined world-view-projection matrix, and the
+// camera is moved into object space for the cone test (which keeps
+// both tests exact under non-uniform scale)
+//
+// visible - Receives the indices of the visible meshlets
+// Returns the number of visible meshlets
+// --------------------------------------------------------
+size_t Meshlets::Cull(std::vector<unsigned int>& visible, const MeshletData& data,
+	const XMFLOAT4X4& world, const XMFLOAT4X4& view, const XMFLOAT4X4& proj, const XMFLOAT3& cameraPosition)
+{
+	visible.clear();
+
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	XMMATRIX wvp = XMMatrixTranspose(XMMatrixMultiply(XMMatrixMultiply(worldMatrix, XMLoadFloat4x4(&view)), XMLoadFloat4x4(&proj)));
+
+	// Gribb/Hartmann plane extraction (rows of the transpose are the
+	// original's columns), with D3D's 0-1 depth range
+	XMVECTOR planes[6] =
+	{
+		XMVectorAdd(wvp.r[3], wvp.r[0]),		// Left
+		XMVectorSubtract(wvp.r[3], wvp.r[0]),	// Right
+		XMVectorAdd(wvp.r[3], wvp.r[1]),		// Bottom
+		XMVectorSubtract(wvp.r[3], wvp.r[1]),	// Top
+		wvp.r[2],								// Near
+		XMVectorSubtract(wvp.r[3], wvp.r[2]),	// Far
+	};
+	for (XMVECTOR& plane : planes)
+		plane = XMVectorScale(plane, 1.0f / XMVectorGetX(XMVector3Length(plane)));
+
+	XMVECTOR objectCamera = XMVector3Transform(XMLoadFloat3(&cameraPosition), XMMatrixInverse(nullptr, worldMatrix));
+
+	for (size_t i = 0; i < data.meshlets.size(); i++)
+	{
+		const Meshlet& m = data.meshlets[i];
+		XMVECTOR center = XMVectorSetW(XMLoadFloat3(&m.center), 1.0f);
+
+		bool outside = false;
+		for (size_t p = 0; p < 6 && !outside; p++)
+			outside = XMVectorGetX(XMVector4Dot(planes[p], center)) < -m.radius;
+		if (outside)
+			continue;
+
+		if (m.coneCutoff < 1.0f)
+		{
+			XMVECTOR toApex = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&m.coneApex), objectCamera));
+			if (XMVectorGetX(XMVector3Dot(toApex, XMLoadFloat3(&m.coneAxis))) >= m.coneCutoff)
+				continue;
+		}
+
+		visible.push_back((unsigned int)i);
+	}
+
+	return visible.size();
+}
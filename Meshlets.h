@@ -0,0 +1,61 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A small cluster of a mesh's triangles
+//
+// - Vertices are indices into the mesh's vertex buffer, stored
+//   in MeshletData::vertices starting at vertexOffset
+// - Triangles are 3 bytes each (indices into this meshlet's vertices),
+//   stored in MeshletData::triangles starting at triangleOffset.
+//   Because triangles are packed back to back, triangleOffset is
+//   also where this meshlet starts in an Unpack()ed index buffer
+// --------------------------------------------------------
+struct Meshlet
+{
+	unsigned int vertexOffset;
+	unsigned int triangleOffset;
+	unsigned int vertexCount;
+	unsigned int triangleCount;
+
+	// Bounding sphere, object space
+	DirectX::XMFLOAT3 center;
+	float radius;
+
+	// Normal cone: the meshlet is entirely back facing when
+	// dot(normalize(coneApex - camera), coneAxis) >= coneCutoff
+	// (a cutoff of 1 or more means the cone is too wide to ever cull)
+	DirectX::XMFLOAT3 coneApex;
+	float coneCutoff;
+	DirectX::XMFLOAT3 coneAxis;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<unsigned int> vertices;
+	std::vector<unsigned char> triangles;
+};
+
+/*
+* Splits meshes into meshlets and culls them on the CPU.
+*
+* Build(): Greedily grows meshlets out of neighboring triangles, then computes their bounds and cones
+* Unpack(): Writes the meshlets' triangles as a regular index buffer, in meshlet order
+* Cull(): Fills a list with the meshlets that are inside the view frustum and not back facing
+*/
+namespace Meshlets
+{
+	const unsigned int MaxVertices = 64;
+	const unsigned int MaxTriangles = 124;
+
+	void Build(MeshletData& out, const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+		unsigned int maxVertices = MaxVertices, unsigned int maxTriangles = MaxTriangles);
+
+	void Unpack(unsigned int* destination, const MeshletData& data);
+
+	size_t Cull(std::vector<unsigned int>& visible, const MeshletData& data,
+		const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj, const DirectX::XMFLOAT3& cameraPosition);
+}
@@ -0,0 +1,395 @@
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2
+#endif
+
+namespace
+{
+	const float Pi = 3.14159265f;
+
+	// Kaiser filter shape: reach (in pixels of the smaller level) and window sharpness
+	const float KaiserWidth = 3.0f;
+	const float KaiserAlpha = 4.0f;
+
+	// --------------------------------------------------------
+	// A level being filtered: RGBA as floats, one pixel per
+	// 16 bytes. Colors are linear light and normals are
+	// vectors in [-1, 1] (not renormalized, so their length
+	// shows how much the normals below them agree)
+	// --------------------------------------------------------
+	struct Pixel
+	{
+		alignas(16) float channels[4];
+	};
+
+	struct FloatImage
+	{
+		unsigned int width = 0;
+		unsigned int height = 0;
+		std::vector<Pixel> pixels;
+	};
+
+	// Per pixel lengths of one level's averaged normals
+	struct NormalLengths
+	{
+		unsigned int width = 0;
+		unsigned int height = 0;
+		std::vector<float> lengths;
+	};
+
+	// The source pixels (already wrapped or clamped) and weights making up one filtered pixel
+	struct FilterTaps
+	{
+		std::vector<int> indices;
+		std::vector<float> weights;
+	};
+
+	// --------------------------------------------------------
+	// sRGB decoding table, plus the linear values halfway
+	// between neighboring codes for encoding by binary search
+	// --------------------------------------------------------
+	struct SrgbTables
+	{
+		float toLinear[256];
+		float midpoints[255];
+
+		SrgbTables()
+		{
+			for (unsigned int i = 0; i < 256; i++)
+			{
+				float value = i / 255.0f;
+				toLinear[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+			}
+			for (unsigned int i = 0; i < 255; i++)
+				midpoints[i] = (toLinear[i] + toLinear[i + 1]) / 2;
+		}
+	};
+
+	const SrgbTables& GetSrgbTables()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	unsigned char EncodeSrgb(const SrgbTables& tables, float linear)
+	{
+		// The smallest code whose midpoint with the next code is above the value
+		return (unsigned char)(std::upper_bound(tables.midpoints, tables.midpoints + 255, linear) - tables.midpoints);
+	}
+
+	unsigned char EncodeUnorm(float value)
+	{
+		return (unsigned char)lroundf((std::clamp)(value, 0.0f, 1.0f) * 255);
+	}
+
+	// Modified Bessel function of the first kind, order 0 (for the Kaiser window)
+	float BesselI0(float x)
+	{
+		float sum = 1, term = 1;
+		for (unsigned int k = 1; k < 20; k++)
+		{
+			term *= (x / (2 * k)) * (x / (2 * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	float Kaiser(float x)
+	{
+		if (fabsf(x) >= KaiserWidth)
+			return 0;
+		float sinc = x == 0 ? 1.0f : sinf(Pi * x) / (Pi * x);
+		float window = x / KaiserWidth;
+		return sinc * BesselI0(KaiserAlpha * sqrtf(1 - window * window)) / BesselI0(KaiserAlpha);
+	}
+
+	// --------------------------------------------------------
+	// Weights for shrinking one axis from sourceSize pixels to
+	// destinationSize pixels. Box weights are how much of each
+	// source pixel a destination pixel covers
+	// --------------------------------------------------------
+	std::vector<FilterTaps> BuildTaps(unsigned int sourceSize, unsigned int destinationSize, const MipOptions& options)
+	{
+		std::vector<FilterTaps> taps(destinationSize);
+		float scale = (float)sourceSize / destinationSize;
+		for (unsigned int i = 0; i < destinationSize; i++)
+		{
+			FilterTaps& pixel = taps[i];
+			if (sourceSize == destinationSize)
+			{
+				pixel.indices.push_back((int)i);
+				pixel.weights.push_back(1);
+				continue;
+			}
+
+			float center = (i + 0.5f) * scale; // In source pixels
+			float reach = options.filter == MipFilter::Box ? scale / 2 : KaiserWidth * scale;
+			int first = (int)floorf(center - reach);
+			int last = (int)ceilf(center + reach);
+			float total = 0;
+			for (int j = first; j < last; j++)
+			{
+				float weight;
+				if (options.filter == MipFilter::Box)
+					weight = (std::max)(0.0f, (std::min)((float)j + 1, center + reach) - (std::max)((float)j, center - reach));
+				else
+					weight = Kaiser((j + 0.5f - center) / scale);
+				if (weight == 0)
+					continue;
+
+				int index = j;
+				if (options.wrap)
+					index = ((j % (int)sourceSize) + (int)sourceSize) % (int)sourceSize;
+				else
+					index = (std::clamp)(j, 0, (int)sourceSize - 1);
+				pixel.indices.push_back(index);
+				pixel.weights.push_back(weight);
+				total += weight;
+			}
+
+			for (float& weight : pixel.weights)
+				weight /= total;
+		}
+		return taps;
+	}
+
+	// --------------------------------------------------------
+	// Shrinks a level to half its size (rounding down, to at
+	// least 1) along both axes
+	// --------------------------------------------------------
+	void Downsample(const FloatImage& source, FloatImage& out, const MipOptions& options)
+	{
+		out.width = (std::max)(source.width / 2, 1u);
+		out.height = (std::max)(source.height / 2, 1u);
+		std::vector<FilterTaps> columns = BuildTaps(source.width, out.width, options);
+		std::vector<FilterTaps> rows = BuildTaps(source.height, out.height, options);
+
+		// Horizontally: every source row, to the new width
+		std::vector<Pixel> narrow((size_t)out.width * source.height);
+		ThreadPool::Shared().ParallelFor(source.height, [&](unsigned int y)
+			{
+				const Pixel* sourceRow = &source.pixels[(size_t)y * source.width];
+				Pixel* outRow = &narrow[(size_t)y * out.width];
+				for (unsigned int x = 0; x < out.width; x++)
+				{
+					const FilterTaps& taps = columns[x];
+#if defined(MIP_GENERATOR_SSE2)
+					__m128 sum = _mm_setzero_ps();
+					for (size_t t = 0; t < taps.indices.size(); t++)
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(sourceRow[taps.indices[t]].channels), _mm_set1_ps(taps.weights[t])));
+					_mm_store_ps(outRow[x].channels, sum);
+#else
+					Pixel sum = {};
+					for (size_t t = 0; t < taps.indices.size(); t++)
+						for (unsigned int c = 0; c < 4; c++)
+							sum.channels[c] += sourceRow[taps.indices[t]].channels[c] * taps.weights[t];
+					outRow[x] = sum;
+#endif
+				}
+			});
+
+		// Vertically: each new row is a weighted sum of whole narrow rows
+		out.pixels.assign((size_t)out.width * out.height, Pixel());
+		ThreadPool::Shared().ParallelFor(out.height, [&](unsigned int y)
+			{
+				const FilterTaps& taps = rows[y];
+				Pixel* outRow = &out.pixels[(size_t)y * out.width];
+				for (size_t t = 0; t < taps.indices.size(); t++)
+				{
+					const Pixel* narrowRow = &narrow[(size_t)taps.indices[t] * out.width];
+#if defined(MIP_GENERATOR_SSE2)
+					__m128 weight = _mm_set1_ps(taps.weights[t]);
+					for (unsigned int x = 0; x < out.width; x++)
+						_mm_store_ps(outRow[x].channels, _mm_add_ps(_mm_load_ps(outRow[x].channels), _mm_mul_ps(_mm_load_ps(narrowRow[x].channels), weight)));
+#else
+					for (unsigned int x = 0; x < out.width; x++)
+						for (unsigned int c = 0; c < 4; c++)
+							outRow[x].channels[c] += narrowRow[x].channels[c] * taps.weights[t];
+#endif
+				}
+			});
+	}
+
+	void ToFloat(const ImageData& image, MipContent content, FloatImage& out)
+	{
+		const SrgbTables& srgb = GetSrgbTables();
+		out.width = image.width;
+		out.height = image.height;
+		out.pixels.resize((size_t)image.width * image.height);
+		ThreadPool::Shared().ParallelFor(image.height, [&](unsigned int y)
+			{
+				for (size_t i = (size_t)y * image.width; i < (size_t)(y + 1) * image.width; i++)
+				{
+					const unsigned char* pixel = &image.pixels[i * 4];
+					float* channels = out.pixels[i].channels;
+					for (unsigned int c = 0; c < 3; c++)
+					{
+						switch (content)
+						{
+						case MipContent::Srgb: channels[c] = srgb.toLinear[pixel[c]]; break;
+						case MipContent::Linear: channels[c] = pixel[c] / 255.0f; break;
+						case MipContent::NormalMap: channels[c] = pixel[c] / 127.5f - 1; break;
+						}
+					}
+					channels[3] = pixel[3] / 255.0f;
+
+					// Stored normals are only roughly unit length, so they're normalized
+					// first - otherwise rounding would look like disagreement
+					if (content == MipContent::NormalMap)
+					{
+						float length = sqrtf(channels[0] * channels[0] + channels[1] * channels[1] + channels[2] * channels[2]);
+						for (unsigned int c = 0; c < 3; c++)
+							channels[c] = length > 1e-6f ? channels[c] / length : (c == 2 ? 1.0f : 0.0f);
+					}
+				}
+			});
+	}
+
+	void ToBytes(const FloatImage& image, MipContent content, ImageData& out)
+	{
+		const SrgbTables& srgb = GetSrgbTables();
+		out.width = image.width;
+		out.height = image.height;
+		out.pixels.resize((size_t)image.width * image.height * 4);
+		ThreadPool::Shared().ParallelFor(image.height, [&](unsigned int y)
+			{
+				for (size_t i = (size_t)y * image.width; i < (size_t)(y + 1) * image.width; i++)
+				{
+					const float* channels = image.pixels[i].channels;
+					unsigned char* pixel = &out.pixels[i * 4];
+					if (content == MipContent::NormalMap)
+					{
+						float length = sqrtf(channels[0] * channels[0] + channels[1] * channels[1] + channels[2] * channels[2]);
+						for (unsigned int c = 0; c < 3; c++)
+						{
+							// Normals that cancel out entirely just face straight out
+							float normal = length > 1e-6f ? channels[c] / length : (c == 2 ? 1.0f : 0.0f);
+							pixel[c] = EncodeUnorm(normal * 0.5f + 0.5f);
+						}
+					}
+					else
+					{
+						for (unsigned int c = 0; c < 3; c++)
+							pixel[c] = content == MipContent::Srgb ? EncodeSrgb(srgb, channels[c]) : EncodeUnorm(channels[c]);
+					}
+					pixel[3] = EncodeUnorm(channels[3]);
+				}
+			});
+	}
+
+	// --------------------------------------------------------
+	// Filters the whole chain, handing every level (0 first)
+	// to onLevel before moving on to the next
+	// --------------------------------------------------------
+	void FilterChain(const ImageData& image, MipContent content, const MipOptions& options,
+		const std::function<void(unsigned int, const FloatImage&)>& onLevel)
+	{
+		if (image.width == 0 || image.height == 0 || image.pixels.size() != (size_t)image.width * image.height * 4)
+			throw std::invalid_argument("Mip chains need RGBA pixels for every texel");
+
+		FloatImage level, next;
+		ToFloat(image, content, level);
+		unsigned int levelCount = MipGenerator::GetMipCount(image.width, image.height);
+		for (unsigned int i = 0; i < levelCount; i++)
+		{
+			if (i > 0)
+			{
+				Downsample(level, next, options);
+				std::swap(level, next);
+			}
+			onLevel(i, level);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Toksvig: a Blinn-Phong lobe with exponent s, averaged
+	// over normals whose mean has length L, looks like one with
+	// 1/s' = 1/s + (1 - L) / L. Converted to and from GGX via
+	// alpha^2 = 2 / (s + 2)
+	// --------------------------------------------------------
+	float WidenRoughness(float roughness, float averageNormalLength)
+	{
+		if (roughness >= 1 || averageNormalLength >= 1)
+			return roughness;
+		float length = (std::max)(averageNormalLength, 1e-3f);
+
+		float alphaSquared = roughness * roughness * roughness * roughness;
+		float inverseExponent = alphaSquared / (2 - 2 * alphaSquared) + (1 - length) / length;
+		alphaSquared = 2 * inverseExponent / (1 + 2 * inverseExponent);
+		return sqrtf(sqrtf(alphaSquared));
+	}
+}
+
+unsigned int MipGenerator::GetMipCount(unsigned int width, unsigned int height)
+{
+	unsigned int count = 1;
+	for (unsigned int size = (std::max)(width, height); size > 1; size /= 2)
+		count++;
+	return count;
+}
+
+void MipGenerator::Generate(const ImageData& image, MipContent content, std::vector<ImageData>& mips, const MipOptions& options)
+{
+	mips.assign(GetMipCount(image.width, image.height), ImageData());
+	FilterChain(image, content, options, [&](unsigned int level, const FloatImage& pixels)
+		{
+			if (level == 0)
+				mips[0] = image; // Exactly as given, not round-tripped through floats
+			else
+				ToBytes(pixels, content, mips[level]);
+		});
+}
+
+void MipGenerator::GenerateRoughness(const ImageData& roughness, unsigned int roughnessChannel, const ImageData& normalMap, std::vector<ImageData>& mips, const MipOptions& options)
+{
+	if (roughnessChannel > 3)
+		throw std::invalid_argument("Roughness must be in channel 0 to 3");
+	Generate(roughness, MipContent::Linear, mips, options);
+
+	// How long the averaged normals are at each of the normal map's levels
+	std::vector<NormalLengths> normalLevels(GetMipCount(normalMap.width, normalMap.height));
+	FilterChain(normalMap, MipContent::NormalMap, options, [&](unsigned int level, const FloatImage& normals)
+		{
+			NormalLengths& lengths = normalLevels[level];
+			lengths.width = normals.width;
+			lengths.height = normals.height;
+			lengths.lengths.resize(normals.pixels.size());
+			for (size_t i = 0; i < normals.pixels.size(); i++)
+			{
+				const float* n = normals.pixels[i].channels;
+				lengths.lengths[i] = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			}
+		});
+
+	// The normal level covering the same area per texel as each roughness level
+	int levelOffset = 0;
+	for (unsigned int size = normalMap.width; size > roughness.width && size > 1; size /= 2)
+		levelOffset++;
+	for (unsigned int size = roughness.width; size > normalMap.width && size > 1; size /= 2)
+		levelOffset--;
+
+	for (unsigned int level = 0; level < mips.size(); level++)
+	{
+		unsigned int normalLevel = (unsigned int)(std::clamp)((int)level + levelOffset, 0, (int)normalLevels.size() - 1);
+		const NormalLengths& normals = normalLevels[normalLevel];
+		ImageData& image = mips[level];
+		ThreadPool::Shared().ParallelFor(image.height, [&](unsigned int y)
+			{
+				unsigned int normalY = (unsigned int)((unsigned long long)y * normals.height / image.height);
+				for (unsigned int x = 0; x < image.width; x++)
+				{
+					unsigned int normalX = (unsigned int)((unsigned long long)x * normals.width / image.width);
+					unsigned char& value = image.pixels[((size_t)y * image.width + x) * 4 + roughnessChannel];
+					value = EncodeUnorm(WidenRoughness(value / 255.0f, normals.lengths[(size_t)normalY * normals.width + normalX]));
+				}
+			});
+	}
+}
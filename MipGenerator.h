@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include "ImageData.h"
+
+// --------------------------------------------------------
+// How each mip level is filtered from the one above it
+//
+// - Box: Averages the 2x2 (or 3x3, for odd sizes) pixels
+//   each new pixel covers. Fast, but a little blurry and
+//   prone to aliasing
+// - Kaiser: A Kaiser-windowed sinc reaching 3 pixels of the
+//   new level each way. Sharper, with less aliasing
+// --------------------------------------------------------
+enum class MipFilter
+{
+	Box,
+	Kaiser
+};
+
+// --------------------------------------------------------
+// What a texture's values mean, which decides how they're
+// averaged
+//
+// - Srgb: sRGB encoded colors (alpha is linear), averaged
+//   as linear light and encoded again
+// - Linear: Data such as masks, averaged as stored
+// - NormalMap: Tangent space normals in RGB, averaged as
+//   vectors and renormalized (alpha is linear)
+// --------------------------------------------------------
+enum class MipContent
+{
+	Srgb,
+	Linear,
+	NormalMap
+};
+
+struct MipOptions
+{
+	MipFilter filter = MipFilter::Kaiser;
+	bool wrap = true; // Filters wrap around the edges (for tiling textures) instead of clamping
+};
+
+/*
+* Builds full mip chains on the CPU, so they can be baked into files (see TextureCompressor)
+* rather than generated on the GPU every time a texture loads.
+*
+* Each level is filtered from the one above it in 32-bit float, with one RGBA pixel per SSE
+* register: first horizontally into a temporary image, then vertically. Both passes split their
+* rows across the shared ThreadPool. Filter weights are worked out once per level and axis, so
+* sizes that aren't powers of 2 shrink correctly too.
+*
+* Roughness maps lose detail differently: when the normals under a texel disagree, the average
+* surface is rougher than any one of them. GenerateRoughness() widens each level's roughness by
+* the spread of the normal map underneath it (Toksvig's method, expressed for the GGX alpha the
+* shader uses: alpha = roughness^2), measured by how far the averaged normals fall short of unit
+* length. Only the roughness channel is changed, so it can share a texture with other data.
+*
+* GetMipCount(): Number of levels in a full chain, down to 1x1
+* Generate(): Fills mips with the full chain - mips[0] is a copy of the image
+* GenerateRoughness(): Like Generate() for a texture holding roughness (as Linear data), with
+*                      its roughness channel (0 - 3 for RGBA) then adjusted by the normal map.
+*                      The two don't have to be the same size
+*/
+namespace MipGenerator
+{
+	unsigned int GetMipCount(unsigned int width, unsigned int height);
+
+	void Generate(const ImageData& image, MipContent content, std::vector<ImageData>& mips, const MipOptions& options = MipOptions());
+	void GenerateRoughness(const ImageData& roughness, unsigned int roughnessChannel, const ImageData& normalMap, std::vector<ImageData>& mips, const MipOptions& options = MipOptions());
+}
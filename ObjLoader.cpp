@@ -0,0 +1,907 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OBJ_LOADER_SSE2
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// Marks a corner that has no uv or normal index
+	const unsigned int MissingIndex = UINT_MAX;
+
+	// Files are only split up for parallel parsing in pieces at least this big
+	const size_t MinBytesPerChunk = 1 << 20;
+
+	// Streaming imports never use less scratch memory than this
+	const size_t MinScratchBudget = 1 << 20;
+
+	// Most a streaming window holds per (triangulated) corner: the corner, its
+	// index and a new vertex, plus the face being read - 13 bytes per face
+	// corner with room to double, and a face has at least one corner for every
+	// 3 triangulated ones
+	const size_t WindowBytesPerCorner = 12 + 4 + sizeof(Vertex) + 9;
+
+	// A single face corner: 0-based indices into the
+	// position, uv and normal lists of the file
+	struct ObjCorner
+	{
+		unsigned int position, uv, normal;
+	};
+
+	// A usemtl record: every corner from this one on uses the named material
+	struct MaterialSwitch
+	{
+		size_t corner;
+		std::string name;
+	};
+
+	// Everything read from an OBJ file, before welding
+	struct ObjContents
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> uvs;
+		std::vector<ObjCorner> corners; // Three per triangle, already in DirectX winding order
+		std::vector<MaterialSwitch> materials;
+
+		// Corners that used negative (relative) indices, as corner * 3 + attribute
+		// (0 = position, 1 = uv, 2 = normal). When parsing a chunk from the middle
+		// of the file these were resolved against the chunk's own counts, so they
+		// still need the number of elements in earlier chunks added to them
+		std::vector<unsigned int> relativeCorners;
+
+		// Loading in full has no budget, so every line fits
+		bool HasRoomForCorners(size_t) const { return true; }
+		bool HasRoomForMaterial(size_t) const { return true; }
+	};
+
+	// Memory a streaming import's attribute lists may take between them
+	struct AttributeBudget
+	{
+		size_t used;
+		size_t limit;
+	};
+
+	// --------------------------------------------------------
+	// An append-only array stored in fixed-size blocks, so it
+	// grows without ever copying (or doubling) what it holds.
+	// Each block is charged to a budget shared with the other
+	// lists, and running out of it ends the import.
+	// --------------------------------------------------------
+	template <typename T>
+	class BlockList
+	{
+	public:
+		BlockList(AttributeBudget& budget) : budget(budget) {}
+
+		void push_back(const T& value)
+		{
+			if (count == blocks.size() << BlockShift)
+			{
+				// The block, and its pointer with room for the list of them to double
+				budget.used += sizeof(T) << BlockShift;
+				budget.used += 2 * sizeof(blocks[0]);
+				if (budget.used > budget.limit)
+					throw std::runtime_error("Error reading OBJ: positions, UVs and normals need more memory than the streaming budget");
+				blocks.emplace_back(new T[(size_t)1 << BlockShift]);
+			}
+			blocks.back()[count & BlockMask] = value;
+			count++;
+		}
+
+		const T& operator[](size_t i) const { return blocks[i >> BlockShift][i & BlockMask]; }
+		size_t size() const { return count; }
+
+	private:
+		static const size_t BlockShift = 12;
+		static const size_t BlockMask = ((size_t)1 << BlockShift) - 1;
+
+		AttributeBudget& budget;
+		std::vector<std::unique_ptr<T[]>> blocks;
+		size_t count = 0;
+	};
+
+	// A streaming import reads the file front to back, so relative
+	// indices are already correct when parsed and need no fixups
+	struct NoFixups
+	{
+		void push_back(unsigned int) {}
+	};
+
+	// A streaming window's usemtl records, counting the memory they take
+	// (each record twice, since the list may double past what it holds)
+	struct MaterialList : std::vector<MaterialSwitch>
+	{
+		size_t bytes = 0;
+
+		void push_back(MaterialSwitch&& material)
+		{
+			bytes += 2 * sizeof(MaterialSwitch) + material.name.size() + 1;
+			std::vector<MaterialSwitch>::push_back(std::move(material));
+		}
+
+		void clear()
+		{
+			bytes = 0;
+			std::vector<MaterialSwitch>::clear();
+		}
+	};
+
+	// What a streaming import keeps: every attribute for the whole file
+	// (faces may refer back to any of them), but only one window of corners.
+	// A window ends at the first face or usemtl line it has no room for.
+	struct StreamedContents
+	{
+		StreamedContents(AttributeBudget& budget) : positions(budget), normals(budget), uvs(budget) {}
+
+		BlockList<XMFLOAT3> positions;
+		BlockList<XMFLOAT3> normals;
+		BlockList<XMFLOAT2> uvs;
+		std::vector<ObjCorner> corners; // Reserved for cornerLimit, so it never grows
+		MaterialList materials;
+		NoFixups relativeCorners;
+
+		size_t cornerLimit = 0;
+		size_t materialLimit = 0;
+
+		bool HasRoomForCorners(size_t count) const { return corners.size() + count <= cornerLimit; }
+		bool HasRoomForMaterial(size_t nameLength) const
+		{
+			return materials.bytes + 2 * sizeof(MaterialSwitch) + nameLength + 1 <= materialLimit;
+		}
+	};
+
+	// --------------------------------------------------------
+	// Returns the first '\n' at or after p, or end if there is none.
+	// Checks 16 bytes at a time when SSE2 is available.
+	// --------------------------------------------------------
+	const char* FindLineEnd(const char* p, const char* end)
+	{
+#ifdef OBJ_LOADER_SSE2
+		const __m128i newline = _mm_set1_epi8('\n');
+		while (end - p >= 16)
+		{
+			__m128i bytes = _mm_loadu_si128((const __m128i*)p);
+			unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline));
+			if (mask != 0)
+				return p + std::countr_zero(mask);
+			p += 16;
+		}
+#endif
+		const void* found = memchr(p, '\n', (size_t)(end - p));
+		return found ? (const char*)found : end;
+	}
+
+	inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	inline const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p)) p++;
+		return p;
+	}
+
+	// Exactly representable powers of ten for the fast float path below
+	const float PowersOfTen[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+	// Reads one float, leaving 0 in place of anything unreadable
+	const char* ParseFloat(const char* p, const char* end, float& out)
+	{
+		p = SkipSpaces(p, end);
+		if (p < end && *p == '+') p++; // from_chars doesn't accept a leading plus
+
+		// Fast path for the plain "-12.345" numbers OBJ exporters write: when the
+		// digits fit in a float's 24-bit mantissa and the power of ten is exact,
+		// a single division is correctly rounded, so the result is identical to
+		// from_chars (same idea as Clinger's fast path used by fast_float)
+		const char* c = p;
+		bool negative = c < end && *c == '-';
+		if (negative) c++;
+
+		unsigned int mantissa = 0;
+		int digits = 0, fractionDigits = 0;
+		while (c < end && (unsigned char)(*c - '0') < 10 && digits < 8)
+		{
+			mantissa = mantissa * 10 + (*c++ - '0');
+			digits++;
+		}
+		if (c < end && *c == '.')
+		{
+			c++;
+			while (c < end && (unsigned char)(*c - '0') < 10 && digits < 8)
+			{
+				mantissa = mantissa * 10 + (*c++ - '0');
+				digits++;
+				fractionDigits++;
+			}
+		}
+
+		bool simple = digits > 0 && mantissa < (1u << 24) && fractionDigits <= 10 &&
+			(c == end || IsSpace(*c));
+		if (simple)
+		{
+			float value = (float)mantissa / PowersOfTen[fractionDigits];
+			out = negative ? -value : value;
+			return c;
+		}
+
+		// Anything longer or with an exponent takes the general route
+		std::from_chars_result result = std::from_chars(p, end, out);
+		if (result.ec == std::errc())
+			return result.ptr;
+
+		out = 0.0f;
+		while (p < end && !IsSpace(*p)) p++;
+		return p;
+	}
+
+	// Reads one (possibly negative) integer, returning p unchanged if there is none.
+	// Indices that don't fit in an int can't be valid, so they're rejected outright
+	inline const char* ParseInt(const char* p, const char* end, int& out)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+
+		// Unsigned, and stops growing once it's out of range, so it can't overflow
+		unsigned int value = 0;
+		const char* start = p;
+		while (p < end && (unsigned char)(*p - '0') < 10)
+		{
+			if (value > INT_MAX / 10)
+				throw std::runtime_error("Error reading OBJ: face index out of range");
+			value = value * 10 + (unsigned int)(*p++ - '0');
+		}
+
+		if (p == start)
+			return p - (negative ? 1 : 0);
+		if (value > INT_MAX)
+			throw std::runtime_error("Error reading OBJ: face index out of range");
+
+		out = negative ? -(int)value : (int)value;
+		return p;
+	}
+
+	// Converts a 1-based (or negative, relative to the end) OBJ index to a 0-based one.
+	// Relative indices may point before the start of a chunk, in which case this
+	// deliberately wraps around; adding the chunk's base offset later undoes that.
+	inline unsigned int ResolveIndex(int index, size_t count, bool& relative)
+	{
+		relative = index < 0;
+		if (index > 0) return (unsigned int)(index - 1);
+		if (index < 0) return (unsigned int)count + (unsigned int)index;
+		throw std::runtime_error("Error reading OBJ: face index of 0 is not allowed");
+	}
+
+	// --------------------------------------------------------
+	// Parses every line between begin and end into the given contents
+	// (an ObjContents, or StreamedContents for streaming imports).
+	// Returns where it stopped: end, or the start of the first line
+	// the contents had no room for.
+	// --------------------------------------------------------
+	template <typename Contents>
+	const char* ParseLines(const char* begin, const char* end, Contents& obj)
+	{
+		// Corners of the face currently being read (reused, so this
+		// only allocates when a face has more corners than any before it)
+		std::vector<ObjCorner> face;
+		std::vector<unsigned char> faceRelative; // Which of each corner's indices were negative
+		face.reserve(8);
+		faceRelative.reserve(8);
+
+		const char* p = begin;
+		while (p < end)
+		{
+			const char* lineEnd = FindLineEnd(p, end);
+			const char* c = SkipSpaces(p, lineEnd);
+
+			if (lineEnd - c >= 2 && c[0] == 'v' && IsSpace(c[1]))
+			{
+				// Position - flip Z (RH to LH)
+				XMFLOAT3 pos;
+				c = ParseFloat(c + 2, lineEnd, pos.x);
+				c = ParseFloat(c, lineEnd, pos.y);
+				c = ParseFloat(c, lineEnd, pos.z);
+				pos.z *= -1.0f;
+				obj.positions.push_back(pos);
+			}
+			else if (lineEnd - c >= 3 && c[0] == 'v' && c[1] == 't' && IsSpace(c[2]))
+			{
+				// UV - flip V since DirectX defines (0,0) as the top left of the texture
+				XMFLOAT2 uv;
+				c = ParseFloat(c + 3, lineEnd, uv.x);
+				c = ParseFloat(c, lineEnd, uv.y);
+				uv.y = 1.0f - uv.y;
+				obj.uvs.push_back(uv);
+			}
+			else if (lineEnd - c >= 3 && c[0] == 'v' && c[1] == 'n' && IsSpace(c[2]))
+			{
+				// Normal - flip Z (RH to LH)
+				XMFLOAT3 norm;
+				c = ParseFloat(c + 3, lineEnd, norm.x);
+				c = ParseFloat(c, lineEnd, norm.y);
+				c = ParseFloat(c, lineEnd, norm.z);
+				norm.z *= -1.0f;
+				obj.normals.push_back(norm);
+			}
+			else if (lineEnd - c >= 7 && memcmp(c, "usemtl", 6) == 0 && IsSpace(c[6]))
+			{
+				// Material for the faces that follow (trailing spaces aren't part of the name)
+				const char* nameBegin = SkipSpaces(c + 7, lineEnd);
+				const char* nameEnd = lineEnd;
+				while (nameEnd > nameBegin && IsSpace(nameEnd[-1]))
+					nameEnd--;
+				if (!obj.HasRoomForMaterial((size_t)(nameEnd - nameBegin)))
+					return p;
+				obj.materials.push_back({ obj.corners.size(), std::string(nameBegin, nameEnd) });
+			}
+			else if (lineEnd - c >= 2 && c[0] == 'f' && IsSpace(c[1]))
+			{
+				// Each corner is v, v/vt, v//vn or v/vt/vn
+				face.clear();
+				faceRelative.clear();
+				c = SkipSpaces(c + 2, lineEnd);
+				while (c < lineEnd)
+				{
+					int v = 0, vt = 0, vn = 0;
+					c = ParseInt(c, lineEnd, v);
+					if (c < lineEnd && *c == '/')
+					{
+						c = ParseInt(c + 1, lineEnd, vt);
+						if (c < lineEnd && *c == '/')
+							c = ParseInt(c + 1, lineEnd, vn);
+					}
+
+					// Anything else on the line ends the face
+					if (v == 0 || (c < lineEnd && !IsSpace(*c)))
+						break;
+
+					ObjCorner corner;
+					bool relative[3] = {};
+					corner.position = ResolveIndex(v, obj.positions.size(), relative[0]);
+					corner.uv = vt != 0 ? ResolveIndex(vt, obj.uvs.size(), relative[1]) : MissingIndex;
+					corner.normal = vn != 0 ? ResolveIndex(vn, obj.normals.size(), relative[2]) : MissingIndex;
+					faceRelative.push_back((unsigned char)(relative[0] | relative[1] << 1 | relative[2] << 2));
+					face.push_back(corner);
+
+					// Checked as the face grows, so a huge one can't outgrow the budget before it's caught
+					if (face.size() > 2 && !obj.HasRoomForCorners((face.size() - 2) * 3))
+						return p;
+
+					c = SkipSpaces(c, lineEnd);
+				}
+
+				// Fan-triangulate, flipping the winding order (RH to LH)
+				for (size_t i = 2; i < face.size(); i++)
+				{
+					size_t triangle[3] = { 0, i, i - 1 };
+					for (size_t corner : triangle)
+					{
+						for (unsigned int attribute = 0; attribute < 3; attribute++)
+							if (faceRelative[corner] & (1 << attribute))
+								obj.relativeCorners.push_back((unsigned int)obj.corners.size() * 3 + attribute);
+						obj.corners.push_back(face[corner]);
+					}
+				}
+			}
+
+			p = lineEnd < end ? lineEnd + 1 : end;
+		}
+		return end;
+	}
+
+	// --------------------------------------------------------
+	// Splits [begin, end) into line-aligned chunks, parses them in parallel
+	// and stitches the results back together in file order, so the merged
+	// contents are exactly what a single ParseLines() over the file produces
+	// --------------------------------------------------------
+	void ParseChunks(const char* begin, const char* end, unsigned int chunkCount, ThreadPool& pool, ObjContents& obj)
+	{
+		// Chunk boundaries always sit just after a line break
+		std::vector<const char*> bounds(chunkCount + 1);
+		bounds[0] = begin;
+		bounds[chunkCount] = end;
+		for (unsigned int i = 1; i < chunkCount; i++)
+		{
+			const char* guess = begin + (end - begin) * i / chunkCount;
+			guess = std::max(guess, bounds[i - 1]);
+			const char* lineEnd = FindLineEnd(guess, end);
+			bounds[i] = lineEnd < end ? lineEnd + 1 : end;
+		}
+
+		std::vector<ObjContents> chunks(chunkCount);
+		pool.ParallelFor(chunkCount, [&](unsigned int i)
+			{
+				size_t estimatedLines = (bounds[i + 1] - bounds[i]) / 24;
+				chunks[i].positions.reserve(estimatedLines / 4);
+				chunks[i].normals.reserve(estimatedLines / 4);
+				chunks[i].uvs.reserve(estimatedLines / 4);
+				chunks[i].corners.reserve(estimatedLines * 3 / 2);
+				ParseLines(bounds[i], bounds[i + 1], chunks[i]);
+			});
+
+		// Prefix sums: where each chunk's data starts in the merged arrays
+		struct Offsets { size_t positions, uvs, normals, corners; };
+		std::vector<Offsets> offsets(chunkCount + 1);
+		offsets[0] = {};
+		for (unsigned int i = 0; i < chunkCount; i++)
+		{
+			offsets[i + 1].positions = offsets[i].positions + chunks[i].positions.size();
+			offsets[i + 1].uvs = offsets[i].uvs + chunks[i].uvs.size();
+			offsets[i + 1].normals = offsets[i].normals + chunks[i].normals.size();
+			offsets[i + 1].corners = offsets[i].corners + chunks[i].corners.size();
+		}
+
+		obj.positions.resize(offsets[chunkCount].positions);
+		obj.uvs.resize(offsets[chunkCount].uvs);
+		obj.normals.resize(offsets[chunkCount].normals);
+		obj.corners.resize(offsets[chunkCount].corners);
+
+		for (unsigned int i = 0; i < chunkCount; i++)
+			for (MaterialSwitch& material : chunks[i].materials)
+				obj.materials.push_back({ material.corner + offsets[i].corners, std::move(material.name) });
+
+		// Copy each chunk into place, fixing up its relative indices on the way
+		pool.ParallelFor(chunkCount, [&](unsigned int i)
+			{
+				ObjContents& chunk = chunks[i];
+				const Offsets& at = offsets[i];
+				std::copy(chunk.positions.begin(), chunk.positions.end(), obj.positions.begin() + at.positions);
+				std::copy(chunk.uvs.begin(), chunk.uvs.end(), obj.uvs.begin() + at.uvs);
+				std::copy(chunk.normals.begin(), chunk.normals.end(), obj.normals.begin() + at.normals);
+
+				ObjCorner* corners = &obj.corners[0] + at.corners;
+				std::copy(chunk.corners.begin(), chunk.corners.end(), corners);
+				for (unsigned int fixup : chunk.relativeCorners)
+				{
+					ObjCorner& c = corners[fixup / 3];
+					switch (fixup % 3)
+					{
+					case 0: c.position += (unsigned int)at.positions; break;
+					case 1: c.uv += (unsigned int)at.uvs; break;
+					case 2: c.normal += (unsigned int)at.normals; break;
+					}
+				}
+			});
+	}
+
+	inline size_t HashCorner(const ObjCorner& c)
+	{
+		size_t hash = c.position * 0x9E3779B1u;
+		hash ^= c.uv + 0x7F4A7C15u + (hash << 6) + (hash >> 2);
+		hash ^= c.normal + 0x85EBCA77u + (hash << 6) + (hash >> 2);
+		return hash;
+	}
+
+	inline bool SameCorner(const ObjCorner& a, const ObjCorner& b)
+	{
+		return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+	}
+
+	// A streaming weld table entry, which keeps its own triplet since
+	// the vertex it was made from has already been handed off
+	struct WeldSlot
+	{
+		ObjCorner corner;
+		unsigned int vertex;
+	};
+
+	// Looks up the data for a corner, checking its indices on the way
+	template <typename Contents>
+	Vertex MakeVertex(const Contents& obj, const ObjCorner& c)
+	{
+		if (c.position >= obj.positions.size() ||
+			(c.uv != MissingIndex && c.uv >= obj.uvs.size()) ||
+			(c.normal != MissingIndex && c.normal >= obj.normals.size()))
+			throw std::runtime_error("Error reading OBJ: face index out of range");
+
+		Vertex v = {};
+		v.Position = obj.positions[c.position];
+		v.UV = c.uv != MissingIndex ? obj.uvs[c.uv] : XMFLOAT2(0, 0);
+		v.Normal = c.normal != MissingIndex ? obj.normals[c.normal] : XMFLOAT3(0, 0, 0);
+		return v;
+	}
+
+	// --------------------------------------------------------
+	// Turns the corners into vertices and indices, sharing one vertex
+	// between all corners with the same position/uv/normal triplet.
+	// Vertices are numbered in order of first appearance.
+	// Vertices are chained by position index, so a lookup only
+	// compares against the few vertices made from that position -
+	// and since nearby faces use nearby positions, the chain heads
+	// are read almost in order rather than scattered like a hash
+	// table's slots.
+	// --------------------------------------------------------
+	void WeldCorners(const ObjContents& obj, MeshData& out)
+	{
+		std::vector<unsigned int> firstVertex(obj.positions.size(), MissingIndex); // Newest vertex with each position
+		std::vector<unsigned int> nextVertex; // The previous vertex with the same position, per vertex
+		std::vector<ObjCorner> vertexCorners; // The triplet each vertex was made from
+
+		out.vertices.clear();
+		out.indices.clear();
+		out.vertices.reserve(obj.corners.size() / 2);
+		nextVertex.reserve(obj.corners.size() / 2);
+		vertexCorners.reserve(obj.corners.size() / 2);
+		out.indices.reserve(obj.corners.size());
+
+		for (const ObjCorner& c : obj.corners)
+		{
+			if (c.position >= obj.positions.size())
+				throw std::runtime_error("Error reading OBJ: face index out of range");
+
+			unsigned int vertex = firstVertex[c.position];
+			while (vertex != MissingIndex && !SameCorner(vertexCorners[vertex], c))
+				vertex = nextVertex[vertex];
+
+			if (vertex == MissingIndex)
+			{
+				vertex = (unsigned int)out.vertices.size();
+				out.vertices.push_back(MakeVertex(obj, c));
+				vertexCorners.push_back(c);
+				nextVertex.push_back(firstVertex[c.position]);
+				firstVertex[c.position] = vertex;
+			}
+
+			out.indices.push_back(vertex);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Same result as WeldCorners(), spread across the pool:
+	//  1. Corners are split into partitions by hash (scattered into one
+	//     list per partition), and each partition finds the first corner
+	//     with each triplet in its own list, using its own table
+	//  2. A prefix sum over the "is first" flags (in corner order) numbers
+	//     the vertices exactly as the serial version would
+	//  3. Every corner then looks up the number of its first occurrence
+	// --------------------------------------------------------
+	void WeldCornersParallel(const ObjContents& obj, MeshData& out, ThreadPool& pool)
+	{
+		const unsigned int corners = (unsigned int)obj.corners.size();
+		const unsigned int partitions = std::min(pool.GetThreadCount() * 2, 255u);
+		const unsigned int ranges = pool.GetThreadCount() * 4;
+		auto rangeStart = [&](unsigned int r) { return (unsigned int)((unsigned long long)corners * r / ranges); };
+
+		std::vector<unsigned int> hashes(corners);
+		std::vector<unsigned char> partitionOf(corners);
+		std::vector<unsigned int> firstCorner(corners);
+		std::vector<unsigned int> vertexOf(corners);
+
+		// Hash everything and count partition sizes per range
+		std::vector<unsigned int> partitionCounts(ranges * partitions, 0);
+		pool.ParallelFor(ranges, [&](unsigned int r)
+			{
+				for (unsigned int c = rangeStart(r); c < rangeStart(r + 1); c++)
+				{
+					size_t hash = HashCorner(obj.corners[c]);
+					hashes[c] = (unsigned int)hash;
+					partitionOf[c] = (unsigned char)((((unsigned int)hash * 0x2545F491u) >> 24) % partitions); // High bits, so tables still get the low ones
+					partitionCounts[r * partitions + partitionOf[c]]++;
+				}
+			});
+
+		// Prefix sum over (partition, range): where each range's corners go in its
+		// partition's list. Ranges fill their slots in corner order, so every list
+		// ends up sorted and the first match in a table is the first occurrence
+		std::vector<unsigned int> listStart(partitions + 1, 0);
+		std::vector<unsigned int> rangeListStart(ranges * partitions);
+		unsigned int listed = 0;
+		for (unsigned int p = 0; p < partitions; p++)
+		{
+			listStart[p] = listed;
+			for (unsigned int r = 0; r < ranges; r++)
+			{
+				rangeListStart[r * partitions + p] = listed;
+				listed += partitionCounts[r * partitions + p];
+			}
+		}
+		listStart[partitions] = listed;
+
+		std::vector<unsigned int> partitionLists(corners);
+		pool.ParallelFor(ranges, [&](unsigned int r)
+			{
+				unsigned int* next = &rangeListStart[r * partitions];
+				for (unsigned int c = rangeStart(r); c < rangeStart(r + 1); c++)
+					partitionLists[next[partitionOf[c]]++] = c;
+			});
+
+		// 1. First occurrence of each triplet, one partition per job
+		pool.ParallelFor(partitions, [&](unsigned int p)
+			{
+				size_t count = listStart[p + 1] - listStart[p];
+				size_t tableMask = std::bit_ceil(count * 2 + 1) - 1;
+				std::vector<unsigned int> table(tableMask + 1, MissingIndex); // Holds corner numbers
+				for (unsigned int i = listStart[p]; i < listStart[p + 1]; i++)
+				{
+					unsigned int c = partitionLists[i];
+					size_t slot = hashes[c] & tableMask;
+					while (table[slot] != MissingIndex && !SameCorner(obj.corners[table[slot]], obj.corners[c]))
+						slot = (slot + 1) & tableMask;
+					if (table[slot] == MissingIndex)
+						table[slot] = c;
+					firstCorner[c] = table[slot];
+				}
+			});
+
+		// 2. Number the first occurrences in corner order
+		std::vector<unsigned int> rangeVertexStart(ranges + 1, 0);
+		pool.ParallelFor(ranges, [&](unsigned int r)
+			{
+				unsigned int firsts = 0;
+				for (unsigned int c = rangeStart(r); c < rangeStart(r + 1); c++)
+					firsts += firstCorner[c] == c;
+				rangeVertexStart[r + 1] = firsts;
+			});
+		for (unsigned int r = 0; r < ranges; r++)
+			rangeVertexStart[r + 1] += rangeVertexStart[r];
+
+		out.vertices.resize(rangeVertexStart[ranges]);
+		out.indices.resize(corners);
+		pool.ParallelFor(ranges, [&](unsigned int r)
+			{
+				unsigned int vertex = rangeVertexStart[r];
+				for (unsigned int c = rangeStart(r); c < rangeStart(r + 1); c++)
+				{
+					if (firstCorner[c] != c)
+						continue;
+					vertexOf[c] = vertex;
+					out.vertices[vertex++] = MakeVertex(obj, obj.corners[c]);
+				}
+			});
+
+		// 3. Every corner shares the vertex of its first occurrence
+		pool.ParallelFor(ranges, [&](unsigned int r)
+			{
+				for (unsigned int c = rangeStart(r); c < rangeStart(r + 1); c++)
+					out.indices[c] = vertexOf[firstCorner[c]];
+			});
+	}
+
+	// --------------------------------------------------------
+	// Turns usemtl records into runs of indices (one index per
+	// corner), in file order. Files without any get no submeshes.
+	// --------------------------------------------------------
+	void AddSubmeshes(const std::vector<MaterialSwitch>& materials, MeshData& out)
+	{
+		out.submeshes.clear();
+		if (materials.empty())
+			return;
+
+		if (materials[0].corner > 0)
+			out.submeshes.push_back({ "", 0, (unsigned int)materials[0].corner });
+
+		for (size_t m = 0; m < materials.size(); m++)
+		{
+			size_t start = materials[m].corner;
+			size_t end = m + 1 < materials.size() ? materials[m + 1].corner : out.indices.size();
+			if (end > start)
+				out.submeshes.push_back({ materials[m].name, (unsigned int)start, (unsigned int)(end - start) });
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Parses an OBJ file into welded vertices and a triangle list
+//
+// objFilePath - Path to the .obj file
+// out - Receives the vertices and indices
+// threadCount - How many threads may parse at once (0 = one per
+//               hardware thread). Files too small to be worth
+//               splitting are always parsed on the calling thread.
+//               The result is identical regardless of thread count.
+// --------------------------------------------------------
+void ObjLoader::Load(const char* objFilePath, MeshData& out, unsigned int threadCount)
+{
+	MappedFile file(objFilePath);
+	if (!file.IsOpen())
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	const char* begin = file.GetData();
+	const char* end = begin + file.GetSize();
+
+	// Each chunk should be big enough to outweigh the cost of waking a thread
+	ThreadPool& pool = ThreadPool::Shared();
+	if (threadCount == 0)
+		threadCount = pool.GetThreadCount();
+	unsigned int chunkCount = (unsigned int)std::min<size_t>(threadCount, file.GetSize() / MinBytesPerChunk);
+
+	ObjContents obj;
+	if (chunkCount > 1)
+	{
+		// A few chunks per thread evens out lines of different cost
+		ParseChunks(begin, end, chunkCount * 4, pool, obj);
+	}
+	else
+	{
+		// Rough guesses based on typical OBJ line lengths, just
+		// so the vectors don't need to grow again and again
+		size_t estimatedLines = file.GetSize() / 24;
+		obj.positions.reserve(estimatedLines / 4);
+		obj.normals.reserve(estimatedLines / 4);
+		obj.uvs.reserve(estimatedLines / 4);
+		obj.corners.reserve(estimatedLines * 3 / 2);
+
+		ParseLines(begin, end, obj);
+	}
+
+	if (obj.corners.empty())
+		throw std::invalid_argument("Error reading OBJ: file contains no faces");
+
+	if (chunkCount > 1)
+		WeldCornersParallel(obj, out, pool);
+	else
+		WeldCorners(obj, out);
+
+	// One contiguous range per material
+	AddSubmeshes(obj.materials, out);
+	MeshOptimizer::GroupByMaterial(out);
+
+#if defined(DEBUG) | defined(_DEBUG)
+	printf("Loaded %s: %d vertices welded down to %d (%d indices, %d submeshes)\n",
+		objFilePath, (int)obj.corners.size(), (int)out.vertices.size(), (int)out.indices.size(), (int)out.submeshes.size());
+#endif
+}
+
+// --------------------------------------------------------
+// Parses an OBJ file in line-aligned windows, handing each
+// window's new vertices and its indices to the sink before
+// moving on, so the full corner list never exists at once
+//
+// objFilePath - Path to the .obj file
+// sink - Receives the geometry, one window at a time
+// scratchBudget - Bytes to stay within, covering everything the
+//                 loader holds and the sink's per-block scratch:
+//                 half for the file's positions, UVs and normals
+//                 (faces may refer back to any of them, so a file
+//                 whose attributes don't fit throws), a quarter for
+//                 the window and a quarter for the weld table. When
+//                 the weld table can't grow any further, it starts
+//                 over, so a corner that repeats a triplet from
+//                 before that point gets a duplicate vertex (the mesh
+//                 is still correct, just less welded). With a big
+//                 enough budget the output matches Load() before its
+//                 GroupByMaterial().
+//
+// The mapped file isn't counted, since the OS pages it in and
+// out as needed, and neither is what the sink keeps for good
+// (MeshCacheSink keeps nothing but the submesh list).
+// --------------------------------------------------------
+void ObjLoader::LoadStreaming(const char* objFilePath, MeshSink& sink, size_t scratchBudget)
+{
+	MappedFile file(objFilePath);
+	if (!file.IsOpen())
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	const char* p = file.GetData();
+	const char* end = p + file.GetSize();
+
+	// While the table grows, the old one is still around, so the biggest
+	// table gets two thirds of its quarter
+	scratchBudget = std::max(scratchBudget, MinScratchBudget);
+	const size_t maxTableSize = std::bit_floor(scratchBudget / 6 / sizeof(WeldSlot));
+	const size_t windowBudget = scratchBudget / 4;
+
+	AttributeBudget attributeBudget = { 0, scratchBudget / 2 };
+	StreamedContents obj(attributeBudget);
+	obj.materialLimit = windowBudget / 8;
+	obj.cornerLimit = (windowBudget - obj.materialLimit) / (WindowBytesPerCorner + sink.GetScratchPerCorner());
+
+	// The weld table starts small and doubles until it hits the budget,
+	// staying at most half full so probes stay short
+	const WeldSlot emptySlot = { { 0, 0, 0 }, MissingIndex };
+	std::vector<WeldSlot> table(std::min<size_t>(maxTableSize, 1 << 16), emptySlot);
+	size_t tableMask = table.size() - 1;
+	size_t tableEntries = 0;
+	unsigned int tableResets = 0;
+
+	// Every window buffer gets its full size up front, so none of them doubles
+	std::vector<Vertex> windowVertices;
+	std::vector<unsigned int> windowIndices;
+	obj.corners.reserve(obj.cornerLimit);
+	windowVertices.reserve(obj.cornerLimit);
+	windowIndices.reserve(obj.cornerLimit);
+	unsigned int vertexCount = 0;
+	size_t cornerCount = 0;
+	size_t windowCount = 0;
+
+	while (p < end)
+	{
+		obj.corners.clear();
+		obj.materials.clear();
+		const char* windowEnd = ParseLines(p, end, obj);
+		if (windowEnd == p)
+			throw std::runtime_error("Error reading OBJ: a line needs more memory than the streaming budget");
+		p = windowEnd;
+		windowCount++;
+
+		// Hands over what's been welded so far, so a material switch
+		// lands between two Append() calls
+		auto flush = [&]()
+			{
+				if (!windowIndices.empty())
+					sink.Append(windowVertices.data(), windowVertices.size(), windowIndices.data(), windowIndices.size());
+				windowVertices.clear();
+				windowIndices.clear();
+			};
+
+		windowVertices.clear();
+		windowIndices.clear();
+		size_t nextMaterial = 0;
+		for (size_t corner = 0; corner < obj.corners.size(); corner++)
+		{
+			const ObjCorner& c = obj.corners[corner];
+			for (; nextMaterial < obj.materials.size() && obj.materials[nextMaterial].corner == corner; nextMaterial++)
+			{
+				flush();
+				sink.BeginSubmesh(obj.materials[nextMaterial].name.c_str());
+			}
+
+			if (tableEntries == table.size() / 2)
+			{
+				if (table.size() < maxTableSize)
+				{
+					std::vector<WeldSlot> grown(table.size() * 2, emptySlot);
+					tableMask = grown.size() - 1;
+					for (const WeldSlot& entry : table)
+					{
+						if (entry.vertex == MissingIndex)
+							continue;
+						size_t slot = HashCorner(entry.corner) & tableMask;
+						while (grown[slot].vertex != MissingIndex)
+							slot = (slot + 1) & tableMask;
+						grown[slot] = entry;
+					}
+					table.swap(grown);
+				}
+				else
+				{
+					std::fill(table.begin(), table.end(), emptySlot);
+					tableEntries = 0;
+					tableResets++;
+				}
+			}
+
+			size_t slot = HashCorner(c) & tableMask;
+			while (table[slot].vertex != MissingIndex && !SameCorner(table[slot].corner, c))
+				slot = (slot + 1) & tableMask;
+
+			if (table[slot].vertex == MissingIndex)
+			{
+				windowVertices.push_back(MakeVertex(obj, c));
+				table[slot] = { c, vertexCount++ };
+				tableEntries++;
+			}
+
+			windowIndices.push_back(table[slot].vertex);
+		}
+
+		// Switches after the window's last face apply to the next window
+		flush();
+		for (; nextMaterial < obj.materials.size(); nextMaterial++)
+			sink.BeginSubmesh(obj.materials[nextMaterial].name.c_str());
+		cornerCount += obj.corners.size();
+	}
+
+	if (cornerCount == 0)
+		throw std::invalid_argument("Error reading OBJ: file contains no faces");
+
+#if defined(DEBUG) | defined(_DEBUG)
+	printf("Streamed %s in %zu windows: %zu corners welded down to %u vertices (weld table restarted %u times)\n",
+		objFilePath, windowCount, cornerCount, vertexCount, tableResets);
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "MeshData.h"
+
+/*
+* Reads Wavefront .OBJ files into welded, indexed geometry.
+*
+* The file is memory-mapped and parsed in place: line breaks are located with SIMD,
+* numbers are converted with std::from_chars and everything lands in pre-reserved
+* vectors, so there are no per-line copies or allocations.
+*
+* Supported: v, vt and vn records, faces with any number of corners (fan-triangulated),
+* negative (relative) indices and all of the v, v/vt, v//vn and v/vt/vn corner forms.
+* Positions, normals and UVs are converted to DirectX's left-handed, top-left-UV space.
+* usemtl records split the faces into submeshes, which Load() sorts by material so each one
+* is a single contiguous index range. mtllib files aren't read - materials are made in code
+* and matched to submeshes by name (see Entity::SetSubmeshMaterial()).
+*
+* Large files can be split into line-aligned chunks that are parsed and welded on the
+* shared ThreadPool. The output is bit-identical to parsing on a single thread.
+*
+* For files too big to hold in memory, LoadStreaming() parses the file in windows and hands
+* welded blocks to a MeshSink as it goes (MeshCacheSink writes them straight to a .meshbin).
+* Everything it holds - the file's positions, UVs and normals, the window, the weld table and
+* the sink's scratch for a block - stays within the given budget; windows end at the first
+* face that wouldn't fit, and a file whose attributes alone outgrow the budget throws.
+*
+* Load(): Parses the file and fills in the vertices, indices and submeshes of the given MeshData
+* LoadStreaming(): Parses the file window by window into a sink, within a scratch budget.
+*                  Submeshes arrive in file order, so a material may show up in several runs.
+*/
+namespace ObjLoader
+{
+	const size_t DefaultScratchBudget = 64 << 20;
+
+	void Load(const char* objFilePath, MeshData& out, unsigned int threadCount = 1);
+	void LoadStreaming(const char* objFilePath, MeshSink& sink, size_t scratchBudget = DefaultScratchBudget);
+}
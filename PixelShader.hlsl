@@ -7,6 +7,7 @@ cbuffer BindlessData : register(b0)
     uint vsConstEachIndex;
     uint psConstAllIndex;
     uint psConstEachIndex;
+    uint vsVertexByteOffset;
 }
 
 //Texture2D AllTextures[ ] : register(t0, space0); - Old Bindless
@@ -15,8 +16,8 @@ struct PSConstantsEach
 {
     unsigned int albedoIndex;
     unsigned int normalIndex;
-    unsigned int roughnessIndex;
-    unsigned int metalnessIndex;
+    unsigned int ormIndex; // Occlusion, roughness and metalness in R, G and B
+    unsigned int padding;
 
     float2 UVScale;
     float2 UVOffset;
@@ -49,8 +50,7 @@ float4 main(VertexToPixel input) : SV_TARGET
     
     Texture2D Albedo = ResourceDescriptorHeap[psEach.albedoIndex];
     Texture2D NormalMap = ResourceDescriptorHeap[psEach.normalIndex];
-    Texture2D RoughnessMap = ResourceDescriptorHeap[psEach.roughnessIndex];
-    Texture2D MetalnessMap = ResourceDescriptorHeap[psEach.metalnessIndex];
+    Texture2D OrmMap = ResourceDescriptorHeap[psEach.ormIndex];
     
     // -- RENORMALIZING AND SCALING NORMALS AND UV --
     input.uv = input.uv * psEach.UVScale + psEach.UVOffset;
@@ -63,15 +63,20 @@ float4 main(VertexToPixel input) : SV_TARGET
     surfaceColor = pow(surfaceColor, 2.2); // Remove gamma correction from texture
     
     // -- SAMPLING ROUGHNESS AND METALNESS(f0) --
-    float roughness = RoughnessMap.Sample(BasicSampler, input.uv).r;
-    float metalness = MetalnessMap.Sample(BasicSampler, input.uv).r;
+    // Both come from one packed texture (occlusion, in red, is unused until there's ambient light)
+    float3 orm = OrmMap.Sample(BasicSampler, input.uv).rgb;
+    float roughness = orm.g;
+    float metalness = orm.b;
     float3 f0 = lerp(0.04, surfaceColor.rgb, metalness);
     //return float4(metalness, 0.0f, 0.0f, 1.0f);
     
     
     // -- SAMPLE NORMAL MAP, CHANGE NORMALS TO ACCOUNT FOR SURFACE UNEVENENESS -- 
+    // Normal maps are BC5, which only stores X and Y - Z is rebuilt from them (always facing out)
     float3 finalNormal;
-    finalNormal = normalize(NormalMap.Sample(BasicSampler, input.uv).xyz * 2.0f - 1.0f); // First unpack the normal map's normal
+    finalNormal.xy = NormalMap.Sample(BasicSampler, input.uv).rg * 2.0f - 1.0f; // First unpack the normal map's normal
+    finalNormal.z = sqrt(saturate(1.0f - dot(finalNormal.xy, finalNormal.xy)));
+    finalNormal = normalize(finalNormal);
     //return float4(finalNormal, 1.0f);
     
     float3 T, B, N;
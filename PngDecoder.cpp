@@ -0,0 +1,854 @@
+#include "PngDecoder.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PNG_DECODER_SSE2
+#endif
+
+namespace
+{
+	const unsigned char Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	// Largest image we'll allocate for - 1 GB of RGBA
+	const unsigned long long MaxPixels = 1ull << 28;
+
+	// Zeros after the compressed data and the inflated scanlines, so the bit
+	// reader and match copies can always move 8 bytes at a time
+	const size_t Padding = 8;
+
+	uint32_t ReadBigEndian(const unsigned char* bytes)
+	{
+		return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+	}
+
+	// --------------------------------------------------------
+	// Deflate's bits, least significant first, from a buffer
+	// with Padding readable bytes past its end
+	// --------------------------------------------------------
+	struct BitReader
+	{
+		const unsigned char* data;
+		size_t size;
+		size_t position;	// Next byte to load into bits
+		uint64_t bits;
+		unsigned int count;	// Valid bits in bits
+
+		// Tops the buffer up to at least 56 bits. Past the end of the data
+		// it reads zeros - Finish() catches streams that relied on them
+		void Refill()
+		{
+			if (position + 8 <= size + Padding)
+			{
+				uint64_t next;
+				memcpy(&next, data + position, sizeof(next));
+				bits |= next << count;
+				position += (63 - count) >> 3;
+				count |= 56;
+			}
+			else
+			{
+				while (count <= 56)
+				{
+					uint64_t byte = position < size ? data[position] : 0;
+					bits |= byte << count;
+					position++;
+					count += 8;
+				}
+			}
+		}
+
+		unsigned int Peek(unsigned int n) { return (unsigned int)(bits & ((1ull << n) - 1)); }
+		void Consume(unsigned int n) { bits >>= n; count -= n; }
+		unsigned int Read(unsigned int n)
+		{
+			unsigned int value = Peek(n);
+			Consume(n);
+			return value;
+		}
+
+		// Drops the rest of the current byte and hands back the ones
+		// already loaded, so the reader sits on a byte boundary
+		size_t AlignToByte()
+		{
+			Consume(count & 7);
+			position -= count / 8;
+			bits = 0;
+			count = 0;
+			return position;
+		}
+
+		void Finish()
+		{
+			if (position - count / 8 > size)
+				throw std::runtime_error("Error reading PNG: compressed data is truncated");
+		}
+	};
+
+	// --------------------------------------------------------
+	// A canonical Huffman code. Codes up to FastBits long are
+	// decoded with one lookup of the next FastBits input bits,
+	// longer ones by comparing against each length's range
+	// --------------------------------------------------------
+	struct Huffman
+	{
+		static const unsigned int FastBits = 10;
+		static const unsigned int MaxLength = 15;
+
+		uint16_t fast[1 << FastBits];	// (length << 9) | symbol, 0 if the code is longer
+		uint32_t limit[MaxLength + 2];	// One past the last code of each length, left aligned to 16 bits
+		uint16_t firstCode[MaxLength + 1];
+		uint16_t firstSymbol[MaxLength + 1];
+		uint8_t lengths[288];			// In code order
+		uint16_t symbols[288];			// In code order
+
+		void Build(const unsigned char* symbolLengths, unsigned int count)
+		{
+			unsigned int lengthCounts[MaxLength + 1] = {};
+			for (unsigned int s = 0; s < count; s++)
+				lengthCounts[symbolLengths[s]]++;
+			lengthCounts[0] = 0;
+
+			memset(fast, 0, sizeof(fast));
+			unsigned int nextCode[MaxLength + 1];
+			unsigned int code = 0;
+			unsigned int symbol = 0;
+			for (unsigned int length = 1; length <= MaxLength; length++)
+			{
+				nextCode[length] = code;
+				firstCode[length] = (uint16_t)code;
+				firstSymbol[length] = (uint16_t)symbol;
+				code += lengthCounts[length];
+				if (code > (1u << length))
+					throw std::runtime_error("Error reading PNG: oversubscribed Huffman code");
+				limit[length] = code << (16 - length);
+				code <<= 1;
+				symbol += lengthCounts[length];
+			}
+			limit[MaxLength + 1] = 1 << 16; // Stops the search
+
+			for (unsigned int s = 0; s < count; s++)
+			{
+				unsigned int length = symbolLengths[s];
+				if (length == 0)
+					continue;
+
+				unsigned int index = nextCode[length] - firstCode[length] + firstSymbol[length];
+				lengths[index] = (uint8_t)length;
+				symbols[index] = (uint16_t)s;
+				if (length <= FastBits)
+				{
+					// Deflate sends codes most significant bit first
+					unsigned int reversed = 0;
+					for (unsigned int b = 0; b < length; b++)
+						reversed |= ((nextCode[length] >> b) & 1) << (length - 1 - b);
+					for (unsigned int fill = reversed; fill < (1u << FastBits); fill += 1 << length)
+						fast[fill] = (uint16_t)(length << 9 | s);
+				}
+				nextCode[length]++;
+			}
+		}
+
+		// Needs at least MaxLength bits in the reader
+		unsigned int Decode(BitReader& in) const
+		{
+			unsigned int entry = fast[in.Peek(FastBits)];
+			if (entry)
+			{
+				in.Consume(entry >> 9);
+				return entry & 511;
+			}
+
+			// Reverse the next 16 bits so codes compare as numbers
+			unsigned int next = in.Peek(16);
+			next = ((next & 0xAAAA) >> 1) | ((next & 0x5555) << 1);
+			next = ((next & 0xCCCC) >> 2) | ((next & 0x3333) << 2);
+			next = ((next & 0xF0F0) >> 4) | ((next & 0x0F0F) << 4);
+			next = ((next & 0xFF00) >> 8) | ((next & 0x00FF) << 8);
+
+			unsigned int length = FastBits + 1;
+			while (next >= limit[length])
+				length++;
+			if (length > MaxLength)
+				throw std::runtime_error("Error reading PNG: invalid Huffman code");
+
+			unsigned int index = (next >> (16 - length)) - firstCode[length] + firstSymbol[length];
+			if (index >= 288 || lengths[index] != length)
+				throw std::runtime_error("Error reading PNG: invalid Huffman code");
+			in.Consume(length);
+			return symbols[index];
+		}
+	};
+
+	const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const unsigned char CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	struct FixedCodes
+	{
+		Huffman literals;
+		Huffman distances;
+
+		FixedCodes()
+		{
+			unsigned char lengths[288];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			literals.Build(lengths, 288);
+
+			memset(lengths, 5, 30);
+			distances.Build(lengths, 30);
+		}
+	};
+
+	void ReadDynamicCodes(BitReader& in, Huffman& literals, Huffman& distances)
+	{
+		in.Refill();
+		unsigned int literalCount = in.Read(5) + 257;
+		unsigned int distanceCount = in.Read(5) + 1;
+		unsigned int codeLengthCount = in.Read(4) + 4;
+
+		unsigned char codeLengthLengths[19] = {};
+		for (unsigned int c = 0; c < codeLengthCount; c++)
+		{
+			in.Refill();
+			codeLengthLengths[CodeLengthOrder[c]] = (unsigned char)in.Read(3);
+		}
+		Huffman codeLengths;
+		codeLengths.Build(codeLengthLengths, 19);
+
+		// Literal and distance lengths are one sequence, and repeats may cross between them
+		unsigned char lengths[288 + 32] = {};
+		unsigned int total = literalCount + distanceCount;
+		for (unsigned int n = 0; n < total;)
+		{
+			in.Refill();
+			unsigned int symbol = codeLengths.Decode(in);
+			if (symbol < 16)
+			{
+				lengths[n++] = (unsigned char)symbol;
+				continue;
+			}
+
+			unsigned char repeated = 0;
+			unsigned int repeat;
+			if (symbol == 16)
+			{
+				if (n == 0)
+					throw std::runtime_error("Error reading PNG: code length repeat with nothing to repeat");
+				repeated = lengths[n - 1];
+				repeat = 3 + in.Read(2);
+			}
+			else if (symbol == 17)
+				repeat = 3 + in.Read(3);
+			else
+				repeat = 11 + in.Read(7);
+
+			if (repeat > total - n)
+				throw std::runtime_error("Error reading PNG: code lengths overrun their table");
+			memset(lengths + n, repeated, repeat);
+			n += repeat;
+		}
+
+		if (lengths[256] == 0)
+			throw std::runtime_error("Error reading PNG: block has no end code");
+		literals.Build(lengths, literalCount);
+		distances.Build(lengths + literalCount, distanceCount);
+	}
+
+	// --------------------------------------------------------
+	// Inflates a zlib stream into exactly outSize bytes. out
+	// must have Padding writable bytes past outSize, and data
+	// Padding readable (zero) bytes past size
+	// --------------------------------------------------------
+	void Inflate(const unsigned char* data, size_t size, unsigned char* out, size_t outSize)
+	{
+		if (size < 2 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+			throw std::runtime_error("Error reading PNG: image data isn't a deflate stream");
+
+		static const FixedCodes fixed;
+		Huffman dynamicLiterals;
+		Huffman dynamicDistances;
+
+		BitReader in = { data, size, 2, 0, 0 };
+		size_t written = 0;
+		bool last = false;
+		while (!last)
+		{
+			in.Refill();
+			last = in.Read(1) != 0;
+			unsigned int type = in.Read(2);
+
+			if (type == 0)
+			{
+				// Stored: LEN, ~LEN, then LEN raw bytes
+				size_t at = in.AlignToByte();
+				if (at + 4 > size)
+					throw std::runtime_error("Error reading PNG: compressed data is truncated");
+				unsigned int length = data[at] | data[at + 1] << 8;
+				unsigned int check = data[at + 2] | data[at + 3] << 8;
+				if ((length ^ 0xFFFF) != check)
+					throw std::runtime_error("Error reading PNG: corrupt stored block");
+				at += 4;
+				if (length > size - at || length > outSize - written)
+					throw std::runtime_error("Error reading PNG: stored block overruns its data");
+
+				memcpy(out + written, data + at, length);
+				written += length;
+				in.position = at + length;
+				continue;
+			}
+			if (type == 3)
+				throw std::runtime_error("Error reading PNG: invalid deflate block type");
+
+			const Huffman* literals = &fixed.literals;
+			const Huffman* distances = &fixed.distances;
+			if (type == 2)
+			{
+				ReadDynamicCodes(in, dynamicLiterals, dynamicDistances);
+				literals = &dynamicLiterals;
+				distances = &dynamicDistances;
+			}
+
+			for (;;)
+			{
+				// 56 bits covers a literal/length code, its extra bits,
+				// a distance code and its extra bits
+				in.Refill();
+				unsigned int symbol = literals->Decode(in);
+				if (symbol < 256)
+				{
+					if (written == outSize)
+						throw std::runtime_error("Error reading PNG: more image data than the header describes");
+					out[written++] = (unsigned char)symbol;
+					continue;
+				}
+				if (symbol == 256)
+					break;
+
+				symbol -= 257;
+				if (symbol >= 29)
+					throw std::runtime_error("Error reading PNG: invalid length code");
+				size_t length = LengthBase[symbol] + in.Read(LengthExtra[symbol]);
+
+				unsigned int distanceSymbol = distances->Decode(in);
+				if (distanceSymbol >= 30)
+					throw std::runtime_error("Error reading PNG: invalid distance code");
+				size_t distance = DistanceBase[distanceSymbol] + in.Read(DistanceExtra[distanceSymbol]);
+
+				if (distance > written)
+					throw std::runtime_error("Error reading PNG: match reaches before the start of the data");
+				if (length > outSize - written)
+					throw std::runtime_error("Error reading PNG: more image data than the header describes");
+
+				unsigned char* destination = out + written;
+				const unsigned char* source = destination - distance;
+				written += length;
+				if (distance >= 8)
+				{
+					// Whole 8 byte steps never read what they write, and the
+					// overshoot past the match lands in the padding
+					for (size_t b = 0; b < length; b += 8)
+					{
+						uint64_t chunk;
+						memcpy(&chunk, source + b, sizeof(chunk));
+						memcpy(destination + b, &chunk, sizeof(chunk));
+					}
+				}
+				else if (distance == 1)
+				{
+					memset(destination, source[0], length);
+				}
+				else
+				{
+					for (size_t b = 0; b < length; b++)
+						destination[b] = source[b];
+				}
+			}
+		}
+
+		in.Finish();
+		if (written != outSize)
+			throw std::runtime_error("Error reading PNG: less image data than the header describes");
+	}
+
+	// --------------------------------------------------------
+	// Scanline filters. Each reconstructs row in place from
+	// its (already reconstructed) prior row. bpp is the byte
+	// distance to the pixel on the left, at least 1
+	// --------------------------------------------------------
+	void UnfilterSub(unsigned char* row, size_t bytes, size_t bpp)
+	{
+		for (size_t i = bpp; i < bytes; i++)
+			row[i] = (unsigned char)(row[i] + row[i - bpp]);
+	}
+
+	void UnfilterUp(unsigned char* row, const unsigned char* prior, size_t bytes)
+	{
+		for (size_t i = 0; i < bytes; i++)
+			row[i] = (unsigned char)(row[i] + prior[i]);
+	}
+
+	void UnfilterAverage(unsigned char* row, const unsigned char* prior, size_t bytes, size_t bpp)
+	{
+		for (size_t i = 0; i < bpp; i++)
+			row[i] = (unsigned char)(row[i] + (prior[i] >> 1));
+		for (size_t i = bpp; i < bytes; i++)
+			row[i] = (unsigned char)(row[i] + ((row[i - bpp] + prior[i]) >> 1));
+	}
+
+	inline unsigned char Paeth(int a, int b, int c)
+	{
+		int pa = abs(b - c);
+		int pb = abs(a - c);
+		int pc = abs(a + b - 2 * c);
+		if (pa <= pb && pa <= pc)
+			return (unsigned char)a;
+		return (unsigned char)(pb <= pc ? b : c);
+	}
+
+	void UnfilterPaeth(unsigned char* row, const unsigned char* prior, size_t bytes, size_t bpp)
+	{
+		for (size_t i = 0; i < bpp; i++)
+			row[i] = (unsigned char)(row[i] + prior[i]);
+		for (size_t i = bpp; i < bytes; i++)
+			row[i] = (unsigned char)(row[i] + Paeth(row[i - bpp], prior[i], prior[i - bpp]));
+	}
+
+#if defined(PNG_DECODER_SSE2)
+	// --------------------------------------------------------
+	// SSE2 filters for 3 and 4 byte pixels - one pixel per
+	// step, all of its channels at once. Rows of 3 byte pixels
+	// are padded by at least a byte (the next row's filter
+	// type, or Padding), so loading 4 bytes at a time is safe
+	// --------------------------------------------------------
+	template<size_t Bpp> __m128i LoadPixel(const unsigned char* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return _mm_cvtsi32_si128((int)value);
+	}
+
+	template<size_t Bpp> void StorePixel(unsigned char* p, __m128i pixel)
+	{
+		uint32_t value = (uint32_t)_mm_cvtsi128_si32(pixel);
+		memcpy(p, &value, Bpp);
+	}
+
+	template<size_t Bpp> void UnfilterSubSSE2(unsigned char* row, size_t bytes)
+	{
+		__m128i left = _mm_setzero_si128();
+		for (size_t i = 0; i < bytes; i += Bpp)
+		{
+			left = _mm_add_epi8(LoadPixel<Bpp>(row + i), left);
+			StorePixel<Bpp>(row + i, left);
+		}
+	}
+
+	template<size_t Bpp> void UnfilterAverageSSE2(unsigned char* row, const unsigned char* prior, size_t bytes)
+	{
+		const __m128i one = _mm_set1_epi8(1);
+		__m128i left = _mm_setzero_si128();
+		for (size_t i = 0; i < bytes; i += Bpp)
+		{
+			__m128i up = LoadPixel<Bpp>(prior + i);
+			// avg_epu8 rounds up - take the carry back off when the sum is odd
+			__m128i average = _mm_sub_epi8(_mm_avg_epu8(left, up), _mm_and_si128(_mm_xor_si128(left, up), one));
+			left = _mm_add_epi8(LoadPixel<Bpp>(row + i), average);
+			StorePixel<Bpp>(row + i, left);
+		}
+	}
+
+	inline __m128i Abs16(__m128i x) { return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x)); }
+	inline __m128i Select(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+	template<size_t Bpp> void UnfilterPaethSSE2(unsigned char* row, const unsigned char* prior, size_t bytes)
+	{
+		// a = left, b = up, c = up left, each widened to 16 bits
+		const __m128i zero = _mm_setzero_si128();
+		__m128i a = zero;
+		__m128i c = zero;
+		for (size_t i = 0; i < bytes; i += Bpp)
+		{
+			__m128i b = _mm_unpacklo_epi8(LoadPixel<Bpp>(prior + i), zero);
+
+			// With p = a + b - c: |p - a| = |b - c|, |p - b| = |a - c|, |p - c| = |(b - c) + (a - c)|
+			__m128i pa = _mm_sub_epi16(b, c);
+			__m128i pb = _mm_sub_epi16(a, c);
+			__m128i pc = Abs16(_mm_add_epi16(pa, pb));
+			pa = Abs16(pa);
+			pb = Abs16(pb);
+
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+			__m128i nearest = Select(_mm_cmpeq_epi16(smallest, pa), a, Select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+			__m128i pixel = _mm_add_epi8(LoadPixel<Bpp>(row + i), _mm_packus_epi16(nearest, nearest));
+			StorePixel<Bpp>(row + i, pixel);
+
+			c = b;
+			a = _mm_unpacklo_epi8(pixel, zero);
+		}
+	}
+#endif
+
+	void Unfilter(unsigned int filter, unsigned char* row, const unsigned char* prior, size_t bytes, size_t bpp)
+	{
+#if defined(PNG_DECODER_SSE2)
+		if (bpp == 3 || bpp == 4)
+		{
+			switch (filter)
+			{
+			case 1: bpp == 3 ? UnfilterSubSSE2<3>(row, bytes) : UnfilterSubSSE2<4>(row, bytes); return;
+			case 3: bpp == 3 ? UnfilterAverageSSE2<3>(row, prior, bytes) : UnfilterAverageSSE2<4>(row, prior, bytes); return;
+			case 4: bpp == 3 ? UnfilterPaethSSE2<3>(row, prior, bytes) : UnfilterPaethSSE2<4>(row, prior, bytes); return;
+			}
+		}
+#endif
+
+		switch (filter)
+		{
+		case 0: break;
+		case 1: UnfilterSub(row, bytes, bpp); break;
+		case 2: UnfilterUp(row, prior, bytes); break;
+		case 3: UnfilterAverage(row, prior, bytes, bpp); break;
+		case 4: UnfilterPaeth(row, prior, bytes, bpp); break;
+		default: throw std::runtime_error("Error reading PNG: unknown scanline filter");
+		}
+	}
+
+	// --------------------------------------------------------
+	// Everything from the header and ancillary chunks needed
+	// to turn scanlines into RGBA
+	// --------------------------------------------------------
+	struct PngFormat
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int bitDepth;
+		unsigned int colorType;
+		unsigned int channels;
+		bool interlaced;
+
+		uint32_t palette[256];		// RGBA, as bytes in memory
+		unsigned int paletteSize;
+		bool hasColorKey;
+		uint16_t colorKey[3];		// tRNS: gray, or red/green/blue, at the stored bit depth
+
+		size_t RowBytes(unsigned int pixels) const { return ((size_t)pixels * channels * bitDepth + 7) / 8; }
+	};
+
+	// --------------------------------------------------------
+	// Expands count pixels of one reconstructed scanline into
+	// RGBA, writing every step'th pixel of out (step > 1 for
+	// interlaced passes)
+	// --------------------------------------------------------
+	void ExpandRow(const PngFormat& format, const unsigned char* row, unsigned int count, unsigned char* out, size_t step)
+	{
+		size_t stride = step * 4;
+		unsigned int depth = format.bitDepth;
+
+		if (depth == 16)
+		{
+			// Keep the high byte of each sample, but compare the whole sample to the color key
+			for (unsigned int x = 0; x < count; x++, out += stride)
+			{
+				const unsigned char* p = row + (size_t)x * format.channels * 2;
+				switch (format.colorType)
+				{
+				case 0:
+					out[0] = out[1] = out[2] = p[0];
+					out[3] = format.hasColorKey && (p[0] << 8 | p[1]) == format.colorKey[0] ? 0 : 255;
+					break;
+				case 2:
+					out[0] = p[0]; out[1] = p[2]; out[2] = p[4];
+					out[3] = format.hasColorKey &&
+						(p[0] << 8 | p[1]) == format.colorKey[0] &&
+						(p[2] << 8 | p[3]) == format.colorKey[1] &&
+						(p[4] << 8 | p[5]) == format.colorKey[2] ? 0 : 255;
+					break;
+				case 4:
+					out[0] = out[1] = out[2] = p[0];
+					out[3] = p[2];
+					break;
+				case 6:
+					out[0] = p[0]; out[1] = p[2]; out[2] = p[4]; out[3] = p[6];
+					break;
+				}
+			}
+			return;
+		}
+
+		if (depth < 8)
+		{
+			// Gray or palette indices packed into bytes, leftmost pixel in the high bits
+			unsigned int mask = (1u << depth) - 1;
+			unsigned int scale = 255 / mask;
+			for (unsigned int x = 0; x < count; x++, out += stride)
+			{
+				size_t bit = (size_t)x * depth;
+				unsigned int sample = (row[bit / 8] >> (8 - depth - bit % 8)) & mask;
+				if (format.colorType == 3)
+				{
+					memcpy(out, &format.palette[sample], 4);
+				}
+				else
+				{
+					out[0] = out[1] = out[2] = (unsigned char)(sample * scale);
+					out[3] = format.hasColorKey && sample == format.colorKey[0] ? 0 : 255;
+				}
+			}
+			return;
+		}
+
+		switch (format.colorType)
+		{
+		case 0:
+			for (unsigned int x = 0; x < count; x++, out += stride)
+			{
+				out[0] = out[1] = out[2] = row[x];
+				out[3] = format.hasColorKey && row[x] == format.colorKey[0] ? 0 : 255;
+			}
+			break;
+		case 2:
+			for (unsigned int x = 0; x < count; x++, out += stride, row += 3)
+			{
+				out[0] = row[0]; out[1] = row[1]; out[2] = row[2];
+				out[3] = format.hasColorKey && row[0] == format.colorKey[0] && row[1] == format.colorKey[1] && row[2] == format.colorKey[2] ? 0 : 255;
+			}
+			break;
+		case 3:
+			for (unsigned int x = 0; x < count; x++, out += stride)
+				memcpy(out, &format.palette[row[x]], 4);
+			break;
+		case 4:
+			for (unsigned int x = 0; x < count; x++, out += stride, row += 2)
+			{
+				out[0] = out[1] = out[2] = row[0];
+				out[3] = row[1];
+			}
+			break;
+		case 6:
+			if (step == 1)
+			{
+				memcpy(out, row, (size_t)count * 4);
+				break;
+			}
+			for (unsigned int x = 0; x < count; x++, out += stride, row += 4)
+				memcpy(out, row, 4);
+			break;
+		}
+	}
+
+	// --------------------------------------------------------
+	// One image (or Adam7 pass) of filtered scanlines
+	// --------------------------------------------------------
+	struct Pass
+	{
+		unsigned int x, y, stepX, stepY;
+		unsigned int width, height;
+	};
+
+	std::vector<Pass> GetPasses(const PngFormat& format)
+	{
+		if (!format.interlaced)
+			return { { 0, 0, 1, 1, format.width, format.height } };
+
+		static const unsigned int Adam7[7][4] = {
+			{ 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 } };
+		std::vector<Pass> passes;
+		for (const auto& p : Adam7)
+		{
+			Pass pass = { p[0], p[1], p[2], p[3], 0, 0 };
+			if (format.width > pass.x)
+				pass.width = (format.width - pass.x + pass.stepX - 1) / pass.stepX;
+			if (format.height > pass.y)
+				pass.height = (format.height - pass.y + pass.stepY - 1) / pass.stepY;
+			if (pass.width > 0 && pass.height > 0)
+				passes.push_back(pass);
+		}
+		return passes;
+	}
+
+	void ReadHeader(const unsigned char* chunk, unsigned int length, PngFormat& format)
+	{
+		if (length != 13)
+			throw std::runtime_error("Error reading PNG: malformed header");
+
+		format.width = ReadBigEndian(chunk);
+		format.height = ReadBigEndian(chunk + 4);
+		format.bitDepth = chunk[8];
+		format.colorType = chunk[9];
+		if (chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1)
+			throw std::runtime_error("Error reading PNG: unknown compression, filter or interlace method");
+		format.interlaced = chunk[12] == 1;
+
+		if (format.width == 0 || format.height == 0)
+			throw std::runtime_error("Error reading PNG: image is empty");
+		if ((unsigned long long)format.width * format.height > MaxPixels)
+			throw std::runtime_error("Error reading PNG: image is too large");
+
+		unsigned int depth = format.bitDepth;
+		bool valid = false;
+		switch (format.colorType)
+		{
+		case 0: format.channels = 1; valid = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16; break;
+		case 2: format.channels = 3; valid = depth == 8 || depth == 16; break;
+		case 3: format.channels = 1; valid = depth == 1 || depth == 2 || depth == 4 || depth == 8; break;
+		case 4: format.channels = 2; valid = depth == 8 || depth == 16; break;
+		case 6: format.channels = 4; valid = depth == 8 || depth == 16; break;
+		}
+		if (!valid)
+			throw std::runtime_error("Error reading PNG: invalid color type and bit depth");
+	}
+}
+
+// --------------------------------------------------------
+// Walks the chunks, inflates the image data, then undoes
+// the filters and expands each scanline into place
+// --------------------------------------------------------
+void PngDecoder::Decode(const unsigned char* data, size_t size, ImageData& out)
+{
+	if (size < sizeof(Signature) || memcmp(data, Signature, sizeof(Signature)) != 0)
+		throw std::invalid_argument("Error reading PNG: not a PNG file");
+
+	PngFormat format = {};
+	for (uint32_t& entry : format.palette)
+		entry = 0;
+	bool hasHeader = false;
+	bool ended = false;
+	std::vector<unsigned char> compressed;
+
+	// Chunks: length, type, data, CRC
+	for (size_t offset = sizeof(Signature); !ended;)
+	{
+		if (size - offset < 12)
+			throw std::runtime_error("Error reading PNG: file is truncated");
+		uint32_t length = ReadBigEndian(data + offset);
+		const unsigned char* type = data + offset + 4;
+		const unsigned char* chunk = data + offset + 8;
+		if (length > size - offset - 12)
+			throw std::runtime_error("Error reading PNG: chunk runs past the end of the file");
+		offset += 12 + (size_t)length;
+
+		if (!hasHeader && memcmp(type, "IHDR", 4) != 0)
+			throw std::runtime_error("Error reading PNG: file doesn't start with a header");
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (hasHeader)
+				throw std::runtime_error("Error reading PNG: more than one header");
+			ReadHeader(chunk, length, format);
+			hasHeader = true;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			if (length % 3 != 0 || length > 256 * 3)
+				throw std::runtime_error("Error reading PNG: malformed palette");
+			format.paletteSize = length / 3;
+			for (unsigned int p = 0; p < format.paletteSize; p++)
+			{
+				unsigned char rgba[4] = { chunk[p * 3], chunk[p * 3 + 1], chunk[p * 3 + 2], 255 };
+				memcpy(&format.palette[p], rgba, 4);
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			// Alpha per palette entry, or the one color that's transparent
+			if (format.colorType == 3)
+			{
+				if (length > format.paletteSize)
+					throw std::runtime_error("Error reading PNG: more transparency entries than palette entries");
+				for (unsigned int p = 0; p < length; p++)
+					((unsigned char*)&format.palette[p])[3] = chunk[p];
+			}
+			else if ((format.colorType == 0 && length == 2) || (format.colorType == 2 && length == 6))
+			{
+				format.hasColorKey = true;
+				for (unsigned int c = 0; c < length / 2; c++)
+					format.colorKey[c] = (uint16_t)(chunk[c * 2] << 8 | chunk[c * 2 + 1]);
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			ended = true;
+		}
+		else if (!(type[0] & 0x20))
+		{
+			// Lowercase first letter means the chunk is safe to skip
+			throw std::runtime_error("Error reading PNG: unknown critical chunk");
+		}
+	}
+
+	if (format.colorType == 3 && format.paletteSize == 0)
+		throw std::runtime_error("Error reading PNG: palette image without a palette");
+
+	// Every pass's scanlines, each led by its filter type byte
+	std::vector<Pass> passes = GetPasses(format);
+	size_t filteredSize = 0;
+	for (const Pass& pass : passes)
+		filteredSize += (size_t)pass.height * (1 + format.RowBytes(pass.width));
+
+	size_t compressedSize = compressed.size();
+	compressed.resize(compressedSize + Padding, 0);
+	std::vector<unsigned char> filtered(filteredSize + Padding);
+	Inflate(&compressed[0], compressedSize, &filtered[0], filteredSize);
+	compressed = {};
+
+	out.width = format.width;
+	out.height = format.height;
+	out.pixels.resize((size_t)format.width * format.height * 4);
+
+	size_t bpp = (std::max)(1u, format.channels * format.bitDepth / 8);
+	std::vector<unsigned char> zeros(format.RowBytes(format.width) + Padding, 0);
+	unsigned char* row = &filtered[0];
+	for (const Pass& pass : passes)
+	{
+		size_t rowBytes = format.RowBytes(pass.width);
+		const unsigned char* prior = &zeros[0];
+		for (unsigned int y = 0; y < pass.height; y++)
+		{
+			unsigned int filter = row[0];
+			unsigned char* pixels = row + 1;
+			Unfilter(filter, pixels, prior, rowBytes, bpp);
+
+			size_t outY = pass.y + (size_t)y * pass.stepY;
+			ExpandRow(format, pixels, pass.width, &out.pixels[(outY * format.width + pass.x) * 4], pass.stepX);
+
+			prior = pixels;
+			row += 1 + rowBytes;
+		}
+	}
+}
+
+void PngDecoder::Load(const char* pngFilePath, ImageData& out)
+{
+	MappedFile file(pngFilePath);
+	if (!file.IsOpen())
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	Decode((const unsigned char*)file.GetData(), file.GetSize(), out);
+}
+
+void PngDecoder::LoadAll(const std::vector<std::string>& pngFilePaths, std::vector<ImageData>& images)
+{
+	images.assign(pngFilePaths.size(), {});
+	ThreadPool::Shared().ParallelFor((unsigned int)pngFilePaths.size(), [&](unsigned int i)
+		{
+			Load(pngFilePaths[i].c_str(), images[i]);
+		});
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ImageData.h"
+
+/*
+* Reads .png files into 8-bit RGBA, in plain C++ with no OS or WIC dependencies.
+*
+* The file is memory-mapped, and the IDAT chunks are inflated straight from the mapping into
+* one buffer sized from the header. Huffman codes are decoded through a lookup table indexed
+* by the next bits of input. Scanline filters are undone in place - with SSE2 for the 3 and 4
+* byte per pixel forms of Sub, Average and Paeth, which carry a dependency from one pixel to
+* the next - and then rows are expanded to RGBA.
+*
+* Supported: every color type (gray, RGB, palette, gray + alpha, RGBA) at every bit depth the
+* format allows, tRNS transparency and Adam7 interlacing. 16-bit samples keep their high byte.
+* Colors are returned as stored (gAMA, cHRM and iCCP are ignored), and the chunk CRCs and zlib
+* checksum aren't checked - only the structure is, so truncated or malformed files still throw.
+*
+* A single image can't be split up (every deflate block depends on the ones before it), so the
+* parallelism is across files: LoadAll() decodes one file per job on the shared ThreadPool.
+*
+* Decode(): Decodes a PNG already in memory
+* Load(): Decodes a PNG file
+* LoadAll(): Decodes several PNG files in parallel. images[i] is the image in paths[i]
+*/
+namespace PngDecoder
+{
+	void Decode(const unsigned char* data, size_t size, ImageData& out);
+	void Load(const char* pngFilePath, ImageData& out);
+	void LoadAll(const std::vector<std::string>& pngFilePaths, std::vector<ImageData>& images);
+}
@@ -0,0 +1,307 @@
+#include "ProceduralMesh.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Sizes that match the OBJ files these shapes replace
+	const float TorusTubeRadius = 0.286f;
+	const float HelixRadius = 0.8f;
+	const float HelixTubeRadius = 0.2f;
+	const float HelixTurns = 3.0f;
+
+	// Where the OBJs' texture seams are and how often their textures repeat
+	const float SphereUVWraps = 2.0f;		// Around the equator, starting from -X
+	const float TorusSeamU = 0.525f;		// u at +X (u runs once around)
+	const float TorusSeamV = 0.45f;			// v at the outer edge (v runs once around the tube)
+	const float HelixSeamU = 0.125f;		// Turns around the tube from the outer edge to u = 0
+	const float HelixUVRepeats = 20.09f;	// v along the length, from the top end down
+
+	// Coarser() never goes below these
+	const unsigned int MinSegments = 3;
+	const unsigned int MinRings = 2;
+
+	// --------------------------------------------------------
+	// A point on a surface, before it gets its UV
+	// --------------------------------------------------------
+	struct SurfacePoint
+	{
+		XMVECTOR position;
+		XMVECTOR normal;
+		XMVECTOR tangent;	// Direction of increasing U
+	};
+
+	Vertex MakeVertex(const SurfacePoint& point, float u, float v)
+	{
+		Vertex vertex;
+		XMStoreFloat3(&vertex.Position, point.position);
+		XMStoreFloat3(&vertex.Normal, XMVector3Normalize(point.normal));
+		XMStoreFloat3(&vertex.Tangent, XMVector3Normalize(point.tangent));
+		vertex.UV = XMFLOAT2(u, v);
+		return vertex;
+	}
+
+	// --------------------------------------------------------
+	// Tessellates a parametric surface into a grid of quads
+	//
+	// surface(u, v) takes u and v in [0, 1], where increasing U
+	// goes right and increasing V goes down when looking at the
+	// outside - which makes the triangles below clockwise
+	// Rows that collapse to a point (a sphere's poles) get one
+	// vertex per quad, halfway across it in U, so the triangles
+	// meeting there keep their own UVs, and the triangles that
+	// collapse with them are skipped
+	// --------------------------------------------------------
+	template<typename Surface>
+	void AddGrid(MeshData& out, unsigned int columns, unsigned int rows, Surface surface, float uScale = 1.0f, float vScale = 1.0f)
+	{
+		std::vector<unsigned int> rowStarts(rows + 1);
+		std::vector<bool> collapsed(rows + 1);
+		for (unsigned int row = 0; row <= rows; row++)
+		{
+			float v = row / (float)rows;
+			XMVECTOR offset = XMVectorSubtract(surface(0.5f, v).position, surface(0.0f, v).position);
+			collapsed[row] = XMVectorGetX(XMVector3LengthSq(offset)) <= 1e-12f;
+			rowStarts[row] = (unsigned int)out.vertices.size();
+			for (unsigned int column = 0; column <= columns; column++)
+			{
+				float u = column / (float)columns;
+				if (!collapsed[row])
+					out.vertices.push_back(MakeVertex(surface(u, v), u * uScale, v * vScale));
+				else if (column < columns)
+				{
+					u = (column + 0.5f) / columns;
+					out.vertices.push_back(MakeVertex(surface(u, v), u * uScale, v * vScale));
+				}
+			}
+		}
+
+		auto addTriangle = [&](unsigned int a, unsigned int b, unsigned int c)
+		{
+			XMVECTOR pa = XMLoadFloat3(&out.vertices[a].Position);
+			XMVECTOR pb = XMLoadFloat3(&out.vertices[b].Position);
+			XMVECTOR pc = XMLoadFloat3(&out.vertices[c].Position);
+			if (XMVectorGetX(XMVector3LengthSq(XMVector3Cross(XMVectorSubtract(pb, pa), XMVectorSubtract(pc, pa)))) <= 1e-12f)
+				return;
+			out.indices.insert(out.indices.end(), { a, b, c });
+		};
+
+		for (unsigned int row = 0; row < rows; row++)
+		{
+			for (unsigned int column = 0; column < columns; column++)
+			{
+				// In a collapsed row, the right hand corner is the left one's own vertex
+				unsigned int topLeft = rowStarts[row] + column, bottomLeft = rowStarts[row + 1] + column;
+				unsigned int topRight = collapsed[row] ? topLeft : topLeft + 1;
+				unsigned int bottomRight = collapsed[row + 1] ? bottomLeft : bottomLeft + 1;
+				if (topLeft != topRight)
+					addTriangle(topLeft, topRight, bottomLeft);
+				if (bottomLeft != bottomRight)
+					addTriangle(topRight, bottomRight, bottomLeft);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// A flat disk as a triangle fan, textured like a square
+	// around it. right is the +U direction
+	// --------------------------------------------------------
+	void AddDisk(MeshData& out, FXMVECTOR center, FXMVECTOR normal, FXMVECTOR right, float radius, unsigned int segments)
+	{
+		XMVECTOR down = XMVector3Cross(normal, right); // Clockwise order around the normal
+		unsigned int first = (unsigned int)out.vertices.size();
+		out.vertices.push_back(MakeVertex({ center, normal, right }, 0.5f, 0.5f));
+
+		for (unsigned int s = 0; s <= segments; s++)
+		{
+			float angle = XM_2PI * s / segments;
+			float c = cosf(angle), sn = sinf(angle);
+			XMVECTOR offset = XMVectorAdd(XMVectorScale(right, c * radius), XMVectorScale(down, sn * radius));
+			out.vertices.push_back(MakeVertex({ XMVectorAdd(center, offset), normal, right }, 0.5f + 0.5f * c, 0.5f + 0.5f * sn));
+		}
+
+		for (unsigned int s = 0; s < segments; s++)
+			out.indices.insert(out.indices.end(), { first, first + 1 + s, first + 2 + s });
+	}
+
+	// A flat square, centered on center, spanning +-1 along right and down
+	void AddSquare(MeshData& out, FXMVECTOR center, FXMVECTOR normal, FXMVECTOR right, unsigned int subdivisions)
+	{
+		XMVECTOR down = XMVector3Cross(normal, right);
+		AddGrid(out, subdivisions, subdivisions, [&](float u, float v)
+		{
+			XMVECTOR position = XMVectorAdd(center, XMVectorAdd(XMVectorScale(right, u * 2 - 1), XMVectorScale(down, v * 2 - 1)));
+			return SurfacePoint{ position, normal, right };
+		});
+	}
+
+	void GenerateCube(MeshData& out, unsigned int subdivisions)
+	{
+		// Each face's outward normal and the direction its texture's +U runs in
+		const XMVECTORF32 faces[6][2] =
+		{
+			{ { 0, 0, -1 }, { 1, 0, 0 } },	// Front (toward the default camera)
+			{ { 1, 0, 0 }, { 0, 0, 1 } },	// Right
+			{ { 0, 0, 1 }, { -1, 0, 0 } },	// Back
+			{ { -1, 0, 0 }, { 0, 0, -1 } },	// Left
+			{ { 0, 1, 0 }, { 1, 0, 0 } },	// Top
+			{ { 0, -1, 0 }, { 1, 0, 0 } },	// Bottom
+		};
+		for (auto& face : faces)
+			AddSquare(out, face[0], face[0], face[1], subdivisions);
+	}
+
+	void GenerateSphere(MeshData& out, unsigned int segments, unsigned int rings)
+	{
+		AddGrid(out, segments, rings, [](float u, float v)
+		{
+			float theta = u * XM_2PI - XM_PI, phi = v * XM_PI;
+			XMVECTOR normal = XMVectorSet(cosf(theta) * sinf(phi), cosf(phi), sinf(theta) * sinf(phi), 0);
+			XMVECTOR tangent = XMVectorSet(-sinf(theta), 0, cosf(theta), 0);
+			return SurfacePoint{ normal, normal, tangent };
+		}, SphereUVWraps, 1.0f);
+	}
+
+	void GenerateCylinder(MeshData& out, unsigned int segments, unsigned int rings)
+	{
+		AddGrid(out, segments, rings, [](float u, float v)
+		{
+			float theta = u * XM_2PI;
+			XMVECTOR normal = XMVectorSet(cosf(theta), 0, sinf(theta), 0);
+			XMVECTOR tangent = XMVectorSet(-sinf(theta), 0, cosf(theta), 0);
+			return SurfacePoint{ XMVectorSetY(normal, 1 - 2 * v), normal, tangent };
+		});
+
+		AddDisk(out, XMVectorSet(0, 1, 0, 0), XMVectorSet(0, 1, 0, 0), XMVectorSet(1, 0, 0, 0), 1.0f, segments);
+		AddDisk(out, XMVectorSet(0, -1, 0, 0), XMVectorSet(0, -1, 0, 0), XMVectorSet(1, 0, 0, 0), 1.0f, segments);
+	}
+
+	void GenerateTorus(MeshData& out, unsigned int segments, unsigned int rings)
+	{
+		float majorRadius = 1.0f - TorusTubeRadius;
+		AddGrid(out, segments, rings, [=](float u, float v)
+		{
+			// V runs around the tube, heading down from the outer edge at phi = 0
+			float theta = (u - TorusSeamU) * XM_2PI, phi = (v - TorusSeamV) * XM_2PI;
+			XMVECTOR radial = XMVectorSet(cosf(theta), 0, sinf(theta), 0);
+			XMVECTOR normal = XMVectorSubtract(XMVectorScale(radial, cosf(phi)), XMVectorSet(0, sinf(phi), 0, 0));
+			XMVECTOR position = XMVectorAdd(XMVectorScale(radial, majorRadius), XMVectorScale(normal, TorusTubeRadius));
+			return SurfacePoint{ position, normal, XMVectorSet(-sinf(theta), 0, cosf(theta), 0) };
+		});
+	}
+
+	void GenerateHelix(MeshData& out, unsigned int segments, unsigned int rings)
+	{
+		float sweep = XM_2PI * HelixTurns;
+		float rise = 2.0f / sweep; // Height gained per radian
+		auto centerline = [=](float t)
+		{
+			return XMVectorSet(HelixRadius * cosf(t), -1.0f + rise * t, HelixRadius * sinf(t), 0);
+		};
+		auto direction = [=](float t)
+		{
+			return XMVector3Normalize(XMVectorSet(-HelixRadius * sinf(t), rise, HelixRadius * cosf(t), 0));
+		};
+
+		// U goes around the tube (away from the Y axis, then perpendicular to that
+		// and the curve) and V runs down the curve, tiling along its length
+		AddGrid(out, rings, segments, [&](float u, float v)
+		{
+			float t = (1 - v) * sweep, phi = (u + HelixSeamU) * XM_2PI;
+			XMVECTOR outward = XMVectorSet(cosf(t), 0, sinf(t), 0);
+			XMVECTOR side = XMVector3Cross(outward, direction(t));
+			XMVECTOR normal = XMVectorAdd(XMVectorScale(outward, cosf(phi)), XMVectorScale(side, sinf(phi)));
+			XMVECTOR around = XMVectorSubtract(XMVectorScale(side, cosf(phi)), XMVectorScale(outward, sinf(phi)));
+			return SurfacePoint{ XMVectorAdd(centerline(t), XMVectorScale(normal, HelixTubeRadius)), normal, around };
+		}, 1.0f, HelixUVRepeats);
+
+		// Cap both ends
+		XMVECTOR start = direction(0), end = direction(sweep);
+		AddDisk(out, centerline(0), XMVectorNegate(start), XMVectorSet(1, 0, 0, 0), HelixTubeRadius, rings);
+		AddDisk(out, centerline(sweep), end, XMVector3Normalize(XMVectorSet(cosf(sweep), 0, sinf(sweep), 0)), HelixTubeRadius, rings);
+	}
+}
+
+ProceduralDesc ProceduralMesh::Default(ProceduralShape shape)
+{
+	switch (shape)
+	{
+	case ProceduralShape::Cube:
+	case ProceduralShape::Plane:
+	case ProceduralShape::DoubleSidedPlane: return { shape, 1, 1 };
+	case ProceduralShape::Cylinder: return { shape, 32, 1 };
+	case ProceduralShape::Torus: return { shape, 40, 20 };
+	case ProceduralShape::Helix: return { shape, 150, 16 };
+	default: return { shape, 32, 16 };
+	}
+}
+
+// --------------------------------------------------------
+// Halves the tessellation once per level, down to the least
+// that still looks like the shape
+// --------------------------------------------------------
+ProceduralDesc ProceduralMesh::Coarser(const ProceduralDesc& desc, unsigned int levels)
+{
+	ProceduralDesc coarser = desc;
+	bool flat = desc.shape == ProceduralShape::Cube || desc.shape == ProceduralShape::Plane || desc.shape == ProceduralShape::DoubleSidedPlane;
+	for (unsigned int level = 0; level < levels; level++)
+	{
+		coarser.segments = (std::max)(coarser.segments / 2, flat ? 1u : MinSegments);
+		coarser.rings = (std::max)(coarser.rings / 2, flat || desc.shape == ProceduralShape::Cylinder ? 1u : MinRings);
+	}
+	return coarser;
+}
+
+void ProceduralMesh::Generate(MeshData& out, const ProceduralDesc& desc)
+{
+	if (desc.segments == 0 || desc.rings == 0)
+		throw std::invalid_argument("Procedural meshes need at least one segment and ring");
+
+	out.vertices.clear();
+	out.indices.clear();
+	switch (desc.shape)
+	{
+	case ProceduralShape::Cube: GenerateCube(out, desc.segments); break;
+	case ProceduralShape::Plane:
+		AddSquare(out, XMVectorZero(), XMVectorSet(0, 1, 0, 0), XMVectorSet(1, 0, 0, 0), desc.segments);
+		break;
+	case ProceduralShape::DoubleSidedPlane:
+		AddSquare(out, XMVectorZero(), XMVectorSet(0, 1, 0, 0), XMVectorSet(1, 0, 0, 0), desc.segments);
+		AddSquare(out, XMVectorZero(), XMVectorSet(0, -1, 0, 0), XMVectorSet(-1, 0, 0, 0), desc.segments);
+		break;
+	case ProceduralShape::Sphere: GenerateSphere(out, (std::max)(desc.segments, MinSegments), (std::max)(desc.rings, MinRings)); break;
+	case ProceduralShape::Cylinder: GenerateCylinder(out, (std::max)(desc.segments, MinSegments), desc.rings); break;
+	case ProceduralShape::Torus: GenerateTorus(out, (std::max)(desc.segments, MinSegments), (std::max)(desc.rings, MinSegments)); break;
+	case ProceduralShape::Helix: GenerateHelix(out, (std::max)(desc.segments, MinSegments), (std::max)(desc.rings, MinSegments)); break;
+	default: throw std::invalid_argument("Unknown procedural shape");
+	}
+}
+
+// --------------------------------------------------------
+// Memoized Generate(). Only weak references are kept, so a
+// tessellation nothing uses anymore is freed (and generated
+// again if it's asked for later)
+// --------------------------------------------------------
+std::shared_ptr<const MeshData> ProceduralMesh::Get(const ProceduralDesc& desc)
+{
+	static std::mutex mutex;
+	static std::map<ProceduralDesc, std::weak_ptr<const MeshData>> generated;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::weak_ptr<const MeshData>& slot = generated[desc];
+	std::shared_ptr<const MeshData> data = slot.lock();
+	if (!data)
+	{
+		std::shared_ptr<MeshData> fresh = std::make_shared<MeshData>();
+		Generate(*fresh, desc);
+		data = fresh;
+		slot = data;
+	}
+	return data;
+}
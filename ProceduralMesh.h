@@ -0,0 +1,53 @@
+#pragma once
+#include <compare>
+#include <memory>
+#include "MeshData.h"
+
+enum class ProceduralShape
+{
+	Cube,				// [-1, 1] on every axis
+	Plane,				// [-1, 1] on X and Z, facing +Y
+	DoubleSidedPlane,	// Plane, plus a copy facing -Y
+	Sphere,				// Radius 1
+	Cylinder,			// Radius 1, Y from -1 to 1, capped
+	Torus,				// Fits in [-1, 1] on X and Z, tube radius 0.286
+	Helix,				// Three turns of radius 0.8 tube around Y from -1 to 1, tube radius 0.2, capped
+};
+
+// --------------------------------------------------------
+// A shape and how finely to tessellate it
+//
+// - segments: Around the shape's axis, or along a helix's
+//   curve (quads per edge for cubes and planes)
+// - rings: Along the axis, or around a torus or helix tube
+//   (ignored by cubes and planes)
+// --------------------------------------------------------
+struct ProceduralDesc
+{
+	ProceduralShape shape = ProceduralShape::Sphere;
+	unsigned int segments = 32;
+	unsigned int rings = 16;
+
+	auto operator<=>(const ProceduralDesc&) const = default;
+};
+
+/*
+* Generates primitive shapes straight into Vertex and index arrays, as replacements for the
+* primitive OBJ files. Every vertex's normal and tangent comes from the surface's analytic
+* derivatives, so there's no tangent generation pass, and triangles are wound for DirectX
+* (clockwise from the outside). Shapes match the size and UV layout conventions of the OBJs.
+*
+* Default(): The tessellation that matches the shape's OBJ file
+* Coarser(): The same shape with segments and rings halved per level, for cheap LOD variants
+* Generate(): Tessellates a shape into out
+* Get(): Generates a shape once and shares the result - repeated requests for the same
+*        parameters return the same data for as long as anything holds on to it
+*/
+namespace ProceduralMesh
+{
+	ProceduralDesc Default(ProceduralShape shape);
+	ProceduralDesc Coarser(const ProceduralDesc& desc, unsigned int levels = 1);
+
+	void Generate(MeshData& out, const ProceduralDesc& desc);
+	std::shared_ptr<const MeshData> Get(const ProceduralDesc& desc);
+}
@@ -0,0 +1,150 @@
+#include "RangeAllocator.h"
+#include <stdexcept>
+
+RangeAllocator::RangeAllocator(unsigned int capacity) :
+	capacity(0),
+	used(0)
+{
+	Grow(capacity);
+}
+
+// --------------------------------------------------------
+// Best fit: takes the smallest free range that can hold
+// size once its start is aligned, and gives whatever is
+// left of it (on either side) back
+// --------------------------------------------------------
+unsigned int RangeAllocator::Allocate(unsigned int size, unsigned int alignment)
+{
+	if (size == 0)
+		throw std::invalid_argument("Range allocations must have a size of at least 1");
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+		throw std::invalid_argument("Range alignments must be a power of two");
+
+	for (auto fit = freeBySize.lower_bound(size); fit != freeBySize.end(); ++fit)
+	{
+		unsigned int offset = fit->second;
+		unsigned long long end = (unsigned long long)offset + fit->first;
+		unsigned long long aligned = ((unsigned long long)offset + alignment - 1) & ~(unsigned long long)(alignment - 1);
+		if (aligned + size > end)
+			continue;
+
+		RemoveFreeRange(freeByOffset.find(offset));
+		if (aligned > offset)
+			AddFreeRange(offset, (unsigned int)(aligned - offset));
+		if (end > aligned + size)
+			AddFreeRange((unsigned int)(aligned + size), (unsigned int)(end - aligned - size));
+
+		allocations.emplace((unsigned int)aligned, Allocation{ size, alignment });
+		used += size;
+		return (unsigned int)aligned;
+	}
+	return InvalidOffset;
+}
+
+void RangeAllocator::Free(unsigned int offset)
+{
+	auto allocation = allocations.find(offset);
+	if (allocation == allocations.end())
+		throw std::invalid_argument("No range was allocated at this offset");
+
+	unsigned int size = allocation->second.size;
+	allocations.erase(allocation);
+	used -= size;
+	AddFreeRange(offset, size);
+}
+
+void RangeAllocator::Grow(unsigned int newCapacity)
+{
+	if (newCapacity < capacity)
+		throw std::invalid_argument("Range allocators can only grow");
+	if (newCapacity == capacity)
+		return;
+
+	unsigned int oldCapacity = capacity;
+	capacity = newCapacity;
+	AddFreeRange(oldCapacity, newCapacity - oldCapacity);
+}
+
+std::vector<RangeMove> RangeAllocator::Compact()
+{
+	std::vector<RangeMove> moves;
+	std::map<unsigned int, Allocation> packed;
+	std::vector<std::pair<unsigned int, unsigned int>> padding;
+	unsigned int cursor = 0;
+	for (auto& [offset, allocation] : allocations)
+	{
+		// Never past offset, which was already aligned
+		unsigned int aligned = (unsigned int)(((unsigned long long)cursor + allocation.alignment - 1) & ~(unsigned long long)(allocation.alignment - 1));
+		if (aligned > cursor)
+			padding.push_back({ cursor, aligned - cursor });
+		if (offset != aligned)
+			moves.push_back({ offset, aligned, allocation.size });
+		packed.emplace_hint(packed.end(), aligned, allocation);
+		cursor = aligned + allocation.size;
+	}
+
+	allocations.swap(packed);
+	freeByOffset.clear();
+	freeBySize.clear();
+	for (auto& [offset, size] : padding)
+		AddFreeRange(offset, size);
+	if (cursor < capacity)
+		AddFreeRange(cursor, capacity - cursor);
+	return moves;
+}
+
+unsigned int RangeAllocator::GetSize(unsigned int offset)
+{
+	auto allocation = allocations.find(offset);
+	if (allocation == allocations.end())
+		throw std::invalid_argument("No range was allocated at this offset");
+	return allocation->second.size;
+}
+
+unsigned int RangeAllocator::GetCapacity() { return capacity; }
+unsigned int RangeAllocator::GetUsed() { return used; }
+unsigned int RangeAllocator::GetLargestFreeRange() { return freeBySize.empty() ? 0 : freeBySize.rbegin()->first; }
+size_t RangeAllocator::GetAllocationCount() { return allocations.size(); }
+size_t RangeAllocator::GetFreeRangeCount() { return freeByOffset.size(); }
+
+// --------------------------------------------------------
+// Adds a free range, merging it with the free ranges
+// directly before and after it (if any)
+// --------------------------------------------------------
+void RangeAllocator::AddFreeRange(unsigned int offset, unsigned int size)
+{
+	auto next = freeByOffset.lower_bound(offset);
+	if (next != freeByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFreeRange(previous);
+		}
+	}
+
+	if (next != freeByOffset.end() && offset + size == next->first)
+	{
+		size += next->second;
+		RemoveFreeRange(next);
+	}
+
+	freeByOffset.emplace(offset, size);
+	freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::RemoveFreeRange(std::map<unsigned int, unsigned int>::iterator range)
+{
+	auto sized = freeBySize.equal_range(range->second);
+	for (auto it = sized.first; it != sized.second; ++it)
+	{
+		if (it->second == range->first)
+		{
+			freeBySize.erase(it);
+			break;
+		}
+	}
+	freeByOffset.erase(range);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <climits>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// --------------------------------------------------------
+// One allocation relocated by RangeAllocator::Compact()
+// --------------------------------------------------------
+struct RangeMove
+{
+	unsigned int from;
+	unsigned int to;
+	unsigned int size;
+};
+
+/*
+* Hands out ranges of an abstract [0, capacity) space - it never touches memory itself, so the
+* same allocator can manage a GPU buffer, a file, or nothing at all in a test.
+*
+* Free space is kept coalesced and indexed by both offset and size, so Allocate() picks the
+* best (smallest) fitting range and Free() merges with its neighbors, both in O(log n).
+* Aligned allocations may have to pass over best fits that are too small once their start
+* is rounded up, and leave that padding free.
+*
+* Allocate(): Returns the offset of a new range (a multiple of alignment, which must be a power
+*             of two), or InvalidOffset if no free range is big enough
+* Free(): Returns a range (by the offset Allocate() gave) to the free space
+* Grow(): Adds space at the end
+* Compact(): Packs every allocation to the front, keeping their order and alignment, and returns
+*            the moves made (sorted by offset, each moving toward 0, so they can be applied in
+*            order even within one buffer). Afterwards all free space is one range at the end,
+*            apart from any padding aligned allocations need
+* GetSize(): Size of the allocation at an offset
+*/
+class RangeAllocator
+{
+public:
+	static const unsigned int InvalidOffset = UINT_MAX;
+
+	RangeAllocator(unsigned int capacity = 0);
+
+	unsigned int Allocate(unsigned int size, unsigned int alignment = 1);
+	void Free(unsigned int offset);
+	void Grow(unsigned int newCapacity);
+	std::vector<RangeMove> Compact();
+
+	unsigned int GetSize(unsigned int offset);
+	unsigned int GetCapacity();
+	unsigned int GetUsed();
+	unsigned int GetLargestFreeRange();
+	size_t GetAllocationCount();
+	size_t GetFreeRangeCount();
+
+private:
+	struct Allocation
+	{
+		unsigned int size;
+		unsigned int alignment;
+	};
+
+	void AddFreeRange(unsigned int offset, unsigned int size);
+	void RemoveFreeRange(std::map<unsigned int, unsigned int>::iterator range);
+
+	unsigned int capacity;
+	unsigned int used;
+
+	std::map<unsigned int, unsigned int> freeByOffset;		// Offset -> size
+	std::multimap<unsigned int, unsigned int> freeBySize;	// Size -> offset
+	std::map<unsigned int, Allocation> allocations;			// Offset -> allocation
+};
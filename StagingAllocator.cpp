@@ -0,0 +1,71 @@
+#include "StagingAllocator.h"
+#include <stdexcept>
+
+StagingAllocator::StagingAllocator(size_t capacity) :
+	capacity(capacity),
+	head(0),
+	tail(0),
+	submitted(0)
+{
+	if (capacity == 0)
+		throw std::invalid_argument("Staging rings need a capacity of at least 1 byte");
+}
+
+// --------------------------------------------------------
+// Takes the next size bytes at or after the head, wrapping
+// to the start of the ring when they'd run past its end.
+// Nothing changes if the space isn't free yet.
+// --------------------------------------------------------
+size_t StagingAllocator::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0)
+		throw std::invalid_argument("Staging allocations must have a size of at least 1");
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+		throw std::invalid_argument("Staging alignments must be a power of two");
+	if (size > capacity)
+		return InvalidOffset;
+
+	// An empty ring can start over at 0, which leaves the most room
+	if (head == tail)
+		head = tail = submitted = (head + capacity - 1) / capacity * capacity;
+
+	unsigned long long start = head;
+	size_t offset = (size_t)(start % capacity);
+	size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+	if (aligned < offset || aligned > capacity - size)
+	{
+		// Skip the rest of this lap
+		start += capacity - offset;
+		aligned = 0;
+	}
+
+	unsigned long long end = start + (aligned - start % capacity) + size;
+	if (end - tail > capacity)
+		return InvalidOffset;
+
+	head = end;
+	return aligned;
+}
+
+void StagingAllocator::Submit(unsigned long long fenceValue)
+{
+	if (head == submitted)
+		return;
+
+	batches.push_back({ fenceValue, head });
+	submitted = head;
+}
+
+void StagingAllocator::Retire(unsigned long long completedFenceValue)
+{
+	while (!batches.empty() && batches.front().fenceValue <= completedFenceValue)
+	{
+		tail = batches.front().end;
+		batches.pop_front();
+	}
+}
+
+size_t StagingAllocator::GetCapacity() { return capacity; }
+size_t StagingAllocator::GetUsed() { return (size_t)(head - tail); }
+size_t StagingAllocator::GetBatchCount() { return batches.size(); }
+bool StagingAllocator::HasOpenBatch() { return head != submitted; }
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+/*
+* Hands out space in a ring buffer for staging uploads - like RangeAllocator, it only does the
+* bookkeeping, so the same logic runs against a mapped upload heap or nothing at all.
+*
+* Allocations are carved off the front of the ring in order and are never freed one by one.
+* Instead, everything allocated since the last Submit() forms a batch tagged with the fence
+* value that marks its copies as done, and Retire() releases every batch whose fence has
+* been reached, oldest first. An allocation that won't fit before the end of the ring skips
+* the leftover bytes and starts again at offset 0.
+*
+* Allocate(): Returns the offset of size bytes at the given (power of two) alignment, or
+*             InvalidOffset if the ring doesn't have room until older batches retire
+* Submit(): Closes the open batch, to be released once the fence reaches fenceValue
+* Retire(): Releases every batch whose fence value is at most completedFenceValue
+* GetUsed(): Bytes in flight or in the open batch, counting any skipped at the end of the ring
+* GetBatchCount(): Submitted batches that haven't retired yet
+*/
+class StagingAllocator
+{
+public:
+	static const size_t InvalidOffset = SIZE_MAX;
+
+	StagingAllocator(size_t capacity);
+
+	size_t Allocate(size_t size, size_t alignment);
+	void Submit(unsigned long long fenceValue);
+	void Retire(unsigned long long completedFenceValue);
+
+	size_t GetCapacity();
+	size_t GetUsed();
+	size_t GetBatchCount();
+	bool HasOpenBatch();
+
+private:
+	struct Batch
+	{
+		unsigned long long fenceValue;
+		unsigned long long end;	// Ring position just past the batch's last byte
+	};
+
+	size_t capacity;
+
+	// Positions only ever increase - the offset in the ring is position % capacity
+	unsigned long long head;		// Where the next allocation goes
+	unsigned long long tail;		// Oldest byte still in use
+	unsigned long long submitted;	// head as of the last Submit()
+
+	std::deque<Batch> batches;
+};
@@ -0,0 +1,408 @@
+#include "TangentGenerator.h"
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TANGENT_GENERATOR_AVX2
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_FUNCTION
+#else
+#include <cpuid.h>
+#define AVX2_FUNCTION __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// UV areas smaller than this can't define a direction
+	const float DegenerateUVArea = 1e-20f;
+
+	// Vertex is read as a flat array of floats by the gathers
+	const int VertexFloats = sizeof(Vertex) / sizeof(float);
+	const int PositionOffset = offsetof(Vertex, Position) / sizeof(float);
+	const int UVOffset = offsetof(Vertex, UV) / sizeof(float);
+	const int NormalOffset = offsetof(Vertex, Normal) / sizeof(float);
+
+	// Per-vertex tangent sums, as separate x/y/z streams
+	struct TangentSums
+	{
+		std::vector<float> x, y, z;
+	};
+
+	// --------------------------------------------------------
+	// Face tangent of one triangle (Lengyel), or zero if its UVs are degenerate
+	// --------------------------------------------------------
+	void FaceTangent(const Vertex& v1, const Vertex& v2, const Vertex& v3, float* tx, float* ty, float* tz)
+	{
+		float x1 = v2.Position.x - v1.Position.x;
+		float y1 = v2.Position.y - v1.Position.y;
+		float z1 = v2.Position.z - v1.Position.z;
+		float x2 = v3.Position.x - v1.Position.x;
+		float y2 = v3.Position.y - v1.Position.y;
+		float z2 = v3.Position.z - v1.Position.z;
+
+		float s1 = v2.UV.x - v1.UV.x;
+		float t1 = v2.UV.y - v1.UV.y;
+		float s2 = v3.UV.x - v1.UV.x;
+		float t2 = v3.UV.y - v1.UV.y;
+
+		float det = s1 * t2 - s2 * t1;
+		float r = std::fabs(det) > DegenerateUVArea ? 1.0f / det : 0.0f;
+
+		*tx = (t2 * x1 - t1 * x2) * r;
+		*ty = (t2 * y1 - t1 * y2) * r;
+		*tz = (t2 * z1 - t1 * z2) * r;
+	}
+
+	// --------------------------------------------------------
+	// acos, accurate to about 7e-5 radians (Abramowitz & Stegun 4.4.45) -
+	// plenty for weights, and the AVX2 path can use the exact same formula
+	// --------------------------------------------------------
+	float FastAcos(float x)
+	{
+		float a = std::fabs(x) < 1.0f ? std::fabs(x) : 1.0f;
+		float result = std::sqrt(1.0f - a) * (1.5707288f + a * (-0.2121144f + a * (0.0742610f + a * -0.0187293f)));
+		return x < 0.0f ? XM_PI - result : result;
+	}
+
+	// --------------------------------------------------------
+	// Adds one triangle's face tangent to its three vertices
+	// --------------------------------------------------------
+	void AddToVertices(TangentSums& sums, const unsigned int* tri, float tx, float ty, float tz)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			sums.x[tri[k]] += tx;
+			sums.y[tri[k]] += ty;
+			sums.z[tri[k]] += tz;
+		}
+	}
+
+	// --------------------------------------------------------
+	// MikkTSpace style contribution of a face tangent to one corner:
+	// projected onto the corner's normal plane, normalized, and
+	// weighted by the triangle's angle at that corner
+	// --------------------------------------------------------
+	XMFLOAT3 CornerContribution(const Vertex& corner, const Vertex& next, const Vertex& previous, float tx, float ty, float tz)
+	{
+		XMVECTOR tangent = XMVectorSet(tx, ty, tz, 0.0f);
+		XMVECTOR normal = XMLoadFloat3(&corner.Normal);
+		XMVECTOR projected = XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+
+		XMVECTOR p = XMLoadFloat3(&corner.Position);
+		XMVECTOR e0 = XMVectorSubtract(XMLoadFloat3(&next.Position), p);
+		XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&previous.Position), p);
+		float lengths = XMVectorGetX(XMVector3Length(e0)) * XMVectorGetX(XMVector3Length(e1));
+		float projectedLength = XMVectorGetX(XMVector3Length(projected));
+
+		XMFLOAT3 result(0, 0, 0);
+		if (lengths > 0.0f && projectedLength > 0.0f)
+		{
+			float angle = FastAcos(XMVectorGetX(XMVector3Dot(e0, e1)) / lengths);
+			XMStoreFloat3(&result, XMVectorScale(projected, angle / projectedLength));
+		}
+		return result;
+	}
+
+	void AddAngleWeighted(TangentSums& sums, const Vertex* vertices, const unsigned int* tri, float tx, float ty, float tz)
+	{
+		for (size_t k = 0; k < 3; k++)
+		{
+			XMFLOAT3 c = CornerContribution(vertices[tri[k]], vertices[tri[(k + 1) % 3]], vertices[tri[(k + 2) % 3]], tx, ty, tz);
+			sums.x[tri[k]] += c.x;
+			sums.y[tri[k]] += c.y;
+			sums.z[tri[k]] += c.z;
+		}
+	}
+
+	void AddTriangle(TangentSums& sums, const Vertex* vertices, const unsigned int* tri, bool angleWeighted)
+	{
+		float tx, ty, tz;
+		FaceTangent(vertices[tri[0]], vertices[tri[1]], vertices[tri[2]], &tx, &ty, &tz);
+		if (angleWeighted)
+			AddAngleWeighted(sums, vertices, tri, tx, ty, tz);
+		else
+			AddToVertices(sums, tri, tx, ty, tz);
+	}
+
+	// --------------------------------------------------------
+	// Gram-Schmidt against the normal, then normalize. Vertices with
+	// no usable tangent (no UVs, or parallel to the normal) get an
+	// arbitrary one perpendicular to the normal instead of NaNs.
+	// --------------------------------------------------------
+	void Orthonormalize(Vertex& v, float sx, float sy, float sz)
+	{
+		XMVECTOR normal = XMLoadFloat3(&v.Normal);
+		XMVECTOR tangent = XMVectorSet(sx, sy, sz, 0.0f);
+		tangent = XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+
+		if (XMVectorGetX(XMVector3LengthSq(tangent)) <= 1e-24f)
+		{
+			XMVECTOR axis = std::fabs(v.Normal.x) < 0.9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+			tangent = XMVector3Cross(axis, normal);
+		}
+
+		XMStoreFloat3(&v.Tangent, XMVector3Normalize(tangent));
+	}
+
+	void GenerateScalar(TangentSums& sums, Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t triangleCount, bool angleWeighted)
+	{
+		for (size_t t = 0; t < triangleCount; t++)
+			AddTriangle(sums, vertices, &indices[t * 3], angleWeighted);
+
+		for (size_t v = 0; v < vertexCount; v++)
+			Orthonormalize(vertices[v], sums.x[v], sums.y[v], sums.z[v]);
+	}
+
+#ifdef TANGENT_GENERATOR_AVX2
+	// --------------------------------------------------------
+	// 8 triangles per iteration: gather corners into SoA registers,
+	// compute 8 face tangents, then scatter them scalar
+	// --------------------------------------------------------
+	AVX2_FUNCTION void GenerateAVX2(TangentSums& sums, Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t triangleCount, bool angleWeighted)
+	{
+		const float* base = reinterpret_cast<const float*>(vertices);
+		const __m256i triangleStride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+		const __m256i vertexFloats = _mm256_set1_epi32(VertexFloats);
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+		const __m256 epsilon = _mm256_set1_ps(DegenerateUVArea);
+		alignas(32) float tx[8], ty[8], tz[8];
+
+		size_t blocks = triangleCount / 8;
+		for (size_t b = 0; b < blocks; b++)
+		{
+			const int* tri = reinterpret_cast<const int*>(&indices[b * 24]);
+
+			// Float offset of each corner's vertex
+			__m256i c0 = _mm256_mullo_epi32(_mm256_i32gather_epi32(tri + 0, triangleStride, 4), vertexFloats);
+			__m256i c1 = _mm256_mullo_epi32(_mm256_i32gather_epi32(tri + 1, triangleStride, 4), vertexFloats);
+			__m256i c2 = _mm256_mullo_epi32(_mm256_i32gather_epi32(tri + 2, triangleStride, 4), vertexFloats);
+
+#define GATHER(corner, offset) _mm256_i32gather_ps(base + (offset), corner, 4)
+			__m256 p0x = GATHER(c0, PositionOffset + 0), p0y = GATHER(c0, PositionOffset + 1), p0z = GATHER(c0, PositionOffset + 2);
+			__m256 x1 = _mm256_sub_ps(GATHER(c1, PositionOffset + 0), p0x);
+			__m256 y1 = _mm256_sub_ps(GATHER(c1, PositionOffset + 1), p0y);
+			__m256 z1 = _mm256_sub_ps(GATHER(c1, PositionOffset + 2), p0z);
+			__m256 x2 = _mm256_sub_ps(GATHER(c2, PositionOffset + 0), p0x);
+			__m256 y2 = _mm256_sub_ps(GATHER(c2, PositionOffset + 1), p0y);
+			__m256 z2 = _mm256_sub_ps(GATHER(c2, PositionOffset + 2), p0z);
+
+			__m256 u0 = GATHER(c0, UVOffset + 0), v0 = GATHER(c0, UVOffset + 1);
+			__m256 s1 = _mm256_sub_ps(GATHER(c1, UVOffset + 0), u0);
+			__m256 t1 = _mm256_sub_ps(GATHER(c1, UVOffset + 1), v0);
+			__m256 s2 = _mm256_sub_ps(GATHER(c2, UVOffset + 0), u0);
+			__m256 t2 = _mm256_sub_ps(GATHER(c2, UVOffset + 1), v0);
+#undef GATHER
+
+			// r = 1 / det, or 0 where the UVs are degenerate
+			__m256 det = _mm256_sub_ps(_mm256_mul_ps(s1, t2), _mm256_mul_ps(s2, t1));
+			__m256 valid = _mm256_cmp_ps(_mm256_andnot_ps(signMask, det), epsilon, _CMP_GT_OQ);
+			__m256 r = _mm256_and_ps(_mm256_div_ps(_mm256_set1_ps(1.0f), det), valid);
+
+			__m256 ftx = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(t2, x1), _mm256_mul_ps(t1, x2)), r);
+			__m256 fty = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(t2, y1), _mm256_mul_ps(t1, y2)), r);
+			__m256 ftz = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(t2, z1), _mm256_mul_ps(t1, z2)), r);
+
+			if (!angleWeighted)
+			{
+				_mm256_store_ps(tx, ftx);
+				_mm256_store_ps(ty, fty);
+				_mm256_store_ps(tz, ftz);
+
+				// Scalar scatter, kept inline (calling non-AVX code here would
+				// cost an SSE/AVX transition per call): lanes can share vertices
+				for (size_t i = 0; i < 8; i++)
+				{
+					const unsigned int* tri = &indices[(b * 8 + i) * 3];
+					for (size_t k = 0; k < 3; k++)
+					{
+						sums.x[tri[k]] += tx[i];
+						sums.y[tri[k]] += ty[i];
+						sums.z[tri[k]] += tz[i];
+					}
+				}
+				continue;
+			}
+
+			// Per corner: the edges leaving it, relative to corner 0's edges (x1/x2 = corner 1/2 minus corner 0)
+			__m256 edgeX[3][2] = { { x1, x2 }, { _mm256_sub_ps(x2, x1), _mm256_sub_ps(_mm256_setzero_ps(), x1) }, { _mm256_sub_ps(_mm256_setzero_ps(), x2), _mm256_sub_ps(x1, x2) } };
+			__m256 edgeY[3][2] = { { y1, y2 }, { _mm256_sub_ps(y2, y1), _mm256_sub_ps(_mm256_setzero_ps(), y1) }, { _mm256_sub_ps(_mm256_setzero_ps(), y2), _mm256_sub_ps(y1, y2) } };
+			__m256 edgeZ[3][2] = { { z1, z2 }, { _mm256_sub_ps(z2, z1), _mm256_sub_ps(_mm256_setzero_ps(), z1) }, { _mm256_sub_ps(_mm256_setzero_ps(), z2), _mm256_sub_ps(z1, z2) } };
+			__m256i corners[3] = { c0, c1, c2 };
+			alignas(32) float cx[3][8], cy[3][8], cz[3][8];
+
+			for (size_t k = 0; k < 3; k++)
+			{
+				// Project onto this corner's normal plane
+				__m256 nx = _mm256_i32gather_ps(base + NormalOffset + 0, corners[k], 4);
+				__m256 ny = _mm256_i32gather_ps(base + NormalOffset + 1, corners[k], 4);
+				__m256 nz = _mm256_i32gather_ps(base + NormalOffset + 2, corners[k], 4);
+				__m256 d = _mm256_fmadd_ps(nx, ftx, _mm256_fmadd_ps(ny, fty, _mm256_mul_ps(nz, ftz)));
+				__m256 px = _mm256_fnmadd_ps(nx, d, ftx);
+				__m256 py = _mm256_fnmadd_ps(ny, d, fty);
+				__m256 pz = _mm256_fnmadd_ps(nz, d, ftz);
+				__m256 projectedLength = _mm256_sqrt_ps(_mm256_fmadd_ps(px, px, _mm256_fmadd_ps(py, py, _mm256_mul_ps(pz, pz))));
+
+				// Corner angle, with the same polynomial acos as the scalar path
+				__m256 ax = edgeX[k][0], ay = edgeY[k][0], az = edgeZ[k][0];
+				__m256 bx = edgeX[k][1], by = edgeY[k][1], bz = edgeZ[k][1];
+				__m256 lengths = _mm256_sqrt_ps(_mm256_mul_ps(
+					_mm256_fmadd_ps(ax, ax, _mm256_fmadd_ps(ay, ay, _mm256_mul_ps(az, az))),
+					_mm256_fmadd_ps(bx, bx, _mm256_fmadd_ps(by, by, _mm256_mul_ps(bz, bz)))));
+				__m256 cosine = _mm256_div_ps(_mm256_fmadd_ps(ax, bx, _mm256_fmadd_ps(ay, by, _mm256_mul_ps(az, bz))), lengths);
+				__m256 a = _mm256_min_ps(_mm256_andnot_ps(signMask, cosine), _mm256_set1_ps(1.0f));
+				__m256 poly = _mm256_fmadd_ps(a, _mm256_set1_ps(-0.0187293f), _mm256_set1_ps(0.0742610f));
+				poly = _mm256_fmadd_ps(a, poly, _mm256_set1_ps(-0.2121144f));
+				poly = _mm256_fmadd_ps(a, poly, _mm256_set1_ps(1.5707288f));
+				__m256 angle = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), a)), poly);
+				__m256 negative = _mm256_cmp_ps(cosine, _mm256_setzero_ps(), _CMP_LT_OQ);
+				angle = _mm256_blendv_ps(angle, _mm256_sub_ps(_mm256_set1_ps(XM_PI), angle), negative);
+
+				// Zero weight for degenerate corners or tangents along the normal
+				__m256 usable = _mm256_and_ps(
+					_mm256_cmp_ps(lengths, _mm256_setzero_ps(), _CMP_GT_OQ),
+					_mm256_cmp_ps(projectedLength, _mm256_setzero_ps(), _CMP_GT_OQ));
+				__m256 scale = _mm256_and_ps(_mm256_div_ps(angle, projectedLength), usable);
+
+				_mm256_store_ps(cx[k], _mm256_mul_ps(px, scale));
+				_mm256_store_ps(cy[k], _mm256_mul_ps(py, scale));
+				_mm256_store_ps(cz[k], _mm256_mul_ps(pz, scale));
+			}
+
+			for (size_t i = 0; i < 8; i++)
+			{
+				const unsigned int* tri = &indices[(b * 8 + i) * 3];
+				for (size_t k = 0; k < 3; k++)
+				{
+					sums.x[tri[k]] += cx[k][i];
+					sums.y[tri[k]] += cy[k][i];
+					sums.z[tri[k]] += cz[k][i];
+				}
+			}
+		}
+
+		// Leftover triangles
+		_mm256_zeroupper();
+		for (size_t t = blocks * 8; t < triangleCount; t++)
+			AddTriangle(sums, vertices, &indices[t * 3], angleWeighted);
+
+		// Orthonormalize 8 vertices at a time: normals are gathered out
+		// of the vertex array, the sums are already SoA
+		const __m256i vertexStride = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), vertexFloats);
+		const __m256 minLengthSq = _mm256_set1_ps(1e-24f);
+		size_t vertexBlocks = vertexCount / 8;
+		for (size_t b = 0; b < vertexBlocks; b++)
+		{
+			const float* first = base + b * 8 * VertexFloats;
+			__m256 nx = _mm256_i32gather_ps(first + NormalOffset + 0, vertexStride, 4);
+			__m256 ny = _mm256_i32gather_ps(first + NormalOffset + 1, vertexStride, 4);
+			__m256 nz = _mm256_i32gather_ps(first + NormalOffset + 2, vertexStride, 4);
+			__m256 sx = _mm256_loadu_ps(&sums.x[b * 8]);
+			__m256 sy = _mm256_loadu_ps(&sums.y[b * 8]);
+			__m256 sz = _mm256_loadu_ps(&sums.z[b * 8]);
+
+			__m256 d = _mm256_fmadd_ps(nx, sx, _mm256_fmadd_ps(ny, sy, _mm256_mul_ps(nz, sz)));
+			sx = _mm256_fnmadd_ps(nx, d, sx);
+			sy = _mm256_fnmadd_ps(ny, d, sy);
+			sz = _mm256_fnmadd_ps(nz, d, sz);
+
+			__m256 lengthSq = _mm256_fmadd_ps(sx, sx, _mm256_fmadd_ps(sy, sy, _mm256_mul_ps(sz, sz)));
+			int usable = _mm256_movemask_ps(_mm256_cmp_ps(lengthSq, minLengthSq, _CMP_GT_OQ));
+			__m256 inverseLength = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(lengthSq));
+
+			_mm256_store_ps(tx, _mm256_mul_ps(sx, inverseLength));
+			_mm256_store_ps(ty, _mm256_mul_ps(sy, inverseLength));
+			_mm256_store_ps(tz, _mm256_mul_ps(sz, inverseLength));
+
+			for (size_t i = 0; i < 8; i++)
+			{
+				size_t v = b * 8 + i;
+				if (usable & (1 << i))
+				{
+					vertices[v].Tangent = XMFLOAT3(tx[i], ty[i], tz[i]);
+				}
+				else
+				{
+					_mm256_zeroupper();
+					Orthonormalize(vertices[v], sums.x[v], sums.y[v], sums.z[v]);
+				}
+			}
+		}
+
+		_mm256_zeroupper();
+		for (size_t v = vertexBlocks * 8; v < vertexCount; v++)
+			Orthonormalize(vertices[v], sums.x[v], sums.y[v], sums.z[v]);
+	}
+#endif
+}
+
+// --------------------------------------------------------
+// Checks CPUID for AVX2/FMA, and that the OS saves YMM registers
+// --------------------------------------------------------
+bool TangentGenerator::IsAVX2Supported()
+{
+#ifdef TANGENT_GENERATOR_AVX2
+	static const bool supported = []()
+	{
+		int info[4] = {};
+#ifdef _MSC_VER
+		__cpuid(info, 1);
+#else
+		__cpuid(1, info[0], info[1], info[2], info[3]);
+#endif
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		if (!osxsave || !fma)
+			return false;
+
+		// XCR0 bits 1 and 2: SSE and AVX state
+#ifdef _MSC_VER
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int low, high;
+		__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		unsigned long long xcr0 = ((unsigned long long)high << 32) | low;
+#endif
+		if ((xcr0 & 6) != 6)
+			return false;
+
+#ifdef _MSC_VER
+		__cpuidex(info, 7, 0);
+#else
+		__cpuid_count(7, 0, info[0], info[1], info[2], info[3]);
+#endif
+		return (info[1] & (1 << 5)) != 0;
+	}();
+	return supported;
+#else
+	return false;
+#endif
+}
+
+// --------------------------------------------------------
+// Calculates tangents for every vertex of a triangle list
+// --------------------------------------------------------
+void TangentGenerator::Generate(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, TangentOptions options)
+{
+	TangentSums sums;
+	sums.x.assign(vertexCount, 0.0f);
+	sums.y.assign(vertexCount, 0.0f);
+	sums.z.assign(vertexCount, 0.0f);
+
+	size_t triangleCount = indexCount / 3;
+
+#ifdef TANGENT_GENERATOR_AVX2
+	if (options.allowSimd && IsAVX2Supported())
+	{
+		GenerateAVX2(sums, vertices, vertexCount, indices, triangleCount, options.angleWeighted);
+		return;
+	}
+#endif
+
+	GenerateScalar(sums, vertices, vertexCount, indices, triangleCount, options.angleWeighted);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// How each triangle's tangent is spread to its vertices
+// --------------------------------------------------------
+struct TangentOptions
+{
+	// false: Sum raw triangle tangents, so larger triangles count for more (Lengyel's method)
+	// true:  Project each triangle's tangent onto the vertex's normal plane and weight it by
+	//        the triangle's angle at that corner, like MikkTSpace. Output then only depends on
+	//        the surface, not on how it was triangulated.
+	bool angleWeighted = false;
+
+	// Allows the AVX2 kernel when the CPU supports it (the scalar path gives the same results)
+	bool allowSimd = true;
+};
+
+/*
+* Generates per-vertex tangents from positions, UVs and normals in a single pass.
+*
+* Triangles are processed 8 at a time with AVX2 (picked at runtime; otherwise scalar):
+* each block is gathered into SoA registers, its 8 face tangents are computed at once, then
+* added to SoA per-vertex accumulators one triangle at a time, so triangles that share a
+* vertex within a block can't lose each other's contributions. Triangles with degenerate UVs
+* (zero UV area) are skipped rather than dividing by zero.
+*
+* Generate(): Overwrites every vertex's Tangent with a unit vector perpendicular to its Normal
+* IsAVX2Supported(): Whether the CPU and OS support the AVX2 path
+*/
+namespace TangentGenerator
+{
+	void Generate(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, TangentOptions options = {});
+
+	bool IsAVX2Supported();
+}
@@ -0,0 +1,361 @@
+#include "TestHarness.h"
+#include "BlockCompression.h"
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Reference decoders, written from the D3D format specs
+	// rather than shared with the encoder, so a mistake in its
+	// bit layout can't cancel out. Each fills a block's pixels
+	// (RGBA, row by row) and leaves channels it lacks alone.
+	// --------------------------------------------------------
+	void Expand565(unsigned int color, int rgb[3])
+	{
+		unsigned int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+		rgb[0] = (int)(r << 3 | r >> 2);
+		rgb[1] = (int)(g << 2 | g >> 4);
+		rgb[2] = (int)(b << 3 | b >> 2);
+	}
+
+	void DecodeBC1(const unsigned char* block, unsigned char pixels[16][4])
+	{
+		unsigned int color0 = block[0] | block[1] << 8, color1 = block[2] | block[3] << 8;
+		int palette[4][4];
+		Expand565(color0, palette[0]);
+		Expand565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			int a = palette[0][c], b = palette[1][c];
+			palette[2][c] = color0 > color1 ? (2 * a + b + 1) / 3 : (a + b + 1) / 2;
+			palette[3][c] = color0 > color1 ? (a + 2 * b + 1) / 3 : 0;
+		}
+		for (int e = 0; e < 4; e++)
+			palette[e][3] = color0 <= color1 && e == 3 ? 0 : 255;
+
+		for (int i = 0; i < 16; i++)
+		{
+			int index = (block[4 + i / 4] >> (i % 4 * 2)) & 3;
+			for (int c = 0; c < 4; c++)
+				pixels[i][c] = (unsigned char)palette[index][c];
+		}
+	}
+
+	void DecodeBC4(const unsigned char* block, int channel, unsigned char pixels[16][4])
+	{
+		int a = block[0], b = block[1];
+		int palette[8] = { a, b };
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = a > b ? ((7 - i) * a + i * b + 3) / 7 : i < 5 ? ((5 - i) * a + i * b + 2) / 5 : i == 5 ? 0 : 255;
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++)
+			bits |= (uint64_t)block[2 + i] << (i * 8);
+		for (int i = 0; i < 16; i++)
+			pixels[i][channel] = (unsigned char)palette[(bits >> (i * 3)) & 7];
+	}
+
+	// Mode 6 only, which is all the encoder writes - false for anything else
+	bool DecodeBC7(const unsigned char* block, unsigned char pixels[16][4])
+	{
+		unsigned int position = 0;
+		auto read = [&](unsigned int count)
+			{
+				unsigned int value = 0;
+				for (unsigned int b = 0; b < count; b++, position++)
+					value |= ((block[position / 8] >> (position % 8)) & 1u) << b;
+				return value;
+			};
+		if (read(7) != 1 << 6)
+			return false;
+
+		int endpoints[2][4];
+		for (int c = 0; c < 4; c++)
+			for (int e = 0; e < 2; e++)
+				endpoints[e][c] = (int)read(7) << 1;
+		for (int e = 0; e < 2; e++)
+		{
+			unsigned int p = read(1);
+			for (int c = 0; c < 4; c++)
+				endpoints[e][c] |= (int)p;
+		}
+
+		const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		for (int i = 0; i < 16; i++)
+		{
+			int w = weights[read(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; c++)
+				pixels[i][c] = (unsigned char)(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+		}
+		return true;
+	}
+
+	unsigned int ChannelCount(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return 3;
+		case BlockFormat::BC4: return 1;
+		case BlockFormat::BC5: return 2;
+		default: return 4;
+		}
+	}
+
+	// Decodes a whole image with the reference decoders
+	ImageData Decode(const std::vector<unsigned char>& encoded, BlockFormat format, unsigned int width, unsigned int height)
+	{
+		ImageData image;
+		image.width = width;
+		image.height = height;
+		image.pixels.assign((size_t)width * height * 4, 0);
+
+		unsigned int blocksX = (width + 3) / 4, blockBytes = BlockCompression::GetBlockBytes(format);
+		for (unsigned int blockY = 0; blockY < (height + 3) / 4; blockY++)
+			for (unsigned int blockX = 0; blockX < blocksX; blockX++)
+			{
+				const unsigned char* block = &encoded[((size_t)blockY * blocksX + blockX) * blockBytes];
+				unsigned char pixels[16][4] = {};
+				switch (format)
+				{
+				case BlockFormat::BC1: DecodeBC1(block, pixels); break;
+				case BlockFormat::BC4: DecodeBC4(block, 0, pixels); break;
+				case BlockFormat::BC5: DecodeBC4(block, 0, pixels); DecodeBC4(block + 8, 1, pixels); break;
+				case BlockFormat::BC7: CHECK(DecodeBC7(block, pixels)); break;
+				}
+
+				for (unsigned int i = 0; i < 16; i++)
+				{
+					unsigned int x = blockX * 4 + i % 4, y = blockY * 4 + i / 4;
+					if (x < width && y < height)
+						memcpy(&image.pixels[((size_t)y * width + x) * 4], pixels[i], 4);
+				}
+			}
+		return image;
+	}
+
+	// PSNR over the channels the format keeps, from the reference decoder
+	double Psnr(const ImageData& image, BlockFormat format, const std::vector<unsigned char>& encoded)
+	{
+		ImageData decoded = Decode(encoded, format, image.width, image.height);
+		unsigned int channels = ChannelCount(format);
+		double squaredError = 0;
+		for (size_t p = 0; p < image.pixels.size(); p += 4)
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				double difference = (double)decoded.pixels[p + c] - image.pixels[p + c];
+				squaredError += difference * difference;
+			}
+		double meanSquaredError = squaredError / ((double)image.width * image.height * channels);
+		return meanSquaredError == 0 ? std::numeric_limits<double>::infinity() : 10 * log10(255.0 * 255.0 / meanSquaredError);
+	}
+
+	ImageData MakeImage(unsigned int width, unsigned int height)
+	{
+		ImageData image;
+		image.width = width;
+		image.height = height;
+		image.pixels.assign((size_t)width * height * 4, 255);
+		return image;
+	}
+
+	ImageData SolidBlock(const unsigned char rgba[4])
+	{
+		ImageData image = MakeImage(4, 4);
+		for (size_t p = 0; p < image.pixels.size(); p += 4)
+			memcpy(&image.pixels[p], rgba, 4);
+		return image;
+	}
+
+	// Encodes and decodes one image, returning whether every kept channel came back exactly
+	bool RoundTripsExactly(const ImageData& image, BlockFormat format)
+	{
+		std::vector<unsigned char> encoded;
+		BlockCompression::Encode(image, format, encoded);
+		return std::isinf(Psnr(image, format, encoded)) && std::isinf(BlockCompression::MeasurePsnr(image, format, encoded.data()));
+	}
+
+	// Encodes and decodes one image, returning the largest error in any kept channel
+	int MaxError(const ImageData& image, BlockFormat format)
+	{
+		std::vector<unsigned char> encoded;
+		BlockCompression::Encode(image, format, encoded);
+		ImageData decoded = Decode(encoded, format, image.width, image.height);
+		int largest = 0;
+		for (size_t p = 0; p < image.pixels.size(); p += 4)
+			for (unsigned int c = 0; c < ChannelCount(format); c++)
+				largest = (std::max)(largest, abs((int)decoded.pixels[p + c] - (int)image.pixels[p + c]));
+		return largest;
+	}
+
+	// Smooth ramps, the kind of content block compression handles well. One way, every
+	// channel runs along x, so each block's colors lie on a line; two ways, red runs
+	// along x and green along y
+	ImageData MakeGradient(unsigned int width, unsigned int height, bool twoWay)
+	{
+		ImageData image = MakeImage(width, height);
+		for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned char* pixel = &image.pixels[((size_t)y * width + x) * 4];
+				pixel[0] = (unsigned char)(x * 255 / (width - 1));
+				pixel[1] = twoWay ? (unsigned char)(y * 255 / (height - 1)) : (unsigned char)(255 - x * 255 / (width - 1));
+				pixel[2] = twoWay ? (unsigned char)((x + y) * 255 / (width + height - 2)) : (unsigned char)(64 + x * 128 / (width - 1));
+				pixel[3] = (unsigned char)(255 - x * 128 / (width - 1));
+			}
+		return image;
+	}
+}
+
+TEST(SingleColorBlocksAreExact)
+{
+	// BC4 and BC5 endpoints are 8 bits, so any value is exact
+	bool exact = true;
+	for (int value = 0; value < 256; value++)
+	{
+		unsigned char rgba[4] = { (unsigned char)value, (unsigned char)(255 - value), 0, 255 };
+		exact = exact && RoundTripsExactly(SolidBlock(rgba), BlockFormat::BC4) && RoundTripsExactly(SolidBlock(rgba), BlockFormat::BC5);
+	}
+	CHECK(exact);
+
+	// BC7 mode 6 endpoints are 7 bits plus a p-bit shared by all four channels, but a
+	// palette entry between two endpoints reaches every value in every channel - except
+	// that no one entry reaches both 0 and 255, so colors with both can be 1 off
+	std::mt19937 random(5);
+	exact = true;
+	for (int i = 0; i < 500; i++)
+	{
+		unsigned char rgba[4] = { (unsigned char)random(), (unsigned char)random(), (unsigned char)random(), (unsigned char)random() };
+		exact = exact && RoundTripsExactly(SolidBlock(rgba), BlockFormat::BC7);
+	}
+	CHECK(exact);
+	const unsigned char extremes[][4] = { { 0, 0, 0, 0 }, { 255, 255, 255, 255 }, { 0, 0, 0, 255 }, { 255, 0, 0, 255 }, { 255, 255, 0, 0 } };
+	for (const unsigned char* rgba : extremes)
+	{
+		bool mixed = std::count(rgba, rgba + 4, 0) > 0 && std::count(rgba, rgba + 4, 255) > 0;
+		CHECK(mixed ? MaxError(SolidBlock(rgba), BlockFormat::BC7) <= 1 : RoundTripsExactly(SolidBlock(rgba), BlockFormat::BC7));
+	}
+
+	// BC1 is exact for any color RGB565 can hold, and within 1 of any other
+	exact = true;
+	for (int i = 0; i < 500; i++)
+	{
+		int rgb[3];
+		Expand565((unsigned int)random() & 0xFFFF, rgb);
+		unsigned char rgba[4] = { (unsigned char)rgb[0], (unsigned char)rgb[1], (unsigned char)rgb[2], 255 };
+		exact = exact && RoundTripsExactly(SolidBlock(rgba), BlockFormat::BC1);
+	}
+	CHECK(exact);
+	int largest = 0;
+	for (int value = 0; value < 256; value++)
+	{
+		unsigned char rgba[4] = { (unsigned char)value, (unsigned char)(value * 7), (unsigned char)(255 - value), 255 };
+		largest = (std::max)(largest, MaxError(SolidBlock(rgba), BlockFormat::BC1));
+	}
+	CHECK(largest <= 1);
+}
+
+TEST(KnownBlocksDecodeToWhatWasEncoded)
+{
+	// Black and white in a checkerboard: the endpoints of every format
+	ImageData checker = MakeImage(4, 4);
+	for (unsigned int i = 0; i < 16; i++)
+		memset(&checker.pixels[i * 4], (i + i / 4) % 2 ? 255 : 0, 4);
+	for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 })
+		CHECK(RoundTripsExactly(checker, format));
+
+	// BC4's 8 value palette, in steps of 36 from 0 to 252, and two of them in BC5's green
+	ImageData steps = MakeImage(4, 4);
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		steps.pixels[i * 4] = (unsigned char)(i % 8 * 36);
+		steps.pixels[i * 4 + 1] = i % 2 ? 108 : 180;
+	}
+	CHECK(RoundTripsExactly(steps, BlockFormat::BC4));
+	CHECK(RoundTripsExactly(steps, BlockFormat::BC5));
+
+	// BC1's palette: two RGB565 colors and the two between them
+	int a[3], b[3];
+	Expand565(0xF800 | 0x07E0, a);
+	Expand565(0x001F, b);
+	ImageData line = MakeImage(4, 4);
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		int weight = i % 4; // 0, 1/3, 2/3, 1 of the way from a to b
+		for (int c = 0; c < 3; c++)
+			line.pixels[i * 4 + c] = (unsigned char)((a[c] * (3 - weight) + b[c] * weight + 1) / 3);
+	}
+	CHECK(RoundTripsExactly(line, BlockFormat::BC1));
+}
+
+TEST(GradientsMeetAMinimumPsnr)
+{
+	// 70x50 isn't a multiple of 4, so the last blocks repeat edge pixels. Every format
+	// fits a line through each block's colors, which can follow a one way gradient
+	// closely but not one running two ways at once
+	const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 };
+	const double minimum[2][4] = { { 42.0, 54.0, 54.0, 52.0 }, { 37.0, 54.0, 53.0, 39.0 } };
+	for (int twoWay = 0; twoWay < 2; twoWay++)
+	{
+		ImageData gradient = MakeGradient(70, 50, twoWay != 0);
+		for (int f = 0; f < 4; f++)
+		{
+			std::vector<unsigned char> encoded;
+			BlockCompression::Encode(gradient, formats[f], encoded);
+			CHECK(encoded.size() == BlockCompression::GetEncodedSize(formats[f], 70, 50));
+			CHECK(encoded.size() == 18 * 13 * BlockCompression::GetBlockBytes(formats[f]));
+
+			// The encoder's own measurement agrees with the reference decoder
+			double psnr = Psnr(gradient, formats[f], encoded);
+			CHECK(psnr >= minimum[twoWay][f]);
+			CHECK(std::fabs(BlockCompression::MeasurePsnr(gradient, formats[f], encoded.data()) - psnr) < 1e-9);
+		}
+	}
+
+	// Noise is much harder, but still nowhere near garbage
+	ImageData noise = MakeImage(32, 32);
+	std::mt19937 random(9);
+	for (unsigned char& value : noise.pixels)
+		value = (unsigned char)(random() % 64 + 96);
+	for (BlockFormat format : formats)
+	{
+		std::vector<unsigned char> encoded;
+		BlockCompression::Encode(noise, format, encoded);
+		CHECK(Psnr(noise, format, encoded) >= 20.0);
+	}
+
+	std::vector<unsigned char> encoded;
+	CHECK_THROWS(BlockCompression::Encode(MakeImage(0, 4), BlockFormat::BC1, encoded), std::invalid_argument);
+}
+
+TEST(CompressorPicksFormatsByUsage)
+{
+	CHECK(TextureCompressor::GetFormatFor(TextureUsage::Color) == BlockFormat::BC7);
+	CHECK(TextureCompressor::GetFormatFor(TextureUsage::NormalMap) == BlockFormat::BC5);
+	CHECK(TextureCompressor::GetFormatFor(TextureUsage::Mask) == BlockFormat::BC4);
+	CHECK(TextureCompressor::GetFormatFor(TextureUsage::PackedOrm) == BlockFormat::BC7);
+
+	// Every level is encoded, and the report measures the full size one
+	std::vector<ImageData> levels;
+	TextureCompressor::GenerateMips(MakeGradient(64, 32, true), TextureUsage::Mask, levels);
+	std::vector<std::vector<unsigned char>> mips;
+	TextureCompressionReport report = {};
+	TextureCompressor::Compress(levels, TextureUsage::Mask, mips, &report);
+
+	CHECK(mips.size() == 7 && report.mipLevels == 7 && report.format == BlockFormat::BC4);
+	size_t compressedBytes = 0;
+	for (size_t i = 0; i < mips.size() && i < levels.size(); i++)
+	{
+		CHECK(mips[i].size() == BlockCompression::GetEncodedSize(BlockFormat::BC4, levels[i].width, levels[i].height));
+		compressedBytes += mips[i].size();
+	}
+	CHECK(report.compressedBytes == compressedBytes);
+	CHECK(std::fabs(report.psnr - Psnr(levels[0], BlockFormat::BC4, mips[0])) < 1e-9);
+}
@@ -0,0 +1,110 @@
+#include "TestHarness.h"
+#include "GlbLoader.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	// A .glb of one JSON chunk and one BIN chunk, each padded to 4 bytes
+	std::string MakeGlb(std::string json, std::string bin)
+	{
+		json.resize((json.size() + 3) & ~size_t(3), ' ');
+		bin.resize((bin.size() + 3) & ~size_t(3), '\0');
+
+		auto u32 = [](std::string& out, unsigned int value) { out.append((const char*)&value, 4); };
+		std::string glb;
+		u32(glb, 0x46546C67);
+		u32(glb, 2);
+		u32(glb, (unsigned int)(12 + 8 + json.size() + 8 + bin.size()));
+		u32(glb, (unsigned int)json.size());
+		u32(glb, 0x4E4F534A);
+		glb += json;
+		u32(glb, (unsigned int)bin.size());
+		u32(glb, 0x004E4942);
+		glb += bin;
+		return glb;
+	}
+
+	// A triangle whose positions are 16 bytes apart in a 768 byte view, with
+	// the view's byteStride, the accessor's count and any extra accessor
+	// members spliced into the JSON as given
+	std::string MakeTriangle(const char* byteStride, const char* count = "3", const char* accessorExtra = "")
+	{
+		std::string bin(768, '\0');
+		const float corners[3][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 } };
+		for (int c = 0; c < 3; c++)
+			memcpy(&bin[c * 16], corners[c], sizeof(corners[c]));
+
+		std::string json =
+			"{\"asset\":{\"version\":\"2.0\"},"
+			"\"buffers\":[{\"byteLength\":768}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteLength\":768,\"byteStride\":" + std::string(byteStride) + "}],"
+			"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"type\":\"VEC3\",\"count\":" + count + accessorExtra + "}],"
+			"\"meshes\":[{\"name\":\"tri\",\"primitives\":[{\"attributes\":{\"POSITION\":0}}]}]}";
+		return MakeGlb(json, bin);
+	}
+
+	// Whether loading the file throws a runtime_error (what malformed files should do)
+	bool Rejects(const std::string& glb)
+	{
+		TestHarness::WriteFile("GlbLoaderTest.glb", glb);
+		std::vector<GlbPrimitive> primitives;
+		try
+		{
+			GlbLoader::Load("GlbLoaderTest.glb", primitives);
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+		return false;
+	}
+}
+
+TEST(StridedPositionsAreReadAndFlipped)
+{
+	TestHarness::WriteFile("GlbLoaderTest.glb", MakeTriangle("16"));
+	std::vector<GlbPrimitive> primitives;
+	GlbLoader::Load("GlbLoaderTest.glb", primitives);
+
+	CHECK(primitives.size() == 1);
+	if (primitives.size() != 1)
+		return;
+	const MeshData& data = primitives[0].data;
+	CHECK(primitives[0].name == "tri" && primitives[0].material == -1);
+	CHECK(data.vertices.size() == 3 && data.vertices[1].Position.x == 1.0f && data.vertices[2].Position.y == 1.0f);
+	CHECK(data.indices.size() == 3 && data.indices[1] == 2 && data.indices[2] == 1);
+}
+
+TEST(StridesOutsideTheSpecAreRejected)
+{
+	CHECK(!Rejects(MakeTriangle("12")));
+	CHECK(!Rejects(MakeTriangle("252")));
+	CHECK(Rejects(MakeTriangle("256")));	// Past glTF's 252 byte limit
+	CHECK(Rejects(MakeTriangle("14")));			// Not a multiple of 4
+	CHECK(Rejects(MakeTriangle("8")));			// Smaller than an element
+}
+
+TEST(NumbersThatDontFitASizeAreRejected)
+{
+	CHECK(Rejects(MakeTriangle("16", "-1")));
+	CHECK(Rejects(MakeTriangle("16", "2.5")));
+	CHECK(Rejects(MakeTriangle("16", "1e300")));
+	CHECK(Rejects(MakeTriangle("16", "18446744073709551615")));
+	CHECK(Rejects(MakeTriangle("16", "3", ",\"byteOffset\":-4")));
+	CHECK(Rejects(MakeTriangle("16", "3", ",\"byteOffset\":1e30")));
+	CHECK(Rejects(MakeTriangle("-16")));
+	CHECK(Rejects(MakeTriangle("16", "\"3\"")));
+}
+
+TEST(AccessorsPastTheirViewAreRejected)
+{
+	// 48 elements 16 bytes apart need 764 of the view's 768 bytes; 49 need 780
+	CHECK(!Rejects(MakeTriangle("16", "48")));
+	CHECK(Rejects(MakeTriangle("16", "49")));
+	CHECK(Rejects(MakeTriangle("16", "48", ",\"byteOffset\":16")));
+
+	// Counts whose (count - 1) * stride would wrap a 64-bit size
+	CHECK(Rejects(MakeTriangle("252", "73201365371896000")));
+}
@@ -0,0 +1,217 @@
+#include "TestHarness.h"
+#include "MeshBounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Containment is checked with a little slack for float rounding
+	const float Tolerance = 1e-4f;
+
+	std::vector<Vertex> ToVertices(const std::vector<XMFLOAT3>& points)
+	{
+		std::vector<Vertex> vertices(points.size(), Vertex());
+		for (size_t i = 0; i < points.size(); i++)
+			vertices[i].Position = points[i];
+		return vertices;
+	}
+
+	// A rotation about x, which the bounds code never special cases
+	XMMATRIX RotationX(float angle)
+	{
+		return XMMATRIX(XMVectorSet(1, 0, 0, 0), XMVectorSet(0, cosf(angle), sinf(angle), 0), XMVectorSet(0, -sinf(angle), cosf(angle), 0), XMVectorSet(0, 0, 0, 1));
+	}
+
+	XMVECTOR Axis(const BoundingOrientedBox& box, int axis)
+	{
+		return XMVector3Rotate(XMVectorSet(axis == 0 ? 1.0f : 0.0f, axis == 1 ? 1.0f : 0.0f, axis == 2 ? 1.0f : 0.0f, 0), XMLoadFloat4(&box.Orientation));
+	}
+
+	float ExtentAlong(const BoundingOrientedBox& box, int axis)
+	{
+		return axis == 0 ? box.Extents.x : axis == 1 ? box.Extents.y : box.Extents.z;
+	}
+
+	bool BoxContains(const BoundingBox& box, XMFLOAT3 p)
+	{
+		return fabsf(p.x - box.Center.x) <= box.Extents.x + Tolerance && fabsf(p.y - box.Center.y) <= box.Extents.y + Tolerance &&
+			fabsf(p.z - box.Center.z) <= box.Extents.z + Tolerance;
+	}
+
+	bool SphereContains(const BoundingSphere& sphere, XMFLOAT3 p)
+	{
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&p), XMLoadFloat3(&sphere.Center))));
+		return distance <= sphere.Radius * (1 + Tolerance) + Tolerance;
+	}
+
+	bool OrientedBoxContains(const BoundingOrientedBox& box, XMFLOAT3 p)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&p), XMLoadFloat3(&box.Center));
+		for (int axis = 0; axis < 3; axis++)
+			if (fabsf(XMVectorGetX(XMVector3Dot(offset, Axis(box, axis)))) > ExtentAlong(box, axis) + Tolerance)
+				return false;
+		return true;
+	}
+
+	// Whether every volume holds every point, and the min/max are the points' actual extremes
+	bool HoldsEveryPoint(const MeshBounds& bounds, const std::vector<XMFLOAT3>& points)
+	{
+		XMFLOAT3 min = points[0], max = points[0];
+		for (const XMFLOAT3& p : points)
+		{
+			if (!BoxContains(bounds.box, p) || !SphereContains(bounds.sphere, p) || !OrientedBoxContains(bounds.orientedBox, p))
+				return false;
+			min = XMFLOAT3((std::min)(min.x, p.x), (std::min)(min.y, p.y), (std::min)(min.z, p.z));
+			max = XMFLOAT3((std::max)(max.x, p.x), (std::max)(max.y, p.y), (std::max)(max.z, p.z));
+		}
+		return min.x == bounds.min.x && min.y == bounds.min.y && min.z == bounds.min.z &&
+			max.x == bounds.max.x && max.y == bounds.max.y && max.z == bounds.max.z;
+	}
+
+	float Volume(const XMFLOAT3& extents) { return extents.x * extents.y * extents.z; }
+
+	// A lattice filling a box with the given half sizes, rotated and then moved to center
+	std::vector<XMFLOAT3> MakeRotatedBox(XMFLOAT3 extents, FXMMATRIX rotation, XMFLOAT3 center)
+	{
+		std::vector<XMFLOAT3> points;
+		for (int x = -2; x <= 2; x++)
+			for (int y = -2; y <= 2; y++)
+				for (int z = -2; z <= 2; z++)
+				{
+					XMVECTOR local = XMVectorSet(extents.x * x / 2, extents.y * y / 2, extents.z * z / 2, 0);
+					XMFLOAT3 p;
+					XMStoreFloat3(&p, XMVectorAdd(XMVector3TransformNormal(local, rotation), XMLoadFloat3(&center)));
+					points.push_back(p);
+				}
+		return points;
+	}
+}
+
+TEST(EveryVolumeHoldsEveryVertex)
+{
+	// Clouds of different shapes: round, long and thin, flat, and a few stray far points
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	const XMFLOAT3 scales[] = { { 1, 1, 1 }, { 20, 0.5f, 0.5f }, { 5, 5, 0.01f }, { 3, 2, 1 } };
+	for (const XMFLOAT3& scale : scales)
+	{
+		for (size_t count : { (size_t)1, (size_t)2, (size_t)7, (size_t)1000 })
+		{
+			std::vector<XMFLOAT3> points;
+			for (size_t i = 0; i < count; i++)
+				points.push_back(XMFLOAT3(unit(random) * scale.x + 100, unit(random) * scale.y - 50, unit(random) * scale.z));
+			if (count > 100)
+				points[count / 2] = XMFLOAT3(100 + scale.x * 4, -50, 0);
+
+			std::vector<Vertex> vertices = ToVertices(points);
+			MeshBounds bounds;
+			BoundingVolumes::Compute(&bounds, vertices.data(), vertices.size());
+			CHECK(HoldsEveryPoint(bounds, points));
+
+			// Each volume is the smaller of its candidates, so none is looser than the box's own
+			float halfDiagonal = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.box.Extents)));
+			CHECK(bounds.sphere.Radius <= halfDiagonal * (1 + Tolerance));
+			CHECK(Volume(bounds.orientedBox.Extents) <= Volume(bounds.box.Extents) * (1 + Tolerance));
+		}
+	}
+
+	// The min/max loop takes points four at a time, so every remainder is covered,
+	// read with a stride that skips the rest of each vertex
+	for (size_t count = 1; count <= 9; count++)
+	{
+		std::vector<XMFLOAT3> points;
+		for (size_t i = 0; i < count; i++)
+			points.push_back(XMFLOAT3(unit(random), unit(random), unit(random)));
+		std::vector<Vertex> vertices = ToVertices(points);
+		MeshBounds bounds;
+		BoundingVolumes::ComputeMinMax(&vertices[0].Position, count, sizeof(Vertex), &bounds.min, &bounds.max);
+		bounds.box.Center = bounds.sphere.Center = bounds.orientedBox.Center = points[0];
+		bounds.box.Extents = bounds.orientedBox.Extents = XMFLOAT3(3, 3, 3);
+		bounds.orientedBox.Orientation = XMFLOAT4(0, 0, 0, 1);
+		bounds.sphere.Radius = 6;
+		CHECK(HoldsEveryPoint(bounds, points));
+	}
+
+	MeshBounds empty;
+	BoundingVolumes::Compute(&empty, nullptr, 0);
+	CHECK(empty.sphere.Radius == 0 && Volume(empty.box.Extents) == 0);
+}
+
+TEST(RotatedBoxesGetTheirOwnAxes)
+{
+	// A 8 x 4 x 2 box turned on two axes: the oriented box finds its center, its sizes
+	// and (up to sign and order) its axes, while the AABB has to be much bigger
+	const XMFLOAT3 extents(4, 2, 1), center(5, -3, 2);
+	XMMATRIX rotation = XMMatrixMultiply(XMMatrixRotationY(0.5f), RotationX(0.35f));
+	std::vector<XMFLOAT3> points = MakeRotatedBox(extents, rotation, center);
+	std::vector<Vertex> vertices = ToVertices(points);
+	MeshBounds bounds;
+	BoundingVolumes::Compute(&bounds, vertices.data(), vertices.size());
+	CHECK(HoldsEveryPoint(bounds, points));
+
+	const BoundingOrientedBox& box = bounds.orientedBox;
+	CHECK(fabsf(box.Center.x - center.x) < 1e-3f && fabsf(box.Center.y - center.y) < 1e-3f && fabsf(box.Center.z - center.z) < 1e-3f);
+	CHECK(fabsf(Volume(box.Extents) - Volume(extents)) < 1e-2f);
+	CHECK(Volume(bounds.box.Extents) > Volume(extents) * 2);
+
+	const float expected[3] = { extents.x, extents.y, extents.z };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// The box axis this one lines up with, and its size along it
+		bool matched = false;
+		for (int k = 0; k < 3; k++)
+		{
+			XMVECTOR boxAxis = XMVector3TransformNormal(XMVectorSet(k == 0 ? 1.0f : 0.0f, k == 1 ? 1.0f : 0.0f, k == 2 ? 1.0f : 0.0f, 0), rotation);
+			if (fabsf(XMVectorGetX(XMVector3Dot(boxAxis, Axis(box, axis)))) > 0.9999f)
+				matched = fabsf(ExtentAlong(box, axis) - expected[k]) < 1e-3f;
+		}
+		CHECK(matched);
+	}
+
+	// The sphere is the box's circumscribed one
+	CHECK(fabsf(bounds.sphere.Radius - sqrtf(4 * 4 + 2 * 2 + 1 * 1)) < 1e-3f);
+}
+
+TEST(AxisAlignedBoxesKeepTheirAabb)
+{
+	// A cube's covariance has no preferred axes, so the oriented box falls back to the AABB
+	std::vector<XMFLOAT3> points = MakeRotatedBox(XMFLOAT3(1, 1, 1), XMMatrixIdentity(), XMFLOAT3(1, 2, 3));
+	std::vector<Vertex> vertices = ToVertices(points);
+	MeshBounds bounds;
+	BoundingVolumes::Compute(&bounds, vertices.data(), vertices.size());
+	CHECK(HoldsEveryPoint(bounds, points));
+	CHECK(fabsf(Volume(bounds.orientedBox.Extents) - 1) < 1e-4f && fabsf(Volume(bounds.box.Extents) - 1) < 1e-4f);
+}
+
+TEST(TransformedVolumesHoldTransformedVertices)
+{
+	std::mt19937 random(4);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<XMFLOAT3> points;
+	for (int i = 0; i < 500; i++)
+		points.push_back(XMFLOAT3(unit(random) * 6, unit(random) * 2 + unit(random), unit(random)));
+	std::vector<Vertex> vertices = ToVertices(points);
+	MeshBounds bounds;
+	BoundingVolumes::Compute(&bounds, vertices.data(), vertices.size());
+
+	// Uniform, then non-uniform scale across a rotation (which shears the oriented box)
+	const XMMATRIX worlds[] = {
+		XMMatrixMultiply(XMMatrixRotationY(1.1f), XMMatrixTranslation(10, 0, -4)),
+		XMMatrixMultiply(XMMatrixMultiply(RotationX(0.6f), XMMatrixScaling(3, 0.5f, 1)), XMMatrixRotationY(0.8f)) };
+	for (const XMMATRIX& world : worlds)
+	{
+		MeshBounds transformed;
+		BoundingVolumes::Transform(&transformed, bounds, world);
+		for (const XMFLOAT3& p : points)
+		{
+			XMFLOAT3 w;
+			XMStoreFloat3(&w, XMVector3Transform(XMLoadFloat3(&p), world));
+			CHECK(BoxContains(transformed.box, w) && SphereContains(transformed.sphere, w) && OrientedBoxContains(transformed.orientedBox, w));
+		}
+	}
+}
@@ -0,0 +1,103 @@
+#include "TestHarness.h"
+#include "MeshCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	MeshData MakeMesh()
+	{
+		MeshData data;
+		for (int i = 0; i < 5; i++)
+		{
+			Vertex v = {};
+			v.Position = DirectX::XMFLOAT3((float)i, (float)(i * i), -1.0f);
+			v.UV = DirectX::XMFLOAT2(i * 0.25f, 0.5f);
+			data.vertices.push_back(v);
+		}
+		data.indices = { 0, 1, 2, 2, 1, 3, 3, 1, 4 };
+		data.submeshes = { { "stone", 0, 6 }, { "wood", 6, 3 } };
+		return data;
+	}
+}
+
+TEST(CacheRoundTrips)
+{
+	MeshData data = MakeMesh();
+	CHECK(MeshCacheFile::Write("MeshCacheTest.meshbin", data, 1234, 99));
+
+	MeshCacheFile cache("MeshCacheTest.meshbin", 1234, 99);
+	CHECK(cache.IsValid());
+	if (!cache.IsValid())
+		return;
+
+	const MeshCacheHeader* header = cache.GetHeader();
+	CHECK(header->vertexCount == 5 && header->indexCount == 9);
+	CHECK(header->vertexOffset == sizeof(MeshCacheHeader));
+	CHECK(header->indexOffset == sizeof(MeshCacheHeader) + 5 * sizeof(Vertex));
+	CHECK(header->boundsMax.y == 16.0f);
+	CHECK(memcmp(cache.GetVertices(), data.vertices.data(), 5 * sizeof(Vertex)) == 0);
+	CHECK(memcmp(cache.GetIndices(), data.indices.data(), 9 * sizeof(unsigned int)) == 0);
+	CHECK(cache.GetSubmeshes().size() == 2 && cache.GetSubmeshes()[1].material == "wood");
+}
+
+TEST(StaleOrTruncatedCachesAreInvalid)
+{
+	CHECK(MeshCacheFile::Write("MeshCacheTest.meshbin", MakeMesh(), 1234, 99));
+	CHECK(!MeshCacheFile("MeshCacheTest.meshbin", 4321, 99).IsValid());
+	CHECK(!MeshCacheFile("MeshCacheTest.meshbin", 1234, 99, MeshImportAngleWeightedTangents).IsValid());
+
+	// Every prefix of the file is missing something
+	std::ifstream in("MeshCacheTest.meshbin", std::ios::binary);
+	std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	bool allInvalid = true;
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		TestHarness::WriteFile("MeshCacheTruncated.meshbin", bytes.data(), size);
+		allInvalid = allInvalid && !MeshCacheFile("MeshCacheTruncated.meshbin", 1234, 99).IsValid();
+	}
+	CHECK(allInvalid);
+
+	// Offsets near 2^64, which would wrap if a size were added to them first
+	MeshCacheHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	header.indexOffset = ~0ull - 3;
+	memcpy(bytes.data(), &header, sizeof(header));
+	TestHarness::WriteFile("MeshCacheTruncated.meshbin", bytes.data(), bytes.size());
+	CHECK(!MeshCacheFile("MeshCacheTruncated.meshbin", 1234, 99).IsValid());
+}
+
+TEST(SinkWritesTheSameCacheBlockByBlock)
+{
+	MeshData data = MakeMesh();
+	{
+		// Empty runs are dropped, and a material that carries on past one is merged
+		MeshCacheSink sink("MeshCacheSink.meshbin", 1234, 99);
+		CHECK(sink.IsOpen());
+		sink.BeginSubmesh("stone");
+		sink.Append(&data.vertices[0], 3, &data.indices[0], 3);
+		sink.BeginSubmesh("wood");
+		sink.BeginSubmesh("stone");
+		sink.Append(&data.vertices[3], 2, &data.indices[3], 3);
+		sink.BeginSubmesh("wood");
+		sink.Append(0, 0, &data.indices[6], 3);
+		CHECK(sink.Finish());
+	}
+
+	std::ifstream written("MeshCacheSink.meshbin", std::ios::binary), expected;
+	CHECK(MeshCacheFile::Write("MeshCacheTest.meshbin", data, 1234, 99));
+	expected.open("MeshCacheTest.meshbin", std::ios::binary);
+	std::string a((std::istreambuf_iterator<char>(written)), std::istreambuf_iterator<char>());
+	std::string b((std::istreambuf_iterator<char>(expected)), std::istreambuf_iterator<char>());
+	CHECK(a == b);
+
+	// A sink that never finishes leaves nothing that loads
+	{
+		MeshCacheSink sink("MeshCacheSink.meshbin", 1234, 99);
+		sink.Append(&data.vertices[0], 5, &data.indices[0], 9);
+	}
+	CHECK(!MeshCacheFile("MeshCacheSink.meshbin", 1234, 99).IsValid());
+	CHECK(!std::ifstream("MeshCacheSink.meshbin.indices").is_open());
+}
@@ -0,0 +1,104 @@
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times MeshCodec's decoders on a grid mesh, against a plain
+// memcpy of the raw arrays (what a .meshbin load costs once
+// the file is mapped).
+//
+// Usage: MeshCodecBenchmark [grid size]
+// The default 708 x 708 grid of quads is ~1M triangles.
+// MeshCodecScalarBenchmark is the same, without SSSE3.
+// --------------------------------------------------------
+namespace
+{
+	// A wavy grid in row order, which is what OptimizeVertexFetch() leaves a grid in
+	void MakeGrid(int size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		for (int y = 0; y <= size; y++)
+			for (int x = 0; x <= size; x++)
+			{
+				float fx = x / (float)size, fy = y / (float)size;
+				Vertex v = {};
+				v.Position = XMFLOAT3(fx * 10.0f - 5.0f, 0.25f * std::sin(fx * 20.0f) * std::cos(fy * 20.0f), fy * 10.0f - 5.0f);
+				v.UV = XMFLOAT2(fx, fy);
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVectorSet(-std::cos(fx * 20.0f) * 0.5f, 1.0f, std::sin(fy * 20.0f) * 0.5f, 0.0f)));
+				XMStoreFloat3(&v.Tangent, XMVector3Normalize(XMVectorSet(1.0f, std::cos(fx * 20.0f) * 0.5f, 0.0f, 0.0f)));
+				vertices.push_back(v);
+			}
+		for (int y = 0; y < size; y++)
+			for (int x = 0; x < size; x++)
+			{
+				unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 2, d = a + size + 1;
+				indices.insert(indices.end(), { a, c, b, a, d, c });
+			}
+	}
+
+	// Best of a few runs, in seconds
+	template <typename Function>
+	double Time(Function function)
+	{
+		double best = 1e30;
+		for (int run = 0; run < 5; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			function();
+			best = (std::min)(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	void Report(const char* name, size_t rawBytes, size_t encodedBytes, double seconds, double copySeconds)
+	{
+		printf("%-9s %6.1f MB -> %6.1f MB (%.2f:1)  decode %7.2f ms  (%6.0f MB/s of output, %.1fx memcpy's time)\n",
+			name, rawBytes / 1e6, encodedBytes / 1e6, rawBytes / (double)encodedBytes,
+			seconds * 1000.0, rawBytes / seconds / 1e6, seconds / copySeconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int size = argc > 1 ? atoi(argv[1]) : 708;
+	if (size < 1)
+	{
+		printf("Usage: MeshCodecBenchmark [grid size]\n");
+		return 1;
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	MakeGrid(size, vertices, indices);
+	printf("%d x %d grid: %zu vertices, %zu triangles\n", size, size, vertices.size(), indices.size() / 3);
+
+	std::vector<unsigned char> encodedVertices, encodedIndices;
+	MeshCodec::EncodeVertices(encodedVertices, vertices.data(), vertices.size());
+	MeshCodec::EncodeIndices(encodedIndices, indices.data(), indices.size());
+
+	std::vector<Vertex> decodedVertices(vertices.size());
+	std::vector<unsigned int> decodedIndices(indices.size());
+	size_t vertexBytes = vertices.size() * sizeof(Vertex), indexBytes = indices.size() * sizeof(unsigned int);
+
+	double vertexCopy = Time([&] { memcpy(decodedVertices.data(), vertices.data(), vertexBytes); });
+	double indexCopy = Time([&] { memcpy(decodedIndices.data(), indices.data(), indexBytes); });
+	double vertexDecode = Time([&] { MeshCodec::DecodeVertices(decodedVertices.data(), vertices.size(), encodedVertices.data(), encodedVertices.size()); });
+	double indexDecode = Time([&] { MeshCodec::DecodeIndices(decodedIndices.data(), indices.size(), encodedIndices.data(), encodedIndices.size()); });
+
+	if (memcmp(decodedVertices.data(), vertices.data(), vertexBytes) != 0 || decodedIndices != indices)
+	{
+		printf("Decoded data doesn't match!\n");
+		return 1;
+	}
+
+	Report("Vertices", vertexBytes, encodedVertices.size(), vertexDecode, vertexCopy);
+	Report("Indices", indexBytes, encodedIndices.size(), indexDecode, indexCopy);
+	return 0;
+}
@@ -0,0 +1,206 @@
+#include "TestHarness.h"
+#include "MeshCodec.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+// Built twice: as MeshCodecTests with SSSE3 enabled, and as MeshCodecScalarTests
+// with MESH_CODEC_NO_SIMD, so both decoders see the same cases
+
+using namespace DirectX;
+
+namespace
+{
+	// Indices with small steps, big jumps both ways and the extremes of 32 bits,
+	// so every byte length (and the zigzag sign) gets used
+	std::vector<unsigned int> MakeIndices(size_t count)
+	{
+		std::mt19937 random(11);
+		std::vector<unsigned int> indices(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			switch (random() % 6)
+			{
+			case 0: indices[i] = (unsigned int)i; break;
+			case 1: indices[i] = i > 0 ? indices[i - 1] + 1 : 0; break;
+			case 2: indices[i] = i > 0 ? indices[i - 1] - 300 : 0; break;
+			case 3: indices[i] = (unsigned int)random(); break;
+			case 4: indices[i] = 0xFFFFFFFF; break;
+			default: indices[i] = (unsigned int)(random() & 0xFFFFFF); break;
+			}
+		}
+		return indices;
+	}
+
+	// Neighboring vertices on a grid (how real meshes look after OptimizeVertexFetch()),
+	// with random bits, -0 and a NaN mixed in
+	std::vector<Vertex> MakeVertices(size_t count)
+	{
+		std::mt19937 random(13);
+		std::vector<Vertex> vertices(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			Vertex& v = vertices[i];
+			float x = (float)(i % 17), z = (float)(i / 17);
+			v.Position = XMFLOAT3(x * 0.1f, std::sin(x) * std::cos(z), z * 0.1f);
+			v.UV = XMFLOAT2(x / 16.0f, z / 16.0f);
+			v.Normal = XMFLOAT3(0, 1, 0);
+			v.Tangent = XMFLOAT3(1, 0, -0.0f);
+			if (i % 5 == 3)
+			{
+				unsigned int bits = (unsigned int)random();
+				memcpy(&v.Position.y, &bits, sizeof(bits));
+			}
+		}
+		if (count > 2)
+			vertices[2].UV.x = std::numeric_limits<float>::quiet_NaN();
+		return vertices;
+	}
+
+	std::vector<unsigned int> RoundTripIndices(const std::vector<unsigned int>& indices)
+	{
+		std::vector<unsigned char> encoded;
+		MeshCodec::EncodeIndices(encoded, indices.data(), indices.size());
+		std::vector<unsigned int> decoded(indices.size() + 1, 0xCDCDCDCD);
+		MeshCodec::DecodeIndices(decoded.data(), indices.size(), encoded.data(), encoded.size());
+		CHECK(decoded.back() == 0xCDCDCDCD); // Nothing written past the end
+		decoded.pop_back();
+		return decoded;
+	}
+
+	std::vector<unsigned char> EncodeIndices(const std::vector<unsigned int>& indices)
+	{
+		std::vector<unsigned char> encoded;
+		MeshCodec::EncodeIndices(encoded, indices.data(), indices.size());
+		return encoded;
+	}
+
+	// A decode the tests expect to throw
+	void DecodeIndices(const std::vector<unsigned char>& encoded, size_t count)
+	{
+		std::vector<unsigned int> decoded(count);
+		MeshCodec::DecodeIndices(decoded.data(), count, encoded.data(), encoded.size());
+	}
+}
+
+TEST(IndicesRoundTripAtEveryCountModFour)
+{
+	// 0-9 cover every remainder with and without a full group of 4 ahead of it
+	for (size_t count : { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 1001, 65538 })
+	{
+		std::vector<unsigned int> indices = MakeIndices(count);
+		CHECK(RoundTripIndices(indices) == indices);
+	}
+}
+
+TEST(IndicesAreDeltasFromThePreviousIndex)
+{
+	// A running sum: sequential indices are all 1 byte deltas, whatever their size
+	std::vector<unsigned int> indices(1000);
+	for (size_t i = 0; i < indices.size(); i++)
+		indices[i] = 4000000000u + (unsigned int)i;
+	CHECK(RoundTripIndices(indices) == indices);
+
+	std::vector<unsigned char> encoded = EncodeIndices(indices);
+	CHECK(encoded.size() == 250 + 4 + 999 + 16); // Control, first index, 999 steps, padding
+
+	// Going down as well as up, across the wraparound
+	std::vector<unsigned int> wrapping = { 3, 2, 1, 0, 0xFFFFFFFF, 0xFFFFFFFE, 0, 1, 0x80000000, 0x7FFFFFFF, 5 };
+	CHECK(RoundTripIndices(wrapping) == wrapping);
+}
+
+TEST(VerticesRoundTripBitForBit)
+{
+	// A vertex is 11 words, so these end on every word count mod 4, and the
+	// first groups of 4 straddle the first vertex (words with nothing 11 back)
+	for (size_t count : { 1, 2, 3, 4, 5, 7, 100, 4099 })
+	{
+		std::vector<Vertex> vertices = MakeVertices(count);
+		std::vector<unsigned char> encoded;
+		MeshCodec::EncodeVertices(encoded, vertices.data(), vertices.size());
+
+		std::vector<Vertex> decoded(count + 1);
+		memset(decoded.data(), 0xCD, decoded.size() * sizeof(Vertex));
+		MeshCodec::DecodeVertices(decoded.data(), count, encoded.data(), encoded.size());
+
+		CHECK(memcmp(decoded.data(), vertices.data(), count * sizeof(Vertex)) == 0);
+		unsigned char past[sizeof(Vertex)];
+		memset(past, 0xCD, sizeof(past));
+		CHECK(memcmp(&decoded[count], past, sizeof(past)) == 0);
+	}
+}
+
+TEST(VerticesAreDeltasFromThePreviousVertex)
+{
+	// Identical vertices cost a byte per word after the first
+	std::vector<Vertex> vertices(64, MakeVertices(1)[0]);
+	std::vector<unsigned char> encoded;
+	MeshCodec::EncodeVertices(encoded, vertices.data(), vertices.size());
+
+	size_t words = vertices.size() * sizeof(Vertex) / 4;
+	CHECK(encoded.size() <= (words + 3) / 4 + sizeof(Vertex) + (words - sizeof(Vertex) / 4) + 16);
+}
+
+TEST(TruncatedDataThrows)
+{
+	std::vector<unsigned int> indices = MakeIndices(103);
+	std::vector<unsigned char> encoded = EncodeIndices(indices);
+
+	// Anything short of the whole encoding - into the padding, the data or the control bytes
+	for (size_t size : { encoded.size() - 1, encoded.size() - 16, encoded.size() - 17, (size_t)30, (size_t)16, (size_t)0 })
+	{
+		std::vector<unsigned char> truncated(encoded.begin(), encoded.begin() + size);
+		CHECK_THROWS(DecodeIndices(truncated, indices.size()), std::runtime_error);
+	}
+
+	// Or decoding more words than were encoded
+	CHECK_THROWS(DecodeIndices(encoded, indices.size() + 4), std::runtime_error);
+
+	// Vertices go through the same checks
+	std::vector<Vertex> vertices = MakeVertices(9);
+	std::vector<unsigned char> encodedVertices;
+	MeshCodec::EncodeVertices(encodedVertices, vertices.data(), vertices.size());
+	encodedVertices.pop_back();
+	std::vector<Vertex> decoded(vertices.size());
+	CHECK_THROWS(MeshCodec::DecodeVertices(decoded.data(), decoded.size(), encodedVertices.data(), encodedVertices.size()), std::runtime_error);
+}
+
+TEST(CorruptControlBytesThrow)
+{
+	std::vector<unsigned int> indices = MakeIndices(103);
+	std::vector<unsigned char> encoded = EncodeIndices(indices);
+
+	// Changing any word's length changes the data length the control bytes add up to
+	for (size_t c = 0; c < (indices.size() + 3) / 4; c++)
+	{
+		std::vector<unsigned char> corrupt = encoded;
+		corrupt[c] ^= (corrupt[c] & 3) == 3 ? 1 : 3;
+		CHECK_THROWS(DecodeIndices(corrupt, indices.size()), std::runtime_error);
+	}
+}
+
+TEST(MeshzFilesRoundTripWithSubmeshes)
+{
+	MeshData data;
+	data.vertices = MakeVertices(50);
+	for (unsigned int i = 0; i < 48; i++)
+		data.indices.push_back((i * 7) % 50);
+	data.submeshes = { { "stone", 0, 30 }, { "grass", 30, 18 } };
+	CHECK(MeshCodec::Write("MeshCodecTest.meshz", data, 5));
+
+	MeshData read;
+	unsigned int importFlags = 0;
+	MeshCodec::Read("MeshCodecTest.meshz", read, &importFlags);
+	CHECK(importFlags == 5);
+	CHECK(read.vertices.size() == data.vertices.size() && memcmp(read.vertices.data(), data.vertices.data(), data.vertices.size() * sizeof(Vertex)) == 0);
+	CHECK(read.indices == data.indices);
+	CHECK(read.submeshes.size() == 2 && read.submeshes[1].material == "grass" && read.submeshes[1].firstIndex == 30);
+
+	// An index past the vertices is caught after decoding
+	data.indices[47] = 50;
+	CHECK(MeshCodec::Write("MeshCodecTest.meshz", data));
+	CHECK_THROWS(MeshCodec::Read("MeshCodecTest.meshz", read), std::runtime_error);
+}
@@ -0,0 +1,166 @@
+#include "TestHarness.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// A wavy size x size grid of quads, with its triangles in row order or shuffled
+	MeshData MakeGrid(int size, bool shuffled)
+	{
+		MeshData data;
+		for (int y = 0; y <= size; y++)
+			for (int x = 0; x <= size; x++)
+			{
+				float fx = x / (float)size, fy = y / (float)size;
+				Vertex v = {};
+				v.Position = XMFLOAT3(fx * 10.0f - 5.0f, 0.25f * std::sin(fx * 20.0f) * std::cos(fy * 20.0f), fy * 10.0f - 5.0f);
+				v.UV = XMFLOAT2(fx, fy);
+				v.Normal = XMFLOAT3(0, 1, 0);
+				data.vertices.push_back(v);
+			}
+
+		std::vector<std::array<unsigned int, 3>> triangles;
+		for (int y = 0; y < size; y++)
+			for (int x = 0; x < size; x++)
+			{
+				unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 2, d = a + size + 1;
+				triangles.push_back({ a, c, b });
+				triangles.push_back({ a, d, c });
+			}
+		if (shuffled)
+			std::shuffle(triangles.begin(), triangles.end(), std::mt19937(3));
+		for (const std::array<unsigned int, 3>& t : triangles)
+			data.indices.insert(data.indices.end(), t.begin(), t.end());
+		return data;
+	}
+
+	// A triangle by its corners' UVs (unique to each vertex here, so they
+	// survive renumbering), rotated to start at the smallest, keeping its winding
+	typedef std::array<std::pair<float, float>, 3> TriangleKey;
+
+	std::vector<TriangleKey> SortedTriangles(const MeshData& data, size_t firstIndex, size_t indexCount)
+	{
+		std::vector<TriangleKey> triangles;
+		for (size_t i = firstIndex; i + 2 < firstIndex + indexCount; i += 3)
+		{
+			TriangleKey t;
+			for (int k = 0; k < 3; k++)
+				t[k] = { data.vertices[data.indices[i + k]].UV.x, data.vertices[data.indices[i + k]].UV.y };
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+			triangles.push_back(t);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	bool SameTriangles(const MeshData& a, const MeshData& b)
+	{
+		return SortedTriangles(a, 0, a.indices.size()) == SortedTriangles(b, 0, b.indices.size());
+	}
+
+	VertexCacheStatistics Analyze(const MeshData& data)
+	{
+		return MeshOptimizer::AnalyzeVertexCache(data.indices.data(), data.indices.size(), data.vertices.size());
+	}
+}
+
+TEST(OptimizingKeepsEveryTriangleAndItsWinding)
+{
+	for (bool shuffled : { false, true })
+	{
+		for (bool reduceOverdraw : { false, true })
+		{
+			MeshData original = MakeGrid(60, shuffled);
+			MeshData optimized = original;
+			MeshOptimizer::Optimize(optimized, reduceOverdraw);
+
+			CHECK(optimized.indices.size() == original.indices.size());
+			CHECK(SameTriangles(optimized, original));
+
+			// Only renumbered: the same vertices, none added
+			CHECK(optimized.vertices.size() == original.vertices.size());
+			auto byUV = [](const Vertex& a, const Vertex& b) { return std::make_pair(a.UV.x, a.UV.y) < std::make_pair(b.UV.x, b.UV.y); };
+			std::vector<Vertex> before = original.vertices, after = optimized.vertices;
+			std::sort(before.begin(), before.end(), byUV);
+			std::sort(after.begin(), after.end(), byUV);
+			CHECK(memcmp(before.data(), after.data(), before.size() * sizeof(Vertex)) == 0);
+		}
+	}
+}
+
+TEST(OptimizingLowersAcmrAndAtvr)
+{
+	// Row order already reuses each row's vertices, but not the row before's once it's
+	// out of the cache. Shuffled, hardly anything is reused
+	for (bool shuffled : { false, true })
+	{
+		MeshData data = MakeGrid(60, shuffled);
+		VertexCacheStatistics before = Analyze(data);
+		MeshOptimizer::Optimize(data, false);
+		VertexCacheStatistics after = Analyze(data);
+		CHECK(after.acmr < before.acmr && after.atvr < before.atvr);
+		CHECK(after.acmr < 0.8f);
+		if (shuffled)
+			CHECK(before.acmr > 2.0f);
+	}
+
+	// Overdraw ordering may give a little of that back, but no more than its threshold
+	MeshData cacheOnly = MakeGrid(60, true), withOverdraw = cacheOnly;
+	MeshOptimizer::Optimize(cacheOnly, false);
+	MeshOptimizer::Optimize(withOverdraw, true);
+	CHECK(Analyze(withOverdraw).acmr <= Analyze(cacheOnly).acmr * 1.05f + 0.01f);
+}
+
+TEST(UnusedVerticesAreDropped)
+{
+	MeshData data = MakeGrid(8, true);
+	size_t used = data.vertices.size();
+	Vertex unused = {};
+	unused.UV = XMFLOAT2(5.0f, 5.0f);
+	data.vertices.insert(data.vertices.begin() + 10, unused);
+	for (unsigned int& index : data.indices)
+		index += index >= 10;
+	MeshData original = data;
+
+	MeshOptimizer::Optimize(data);
+	CHECK(data.vertices.size() == used);
+	CHECK(SameTriangles(data, original));
+
+	// And fetch order is first use order
+	unsigned int next = 0;
+	bool inOrder = true;
+	for (unsigned int index : data.indices)
+	{
+		inOrder = inOrder && index <= next;
+		next = (std::max)(next, index + 1);
+	}
+	CHECK(inOrder);
+}
+
+TEST(TrianglesStayInTheirSubmesh)
+{
+	MeshData data = MakeGrid(30, true);
+	unsigned int third = (unsigned int)(data.indices.size() / 9 * 3);
+	data.submeshes = { { "a", 0, third }, { "b", third, third }, { "a", third * 2, (unsigned int)data.indices.size() - third * 2 } };
+	MeshData original = data;
+	MeshOptimizer::Optimize(data);
+
+	// The two "a" runs become one range, holding exactly their triangles
+	CHECK(data.submeshes.size() == 2);
+	if (data.submeshes.size() != 2)
+		return;
+	std::vector<TriangleKey> a = SortedTriangles(original, 0, third), b = SortedTriangles(original, third, third);
+	std::vector<TriangleKey> aRest = SortedTriangles(original, third * 2, original.indices.size() - third * 2);
+	a.insert(a.end(), aRest.begin(), aRest.end());
+	std::sort(a.begin(), a.end());
+	CHECK(SortedTriangles(data, data.submeshes[0].firstIndex, data.submeshes[0].indexCount) == a);
+	CHECK(SortedTriangles(data, data.submeshes[1].firstIndex, data.submeshes[1].indexCount) == b);
+}
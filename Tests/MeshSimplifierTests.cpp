@@ -0,0 +1,204 @@
+#include "TestHarness.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// A size x size grid of unit quads in the z = 0 plane, cut
+	// by a UV seam down the column x = seam: the vertices there
+	// are split in two, with the left side's UVs running 0 - 0.5
+	// and the right side's starting over from 0.75
+	// --------------------------------------------------------
+	struct SeamedPlane
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<bool> rightSide; // Per vertex, which side of the seam it's on
+		int size, seam;
+
+		SeamedPlane(int size, int seam) : size(size), seam(seam)
+		{
+			std::vector<unsigned int> left((size + 1) * (size + 1)), right((size + 1) * (size + 1));
+			for (int y = 0; y <= size; y++)
+				for (int x = 0; x <= size; x++)
+				{
+					Vertex v = {};
+					v.Position = XMFLOAT3((float)x, (float)y, 0.0f);
+					v.Normal = XMFLOAT3(0, 0, -1);
+					int i = y * (size + 1) + x;
+					if (x <= seam)
+						left[i] = Add(v, XMFLOAT2(x * 0.5f / seam, y / (float)size), false);
+					if (x >= seam)
+						right[i] = Add(v, XMFLOAT2(0.75f + (x - seam) * 0.25f / (size - seam), y / (float)size), true);
+				}
+
+			for (int y = 0; y < size; y++)
+				for (int x = 0; x < size; x++)
+				{
+					const std::vector<unsigned int>& side = x < seam ? left : right;
+					unsigned int a = side[y * (size + 1) + x], b = side[y * (size + 1) + x + 1];
+					unsigned int c = side[(y + 1) * (size + 1) + x + 1], d = side[(y + 1) * (size + 1) + x];
+					indices.insert(indices.end(), { a, c, b, a, d, c });
+				}
+		}
+
+		unsigned int Add(Vertex v, XMFLOAT2 uv, bool right)
+		{
+			v.UV = uv;
+			vertices.push_back(v);
+			rightSide.push_back(right);
+			return (unsigned int)vertices.size() - 1;
+		}
+
+		// Bumps, so every collapse costs something
+		void AddBumps()
+		{
+			for (Vertex& v : vertices)
+				v.Position.z = 0.3f * std::sin(v.Position.x * 0.7f) * std::cos(v.Position.y * 0.9f);
+		}
+	};
+
+	typedef std::pair<float, float> Point;
+	typedef std::pair<Point, Point> Edge;
+
+	Point At(const Vertex& v) { return { v.Position.x, v.Position.y }; }
+
+	// Edges (by position, either way round) used by only one triangle
+	std::set<Edge> OpenEdges(const std::vector<unsigned int>& indices, size_t indexCount, const std::vector<Vertex>& vertices)
+	{
+		std::map<Edge, int> uses;
+		for (size_t i = 0; i < indexCount; i += 3)
+			for (size_t k = 0; k < 3; k++)
+			{
+				Point a = At(vertices[indices[i + k]]), b = At(vertices[indices[i + (k + 1) % 3]]);
+				uses[{ (std::min)(a, b), (std::max)(a, b) }]++;
+			}
+		std::set<Edge> open;
+		for (const auto& edge : uses)
+			if (edge.second == 1)
+				open.insert(edge.first);
+		return open;
+	}
+
+	// Area of each side's triangles in the xy plane, signed so flipped ones count against it
+	void SideAreas(const SeamedPlane& plane, const std::vector<unsigned int>& indices, size_t indexCount, double areas[2])
+	{
+		areas[0] = areas[1] = 0.0;
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			Point a = At(plane.vertices[indices[i]]), b = At(plane.vertices[indices[i + 1]]), c = At(plane.vertices[indices[i + 2]]);
+			double cross = (b.first - a.first) * (c.second - a.second) - (b.second - a.second) * (c.first - a.first);
+			areas[plane.rightSide[indices[i]]] -= cross * 0.5; // Clockwise seen from -z
+		}
+	}
+}
+
+TEST(LodsMeetTheirTargets)
+{
+	SeamedPlane plane(48, 24);
+	plane.AddBumps();
+	std::vector<MeshSimplifier::Lod> lods = MeshSimplifier::BuildLodChain(plane.indices.data(), plane.indices.size(),
+		plane.vertices.data(), plane.vertices.size(), 8, 0.5f);
+
+	// Each level targets half of the one before, and only ends up with a triangle fewer
+	// if its last collapse took out two at once. Once the locked border is most of what's
+	// left, levels fall short, and the chain stops when one shrinks by less than a quarter
+	CHECK(lods.size() >= 4 && lods.size() < 8);
+	size_t previous = plane.indices.size() / 3;
+	for (size_t level = 0; level < lods.size(); level++)
+	{
+		const MeshSimplifier::Lod& lod = lods[level];
+		size_t triangles = lod.indices.size() / 3;
+		size_t target = previous / 2;
+		CHECK(lod.indices.size() % 3 == 0);
+		CHECK(triangles <= previous * 3 / 4);
+		if (level < 4)
+			CHECK(triangles <= target && triangles + 1 >= target);
+
+		bool valid = true;
+		for (size_t i = 0; i < lod.indices.size(); i += 3)
+		{
+			unsigned int a = lod.indices[i], b = lod.indices[i + 1], c = lod.indices[i + 2];
+			valid = valid && a < plane.vertices.size() && b < plane.vertices.size() && c < plane.vertices.size() && a != b && b != c && a != c;
+		}
+		CHECK(valid);
+		previous = triangles;
+	}
+}
+
+TEST(LodErrorsGrowLevelByLevel)
+{
+	SeamedPlane plane(24, 12);
+	plane.AddBumps();
+	std::vector<MeshSimplifier::Lod> lods = MeshSimplifier::BuildLodChain(plane.indices.data(), plane.indices.size(),
+		plane.vertices.data(), plane.vertices.size(), 5, 0.5f);
+	CHECK(lods.size() >= 3);
+
+	float previous = 0.0f;
+	for (const MeshSimplifier::Lod& lod : lods)
+	{
+		CHECK(lod.error > previous);
+		previous = lod.error;
+	}
+
+	// A tight limit ends the chain sooner, with every level inside it (as a fraction of the 24 unit plane)
+	std::vector<MeshSimplifier::Lod> tight = MeshSimplifier::BuildLodChain(plane.indices.data(), plane.indices.size(),
+		plane.vertices.data(), plane.vertices.size(), 5, 0.01f);
+	CHECK(tight.size() < lods.size());
+	for (const MeshSimplifier::Lod& lod : tight)
+		CHECK(lod.error <= 0.01f * 24.0f * tight.size());
+}
+
+TEST(BordersAndSeamsHold)
+{
+	// Flat, so nothing stops the plane collapsing as far as the locks let it
+	SeamedPlane plane(16, 6);
+	std::vector<unsigned int> simplified(plane.indices.size());
+	float error = -1.0f;
+	size_t count = MeshSimplifier::Simplify(simplified.data(), plane.indices.data(), plane.indices.size(),
+		plane.vertices.data(), plane.vertices.size(), 0, 1.0f, &error);
+	CHECK(count > 0 && count < plane.indices.size() / 4);
+	CHECK(error == 0.0f);
+
+	// The outline is every one of the original border edges, so no border vertex moved
+	CHECK(OpenEdges(simplified, count, plane.vertices) == OpenEdges(plane.indices, plane.indices.size(), plane.vertices));
+
+	// No triangle mixes the two sides' UVs
+	bool oneSide = true;
+	for (size_t i = 0; i < count; i += 3)
+		oneSide = oneSide && plane.rightSide[simplified[i]] == plane.rightSide[simplified[i + 1]] &&
+			plane.rightSide[simplified[i]] == plane.rightSide[simplified[i + 2]];
+	CHECK(oneSide);
+
+	// Each side still covers exactly its half, and the two meet along the whole seam with
+	// the same edges: seam vertices can only slide along the seam, both sides together
+	double areas[2];
+	SideAreas(plane, simplified, count, areas);
+	CHECK(std::fabs(areas[0] - 6.0 * 16.0) < 1e-3 && std::fabs(areas[1] - 10.0 * 16.0) < 1e-3);
+
+	std::set<Edge> seams[2];
+	for (int side = 0; side < 2; side++)
+	{
+		std::vector<unsigned int> sideIndices;
+		for (size_t i = 0; i < count; i += 3)
+			if (plane.rightSide[simplified[i]] == (side == 1))
+				sideIndices.insert(sideIndices.end(), &simplified[i], &simplified[i] + 3);
+		for (const Edge& e : OpenEdges(sideIndices, sideIndices.size(), plane.vertices))
+			if (e.first.first == plane.seam && e.second.first == plane.seam)
+				seams[side].insert(e);
+	}
+	CHECK(!seams[0].empty() && seams[0] == seams[1]);
+	double seamLength = 0.0;
+	for (const Edge& e : seams[0])
+		seamLength += e.second.second - e.first.second;
+	CHECK(std::fabs(seamLength - 16.0) < 1e-3);
+}
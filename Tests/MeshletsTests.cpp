@@ -0,0 +1,257 @@
+#include "TestHarness.h"
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+using namespace DirectX;
+
+namespace
+{
+	typedef std::array<unsigned int, 3> Triangle;
+
+	// A size x size grid of quads in the z = depth plane, wound clockwise as seen
+	// from -z (so facing a camera there, looking down +z), or from +z when flipped
+	void AddGrid(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, int size, float depth, bool flipped = false)
+	{
+		unsigned int first = (unsigned int)vertices.size();
+		for (int y = 0; y <= size; y++)
+			for (int x = 0; x <= size; x++)
+			{
+				Vertex v = {};
+				v.Position = XMFLOAT3(x / (float)size * 2.0f - 1.0f, y / (float)size * 2.0f - 1.0f, depth);
+				vertices.push_back(v);
+			}
+		for (int y = 0; y < size; y++)
+			for (int x = 0; x < size; x++)
+			{
+				unsigned int a = first + y * (size + 1) + x, b = a + 1, c = a + size + 2, d = a + size + 1;
+				if (flipped)
+					indices.insert(indices.end(), { a, b, c, a, c, d });
+				else
+					indices.insert(indices.end(), { a, c, b, a, d, c });
+			}
+	}
+
+	// Rotated so its smallest index comes first, which keeps the winding
+	Triangle Canonical(const unsigned int* t)
+	{
+		int first = (int)(std::min_element(t, t + 3) - t);
+		return { t[first], t[(first + 1) % 3], t[(first + 2) % 3] };
+	}
+
+	std::vector<Triangle> SortedTriangles(const unsigned int* indices, size_t indexCount)
+	{
+		std::vector<Triangle> triangles;
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+			triangles.push_back(Canonical(&indices[i]));
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// Every meshlet is within the limits and packed back to back, and the meshlets
+	// hold each of the mesh's triangles exactly once, with the same winding
+	bool IsValidSplit(const MeshletData& data, const std::vector<unsigned int>& indices, unsigned int maxVertices, unsigned int maxTriangles)
+	{
+		unsigned int vertexOffset = 0, triangleOffset = 0;
+		for (const Meshlet& m : data.meshlets)
+		{
+			if (m.vertexCount == 0 || m.vertexCount > maxVertices || m.triangleCount == 0 || m.triangleCount > maxTriangles)
+				return false;
+			if (m.vertexOffset != vertexOffset || m.triangleOffset != triangleOffset)
+				return false;
+			for (unsigned int i = 0; i < m.triangleCount * 3; i++)
+				if (data.triangles[m.triangleOffset + i] >= m.vertexCount)
+					return false;
+			vertexOffset += m.vertexCount;
+			triangleOffset += m.triangleCount * 3;
+		}
+		if (vertexOffset != data.vertices.size() || triangleOffset != data.triangles.size())
+			return false;
+
+		std::vector<unsigned int> unpacked(data.triangles.size());
+		Meshlets::Unpack(unpacked.data(), data);
+		return SortedTriangles(unpacked.data(), unpacked.size()) == SortedTriangles(indices.data(), indices.size());
+	}
+
+	XMVECTOR Position(const MeshletData& data, const std::vector<Vertex>& vertices, const Meshlet& m, unsigned int local)
+	{
+		return XMLoadFloat3(&vertices[data.vertices[m.vertexOffset + local]].Position);
+	}
+
+	// A camera at eye looking along direction, with a 60 degree field of view
+	struct TestCamera
+	{
+		XMFLOAT4X4 view, proj;
+		XMFLOAT3 position;
+
+		TestCamera(XMFLOAT3 eye, XMFLOAT3 direction) : position(eye)
+		{
+			XMStoreFloat4x4(&view, XMMatrixLookToLH(XMLoadFloat3(&eye), XMLoadFloat3(&direction), XMVectorSet(0, 1, 0, 0)));
+			XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PI / 3.0f, 1.0f, 0.1f, 100.0f));
+		}
+
+		size_t Cull(std::vector<unsigned int>& visible, const MeshletData& data, XMMATRIX world = XMMatrixIdentity())
+		{
+			XMFLOAT4X4 worldMatrix;
+			XMStoreFloat4x4(&worldMatrix, world);
+			return Meshlets::Cull(visible, data, worldMatrix, view, proj, position);
+		}
+	};
+}
+
+TEST(MeshletsStayWithinTheirLimits)
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	AddGrid(vertices, indices, 40, 0.0f);
+
+	// The defaults, tight limits where triangles run out first, and where vertices do
+	const unsigned int limits[][2] = { { Meshlets::MaxVertices, Meshlets::MaxTriangles }, { 16, 40 }, { 64, 8 }, { 3, 1 } };
+	for (const auto& limit : limits)
+	{
+		MeshletData data;
+		Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size(), limit[0], limit[1]);
+		CHECK(IsValidSplit(data, indices, limit[0], limit[1]));
+	}
+
+	// Grown from neighbors, a grid fills the default meshlets well
+	MeshletData data;
+	Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size());
+	CHECK(data.meshlets.size() <= indices.size() / 3 / 80);
+
+	CHECK_THROWS(Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size(), 2, 124), std::invalid_argument);
+	CHECK_THROWS(Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size(), 64, 0), std::invalid_argument);
+	CHECK_THROWS(Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size(), 257, 124), std::invalid_argument);
+}
+
+TEST(ShuffledTrianglesAreEachUsedOnce)
+{
+	// Out of order, so seeds come from all over and meshlets meet each other
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	AddGrid(vertices, indices, 30, 0.0f);
+	AddGrid(vertices, indices, 10, 1.0f, true);
+	std::vector<Triangle> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3)
+		triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(7));
+	indices.clear();
+	for (const Triangle& t : triangles)
+		indices.insert(indices.end(), t.begin(), t.end());
+
+	MeshletData data;
+	Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size());
+	CHECK(IsValidSplit(data, indices, Meshlets::MaxVertices, Meshlets::MaxTriangles));
+
+	// Nothing at all for an empty mesh
+	Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), 0);
+	CHECK(data.meshlets.empty() && data.vertices.empty() && data.triangles.empty());
+}
+
+TEST(BoundsHoldEveryVertexAndNormal)
+{
+	// A bumpy grid, so normals spread out a little
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	AddGrid(vertices, indices, 24, 0.0f);
+	for (Vertex& v : vertices)
+		v.Position.z = 0.05f * std::sin(v.Position.x * 9.0f) * std::cos(v.Position.y * 7.0f);
+
+	MeshletData data;
+	Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size(), 32, 40);
+	bool spheresHold = true, conesHold = true, anyCone = false;
+	for (const Meshlet& m : data.meshlets)
+	{
+		XMVECTOR center = XMLoadFloat3(&m.center);
+		for (unsigned int i = 0; i < m.vertexCount; i++)
+			spheresHold = spheresHold && XMVectorGetX(XMVector3Length(Position(data, vertices, m, i) - center)) <= m.radius * 1.0001f;
+
+		if (m.coneCutoff >= 1.0f)
+			continue;
+		anyCone = true;
+
+		// Each normal is within the cone, and the apex is behind each triangle's plane
+		XMVECTOR axis = XMLoadFloat3(&m.coneAxis), apex = XMLoadFloat3(&m.coneApex);
+		float minDot = std::sqrt(1.0f - m.coneCutoff * m.coneCutoff);
+		for (unsigned int t = 0; t < m.triangleCount; t++)
+		{
+			const unsigned char* tri = &data.triangles[m.triangleOffset + t * 3];
+			XMVECTOR p0 = Position(data, vertices, m, tri[0]);
+			XMVECTOR normal = XMVector3Normalize(XMVector3Cross(Position(data, vertices, m, tri[1]) - p0, Position(data, vertices, m, tri[2]) - p0));
+			conesHold = conesHold && XMVectorGetX(XMVector3Dot(normal, axis)) >= minDot - 1e-4f;
+			conesHold = conesHold && XMVectorGetX(XMVector3Dot(apex - p0, normal)) <= 1e-4f;
+		}
+	}
+	CHECK(spheresHold);
+	CHECK(conesHold && anyCone);
+
+	// A flat grid facing -z (7 x 7 quads, which fills one meshlet) gets a cone
+	// straight down that axis, with no spread at all
+	vertices.clear();
+	indices.clear();
+	AddGrid(vertices, indices, 7, 0.0f);
+	Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size());
+	CHECK(data.meshlets.size() == 1);
+	if (data.meshlets.size() == 1)
+	{
+		const Meshlet& m = data.meshlets[0];
+		CHECK(std::fabs(m.coneAxis.z + 1.0f) < 1e-5f && std::fabs(m.coneCutoff) < 1e-3f);
+		// The smallest sphere has radius sqrt(2), and the fast one can be a little bigger
+		CHECK(m.radius >= std::sqrt(2.0f) - 1e-4f && m.radius < std::sqrt(2.0f) * 1.2f);
+	}
+}
+
+TEST(BackFacingMeshletsAreCulled)
+{
+	// One grid facing -z, and one behind it facing +z, a meshlet each
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	AddGrid(vertices, indices, 7, 0.0f);
+	size_t frontTriangles = indices.size() / 3;
+	AddGrid(vertices, indices, 7, 1.0f, true);
+
+	MeshletData data;
+	Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size());
+	CHECK(data.meshlets.size() == 2 && data.meshlets[0].triangleCount == frontTriangles);
+
+	// From either side, only the grid facing the camera is kept
+	std::vector<unsigned int> visible;
+	CHECK(TestCamera(XMFLOAT3(0, 0, -5), XMFLOAT3(0, 0, 1)).Cull(visible, data) == 1 && visible[0] == 0);
+	CHECK(TestCamera(XMFLOAT3(0, 0, 6), XMFLOAT3(0, 0, -1)).Cull(visible, data) == 1 && visible[0] == 1);
+
+	// From the side, only the planes' sides the camera is on count: between them
+	// it sees the back of both, and just in front of the first it sees that one
+	CHECK(TestCamera(XMFLOAT3(-5, 0, 0.5f), XMFLOAT3(1, 0, 0)).Cull(visible, data) == 0);
+	CHECK(TestCamera(XMFLOAT3(-5, 0, -0.5f), XMFLOAT3(1, 0, 0)).Cull(visible, data) == 1 && visible[0] == 0);
+}
+
+TEST(MeshletsOutsideTheFrustumAreCulled)
+{
+	// Three grids facing -z: ahead of the camera, off to the side and behind it
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	AddGrid(vertices, indices, 7, 0.0f);
+	AddGrid(vertices, indices, 7, 0.0f);
+	AddGrid(vertices, indices, 7, -20.0f);
+	for (size_t v = vertices.size() / 3; v < vertices.size() * 2 / 3; v++)
+		vertices[v].Position.x += 30.0f;
+
+	MeshletData data;
+	Meshlets::Build(data, vertices.data(), vertices.size(), indices.data(), indices.size());
+	CHECK(data.meshlets.size() == 3);
+
+	std::vector<unsigned int> visible;
+	TestCamera camera(XMFLOAT3(0, 0, -5), XMFLOAT3(0, 0, 1));
+	CHECK(camera.Cull(visible, data) == 1 && visible[0] == 0);
+
+	// Turning the camera brings the one to the side in
+	CHECK(TestCamera(XMFLOAT3(0, 0, -5), XMFLOAT3(30, 0, 5)).Cull(visible, data) == 1 && visible[0] == 1);
+
+	// Meshlets are culled where the world matrix puts them
+	CHECK(camera.Cull(visible, data, XMMatrixTranslation(-30, 0, 0)) == 1 && visible[0] == 1);
+	CHECK(camera.Cull(visible, data, XMMatrixTranslation(0, 0, 200)) == 0);
+}
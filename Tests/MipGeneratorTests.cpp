@@ -0,0 +1,248 @@
+#include "TestHarness.h"
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+	const MipFilter Filters[] = { MipFilter::Box, MipFilter::Kaiser };
+
+	ImageData MakeImage(unsigned int width, unsigned int height, unsigned char value = 255)
+	{
+		ImageData image;
+		image.width = width;
+		image.height = height;
+		image.pixels.assign((size_t)width * height * 4, value);
+		return image;
+	}
+
+	unsigned char* PixelAt(ImageData& image, unsigned int x, unsigned int y) { return &image.pixels[((size_t)y * image.width + x) * 4]; }
+
+	// Black and white squares a pixel wide, in every channel
+	ImageData MakeCheckerboard(unsigned int size)
+	{
+		ImageData image = MakeImage(size, size);
+		for (unsigned int y = 0; y < size; y++)
+			for (unsigned int x = 0; x < size; x++)
+				std::fill(PixelAt(image, x, y), PixelAt(image, x, y) + 4, (x + y) % 2 ? 255 : 0);
+		return image;
+	}
+
+	// The sRGB transfer functions, written out rather than taken from the generator's tables
+	double SrgbToLinear(double value) { return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4); }
+	double LinearToSrgb(double value) { return value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1 / 2.4) - 0.055; }
+
+	// Whether every pixel of every level holds the given value in the given channels
+	bool IsFlat(const std::vector<ImageData>& mips, unsigned int firstChannel, unsigned int channelCount, unsigned char value)
+	{
+		for (const ImageData& level : mips)
+			for (size_t p = 0; p < level.pixels.size(); p += 4)
+				for (unsigned int c = firstChannel; c < firstChannel + channelCount; c++)
+					if (level.pixels[p + c] != value)
+						return false;
+		return true;
+	}
+
+	// Normals leaning alternately left and right, column by column, which average to straight out
+	ImageData MakeRidgedNormals(unsigned int size)
+	{
+		ImageData image = MakeImage(size, size);
+		for (unsigned int y = 0; y < size; y++)
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned char* pixel = PixelAt(image, x, y);
+				pixel[0] = x % 2 ? 218 : 37; // About 45 degrees either way
+				pixel[1] = 128;
+				pixel[2] = 218;
+			}
+		return image;
+	}
+
+	double NormalLength(const unsigned char* pixel)
+	{
+		double squared = 0;
+		for (unsigned int c = 0; c < 3; c++)
+			squared += (pixel[c] / 127.5 - 1) * (pixel[c] / 127.5 - 1);
+		return sqrt(squared);
+	}
+}
+
+TEST(LevelsShrinkDownToOnePixel)
+{
+	CHECK(MipGenerator::GetMipCount(1, 1) == 1);
+	CHECK(MipGenerator::GetMipCount(256, 256) == 9);
+	CHECK(MipGenerator::GetMipCount(300, 200) == 9);
+	CHECK(MipGenerator::GetMipCount(1, 7) == 3);
+
+	// Each level halves both sizes, rounding down, but never below 1
+	const unsigned int sizes[][2] = { { 64, 16 }, { 37, 5 }, { 1, 9 }, { 6, 6 } };
+	for (const unsigned int* size : sizes)
+	{
+		for (MipFilter filter : Filters)
+		{
+			MipOptions options;
+			options.filter = filter;
+			std::vector<ImageData> mips;
+			MipGenerator::Generate(MakeImage(size[0], size[1], 90), MipContent::Linear, mips, options);
+			CHECK(mips.size() == MipGenerator::GetMipCount(size[0], size[1]));
+
+			unsigned int width = size[0], height = size[1];
+			for (const ImageData& level : mips)
+			{
+				CHECK(level.width == width && level.height == height && level.pixels.size() == (size_t)width * height * 4);
+				width = (std::max)(width / 2, 1u);
+				height = (std::max)(height / 2, 1u);
+			}
+			CHECK(mips.back().width == 1 && mips.back().height == 1);
+
+			// Filter weights add up to 1, however the sizes divide
+			CHECK(IsFlat(mips, 0, 4, 90));
+		}
+	}
+
+	std::vector<ImageData> mips;
+	CHECK_THROWS(MipGenerator::Generate(MakeImage(0, 4), MipContent::Linear, mips), std::invalid_argument);
+}
+
+TEST(CheckerboardsAverageAsLinearLight)
+{
+	// Half black, half white is half the light - which is sRGB 188, not 128. Data and alpha
+	// are averaged as stored
+	MipOptions options;
+	options.filter = MipFilter::Box;
+	std::vector<ImageData> srgb, linear;
+	MipGenerator::Generate(MakeCheckerboard(8), MipContent::Srgb, srgb, options);
+	MipGenerator::Generate(MakeCheckerboard(8), MipContent::Linear, linear, options);
+	CHECK(srgb.size() == 4 && linear.size() == 4);
+	for (size_t level = 1; level < srgb.size(); level++)
+	{
+		CHECK(IsFlat({ srgb[level] }, 0, 3, 188));
+		CHECK(IsFlat({ srgb[level] }, 3, 1, 128));
+		CHECK(IsFlat({ linear[level] }, 0, 4, 128));
+	}
+
+	// The Kaiser filter sees the same average, give or take a little ringing
+	options.filter = MipFilter::Kaiser;
+	MipGenerator::Generate(MakeCheckerboard(8), MipContent::Srgb, srgb, options);
+	for (size_t p = 0; p < srgb[1].pixels.size(); p += 4)
+		CHECK(abs(srgb[1].pixels[p] - 188) <= 4 && abs(srgb[1].pixels[p + 3] - 128) <= 4);
+}
+
+TEST(SrgbLevelsMatchTheTransferFunction)
+{
+	// Level 0 is the image as given, and flat colors come through every level exactly
+	std::mt19937 random(3);
+	for (MipFilter filter : Filters)
+	{
+		MipOptions options;
+		options.filter = filter;
+		for (int i = 0; i < 20; i++)
+		{
+			unsigned char value = (unsigned char)random();
+			std::vector<ImageData> mips;
+			MipGenerator::Generate(MakeImage(12, 10, value), MipContent::Srgb, mips, options);
+			CHECK(IsFlat(mips, 0, 4, value));
+		}
+	}
+
+	// A box filtered 2x2 is the mean of its linear values, encoded again
+	MipOptions box;
+	box.filter = MipFilter::Box;
+	for (int i = 0; i < 50; i++)
+	{
+		ImageData image = MakeImage(2, 2);
+		for (unsigned char& value : image.pixels)
+			value = (unsigned char)random();
+
+		std::vector<ImageData> mips;
+		MipGenerator::Generate(image, MipContent::Srgb, mips, box);
+		CHECK(mips.size() == 2 && mips[0].pixels == image.pixels);
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			double sum = 0;
+			for (unsigned int p = 0; p < 4; p++)
+				sum += c < 3 ? SrgbToLinear(image.pixels[p * 4 + c] / 255.0) : image.pixels[p * 4 + c] / 255.0;
+			double expected = (c < 3 ? LinearToSrgb(sum / 4) : sum / 4) * 255;
+			CHECK(fabs(mips[1].pixels[c] - expected) <= 0.51);
+		}
+	}
+}
+
+TEST(NormalMapLevelsStayUnitLength)
+{
+	// Ridges cancel out sideways, leaving normals that face straight out
+	std::vector<ImageData> mips;
+	MipOptions box;
+	box.filter = MipFilter::Box;
+	MipGenerator::Generate(MakeRidgedNormals(8), MipContent::NormalMap, mips, box);
+	for (size_t level = 1; level < mips.size(); level++)
+		for (size_t p = 0; p < mips[level].pixels.size(); p += 4)
+			CHECK(abs(mips[level].pixels[p] - 128) <= 1 && abs(mips[level].pixels[p + 1] - 128) <= 1 && mips[level].pixels[p + 2] == 255);
+
+	// Random bumps come out renormalized at every level, with either filter
+	ImageData bumps = MakeImage(16, 16);
+	std::mt19937 random(7);
+	for (size_t p = 0; p < bumps.pixels.size(); p += 4)
+	{
+		bumps.pixels[p] = (unsigned char)(random() % 128 + 64);
+		bumps.pixels[p + 1] = (unsigned char)(random() % 128 + 64);
+		bumps.pixels[p + 2] = 255;
+	}
+	for (MipFilter filter : Filters)
+	{
+		MipOptions options;
+		options.filter = filter;
+		MipGenerator::Generate(bumps, MipContent::NormalMap, mips, options);
+		for (size_t level = 1; level < mips.size(); level++)
+			for (size_t p = 0; p < mips[level].pixels.size(); p += 4)
+				CHECK(fabs(NormalLength(&mips[level].pixels[p]) - 1) < 0.02);
+	}
+}
+
+TEST(OrmRoughnessWidensWhereNormalsDisagree)
+{
+	// Missing masks take their defaults, and smaller ones are scaled up to the largest
+	ImageData occlusion = MakeImage(8, 8, 200), roughness = MakeImage(4, 4, 100), packed;
+	TextureCompressor::PackOrm(&occlusion, &roughness, nullptr, packed);
+	CHECK(packed.width == 8 && packed.height == 8);
+	CHECK(packed.pixels[0] == 200 && packed.pixels[1] == 100 && packed.pixels[2] == 0 && packed.pixels[3] == 255);
+	TextureCompressor::PackOrm(nullptr, nullptr, &occlusion, packed);
+	CHECK(packed.pixels[0] == 255 && packed.pixels[1] == 255 && packed.pixels[2] == 200);
+	CHECK_THROWS(TextureCompressor::PackOrm(nullptr, nullptr, nullptr, packed), std::invalid_argument);
+	TextureCompressor::PackOrm(&occlusion, &roughness, nullptr, packed);
+
+	// A flat normal map, or none, leaves the ORM averaged as plain data
+	std::vector<ImageData> plain, flat, ridged;
+	ImageData flatNormals = MakeImage(8, 8);
+	for (size_t p = 0; p < flatNormals.pixels.size(); p += 4)
+		flatNormals.pixels[p] = flatNormals.pixels[p + 1] = 128;
+	TextureCompressor::GenerateMips(packed, TextureUsage::PackedOrm, plain);
+	TextureCompressor::GenerateMips(packed, TextureUsage::PackedOrm, flat, &flatNormals);
+	CHECK(plain.size() == 4 && IsFlat(plain, 1, 1, 100));
+	CHECK(flat.size() == plain.size());
+	for (size_t level = 0; level < flat.size() && level < plain.size(); level++)
+		CHECK(flat[level].pixels == plain[level].pixels);
+
+	// Ridges average away, so the levels above them get rougher - but only in green,
+	// and not level 0, where the normals still agree with themselves
+	ImageData ridges = MakeRidgedNormals(8);
+	TextureCompressor::GenerateMips(packed, TextureUsage::PackedOrm, ridged, &ridges);
+	CHECK(ridged.size() == 4 && ridged[0].pixels == packed.pixels);
+	CHECK(IsFlat(ridged, 0, 1, 200) && IsFlat(ridged, 2, 1, 0));
+	for (size_t level = 1; level < ridged.size(); level++)
+		for (size_t p = 0; p < ridged[level].pixels.size(); p += 4)
+			CHECK(ridged[level].pixels[p + 1] > 110);
+
+	// A normal map of a different size is matched up by texel coverage
+	std::vector<ImageData> larger;
+	ImageData largerRidges = MakeRidgedNormals(32);
+	TextureCompressor::GenerateMips(packed, TextureUsage::PackedOrm, larger, &largerRidges);
+	CHECK(larger.size() == 4 && larger[0].pixels[1] > 110);
+
+	CHECK_THROWS(MipGenerator::GenerateRoughness(packed, 4, flatNormals, plain), std::invalid_argument);
+}
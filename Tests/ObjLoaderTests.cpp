@@ -0,0 +1,394 @@
+#include "TestHarness.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	MeshData LoadText(const std::string& text, unsigned int threadCount = 1)
+	{
+		CHECK(TestHarness::WriteFile("ObjLoaderTest.obj", text));
+		MeshData data;
+		ObjLoader::Load("ObjLoaderTest.obj", data, threadCount);
+		return data;
+	}
+
+	const char* Square =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+		"vn 0 0 1\n";
+
+	// --------------------------------------------------------
+	// A size x size grid whose rows of positions and UVs are
+	// given just before the faces that first use them, so every
+	// window brings new attributes along. Every 5th row's quads
+	// are padded out to long lines, every 10th row is a single
+	// polygon strip, and odd corners use relative indices.
+	// --------------------------------------------------------
+	std::string MakeStreamingGrid(int size, const char* material = 0)
+	{
+		std::string text = "vn 0 0 1\n";
+		auto addRow = [&](int y)
+			{
+				for (int x = 0; x <= size; x++)
+					text += "v " + std::to_string(x * 0.01) + " " + std::to_string(y * 0.01) + " 0.5\nvt " +
+						std::to_string(x / (float)size) + " " + std::to_string(y / (float)size) + "\n";
+			};
+		auto corner = [&](int x, int y)
+			{
+				int index = y * (size + 1) + x + 1;
+				int defined = (std::min(y, size - 1) + 2) * (size + 1); // Rows written so far
+				std::string v = std::to_string(x % 2 ? index - defined - 1 : index);
+				return v + "/" + std::to_string(index) + "/1";
+			};
+
+		addRow(0);
+		for (int y = 0; y < size; y++)
+		{
+			addRow(y + 1);
+			if (material && y == size / 2)
+				text += std::string("usemtl ") + material + "\n";
+			if (y % 10 == 9)
+			{
+				text += "f";
+				for (int x = 0; x <= size; x++)
+					text += ' ' + corner(x, y);
+				for (int x = size; x >= 0; x--)
+					text += ' ' + corner(x, y + 1);
+				text += "\n";
+				continue;
+			}
+			for (int x = 0; x < size; x++)
+			{
+				std::string gap = y % 5 == 4 ? std::string(100, ' ') : " ";
+				text += "f " + corner(x, y) + gap + corner(x + 1, y) + gap + corner(x + 1, y + 1) + gap + corner(x, y + 1) + "\n";
+			}
+		}
+		return text;
+	}
+
+	// Collects a streaming import, counting the blocks it came in
+	class CountingSink : public MeshDataSink
+	{
+	public:
+		CountingSink(MeshData& data, size_t scratchPerCorner = 0) : MeshDataSink(data), scratchPerCorner(scratchPerCorner) {}
+
+		void Append(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) override
+		{
+			blocks++;
+			largestBlock = std::max(largestBlock, indexCount);
+			MeshDataSink::Append(vertices, vertexCount, indices, indexCount);
+		}
+
+		size_t GetScratchPerCorner() const override { return scratchPerCorner; }
+
+		size_t blocks = 0;
+		size_t largestBlock = 0;
+
+	private:
+		size_t scratchPerCorner;
+	};
+
+	MeshData StreamText(const std::string& text, size_t scratchBudget, size_t* blocks = 0)
+	{
+		CHECK(TestHarness::WriteFile("ObjLoaderTest.obj", text));
+		MeshData data;
+		CountingSink sink(data);
+		ObjLoader::LoadStreaming("ObjLoaderTest.obj", sink, scratchBudget);
+		if (blocks)
+			*blocks = sink.blocks;
+		return data;
+	}
+
+	// Whether both meshes have the same corners in the same order, however they're welded
+	bool SameCorners(const MeshData& a, const MeshData& b)
+	{
+		if (a.indices.size() != b.indices.size())
+			return false;
+		for (size_t i = 0; i < a.indices.size(); i++)
+			if (memcmp(&a.vertices[a.indices[i]], &b.vertices[b.indices[i]], sizeof(Vertex)) != 0)
+				return false;
+		return true;
+	}
+
+	// Just the indices of one submesh, with every vertex
+	MeshData SubmeshOf(const MeshData& data, const SubmeshRange& range)
+	{
+		MeshData submesh;
+		submesh.vertices = data.vertices;
+		submesh.indices.assign(data.indices.begin() + range.firstIndex, data.indices.begin() + range.firstIndex + range.indexCount);
+		return submesh;
+	}
+
+	bool SameMesh(const MeshData& a, const MeshData& b)
+	{
+		return a.indices == b.indices && a.vertices.size() == b.vertices.size() &&
+			memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0;
+	}
+}
+
+TEST(QuadIsFanTriangulatedAndWelded)
+{
+	MeshData data = LoadText(std::string(Square) + "f 1/1/1 2/2/1 3/3/1 4/4/1\n");
+	CHECK(data.vertices.size() == 4);
+	CHECK(data.indices.size() == 6);
+
+	// Winding is flipped for DirectX: (0, 2, 1), (0, 3, 2)
+	const unsigned int expected[] = { 0, 1, 2, 0, 3, 1 };
+	for (size_t i = 0; i < 6 && i < data.indices.size(); i++)
+		CHECK(data.indices[i] == expected[i]);
+
+	// Z and V are flipped into DirectX's conventions
+	CHECK(data.vertices[0].Normal.z == -1.0f);
+	CHECK(data.vertices[0].UV.y == 1.0f);
+}
+
+TEST(NegativeAndNormalOnlyIndicesMatchAbsoluteOnes)
+{
+	MeshData absolute = LoadText(std::string(Square) + "f 1//1 2//1 3//1\n");
+	MeshData relative = LoadText(std::string(Square) + "f -4//-1 -3//-1 -2//-1\n");
+	CHECK(absolute.vertices.size() == 3 && relative.vertices.size() == 3);
+	for (size_t i = 0; i < 3 && i < relative.vertices.size(); i++)
+	{
+		CHECK(absolute.vertices[i].Position.x == relative.vertices[i].Position.x);
+		CHECK(absolute.vertices[i].Position.y == relative.vertices[i].Position.y);
+		CHECK(relative.vertices[i].UV.x == 0.0f);
+	}
+}
+
+TEST(LongLinesAreNotCutOff)
+{
+	// The old loader read lines into 100 chars, so the last corner of this face was lost
+	std::string text = Square;
+	text += "f 1/1/1" + std::string(120, ' ') + "2/2/1 3/3/1 4/4/1\n";
+	CHECK(LoadText(text).indices.size() == 6);
+}
+
+TEST(IndicesTooBigForAnIntAreRejected)
+{
+	// Each one would overflow a signed accumulator
+	CHECK_THROWS(LoadText(std::string(Square) + "f 1 2 2147483648\n"), std::runtime_error);
+	CHECK_THROWS(LoadText(std::string(Square) + "f 1 2 -99999999999\n"), std::runtime_error);
+	CHECK_THROWS(LoadText(std::string(Square) + "f 1 2 3/123456789012345678901234567890\n"), std::runtime_error);
+
+	// Big but in range, so it's only out of range for this file
+	CHECK_THROWS(LoadText(std::string(Square) + "f 1 2 2147483647\n"), std::runtime_error);
+}
+
+TEST(ThreadCountDoesNotChangeTheResult)
+{
+	// Enough lines that the file is split into chunks (1 MB each, at least)
+	std::string text;
+	const int size = 300;
+	for (int y = 0; y <= size; y++)
+		for (int x = 0; x <= size; x++)
+			text += "v " + std::to_string(x * 0.01) + " " + std::to_string(y * 0.01) + " 0.5\nvt " +
+				std::to_string(x / (float)size) + " " + std::to_string(y / (float)size) + "\n";
+	text += "vn 0 0 1\n";
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+		{
+			int a = y * (size + 1) + x + 1, b = a + 1, c = a + size + 2, d = a + size + 1;
+			text += "f " + std::to_string(a) + "/" + std::to_string(a) + "/1 " + std::to_string(b) + "/" + std::to_string(b) +
+				"/1 " + std::to_string(c) + "/" + std::to_string(c) + "/1 -" + std::to_string((size + 1) * (size + 1) - d + 1) + "/" +
+				std::to_string(d) + "/1\n";
+		}
+
+	MeshData serial = LoadText(text, 1);
+	MeshData parallel = LoadText(text, 4);
+	CHECK(serial.vertices.size() == (size_t)(size + 1) * (size + 1));
+	CHECK(serial.indices == parallel.indices);
+	CHECK(serial.vertices.size() == parallel.vertices.size());
+	bool same = serial.vertices.size() == parallel.vertices.size();
+	for (size_t i = 0; same && i < serial.vertices.size(); i++)
+		same = memcmp(&serial.vertices[i], &parallel.vertices[i], sizeof(Vertex)) == 0;
+	CHECK(same);
+}
+
+TEST(StreamingMatchesLoadWithRoomToWeld)
+{
+	std::string text = MakeStreamingGrid(100);
+	MeshData loaded = LoadText(text);
+	size_t blocks = 0;
+	MeshData streamed = StreamText(text, ObjLoader::DefaultScratchBudget, &blocks);
+	CHECK(blocks == 1);
+	CHECK(SameMesh(loaded, streamed));
+}
+
+TEST(SmallBudgetsStreamInManyWindows)
+{
+	// The smallest budget (1 MB) holds ~3300 corners a window, and a weld table
+	// that starts over every 4096 vertices - this grid has ~60000 and ~10000
+	std::string text = MakeStreamingGrid(100);
+	MeshData loaded = LoadText(text);
+	size_t blocks = 0;
+	MeshData streamed = StreamText(text, 0, &blocks);
+	CHECK(blocks >= 18);
+
+	// Windows end between faces, so no face is lost or split, and restarting
+	// the weld table only ever adds duplicate vertices
+	CHECK(SameCorners(loaded, streamed));
+	CHECK(streamed.vertices.size() > loaded.vertices.size());
+	CHECK(streamed.vertices.size() < loaded.vertices.size() * 2);
+	CHECK(*std::max_element(streamed.indices.begin(), streamed.indices.end()) == streamed.vertices.size() - 1);
+}
+
+TEST(WindowsLeaveRoomForTheSinksScratch)
+{
+	CHECK(TestHarness::WriteFile("ObjLoaderTest.obj", MakeStreamingGrid(60)));
+	MeshData lean, greedy;
+	CountingSink leanSink(lean), greedySink(greedy, 69);
+	ObjLoader::LoadStreaming("ObjLoaderTest.obj", leanSink, 0);
+	ObjLoader::LoadStreaming("ObjLoaderTest.obj", greedySink, 0);
+
+	// Twice the bytes per corner, so windows of half as many corners
+	CHECK(greedySink.largestBlock <= leanSink.largestBlock / 2 + 3);
+	CHECK(greedySink.blocks >= leanSink.blocks * 2 - 1);
+	CHECK(SameCorners(lean, greedy));
+}
+
+TEST(StreamingKeepsToItsBudget)
+{
+	// Positions and UVs get half of the 1 MB minimum, which 50000 positions pass
+	std::string positions;
+	for (int i = 0; i < 50000; i++)
+		positions += "v " + std::to_string(i) + " 0 0\n";
+	CHECK_THROWS(StreamText(positions + "f 1 2 3\n", 0), std::runtime_error);
+	CHECK(StreamText(positions + "f 1 2 3\n", 4 << 20).indices.size() == 3);
+
+	// A face with more corners than a whole window holds
+	std::string face;
+	for (int i = 0; i < 2000; i++)
+		face += "v " + std::to_string(i) + " 1 0\n";
+	face += "f";
+	for (int i = 1; i <= 2000; i++)
+		face += ' ' + std::to_string(i);
+	CHECK_THROWS(StreamText(face, 0), std::runtime_error);
+	CHECK(StreamText(face, 4 << 20).indices.size() == 1998 * 3);
+}
+
+TEST(StreamedMaterialsAndCachesMatchLoad)
+{
+	std::string text = std::string("usemtl stone\n") + MakeStreamingGrid(100, "grass");
+	MeshData loaded = LoadText(text);
+	MeshData streamed = StreamText(text, 0);
+	CHECK(loaded.submeshes.size() == 2 && streamed.submeshes.size() == 2);
+	for (size_t s = 0; s < 2 && s < streamed.submeshes.size(); s++)
+	{
+		CHECK(streamed.submeshes[s].material == loaded.submeshes[s].material);
+		CHECK(streamed.submeshes[s].firstIndex == loaded.submeshes[s].firstIndex);
+		CHECK(streamed.submeshes[s].indexCount == loaded.submeshes[s].indexCount);
+	}
+
+	// Straight into a .meshbin, which comes out the same as collecting the blocks
+	MeshCacheSink sink("ObjLoaderTest.meshbin", 1, 2, MeshImportStreamed);
+	CHECK(sink.IsOpen());
+	ObjLoader::LoadStreaming("ObjLoaderTest.obj", sink, 0);
+	CHECK(sink.Finish());
+
+	MeshCacheFile cache("ObjLoaderTest.meshbin", 1, 2, MeshImportStreamed);
+	CHECK(cache.IsValid());
+	if (!cache.IsValid())
+		return;
+	MeshData cached;
+	cached.vertices.assign(cache.GetVertices(), cache.GetVertices() + cache.GetHeader()->vertexCount);
+	cached.indices.assign(cache.GetIndices(), cache.GetIndices() + cache.GetHeader()->indexCount);
+	CHECK(SameMesh(cached, streamed));
+	CHECK(cache.GetSubmeshes().size() == 2 && cache.GetSubmeshes()[1].material == "grass");
+	CHECK(cache.GetSubmeshes()[1].firstIndex == streamed.submeshes[1].firstIndex);
+	CHECK(!MeshCacheFile("ObjLoaderTest.meshbin", 1, 2).IsValid());
+}
+
+TEST(EachMaterialGetsOneSubmesh)
+{
+	// Faces before any usemtl, two materials used twice each, and a material with no faces
+	std::string faces[] = { "f 1 2 3\n", "f 1 3 4\n", "f 2 3 4\nf 1 2 4\n", "f 1 2 3 4\n", "f 4 3 1\n" };
+	MeshData data = LoadText(std::string(Square) + faces[0] + "usemtl stone\n" + faces[1] + "usemtl grass\n" + faces[2] +
+		"usemtl stone\n" + faces[3] + "usemtl unused\nusemtl grass\n" + faces[4]);
+
+	// Runs of the same material are merged in order of first use, and the empty one is dropped
+	CHECK(data.submeshes.size() == 3);
+	if (data.submeshes.size() != 3)
+		return;
+	const char* materials[] = { "", "stone", "grass" };
+	const unsigned int firstIndices[] = { 0, 3, 12 };
+	const unsigned int indexCounts[] = { 3, 9, 9 };
+	for (size_t s = 0; s < 3; s++)
+	{
+		CHECK(data.submeshes[s].material == materials[s]);
+		CHECK(data.submeshes[s].firstIndex == firstIndices[s] && data.submeshes[s].indexCount == indexCounts[s]);
+	}
+	CHECK(data.indices.size() == 21);
+
+	// Each holds its runs' triangles, in file order
+	MeshData stone = LoadText(std::string(Square) + faces[1] + faces[3]);
+	MeshData grass = LoadText(std::string(Square) + faces[2] + faces[4]);
+	CHECK(SameCorners(SubmeshOf(data, data.submeshes[1]), stone));
+	CHECK(SameCorners(SubmeshOf(data, data.submeshes[2]), grass));
+}
+
+TEST(GroupByMaterialMovesWholeRuns)
+{
+	MeshData data;
+	for (unsigned int i = 0; i < 18; i++)
+		data.indices.push_back(i);
+	data.submeshes = { { "a", 0, 3 }, { "b", 3, 6 }, { "a", 9, 3 }, { "c", 12, 0 }, { "b", 12, 6 } };
+	MeshOptimizer::GroupByMaterial(data);
+
+	const unsigned int expected[] = { 0, 1, 2, 9, 10, 11, 3, 4, 5, 6, 7, 8, 12, 13, 14, 15, 16, 17 };
+	CHECK(data.indices == std::vector<unsigned int>(expected, expected + 18));
+	CHECK(data.submeshes.size() == 2);
+	if (data.submeshes.size() == 2)
+	{
+		CHECK(data.submeshes[0].material == "a" && data.submeshes[0].firstIndex == 0 && data.submeshes[0].indexCount == 6);
+		CHECK(data.submeshes[1].material == "b" && data.submeshes[1].firstIndex == 6 && data.submeshes[1].indexCount == 12);
+	}
+
+	// Already grouped data, and data without submeshes, is left alone
+	MeshData grouped = data;
+	MeshOptimizer::GroupByMaterial(grouped);
+	CHECK(grouped.indices == data.indices && grouped.submeshes.size() == 2);
+	data.submeshes.clear();
+	MeshOptimizer::GroupByMaterial(data);
+	CHECK(data.indices == std::vector<unsigned int>(expected, expected + 18) && data.submeshes.empty());
+}
+
+TEST(FilesWithoutMaterialsAreOneUnnamedSubmesh)
+{
+	MeshData data = LoadText(std::string(Square) + "f 1 2 3 4\nf 1 3 4\n");
+	CHECK(data.submeshes.empty());
+
+	// Which a Mesh draws as a single submesh covering everything
+	std::vector<SubmeshRange> ranges = GetSubmeshRanges(data.submeshes.data(), data.submeshes.size(), (unsigned int)data.indices.size());
+	CHECK(ranges.size() == 1 && ranges[0].material.empty() && ranges[0].firstIndex == 0 && ranges[0].indexCount == 9);
+	CHECK(FindSubmeshByMaterial(ranges, "") == 0);
+}
+
+TEST(SubmeshesAreFoundByMaterial)
+{
+	// What Mesh::FindSubmesh() does with the submeshes it makes from these ranges
+	MeshData data = LoadText(std::string(Square) + "f 1 2 3\nusemtl stone\nf 1 3 4\nusemtl grass\nf 2 3 4\nusemtl stone\nf 1 2 4\n");
+	std::vector<SubmeshRange> ranges = GetSubmeshRanges(data.submeshes.data(), data.submeshes.size(), (unsigned int)data.indices.size());
+	CHECK(ranges.size() == 3);
+	CHECK(FindSubmeshByMaterial(ranges, "") == 0);
+	CHECK(FindSubmeshByMaterial(ranges, "stone") == 1);
+	CHECK(FindSubmeshByMaterial(ranges, "grass") == 2);
+	CHECK(FindSubmeshByMaterial(ranges, "Stone") == -1 && FindSubmeshByMaterial(ranges, "gravel") == -1);
+
+	// Ranges that leave gaps, overlap, split triangles or are empty can't be drawn
+	std::vector<SubmeshRange> bad[] =
+	{
+		{ { "a", 0, 3 }, { "b", 6, 6 } },
+		{ { "a", 0, 6 }, { "b", 3, 9 } },
+		{ { "a", 0, 4 }, { "b", 4, 8 } },
+		{ { "a", 0, 0 }, { "b", 0, 12 } },
+		{ { "a", 0, 9 } },
+		{ { "a", 0, 15 } },
+	};
+	for (const std::vector<SubmeshRange>& submeshes : bad)
+		CHECK_THROWS(GetSubmeshRanges(submeshes.data(), submeshes.size(), 12), std::invalid_argument);
+}
@@ -0,0 +1,84 @@
+#include "PngDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Times PngDecoder on real textures: each file decoded on
+// its own, then all of them at once through LoadAll().
+//
+// Usage: PngDecoderBenchmark [.png files...]
+// With no files, it decodes the .png textures in Assets/.
+// --------------------------------------------------------
+namespace
+{
+	const char* DefaultTextures[] =
+	{
+		"diamond_metalness.png", "diamond_roughness.png", "metal46_metalness.png",
+		"metal46_roughness.png", "metal49_albedo.png", "metal49_metalness.png",
+		"metal49_roughness.png", "onyx_roughness.png", "wood_roughness.png",
+	};
+
+	// Best of a few runs, in seconds
+	template <typename Function>
+	double Time(Function function)
+	{
+		double best = 1e30;
+		for (int run = 0; run < 5; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			function();
+			best = (std::min)(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	long long FileSize(const std::string& path)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		if (!file)
+			return -1;
+		fseek(file, 0, SEEK_END);
+		long long size = ftell(file);
+		fclose(file);
+		return size;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+		paths.push_back(argv[i]);
+	if (paths.empty())
+		for (const char* name : DefaultTextures)
+			paths.push_back(std::string(TEXTURE_DIR) + name);
+
+	double totalSeconds = 0.0;
+	for (const std::string& path : paths)
+	{
+		long long size = FileSize(path);
+		if (size < 0)
+		{
+			printf("Can't open %s\nUsage: PngDecoderBenchmark [.png files...]\n", path.c_str());
+			return 1;
+		}
+
+		ImageData image;
+		double seconds = Time([&] { PngDecoder::Load(path.c_str(), image); });
+		size_t pixels = (size_t)image.width * image.height;
+		printf("%-40s %5u x %-5u %6.1f MB -> %6.1f MB  %7.2f ms  (%6.0f MB/s of output)\n",
+			path.substr(path.find_last_of("/\\") + 1).c_str(), image.width, image.height,
+			size / 1e6, pixels * 4 / 1e6, seconds * 1000.0, pixels * 4 / seconds / 1e6);
+		totalSeconds += seconds;
+	}
+
+	std::vector<ImageData> images;
+	double parallelSeconds = Time([&] { PngDecoder::LoadAll(paths, images); });
+	printf("%zu files: %.2f ms one at a time, %.2f ms with LoadAll() (%.1fx)\n",
+		paths.size(), totalSeconds * 1000.0, parallelSeconds * 1000.0, totalSeconds / parallelSeconds);
+	return 0;
+}
@@ -0,0 +1,286 @@
+#include "TestHarness.h"
+#include "PngDecoder.h"
+
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+// --------------------------------------------------------
+// The .png files in Data/ are tiny images whose samples come
+// from Sample() below. Row n of each file (counting across
+// Adam7 passes) uses scanline filter n % 5, so every file
+// has every filter type:
+//   palette4_5x3.png         4-bit palette, 16 entries, tRNS
+//   graya8_4x4.png           8-bit gray + alpha
+//   rgba16_3x2.png           16-bit RGBA
+//   gray1_10x2.png           1-bit gray
+//   rgb8_interlaced_9x7.png  8-bit RGB, Adam7
+//   gray8_filters_7x5.png    8-bit gray (1 byte per pixel)
+//   rgb8_filters_7x5.png     8-bit RGB (3 bytes per pixel)
+//   rgba8_filters_7x5.png    8-bit RGBA (4 bytes per pixel)
+// --------------------------------------------------------
+namespace
+{
+	unsigned char Sample(unsigned int x, unsigned int y, unsigned int channel)
+	{
+		return (unsigned char)(x * 29 + y * 53 + channel * 97 + x * y * 7);
+	}
+
+	std::string DataPath(const char* name) { return std::string(TEST_DATA_DIR) + name; }
+
+	std::string ReadData(const char* name)
+	{
+		std::ifstream file(DataPath(name), std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	ImageData Load(const char* name)
+	{
+		ImageData image;
+		PngDecoder::Load(DataPath(name).c_str(), image);
+		return image;
+	}
+
+	// Whether every pixel is what expected(x, y, rgba) says it should be
+	template <typename Expected>
+	bool HasPixels(const ImageData& image, unsigned int width, unsigned int height, Expected expected)
+	{
+		if (image.width != width || image.height != height || image.pixels.size() != (size_t)width * height * 4)
+			return false;
+		for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned char rgba[4];
+				expected(x, y, rgba);
+				if (memcmp(&image.pixels[((size_t)y * width + x) * 4], rgba, 4) != 0)
+					return false;
+			}
+		return true;
+	}
+
+	// Sample() in every channel present, with the rest filled in the way the decoder does
+	void Color(unsigned int x, unsigned int y, unsigned char* rgba, unsigned int channels)
+	{
+		for (unsigned int c = 0; c < 4; c++)
+			rgba[c] = c < channels ? Sample(x, y, c) : 255;
+	}
+
+	// --------------------------------------------------------
+	// Builds PNGs in memory for the malformed cases. The image
+	// data goes in a stored (uncompressed) deflate block, so a
+	// test can put anything it likes in the scanlines. CRCs and
+	// the zlib checksum are left zero, which the decoder allows.
+	// --------------------------------------------------------
+	struct PngBuilder
+	{
+		std::string file = std::string("\x89PNG\r\n\x1A\n", 8);
+
+		void Chunk(const char* type, const std::string& data)
+		{
+			unsigned int length = (unsigned int)data.size();
+			file += { (char)(length >> 24), (char)(length >> 16), (char)(length >> 8), (char)length };
+			file += std::string(type, 4) + data + std::string(4, '\0');
+		}
+
+		void Header(unsigned int width, unsigned int height, unsigned char bitDepth, unsigned char colorType)
+		{
+			std::string header;
+			for (unsigned int value : { width, height })
+				header += { (char)(value >> 24), (char)(value >> 16), (char)(value >> 8), (char)value };
+			header += { (char)bitDepth, (char)colorType, 0, 0, 0 };
+			Chunk("IHDR", header);
+		}
+
+		void Stored(const std::string& scanlines)
+		{
+			unsigned int length = (unsigned int)scanlines.size();
+			std::string zlib = { 0x78, 0x01, 0x01 };
+			zlib += { (char)length, (char)(length >> 8), (char)~length, (char)(~length >> 8) };
+			Chunk("IDAT", zlib + scanlines + std::string(4, '\0'));
+		}
+
+		ImageData Decode()
+		{
+			ImageData image;
+			PngDecoder::Decode((const unsigned char*)file.data(), file.size(), image);
+			return image;
+		}
+	};
+
+	// A 2x2 8-bit gray image with the given scanlines, and any chunks before its data
+	ImageData DecodeGray(const std::string& scanlines, const char* chunkType = nullptr, const std::string& chunk = "")
+	{
+		PngBuilder png;
+		png.Header(2, 2, 8, 0);
+		if (chunkType)
+			png.Chunk(chunkType, chunk);
+		png.Stored(scanlines);
+		png.Chunk("IEND", "");
+		return png.Decode();
+	}
+
+	void DecodeData(const std::string& data)
+	{
+		ImageData image;
+		PngDecoder::Decode((const unsigned char*)data.data(), data.size(), image);
+	}
+}
+
+TEST(EveryFilterTypeIsUndone)
+{
+	// 1, 3 and 4 bytes per pixel, where the last two take the SSE2 paths
+	CHECK(HasPixels(Load("gray8_filters_7x5.png"), 7, 5, [](unsigned int x, unsigned int y, unsigned char* rgba)
+		{
+			rgba[0] = rgba[1] = rgba[2] = Sample(x, y, 0);
+			rgba[3] = 255;
+		}));
+	CHECK(HasPixels(Load("rgb8_filters_7x5.png"), 7, 5, [](unsigned int x, unsigned int y, unsigned char* rgba) { Color(x, y, rgba, 3); }));
+	CHECK(HasPixels(Load("rgba8_filters_7x5.png"), 7, 5, [](unsigned int x, unsigned int y, unsigned char* rgba) { Color(x, y, rgba, 4); }));
+}
+
+TEST(PaletteImagesUseTheirTransparency)
+{
+	// Entry i is (17i, 255 - 17i, 53i), and only the first four have alpha in tRNS
+	const unsigned char alpha[4] = { 0, 85, 170, 200 };
+	CHECK(HasPixels(Load("palette4_5x3.png"), 5, 3, [&](unsigned int x, unsigned int y, unsigned char* rgba)
+		{
+			unsigned int i = (x * 3 + y * 5) % 16;
+			rgba[0] = (unsigned char)(i * 17);
+			rgba[1] = (unsigned char)(255 - i * 17);
+			rgba[2] = (unsigned char)(i * 53);
+			rgba[3] = i < 4 ? alpha[i] : 255;
+		}));
+}
+
+TEST(GrayImagesFillEveryChannel)
+{
+	CHECK(HasPixels(Load("graya8_4x4.png"), 4, 4, [](unsigned int x, unsigned int y, unsigned char* rgba)
+		{
+			rgba[0] = rgba[1] = rgba[2] = Sample(x, y, 0);
+			rgba[3] = Sample(x, y, 1);
+		}));
+
+	// Low bit depths are scaled up to the full range
+	CHECK(HasPixels(Load("gray1_10x2.png"), 10, 2, [](unsigned int x, unsigned int y, unsigned char* rgba)
+		{
+			rgba[0] = rgba[1] = rgba[2] = (x + y) % 3 == 0 ? 255 : 0;
+			rgba[3] = 255;
+		}));
+}
+
+TEST(SixteenBitSamplesKeepTheirHighByte)
+{
+	// The low bytes are the high bytes ^ 0xA5, so they'd show if used
+	CHECK(HasPixels(Load("rgba16_3x2.png"), 3, 2, [](unsigned int x, unsigned int y, unsigned char* rgba) { Color(x, y, rgba, 4); }));
+}
+
+TEST(InterlacedPassesLandInPlace)
+{
+	// 9x7 leaves some of Adam7's passes partly or entirely empty
+	CHECK(HasPixels(Load("rgb8_interlaced_9x7.png"), 9, 7, [](unsigned int x, unsigned int y, unsigned char* rgba) { Color(x, y, rgba, 3); }));
+}
+
+TEST(LoadAllMatchesLoad)
+{
+	const char* names[] = { "palette4_5x3.png", "graya8_4x4.png", "rgba16_3x2.png", "rgb8_interlaced_9x7.png", "rgba8_filters_7x5.png" };
+	std::vector<std::string> paths;
+	for (const char* name : names)
+		paths.push_back(DataPath(name));
+
+	std::vector<ImageData> images;
+	PngDecoder::LoadAll(paths, images);
+	CHECK(images.size() == paths.size());
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		ImageData single = Load(names[i]);
+		CHECK(images[i].width == single.width && images[i].height == single.height && images[i].pixels == single.pixels);
+	}
+
+	// A missing file fails the whole call
+	paths.push_back("NoSuchImage.png");
+	CHECK_THROWS(PngDecoder::LoadAll(paths, images), std::invalid_argument);
+}
+
+TEST(TruncatedFilesThrow)
+{
+	// Cut anywhere - the signature, a chunk header, the image data or IEND
+	for (const char* name : { "rgb8_interlaced_9x7.png", "palette4_5x3.png" })
+	{
+		std::string data = ReadData(name);
+		for (size_t size = 0; size < data.size(); size++)
+		{
+			if (size < 8)
+				CHECK_THROWS(DecodeData(data.substr(0, size)), std::invalid_argument);
+			else
+				CHECK_THROWS(DecodeData(data.substr(0, size)), std::runtime_error);
+		}
+		DecodeData(data);
+	}
+}
+
+TEST(CorruptFilesThrow)
+{
+	// The builder's image decodes, so it's each change below that's caught
+	const std::string rows = std::string("\0\x10\x20\0\x30\x40", 6);
+	CHECK(DecodeGray(rows).pixels[4] == 0x20);
+
+	// Scanlines: an unknown filter type, one short, one extra
+	CHECK_THROWS(DecodeGray(std::string("\x05\x10\x20\0\x30\x40", 6)), std::runtime_error);
+	CHECK_THROWS(DecodeGray(rows.substr(0, 5)), std::runtime_error);
+	CHECK_THROWS(DecodeGray(rows + '\0'), std::runtime_error);
+
+	// Chunks: unknown critical ones, a bad palette, tRNS entries with no palette entry
+	CHECK_THROWS(DecodeGray(rows, "ABCD", "data"), std::runtime_error);
+	CHECK(DecodeGray(rows, "abCD", "data").pixels[4] == 0x20);
+	CHECK_THROWS(DecodeGray(rows, "PLTE", "\x01\x02"), std::runtime_error);
+	CHECK_THROWS(DecodeGray(rows, "IHDR", std::string(13, '\x01')), std::runtime_error);
+
+	PngBuilder palette;
+	palette.Header(2, 2, 8, 3);
+	palette.Chunk("PLTE", "\x01\x02\x03");
+	palette.Chunk("tRNS", "\x01\x02");
+	palette.Stored(std::string(6, '\0'));
+	palette.Chunk("IEND", "");
+	CHECK_THROWS(palette.Decode(), std::runtime_error);
+
+	// Headers: a color type and bit depth that don't go together, an empty image,
+	// a palette image with no palette, and data before the header
+	for (unsigned char colorType : { 2, 3, 9 })
+	{
+		PngBuilder png;
+		png.Header(2, 2, colorType == 3 ? 8 : 4, colorType);
+		png.Stored(std::string(6, '\0'));
+		png.Chunk("IEND", "");
+		CHECK_THROWS(png.Decode(), std::runtime_error);
+	}
+	PngBuilder empty;
+	empty.Header(0, 2, 8, 0);
+	empty.Chunk("IEND", "");
+	CHECK_THROWS(empty.Decode(), std::runtime_error);
+	PngBuilder headerless;
+	headerless.Stored(rows);
+	headerless.Chunk("IEND", "");
+	CHECK_THROWS(headerless.Decode(), std::runtime_error);
+
+	// Deflate: block type 3 doesn't exist, and a stored block's length must match its complement
+	std::string data = ReadData("rgb8_filters_7x5.png");
+	size_t idat = data.find("IDAT") + 4;
+	std::string badType = data;
+	badType[idat + 2] = (char)0x07;
+	CHECK_THROWS(DecodeData(badType), std::runtime_error);
+
+	PngBuilder stored;
+	stored.Header(2, 2, 8, 0);
+	stored.Stored(rows);
+	stored.Chunk("IEND", "");
+	stored.file[stored.file.find("IDAT") + 4 + 5] ^= 1;
+	CHECK_THROWS(stored.Decode(), std::runtime_error);
+
+	// Not a PNG at all, or not there
+	CHECK_THROWS(DecodeData("GIF89a and more bytes than any signature"), std::invalid_argument);
+	ImageData image;
+	CHECK_THROWS(PngDecoder::Load("NoSuchImage.png", image), std::invalid_argument);
+}
@@ -0,0 +1,112 @@
+#include "TestHarness.h"
+#include "ObjLoader.h"
+#include "ProceduralMesh.h"
+
+#include <cmath>
+#include <string>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Each shape against the OBJ it replaces, from
+	// Assets/Meshes. uPeriod and vPeriod are how far apart two
+	// UVs can be and still sample the same texel (0 if they
+	// can't wrap), so seam vertices match either side
+	// --------------------------------------------------------
+	struct ObjShape
+	{
+		const char* file;
+		ProceduralShape shape;
+		float uPeriod;
+		float vPeriod;
+	};
+
+	MeshData LoadObj(const char* file)
+	{
+		MeshData data;
+		ObjLoader::Load((std::string(MESH_DIR) + file).c_str(), data);
+		return data;
+	}
+
+	MeshData GenerateDefault(ProceduralShape shape)
+	{
+		MeshData data;
+		ProceduralMesh::Generate(data, ProceduralMesh::Default(shape));
+		return data;
+	}
+
+	float WrappedDistance(float a, float b, float period)
+	{
+		return period > 0 ? fabsf(remainderf(a - b, period)) : fabsf(a - b);
+	}
+
+	// Whether some generated vertex is where the OBJ's is, facing the same way, with the same UV
+	bool HasMatch(const Vertex& target, const MeshData& generated, const ObjShape& shape, float positionTolerance, float uvTolerance)
+	{
+		for (const Vertex& v : generated.vertices)
+		{
+			XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&v.Position), XMLoadFloat3(&target.Position));
+			if (XMVectorGetX(XMVector3Length(offset)) > positionTolerance ||
+				XMVectorGetX(XMVector3Dot(XMLoadFloat3(&v.Normal), XMLoadFloat3(&target.Normal))) < 0.5f)
+				continue;
+			if (WrappedDistance(v.UV.x, target.UV.x, shape.uPeriod) <= uvTolerance && WrappedDistance(v.UV.y, target.UV.y, shape.vPeriod) <= uvTolerance)
+				return true;
+		}
+		return false;
+	}
+
+	// The OBJ vertices with no generated match
+	size_t CountUnmatched(const MeshData& obj, const MeshData& generated, const ObjShape& shape, float positionTolerance, float uvTolerance)
+	{
+		size_t unmatched = 0;
+		for (const Vertex& v : obj.vertices)
+			if (!HasMatch(v, generated, shape, positionTolerance, uvTolerance))
+				unmatched++;
+		return unmatched;
+	}
+
+	// Triangles on a flat cap, where all three corners share one normal
+	size_t CountFlatTriangles(const MeshData& data)
+	{
+		size_t flat = 0;
+		for (size_t i = 0; i + 2 < data.indices.size(); i += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&data.vertices[data.indices[i]].Normal);
+			XMVECTOR b = XMLoadFloat3(&data.vertices[data.indices[i + 1]].Normal);
+			XMVECTOR c = XMLoadFloat3(&data.vertices[data.indices[i + 2]].Normal);
+			if (XMVectorGetX(XMVector3Dot(a, b)) > 0.9999f && XMVectorGetX(XMVector3Dot(a, c)) > 0.9999f)
+				flat++;
+		}
+		return flat;
+	}
+}
+
+TEST(SphereAndTorusMatchTheirObjs)
+{
+	// The sphere's texture wraps twice around, and its poles have one vertex per
+	// triangle, halfway across it in U - so the counts and UVs come out the same
+	const ObjShape shapes[] = { { "sphere.obj", ProceduralShape::Sphere, 2, 0 }, { "torus.obj", ProceduralShape::Torus, 1, 1 } };
+	for (const ObjShape& shape : shapes)
+	{
+		MeshData obj = LoadObj(shape.file), generated = GenerateDefault(shape.shape);
+		CHECK(obj.vertices.size() == generated.vertices.size());
+		CHECK(obj.indices.size() == generated.indices.size());
+		CHECK(CountUnmatched(obj, generated, shape, 2e-3f, 1e-3f) == 0);
+	}
+}
+
+TEST(HelixTubeMatchesItsObj)
+{
+	// The OBJ's end caps are triangulated without a center vertex, and it splits its tube's
+	// vertices along extra UV seams, so only the tube's triangles are counted. The generated
+	// curve is an exact helix and the OBJ's is slightly off one, so positions only roughly agree
+	const ObjShape helix = { "helix.obj", ProceduralShape::Helix, 1, 0 };
+	MeshData obj = LoadObj(helix.file), generated = GenerateDefault(helix.shape);
+	size_t objCaps = CountFlatTriangles(obj), generatedCaps = CountFlatTriangles(generated);
+	CHECK(objCaps == 24 && generatedCaps == 32);
+	CHECK(obj.indices.size() / 3 - objCaps == generated.indices.size() / 3 - generatedCaps);
+	CHECK(generated.indices.size() / 3 - generatedCaps == 150 * 16 * 2);
+	CHECK(CountUnmatched(obj, generated, helix, 0.03f, 0.01f) == 0);
+}
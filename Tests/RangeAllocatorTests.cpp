@@ -0,0 +1,164 @@
+#include "TestHarness.h"
+#include "RangeAllocator.h"
+
+#include <stdexcept>
+
+namespace
+{
+	// Allocates back to back from an empty allocator, then frees the ones
+	// given, leaving free ranges of known sizes between live ones
+	RangeAllocator MakeHoles(const std::vector<unsigned int>& sizes, const std::vector<size_t>& freed)
+	{
+		unsigned int total = 0;
+		for (unsigned int size : sizes)
+			total += size;
+		RangeAllocator ranges(total);
+		std::vector<unsigned int> offsets;
+		for (unsigned int size : sizes)
+			offsets.push_back(ranges.Allocate(size));
+		for (size_t i : freed)
+			ranges.Free(offsets[i]);
+		return ranges;
+	}
+}
+
+TEST(AllocationsTakeTheBestFit)
+{
+	// Holes of 30 at 0, 10 at 40 and 20 at 60, with 10 live between each
+	RangeAllocator ranges = MakeHoles({ 30, 10, 10, 10, 20, 10 }, { 0, 2, 4 });
+	CHECK(ranges.GetFreeRangeCount() == 3 && ranges.GetLargestFreeRange() == 30);
+
+	// Each goes in the smallest hole it fits, not the first or the biggest
+	CHECK(ranges.Allocate(15) == 60);
+	CHECK(ranges.Allocate(8) == 40);
+	CHECK(ranges.Allocate(10) == 0);
+
+	// The leftovers: 20 at 10, 5 at 75 and 2 at 48
+	CHECK(ranges.GetFreeRangeCount() == 3);
+	CHECK(ranges.Allocate(2) == 48);
+	CHECK(ranges.Allocate(5) == 75);
+	CHECK(ranges.Allocate(21) == RangeAllocator::InvalidOffset);
+	CHECK(ranges.Allocate(20) == 10);
+	CHECK(ranges.GetUsed() == ranges.GetCapacity() && ranges.GetFreeRangeCount() == 0);
+}
+
+TEST(FreedRangesMergeWithTheirNeighbors)
+{
+	RangeAllocator ranges(100);
+	unsigned int a = ranges.Allocate(10), b = ranges.Allocate(20), c = ranges.Allocate(30), d = ranges.Allocate(40);
+	CHECK(ranges.GetFreeRangeCount() == 0);
+
+	// Apart from each other they stay apart
+	ranges.Free(a);
+	ranges.Free(c);
+	CHECK(ranges.GetFreeRangeCount() == 2 && ranges.GetLargestFreeRange() == 30);
+
+	// Freeing b joins it with both, and d then joins that
+	ranges.Free(b);
+	CHECK(ranges.GetFreeRangeCount() == 1 && ranges.GetLargestFreeRange() == 60);
+	ranges.Free(d);
+	CHECK(ranges.GetFreeRangeCount() == 1 && ranges.GetLargestFreeRange() == 100);
+	CHECK(ranges.GetUsed() == 0 && ranges.GetAllocationCount() == 0);
+	CHECK(ranges.Allocate(100) == 0);
+
+	// Only offsets Allocate() gave can be freed, and only once
+	CHECK_THROWS(ranges.Free(1), std::invalid_argument);
+	ranges.Free(0);
+	CHECK_THROWS(ranges.Free(0), std::invalid_argument);
+}
+
+TEST(FullAllocatorsFailUntilTheyGrow)
+{
+	RangeAllocator ranges(64);
+	CHECK(ranges.Allocate(64) == 0);
+	CHECK(ranges.Allocate(1) == RangeAllocator::InvalidOffset);
+	CHECK(ranges.GetUsed() == 64 && ranges.GetAllocationCount() == 1);
+
+	// Growing adds a free range at the end, which merges with free space before it
+	ranges.Grow(96);
+	CHECK(ranges.Allocate(40) == RangeAllocator::InvalidOffset);
+	CHECK(ranges.Allocate(32) == 64);
+	ranges.Free(64);
+	ranges.Grow(128);
+	CHECK(ranges.GetFreeRangeCount() == 1 && ranges.Allocate(64) == 64);
+
+	CHECK_THROWS(ranges.Grow(100), std::invalid_argument);
+	CHECK_THROWS(ranges.Allocate(0), std::invalid_argument);
+
+	// An empty allocator has nothing to give until it grows
+	RangeAllocator empty;
+	CHECK(empty.Allocate(1) == RangeAllocator::InvalidOffset);
+	empty.Grow(1);
+	CHECK(empty.Allocate(1) == 0);
+}
+
+TEST(CompactReturnsTheMovesItMade)
+{
+	// Live: 10 at 10, 10 at 30, 20 at 60 - everything else free
+	RangeAllocator ranges = MakeHoles({ 10, 10, 10, 10, 20, 20, 10 }, { 0, 2, 4, 6 });
+	std::vector<RangeMove> moves = ranges.Compact();
+
+	// In offset order, each toward 0, in the order they sat
+	CHECK(moves.size() == 3);
+	if (moves.size() == 3)
+	{
+		CHECK(moves[0].from == 10 && moves[0].to == 0 && moves[0].size == 10);
+		CHECK(moves[1].from == 30 && moves[1].to == 10 && moves[1].size == 10);
+		CHECK(moves[2].from == 60 && moves[2].to == 20 && moves[2].size == 20);
+	}
+	CHECK(ranges.GetSize(20) == 20);
+	CHECK_THROWS(ranges.GetSize(60), std::invalid_argument);
+
+	// All free space is now one range at the end
+	CHECK(ranges.GetFreeRangeCount() == 1 && ranges.GetLargestFreeRange() == 50);
+	CHECK(ranges.Allocate(50) == 40);
+
+	// Already packed, so nothing moves
+	CHECK(ranges.Compact().empty());
+}
+
+TEST(AlignedAllocationsStartOnTheirAlignment)
+{
+	RangeAllocator ranges(256);
+	CHECK(ranges.Allocate(3) == 0);
+	CHECK(ranges.Allocate(8, 16) == 16);
+	CHECK(ranges.Allocate(1, 64) == 64);
+
+	// The padding skipped over stays free: 13 at 3, 40 at 24 and the rest at 65
+	CHECK(ranges.GetFreeRangeCount() == 3 && ranges.GetUsed() == 12);
+	CHECK(ranges.Allocate(13) == 3);
+
+	// The best fit (40 at 24) is too small once aligned, so the next one is used...
+	CHECK(ranges.Allocate(40, 32) == 96);
+
+	// ...leaving 31 at 65, which is the best fit for 24 aligned to 8, just
+	CHECK(ranges.Allocate(24, 8) == 72);
+	CHECK(ranges.GetFreeRangeCount() == 3 && ranges.GetLargestFreeRange() == 120); // 40 at 24, 7 at 65, 120 at 136
+
+	CHECK_THROWS(ranges.Allocate(4, 0), std::invalid_argument);
+	CHECK_THROWS(ranges.Allocate(4, 12), std::invalid_argument);
+}
+
+TEST(CompactKeepsAlignment)
+{
+	RangeAllocator ranges(256);
+	unsigned int a = ranges.Allocate(10);
+	ranges.Allocate(5, 32);
+	unsigned int c = ranges.Allocate(40);
+	ranges.Allocate(16, 64);
+	ranges.Free(a);
+	ranges.Free(c);
+
+	// The 5 goes to 0, and the 16 to the next multiple of 64 rather than 5
+	std::vector<RangeMove> moves = ranges.Compact();
+	CHECK(moves.size() == 2);
+	if (moves.size() == 2)
+	{
+		CHECK(moves[0].from == 32 && moves[0].to == 0);
+		CHECK(moves[1].from == 128 && moves[1].to == 64);
+	}
+
+	// The padding between them is free too, and still merges on its own
+	CHECK(ranges.GetFreeRangeCount() == 2 && ranges.GetLargestFreeRange() == 256 - 80);
+	CHECK(ranges.Allocate(59) == 5);
+}
@@ -0,0 +1,133 @@
+#include "TestHarness.h"
+#include "StagingAllocator.h"
+
+#include <stdexcept>
+
+TEST(AllocationsAreAlignedAndInOrder)
+{
+	StagingAllocator ring(1024);
+	CHECK(ring.Allocate(10, 1) == 0);
+	CHECK(ring.Allocate(8, 16) == 16);
+	CHECK(ring.Allocate(1, 256) == 256);
+	CHECK(ring.Allocate(3, 4) == 260);
+
+	// Padding for alignment counts as used
+	CHECK(ring.GetUsed() == 263);
+	CHECK(ring.HasOpenBatch() && ring.GetBatchCount() == 0);
+}
+
+TEST(BadArgumentsThrow)
+{
+	CHECK_THROWS(StagingAllocator(0), std::invalid_argument);
+
+	StagingAllocator ring(1024);
+	CHECK_THROWS(ring.Allocate(0, 4), std::invalid_argument);
+	CHECK_THROWS(ring.Allocate(16, 0), std::invalid_argument);
+	CHECK_THROWS(ring.Allocate(16, 12), std::invalid_argument);
+	CHECK(ring.GetUsed() == 0);
+}
+
+TEST(AllocationsWrapPastTheEndOfTheRing)
+{
+	StagingAllocator ring(1000);
+	CHECK(ring.Allocate(600, 1) == 0);
+	ring.Submit(1);
+	CHECK(ring.Allocate(300, 1) == 600);
+	ring.Submit(2);
+	ring.Retire(1);
+
+	// 200 bytes don't fit in the 100 left before the end, so they start
+	// over at 0 - and the skipped 100 stay in use until this batch retires
+	CHECK(ring.Allocate(200, 1) == 0);
+	CHECK(ring.GetUsed() == 300 + 100 + 200);
+
+	// The wrapped allocation can't run into batch 2, which starts at 600
+	CHECK(ring.Allocate(500, 1) == StagingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(400, 1) == 200);
+	ring.Submit(3);
+	CHECK(ring.Allocate(1, 1) == StagingAllocator::InvalidOffset);
+
+	// Batch 2 retiring makes room again, but not the skipped bytes, which are batch 3's
+	ring.Retire(2);
+	CHECK(ring.GetUsed() == 100 + 200 + 400);
+	CHECK(ring.Allocate(300, 1) == 600);
+	CHECK(ring.Allocate(1, 1) == StagingAllocator::InvalidOffset);
+}
+
+TEST(AlignmentPastTheEndWrapsToZero)
+{
+	StagingAllocator ring(1024);
+	CHECK(ring.Allocate(900, 1) == 0);
+	ring.Submit(1);
+	CHECK(ring.Allocate(1, 1) == 900);
+	ring.Submit(2);
+
+	// 901 aligned to 512 is the end of the ring, so this goes back to 0 -
+	// aligned for anything, but still batch 1's
+	CHECK(ring.Allocate(16, 512) == StagingAllocator::InvalidOffset);
+	ring.Retire(1);
+	CHECK(ring.Allocate(16, 512) == 0);
+	CHECK(ring.Allocate(16, 256) == 256);
+	CHECK(ring.GetUsed() == 1 + 123 + 272); // Batch 2, the skipped end and 0 to 272
+}
+
+TEST(OversizedAllocationsFailWithoutTouchingTheRing)
+{
+	// Graphics gives anything bigger than the ring a buffer of its own, so
+	// refusing it mustn't disturb the open batch
+	StagingAllocator ring(256);
+	CHECK(ring.Allocate(100, 1) == 0);
+	CHECK(ring.Allocate(257, 1) == StagingAllocator::InvalidOffset);
+	CHECK(ring.Allocate((size_t)1 << 40, 256) == StagingAllocator::InvalidOffset);
+	CHECK(ring.GetUsed() == 100);
+	CHECK(ring.Allocate(100, 1) == 100);
+
+	// Exactly the capacity fits, once nothing else is in flight
+	ring.Submit(1);
+	CHECK(ring.Allocate(256, 1) == StagingAllocator::InvalidOffset);
+	ring.Retire(1);
+	CHECK(ring.Allocate(256, 1) == 0);
+}
+
+TEST(SpaceIsReusedOnlyAfterItsFenceValue)
+{
+	StagingAllocator ring(1024);
+	CHECK(ring.Allocate(512, 1) == 0);
+	ring.Submit(5);
+	CHECK(ring.Allocate(512, 1) == 512);
+	ring.Submit(8);
+	CHECK(ring.GetBatchCount() == 2 && !ring.HasOpenBatch());
+	CHECK(ring.Allocate(1, 1) == StagingAllocator::InvalidOffset);
+
+	// Fence values below a batch's leave it in flight
+	ring.Retire(4);
+	CHECK(ring.GetBatchCount() == 2 && ring.GetUsed() == 1024);
+	CHECK(ring.Allocate(1, 1) == StagingAllocator::InvalidOffset);
+
+	// Batches retire oldest first, each once its own value is reached
+	ring.Retire(7);
+	CHECK(ring.GetBatchCount() == 1 && ring.GetUsed() == 512);
+	CHECK(ring.Allocate(512, 1) == 0);
+	CHECK(ring.Allocate(1, 1) == StagingAllocator::InvalidOffset);
+	ring.Submit(9);
+
+	ring.Retire(9);
+	CHECK(ring.GetBatchCount() == 0 && ring.GetUsed() == 0);
+}
+
+TEST(EmptySubmitsMakeNoBatch)
+{
+	StagingAllocator ring(1024);
+	ring.Submit(1);
+	CHECK(ring.GetBatchCount() == 0);
+
+	CHECK(ring.Allocate(64, 1) == 0);
+	ring.Submit(2);
+	ring.Submit(3);
+	CHECK(ring.GetBatchCount() == 1);
+
+	// Retiring the one batch leaves the ring empty, so it starts over at 0
+	ring.Retire(3);
+	CHECK(ring.GetUsed() == 0);
+	CHECK(ring.Allocate(64, 1) == 0);
+}
@@ -0,0 +1,170 @@
+#include "TangentGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times TangentGenerator::Generate() on a million-triangle
+// mesh, scalar vs AVX2, against the two CalculateTangents
+// passes the OBJ constructor used to make.
+//
+// Usage: TangentBenchmark [grid size]
+// The default 708 x 708 grid of quads is ~1M triangles.
+// --------------------------------------------------------
+namespace
+{
+	// The old Mesh::CalculateTangents: one scalar AoS pass, normalizing every vertex
+	void CalculateTangentsOld(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices)
+	{
+		for (int i = 0; i < numVerts; i++)
+			verts[i].Tangent = XMFLOAT3(0, 0, 0);
+
+		for (int i = 0; i < numIndices;)
+		{
+			Vertex* v1 = &verts[indices[i++]];
+			Vertex* v2 = &verts[indices[i++]];
+			Vertex* v3 = &verts[indices[i++]];
+
+			float x1 = v2->Position.x - v1->Position.x;
+			float y1 = v2->Position.y - v1->Position.y;
+			float z1 = v2->Position.z - v1->Position.z;
+			float x2 = v3->Position.x - v1->Position.x;
+			float y2 = v3->Position.y - v1->Position.y;
+			float z2 = v3->Position.z - v1->Position.z;
+
+			float s1 = v2->UV.x - v1->UV.x;
+			float t1 = v2->UV.y - v1->UV.y;
+			float s2 = v3->UV.x - v1->UV.x;
+			float t2 = v3->UV.y - v1->UV.y;
+			float r = 1.0f / (s1 * t2 - s2 * t1);
+
+			float tx = (t2 * x1 - t1 * x2) * r;
+			float ty = (t2 * y1 - t1 * y2) * r;
+			float tz = (t2 * z1 - t1 * z2) * r;
+			for (Vertex* v : { v1, v2, v3 })
+			{
+				v->Tangent.x += tx;
+				v->Tangent.y += ty;
+				v->Tangent.z += tz;
+			}
+		}
+
+		for (int i = 0; i < numVerts; i++)
+		{
+			XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+			XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+			tangent = XMVector3Normalize(XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent))));
+			XMStoreFloat3(&verts[i].Tangent, tangent);
+		}
+	}
+
+	// A wavy grid, with the normals of the surface and UVs that run across it once
+	void MakeGrid(int size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		vertices.clear();
+		indices.clear();
+		for (int y = 0; y <= size; y++)
+			for (int x = 0; x <= size; x++)
+			{
+				float fx = x / (float)size, fy = y / (float)size;
+				float dx = 0.25f * 20.0f * std::cos(fx * 20.0f) * std::cos(fy * 20.0f) / 10.0f;
+				float dz = -0.25f * 20.0f * std::sin(fx * 20.0f) * std::sin(fy * 20.0f) / 10.0f;
+
+				Vertex v = {};
+				v.Position = XMFLOAT3(fx * 10.0f - 5.0f, 0.25f * std::sin(fx * 20.0f) * std::cos(fy * 20.0f), fy * 10.0f - 5.0f);
+				v.UV = XMFLOAT2(fx, fy);
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVectorSet(-dx, 1.0f, -dz, 0.0f)));
+				vertices.push_back(v);
+			}
+		for (int y = 0; y < size; y++)
+			for (int x = 0; x < size; x++)
+			{
+				unsigned int a = y * (size + 1) + x, b = a + 1, c = a + size + 2, d = a + size + 1;
+				indices.insert(indices.end(), { a, c, b, a, d, c });
+			}
+	}
+
+	// Best of a few runs, in seconds
+	template <typename Function>
+	double Time(Function function)
+	{
+		double best = 1e30;
+		for (int run = 0; run < 5; run++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			function();
+			best = (std::min)(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+
+	// Largest angle between two sets of tangents, in degrees
+	float MaxDifferenceDegrees(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+	{
+		float worst = 0.0f;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			// atan2 of |cross| and dot stays accurate for tiny angles, where acos doesn't
+			XMVECTOR ta = XMLoadFloat3(&a[i].Tangent), tb = XMLoadFloat3(&b[i].Tangent);
+			float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(ta, tb)));
+			worst = (std::max)(worst, XMConvertToDegrees(std::atan2(sine, XMVectorGetX(XMVector3Dot(ta, tb)))));
+		}
+		return worst;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int size = argc > 1 ? atoi(argv[1]) : 708;
+	if (size < 1)
+	{
+		printf("Usage: TangentBenchmark [grid size]\n");
+		return 1;
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	MakeGrid(size, vertices, indices);
+	double triangles = indices.size() / 3.0;
+	printf("%d x %d grid: %zu vertices, %.0f triangles\n", size, size, vertices.size(), triangles);
+
+	std::vector<Vertex> old = vertices;
+	double oldSeconds = Time([&]
+	{
+		CalculateTangentsOld(old.data(), (int)old.size(), indices.data(), (int)indices.size());
+		CalculateTangentsOld(old.data(), (int)old.size(), indices.data(), (int)indices.size());
+	});
+	printf("Old CalculateTangents x2:    %8.2f ms\n", oldSeconds * 1000.0);
+
+	for (bool angleWeighted : { false, true })
+	{
+		TangentOptions options;
+		options.angleWeighted = angleWeighted;
+		const char* weighting = angleWeighted ? "angle weighted" : "area weighted ";
+
+		options.allowSimd = false;
+		std::vector<Vertex> scalar = vertices;
+		double scalarSeconds = Time([&] { TangentGenerator::Generate(scalar.data(), scalar.size(), indices.data(), indices.size(), options); });
+		printf("Scalar, %s:      %8.2f ms  (%.1f M triangles/s)\n", weighting, scalarSeconds * 1000.0, triangles / scalarSeconds / 1e6);
+
+		if (!TangentGenerator::IsAVX2Supported())
+		{
+			printf("AVX2, %s:        not supported on this CPU\n", weighting);
+			continue;
+		}
+
+		options.allowSimd = true;
+		std::vector<Vertex> simd = vertices;
+		double simdSeconds = Time([&] { TangentGenerator::Generate(simd.data(), simd.size(), indices.data(), indices.size(), options); });
+		printf("AVX2, %s:        %8.2f ms  (%.1f M triangles/s, %.2fx scalar, %.2fx old; max difference %.4f deg)\n",
+			weighting, simdSeconds * 1000.0, triangles / simdSeconds / 1e6, scalarSeconds / simdSeconds, oldSeconds / simdSeconds,
+			MaxDifferenceDegrees(scalar, simd));
+	}
+	return 0;
+}
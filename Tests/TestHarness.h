@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+/*
+* A minimal test runner for the CPU-side components, so the tests build anywhere the engine's
+* portable code does without pulling in a test framework.
+*
+* TEST(name) defines a test and registers it. CHECK() records a failure and carries on;
+* CHECK_THROWS() passes when the expression throws the given exception type. Each test
+* executable links TestMain.cpp, which runs every registered test and returns non-zero if
+* any check failed (or a test threw). WriteFile() saves test input next to the executable.
+*/
+namespace TestHarness
+{
+	struct TestCase
+	{
+		const char* name;
+		void (*run)();
+	};
+
+	inline std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	inline int& GetFailureCount()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline void Fail(const char* file, int line, const char* expression)
+	{
+		printf("%s(%d): check failed: %s\n", file, line, expression);
+		GetFailureCount()++;
+	}
+
+	struct Registrar
+	{
+		Registrar(const char* name, void (*run)()) { GetTests().push_back({ name, run }); }
+	};
+
+	// Writes size bytes to path, replacing it - false if that fails
+	inline bool WriteFile(const char* path, const void* data, size_t size)
+	{
+		FILE* file = fopen(path, "wb");
+		if (!file)
+			return false;
+		bool written = fwrite(data, 1, size, file) == size;
+		return fclose(file) == 0 && written;
+	}
+
+	inline bool WriteFile(const char* path, const std::string& text)
+	{
+		return WriteFile(path, text.data(), text.size());
+	}
+
+	int RunAll();
+}
+
+#define TEST(name) \
+	static void name(); \
+	static TestHarness::Registrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) TestHarness::Fail(__FILE__, __LINE__, #expression); } while (0)
+
+#define CHECK_THROWS(expression, exceptionType) \
+	do { \
+		bool thrown = false; \
+		try { expression; } catch (const exceptionType&) { thrown = true; } \
+		if (!thrown) TestHarness::Fail(__FILE__, __LINE__, #expression " throws " #exceptionType); \
+	} while (0)
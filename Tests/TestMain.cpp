@@ -0,0 +1,35 @@
+#include "TestHarness.h"
+
+// --------------------------------------------------------
+// Runs every registered test, reporting each one, and
+// returns the process exit code (0 when everything passed)
+// --------------------------------------------------------
+int TestHarness::RunAll()
+{
+	int failedTests = 0;
+	for (const TestCase& test : GetTests())
+	{
+		int failuresBefore = GetFailureCount();
+		try
+		{
+			test.run();
+		}
+		catch (const std::exception& e)
+		{
+			printf("%s: threw %s\n", test.name, e.what());
+			GetFailureCount()++;
+		}
+
+		bool passed = GetFailureCount() == failuresBefore;
+		printf("[%s] %s\n", passed ? "pass" : "FAIL", test.name);
+		failedTests += passed ? 0 : 1;
+	}
+
+	printf("%d of %d tests passed\n", (int)GetTests().size() - failedTests, (int)GetTests().size());
+	return failedTests == 0 ? 0 : 1;
+}
+
+int main()
+{
+	return TestHarness::RunAll();
+}
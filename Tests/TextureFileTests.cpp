@@ -0,0 +1,207 @@
+#include "TestHarness.h"
+#include "TextureFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+// --------------------------------------------------------
+// The files in Data/ are tiny textures whose level i holds
+// bytes (37 * i + n) & 0xFF, n counting from 0:
+//   bc1_6x5.dds    Legacy DXT1 header, 3 levels (6x5, 3x2, 1x1)
+//   rgba8_5x3.dds  DX10 header, R8G8B8A8_UNORM, 2 levels (5x3, 2x1)
+//   bc7_8x8.ktx2   BC7_UNORM, 4 levels (8x8 down to 1x1)
+//   r8_3x3.ktx2    R8_UNORM, 2 levels (3x3, 1x1)
+// The .ktx2 files store their levels smallest first.
+// --------------------------------------------------------
+namespace
+{
+	const unsigned int R8 = 61;
+	const unsigned int R8G8B8A8 = 28;
+	const unsigned int BC1 = 71;
+	const unsigned int BC7 = 98;
+
+	std::string DataPath(const char* name) { return std::string(TEST_DATA_DIR) + name; }
+
+	std::string ReadData(const char* name)
+	{
+		std::ifstream file(DataPath(name), std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	// Whether every level's data is where the file says, holding the test pattern
+	bool HasTestPattern(TextureFile& texture)
+	{
+		const std::vector<TextureLevel>& levels = texture.GetLevels();
+		for (size_t i = 0; i < levels.size(); i++)
+			for (size_t n = 0; n < (size_t)levels[i].rowBytes * levels[i].rowCount; n++)
+				if (levels[i].data[n] != (unsigned char)(37 * i + n))
+					return false;
+		return true;
+	}
+
+	bool Matches(const TextureFootprint& footprint, unsigned long long offset, unsigned int width, unsigned int height, unsigned int rowPitch, unsigned int rowBytes, unsigned int rowCount)
+	{
+		return footprint.offset == offset && footprint.width == width && footprint.height == height &&
+			footprint.rowPitch == rowPitch && footprint.rowBytes == rowBytes && footprint.rowCount == rowCount;
+	}
+
+	// Loading the first size bytes of a data file, which should fail
+	void LoadTruncated(const char* name, size_t size)
+	{
+		std::string path = std::string("Truncated_") + name;
+		TestHarness::WriteFile(path.c_str(), ReadData(name).substr(0, size));
+		TextureFile texture(path.c_str());
+	}
+}
+
+// The expected layouts are what ID3D12Device::GetCopyableFootprints() returns for the same descs
+TEST(FootprintsMatchGetCopyableFootprints)
+{
+	std::vector<TextureFootprint> footprints;
+
+	// Rows that aren't a multiple of 256 bytes get padded, and levels start on 512
+	CHECK(TextureFile::ComputeFootprints(R8G8B8A8, 300, 200, 3, footprints) == 358188);
+	CHECK(footprints.size() == 3);
+	if (footprints.size() == 3)
+	{
+		CHECK(Matches(footprints[0], 0, 300, 200, 1280, 1200, 200));
+		CHECK(Matches(footprints[1], 256000, 150, 100, 768, 600, 100));
+		CHECK(Matches(footprints[2], 332800, 75, 50, 512, 300, 50));
+	}
+
+	// A texture that's smaller than a row: the total doesn't count the padding
+	CHECK(TextureFile::ComputeFootprints(R8, 1, 1, 1, footprints) == 1);
+	CHECK(footprints.size() == 1 && Matches(footprints[0], 0, 1, 1, 256, 1, 1));
+}
+
+TEST(BlockCompressedFootprintsCoverWholeBlocks)
+{
+	std::vector<TextureFootprint> footprints;
+
+	// A full BC1 chain: the 2x2 and 1x1 tail mips are still 4x4 blocks
+	CHECK(TextureFile::ComputeFootprints(BC1, 256, 256, 9, footprints) == 49672);
+	CHECK(footprints.size() == 9);
+	if (footprints.size() == 9)
+	{
+		CHECK(Matches(footprints[0], 0, 256, 256, 512, 512, 64));
+		CHECK(Matches(footprints[1], 32768, 128, 128, 256, 256, 32));
+		CHECK(Matches(footprints[2], 40960, 64, 64, 256, 128, 16));
+		CHECK(Matches(footprints[3], 45056, 32, 32, 256, 64, 8));
+		CHECK(Matches(footprints[4], 47104, 16, 16, 256, 32, 4));
+		CHECK(Matches(footprints[5], 48128, 8, 8, 256, 16, 2));
+		CHECK(Matches(footprints[6], 48640, 4, 4, 256, 8, 1));
+		CHECK(Matches(footprints[7], 49152, 4, 4, 256, 8, 1));
+		CHECK(Matches(footprints[8], 49664, 4, 4, 256, 8, 1));
+	}
+
+	// Sizes that aren't multiples of 4 round up to whole blocks too
+	CHECK(TextureFile::ComputeFootprints(BC7, 6, 5, 3, footprints) == 1040);
+	CHECK(footprints.size() == 3);
+	if (footprints.size() == 3)
+	{
+		CHECK(Matches(footprints[0], 0, 8, 8, 256, 32, 2));
+		CHECK(Matches(footprints[1], 512, 4, 4, 256, 16, 1));
+		CHECK(Matches(footprints[2], 1024, 4, 4, 256, 16, 1));
+	}
+
+	// Unsupported formats have no layout
+	CHECK(TextureFile::ComputeFootprints(2, 16, 16, 1, footprints) == 0 && footprints.empty());
+}
+
+TEST(DdsFilesAreReadInPlace)
+{
+	TextureFile bc1(DataPath("bc1_6x5.dds").c_str());
+	CHECK(bc1.GetWidth() == 6 && bc1.GetHeight() == 5);
+	CHECK(bc1.GetDxgiFormat() == BC1 && bc1.GetMipCount() == 3);
+	const std::vector<TextureLevel>& levels = bc1.GetLevels();
+	if (levels.size() == 3)
+	{
+		CHECK(levels[0].width == 6 && levels[0].height == 5 && levels[0].rowBytes == 16 && levels[0].rowCount == 2);
+		CHECK(levels[1].width == 3 && levels[1].height == 2 && levels[1].rowBytes == 8 && levels[1].rowCount == 1);
+		CHECK(levels[2].width == 1 && levels[2].height == 1 && levels[2].rowBytes == 8 && levels[2].rowCount == 1);
+	}
+	CHECK(HasTestPattern(bc1));
+
+	TextureFile rgba(DataPath("rgba8_5x3.dds").c_str());
+	CHECK(rgba.GetWidth() == 5 && rgba.GetHeight() == 3);
+	CHECK(rgba.GetDxgiFormat() == R8G8B8A8 && rgba.GetMipCount() == 2);
+	CHECK(rgba.GetLevels()[0].rowBytes == 20 && rgba.GetLevels()[1].rowBytes == 8);
+	CHECK(HasTestPattern(rgba));
+}
+
+TEST(Ktx2FilesAreReadInPlace)
+{
+	TextureFile bc7(DataPath("bc7_8x8.ktx2").c_str());
+	CHECK(bc7.GetWidth() == 8 && bc7.GetHeight() == 8);
+	CHECK(bc7.GetDxgiFormat() == BC7 && bc7.GetMipCount() == 4);
+	const std::vector<TextureLevel>& levels = bc7.GetLevels();
+	if (levels.size() == 4)
+	{
+		CHECK(levels[0].rowBytes == 32 && levels[0].rowCount == 2);
+		CHECK(levels[3].width == 1 && levels[3].rowBytes == 16 && levels[3].rowCount == 1);
+
+		// Levels are found through the index, not by their order in the file
+		CHECK(levels[3].data < levels[0].data);
+	}
+	CHECK(HasTestPattern(bc7));
+
+	TextureFile r8(DataPath("r8_3x3.ktx2").c_str());
+	CHECK(r8.GetDxgiFormat() == R8 && r8.GetMipCount() == 2);
+	CHECK(r8.GetLevels()[0].rowBytes == 3 && r8.GetLevels()[0].rowCount == 3);
+	CHECK(HasTestPattern(r8));
+}
+
+TEST(LevelsAreCopiedIntoTheirFootprints)
+{
+	TextureFile texture(DataPath("rgba8_5x3.dds").c_str());
+	std::vector<TextureFootprint> footprints;
+	unsigned long long total = texture.ComputeFootprints(footprints);
+	CHECK(total == 1024 + 8); // Level 0 ends at 2 * 256 + 20, so level 1 starts at 1024
+
+	std::vector<unsigned char> staging(total, 0xCD);
+	texture.CopyLevels(footprints, staging.data());
+
+	// Each row lands at its pitch, leaving the padding between rows alone
+	const TextureLevel& level = texture.GetLevels()[0];
+	for (unsigned int row = 0; row < level.rowCount; row++)
+		CHECK(memcmp(&staging[row * 256], level.data + row * level.rowBytes, level.rowBytes) == 0);
+	CHECK(staging[20] == 0xCD && staging[255] == 0xCD);
+	CHECK(memcmp(&staging[1024], texture.GetLevels()[1].data, 8) == 0);
+
+	footprints.pop_back();
+	CHECK_THROWS(texture.CopyLevels(footprints, staging.data()), std::invalid_argument);
+}
+
+TEST(TruncatedFilesThrow)
+{
+	// .dds: the headers, the DX10 extension, then the last level's last byte
+	const size_t ddsHeaders = 4 + 124;
+	CHECK_THROWS(LoadTruncated("bc1_6x5.dds", 3), std::runtime_error);
+	CHECK_THROWS(LoadTruncated("bc1_6x5.dds", ddsHeaders - 1), std::runtime_error);
+	CHECK_THROWS(LoadTruncated("bc1_6x5.dds", ddsHeaders + 32), std::runtime_error);
+	CHECK_THROWS(LoadTruncated("bc1_6x5.dds", ReadData("bc1_6x5.dds").size() - 1), std::runtime_error);
+	CHECK_THROWS(LoadTruncated("rgba8_5x3.dds", ddsHeaders + 19), std::runtime_error);
+	CHECK_THROWS(LoadTruncated("rgba8_5x3.dds", ReadData("rgba8_5x3.dds").size() - 1), std::runtime_error);
+
+	// .ktx2: the header, the level index, then level 0 (stored last)
+	const size_t ktx2Header = 12 + 68;
+	CHECK_THROWS(LoadTruncated("bc7_8x8.ktx2", 11), std::runtime_error);
+	CHECK_THROWS(LoadTruncated("bc7_8x8.ktx2", ktx2Header - 1), std::runtime_error);
+	CHECK_THROWS(LoadTruncated("bc7_8x8.ktx2", ktx2Header + 4 * 24 - 1), std::runtime_error);
+	CHECK_THROWS(LoadTruncated("bc7_8x8.ktx2", ReadData("bc7_8x8.ktx2").size() - 1), std::runtime_error);
+	CHECK_THROWS(LoadTruncated("r8_3x3.ktx2", ReadData("r8_3x3.ktx2").size() - 1), std::runtime_error);
+
+	// The whole file still loads, so it's the truncation each of those caught
+	LoadTruncated("bc7_8x8.ktx2", ReadData("bc7_8x8.ktx2").size());
+}
+
+TEST(MissingAndForeignFilesThrow)
+{
+	CHECK_THROWS(TextureFile("NoSuchTexture.dds"), std::runtime_error);
+
+	TestHarness::WriteFile("NotATexture.dds", std::string("PNG and a lot more bytes than any magic number"));
+	CHECK_THROWS(TextureFile("NotATexture.dds"), std::runtime_error);
+}
@@ -0,0 +1,44 @@
+#include "TestHarness.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(EveryJobRunsOnce)
+{
+	ThreadPool pool(4);
+	std::vector<std::atomic<int>> runs(1000);
+	pool.ParallelFor(1000, [&](unsigned int i) { runs[i]++; });
+	bool once = true;
+	for (std::atomic<int>& count : runs)
+		once = once && count == 1;
+	CHECK(once);
+}
+
+TEST(NestedCallsRunSeriallyOnEveryThread)
+{
+	// Jobs run on the workers and on the calling thread, and a nested call from
+	// any of them must run in place rather than wait for the pool it's inside
+	ThreadPool pool(4);
+	std::atomic<int> inner(0);
+	for (int repeat = 0; repeat < 50; repeat++)
+		pool.ParallelFor(16, [&](unsigned int) { pool.ParallelFor(8, [&](unsigned int) { inner++; }); });
+	CHECK(inner == 50 * 16 * 8);
+
+	// And the caller can use the pool normally again afterwards
+	std::atomic<int> after(0);
+	pool.ParallelFor(16, [&](unsigned int) { after++; });
+	CHECK(after == 16);
+}
+
+TEST(FirstExceptionReachesTheCaller)
+{
+	ThreadPool pool(3);
+	CHECK_THROWS(pool.ParallelFor(64, [](unsigned int i) { if (i == 10) throw std::runtime_error("job failed"); }), std::runtime_error);
+
+	// The pool still works after a failed run
+	std::atomic<int> count(0);
+	pool.ParallelFor(64, [&](unsigned int) { count++; });
+	CHECK(count == 64);
+}
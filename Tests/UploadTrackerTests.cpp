@@ -0,0 +1,193 @@
+#include "TestHarness.h"
+#include "UploadTracker.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Stands in for Graphics' copy queue and its fence: batches
+	// are submitted the way SubmitUploadList() does it, and the
+	// "GPU" finishes them only when a test says so
+	// --------------------------------------------------------
+	struct FakeCopyQueue
+	{
+		UploadTracker tracker;
+		unsigned long long signaled = 0;	// Last value the queue will set the fence to
+		unsigned long long fence = 0;		// The fence's completed value
+		int allocator = -1;					// The open batch's, or -1 if none is open
+
+		FakeCopyQueue(size_t stagingBytes) : tracker(stagingBytes) {}
+
+		size_t Stage(size_t size)
+		{
+			Open();
+			return tracker.AllocateStaging(size, 4);
+		}
+
+		void Open()
+		{
+			if (allocator < 0 && (allocator = tracker.AcquireAllocator()) < 0)
+				allocator = (int)tracker.AddAllocator();
+		}
+
+		UploadTicket Submit()
+		{
+			Open();
+			UploadTicket ticket = tracker.Submit((unsigned int)allocator);
+			signaled = ticket;
+			allocator = -1;
+			return ticket;
+		}
+
+		// The GPU finishing batches, up to the given fence value
+		void Complete(unsigned long long value) { fence = (std::min)(value, signaled); }
+
+		// Graphics::IsUploadComplete(): polls the fence when the ticket isn't known to be done
+		bool IsReady(UploadTicket ticket)
+		{
+			if (!tracker.IsComplete(ticket))
+				tracker.Update(fence);
+			return tracker.IsComplete(ticket);
+		}
+
+		// Graphics::WaitForUpload(): submits the open batch if it's the one waited for,
+		// then blocks until the fence gets there (which the fake does immediately)
+		void Wait(UploadTicket ticket)
+		{
+			if (ticket > tracker.GetLastSubmitted())
+				Submit();
+			if (ticket > tracker.GetLastSubmitted())
+				throw std::invalid_argument("No upload batch has that ticket");
+			Complete((std::max)(fence, ticket));
+			tracker.Update(fence);
+		}
+	};
+}
+
+TEST(TicketsAreNumberedInSubmissionOrder)
+{
+	FakeCopyQueue queue(1024);
+	CHECK(queue.tracker.GetOpenTicket() == 1 && queue.tracker.GetLastSubmitted() == 0);
+
+	// The open batch's ticket is known up front, and is what Submit() returns
+	for (UploadTicket expected = 1; expected <= 5; expected++)
+	{
+		queue.Stage(16);
+		CHECK(queue.tracker.GetOpenTicket() == expected);
+		CHECK(queue.Submit() == expected);
+		CHECK(queue.tracker.GetLastSubmitted() == expected);
+	}
+
+	// Empty batches still get tickets, since their fence signals still count
+	CHECK(queue.Submit() == 6);
+	CHECK(queue.tracker.GetOpenTicket() == 7);
+}
+
+TEST(TicketsCompleteWithTheFence)
+{
+	FakeCopyQueue queue(1024);
+	UploadTicket first = queue.Submit(), second = queue.Submit(), third = queue.Submit();
+
+	// Ticket 0 is never handed out, so it's always done
+	CHECK(queue.IsReady(0));
+	CHECK(!queue.IsReady(first) && !queue.IsReady(second) && !queue.IsReady(third));
+
+	// The fence completes batches in order, and a later value covers every earlier ticket
+	queue.Complete(second);
+	CHECK(queue.IsReady(first) && queue.IsReady(second) && !queue.IsReady(third));
+	CHECK(queue.tracker.GetCompleted() == second);
+
+	// Reports of an older value don't undo anything
+	queue.tracker.Update(first);
+	CHECK(queue.IsReady(second) && queue.tracker.GetCompleted() == second);
+
+	// Tickets the tracker hasn't heard about yet aren't complete until Update()
+	queue.Complete(third);
+	CHECK(!queue.tracker.IsComplete(third));
+	CHECK(queue.IsReady(third));
+}
+
+TEST(WaitingSubmitsTheOpenBatch)
+{
+	FakeCopyQueue queue(1024);
+	queue.Stage(64);
+	UploadTicket open = queue.tracker.GetOpenTicket();
+
+	queue.Wait(open);
+	CHECK(queue.tracker.GetLastSubmitted() == open && queue.IsReady(open));
+	CHECK(queue.tracker.GetStagingUsed() == 0);
+
+	// Waiting on a finished ticket changes nothing, and batches past the open one don't exist
+	queue.Wait(open);
+	CHECK(queue.tracker.GetLastSubmitted() == open);
+	CHECK_THROWS(queue.Wait(open + 2), std::invalid_argument);
+}
+
+TEST(StagingIsRecycledOnlyOnceItsBatchCompletes)
+{
+	FakeCopyQueue queue(1024);
+	CHECK(queue.Stage(512) == 0);
+	UploadTicket first = queue.Submit();
+	CHECK(queue.Stage(512) == 512);
+	UploadTicket second = queue.Submit();
+
+	// The ring is full until the GPU is done with a batch - submitting isn't enough,
+	// and neither is the fence getting there before the tracker hears about it
+	CHECK(queue.Stage(4) == StagingAllocator::InvalidOffset);
+	queue.Complete(first);
+	CHECK(queue.Stage(4) == StagingAllocator::InvalidOffset);
+	CHECK(queue.tracker.GetStagingUsed() == 1024);
+
+	// Then exactly that batch's space comes back
+	CHECK(queue.IsReady(first));
+	CHECK(queue.tracker.GetStagingUsed() == 512);
+	CHECK(queue.Stage(512) == 0);
+	CHECK(queue.Stage(4) == StagingAllocator::InvalidOffset);
+
+	// The open batch holds onto its space whatever the fence does
+	queue.Wait(second);
+	CHECK(queue.tracker.GetStagingUsed() == 512);
+	CHECK(queue.Stage(512) == 512);
+	queue.Wait(queue.tracker.GetOpenTicket());
+	CHECK(queue.tracker.GetStagingUsed() == 0);
+}
+
+TEST(AllocatorsAreReusedOnlyOnceTheirBatchCompletes)
+{
+	UploadTracker tracker(1024);
+	CHECK(tracker.AcquireAllocator() == -1);
+	unsigned int a = tracker.AddAllocator();
+	UploadTicket first = tracker.Submit(a);
+
+	// a recorded the batch still running, so another one is needed
+	CHECK(tracker.AcquireAllocator() == -1);
+	unsigned int b = tracker.AddAllocator();
+	CHECK(b != a && tracker.GetAllocatorCount() == 2);
+	UploadTicket second = tracker.Submit(b);
+
+	// Each comes back once its own batch is done
+	tracker.Update(first);
+	CHECK(tracker.AcquireAllocator() == (int)a);
+	CHECK(tracker.AcquireAllocator() == -1);
+	UploadTicket third = tracker.Submit(a);
+
+	// And when several are free, the one that finished longest ago goes first
+	tracker.Update(third);
+	CHECK(tracker.AcquireAllocator() == (int)b);
+	CHECK(tracker.AcquireAllocator() == (int)a);
+	CHECK(tracker.AcquireAllocator() == -1);
+	CHECK(second < third);
+}
+
+TEST(SubmittingNeedsAnAcquiredAllocator)
+{
+	UploadTracker tracker(1024);
+	CHECK_THROWS(tracker.Submit(0), std::invalid_argument);
+
+	unsigned int allocator = tracker.AddAllocator();
+	tracker.Submit(allocator);
+	CHECK_THROWS(tracker.Submit(allocator), std::invalid_argument);
+	CHECK(tracker.GetLastSubmitted() == 1);
+}
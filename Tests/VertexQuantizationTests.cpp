@@ -0,0 +1,109 @@
+#include "TestHarness.h"
+#include "VertexQuantization.h"
+
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// Random vertices in a box, with unit normals and tangents pointing anywhere
+	std::vector<Vertex> MakeVertices(size_t count, XMFLOAT3 extent, float uvRange)
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		std::vector<Vertex> vertices(count);
+		for (Vertex& v : vertices)
+		{
+			v.Position = XMFLOAT3(unit(random) * extent.x * 0.5f, unit(random) * extent.y * 0.5f, unit(random) * extent.z * 0.5f);
+			v.UV = XMFLOAT2(unit(random) * uvRange, unit(random) * uvRange);
+			XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random), 0)));
+			XMStoreFloat3(&v.Tangent, XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random), 0)));
+		}
+		return vertices;
+	}
+
+	// The worst UV error once u and v have gone through half floats
+	float HalfUVError(float u, float v)
+	{
+		Vertex vertex = {};
+		vertex.UV = XMFLOAT2(u, v);
+		return VertexQuantization::MeasureError(&vertex, 1).uv;
+	}
+}
+
+TEST(PositionsRoundTripWithinHalfAStepOfTheBounds)
+{
+	XMFLOAT3 extent(10.0f, 2.0f, 0.5f);
+	std::vector<Vertex> vertices = MakeVertices(10000, extent, 1.0f);
+
+	XMFLOAT3 boundsMin, boundsMax;
+	VertexQuantization::ComputeBounds(vertices.data(), vertices.size(), &boundsMin, &boundsMax);
+	std::vector<CompactVertex> compact(vertices.size());
+	VertexQuantization::Encode(compact.data(), vertices.data(), vertices.size(), boundsMin, boundsMax);
+
+	// Each axis gets 65535 steps across its own extent
+	float worst[3] = {};
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		Vertex decoded = VertexQuantization::Decode(compact[i], boundsMin, boundsMax);
+		worst[0] = (std::max)(worst[0], std::abs(decoded.Position.x - vertices[i].Position.x) / (boundsMax.x - boundsMin.x));
+		worst[1] = (std::max)(worst[1], std::abs(decoded.Position.y - vertices[i].Position.y) / (boundsMax.y - boundsMin.y));
+		worst[2] = (std::max)(worst[2], std::abs(decoded.Position.z - vertices[i].Position.z) / (boundsMax.z - boundsMin.z));
+	}
+	for (float error : worst)
+		CHECK(error <= 0.5f / 65535.0f + 1e-6f);
+
+	// MeasureError agrees, in object space units
+	CHECK(VertexQuantization::MeasureError(vertices.data(), vertices.size()).position <= 10.0f * (0.5f / 65535.0f + 1e-6f));
+}
+
+TEST(NormalsAndTangentsRoundTripWithinATwentiethOfADegree)
+{
+	std::vector<Vertex> vertices = MakeVertices(10000, XMFLOAT3(1, 1, 1), 1.0f);
+
+	// Include the axes and the octahedron's folded edges, where encoding is most fragile
+	const XMFLOAT3 edges[] = { { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, -1, 0 }, { 0.7071068f, 0, -0.7071068f }, { 0.5f, -0.5f, -0.7071068f } };
+	for (const XMFLOAT3& edge : edges)
+	{
+		vertices.push_back(vertices[0]);
+		vertices.back().Normal = edge;
+		vertices.back().Tangent = edge;
+	}
+
+	QuantizationError error = VertexQuantization::MeasureError(vertices.data(), vertices.size());
+	CHECK(error.normalDegrees < 0.05f);
+	CHECK(error.tangentDegrees < 0.05f);
+}
+
+TEST(HalfUVsStayWithinATexelOfA2KTexture)
+{
+	std::vector<Vertex> vertices = MakeVertices(10000, XMFLOAT3(1, 1, 1), MaxHalfPrecisionUV);
+	CHECK(VertexQuantization::FitsHalfPrecisionUVs(vertices.data(), vertices.size()));
+	CHECK(VertexQuantization::MeasureError(vertices.data(), vertices.size()).uv <= 1.0f / 2048.0f);
+
+	// Just past the limit, the error doubles - and keeps doubling with
+	// every power of two, which is why tiled UVs keep their floats
+	CHECK(HalfUVError(1.0f + 1.5f / 2048.0f, 0.0f) <= 1.0f / 2048.0f);
+	CHECK(HalfUVError(2.0f + 2.0f / 2048.0f, 0.0f) > 1.0f / 2048.0f);
+	CHECK(HalfUVError(20.0f + 1.0f / 128.0f, 0.0f) > 4.0f / 1024.0f);
+}
+
+TEST(UVsPastTheLimitDontFitHalfPrecision)
+{
+	Vertex vertex = {};
+	vertex.UV = XMFLOAT2(MaxHalfPrecisionUV, -MaxHalfPrecisionUV);
+	CHECK(VertexQuantization::FitsHalfPrecisionUVs(&vertex, 1));
+
+	std::vector<Vertex> vertices = MakeVertices(100, XMFLOAT3(1, 1, 1), 1.0f);
+	CHECK(VertexQuantization::FitsHalfPrecisionUVs(vertices.data(), vertices.size()));
+	vertices[50].UV.y = 20.0f;
+	CHECK(!VertexQuantization::FitsHalfPrecisionUVs(vertices.data(), vertices.size()));
+	vertices[50].UV.y = 0.0f;
+	vertices[99].UV.x = -2.5f;
+	CHECK(!VertexQuantization::FitsHalfPrecisionUVs(vertices.data(), vertices.size()));
+
+	CHECK(VertexQuantization::FitsHalfPrecisionUVs(nullptr, 0));
+}
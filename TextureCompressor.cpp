@@ -0,0 +1,127 @@
+#include "TextureCompressor.h"
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+// --------------------------------------------------------
+// Packs occlusion (R), roughness (G) and metalness (B), the
+// same layout glTF uses. Alpha is opaque
+// --------------------------------------------------------
+void TextureCompressor::PackOrm(const ImageData* occlusion, const ImageData* roughness, const ImageData* metalness, ImageData& out)
+{
+	const ImageData* masks[3] = { occlusion, roughness, metalness };
+	const unsigned char defaults[3] = { 255, 255, 0 };
+
+	out.width = 0;
+	out.height = 0;
+	for (const ImageData* mask : masks)
+	{
+		if (!mask)
+			continue;
+		if (mask->width == 0 || mask->height == 0 || mask->pixels.size() != (size_t)mask->width * mask->height * 4)
+			throw std::invalid_argument("Masks need RGBA pixels for every texel");
+		out.width = (std::max)(out.width, mask->width);
+		out.height = (std::max)(out.height, mask->height);
+	}
+	if (out.width == 0)
+		throw std::invalid_argument("Packing needs at least one mask");
+
+	out.pixels.resize((size_t)out.width * out.height * 4);
+	for (unsigned int y = 0; y < out.height; y++)
+	{
+		for (unsigned int x = 0; x < out.width; x++)
+		{
+			unsigned char* pixel = &out.pixels[((size_t)y * out.width + x) * 4];
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				const ImageData* mask = masks[c];
+				if (!mask)
+				{
+					pixel[c] = defaults[c];
+					continue;
+				}
+				unsigned int maskX = (unsigned int)((unsigned long long)x * mask->width / out.width);
+				unsigned int maskY = (unsigned int)((unsigned long long)y * mask->height / out.height);
+				pixel[c] = mask->pixels[((size_t)maskY * mask->width + maskX) * 4];
+			}
+			pixel[3] = 255;
+		}
+	}
+}
+
+BlockFormat TextureCompressor::GetFormatFor(TextureUsage usage)
+{
+	switch (usage)
+	{
+	case TextureUsage::NormalMap: return BlockFormat::BC5;
+	case TextureUsage::Mask: return BlockFormat::BC4;
+	default: return BlockFormat::BC7;
+	}
+}
+
+void TextureCompressor::GenerateMips(const ImageData& image, TextureUsage usage, std::vector<ImageData>& levels, const ImageData* normalMap)
+{
+	switch (usage)
+	{
+	case TextureUsage::Color: MipGenerator::Generate(image, MipContent::Srgb, levels); break;
+	case TextureUsage::NormalMap: MipGenerator::Generate(image, MipContent::NormalMap, levels); break;
+	case TextureUsage::Mask: MipGenerator::Generate(image, MipContent::Linear, levels); break;
+	case TextureUsage::PackedOrm:
+		if (normalMap)
+			MipGenerator::GenerateRoughness(image, 1, *normalMap, levels);
+		else
+			MipGenerator::Generate(image, MipContent::Linear, levels);
+		break;
+	}
+}
+
+void TextureCompressor::Compress(const std::vector<ImageData>& levels, TextureUsage usage, std::vector<std::vector<unsigned char>>& mips, TextureCompressionReport* report)
+{
+	BlockFormat format = GetFormatFor(usage);
+	mips.assign(levels.size(), {});
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	size_t pixelCount = 0;
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		BlockCompression::Encode(levels[i], format, mips[i]);
+		pixelCount += (size_t)levels[i].width * levels[i].height;
+	}
+	double encodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (report && !levels.empty())
+	{
+		report->format = format;
+		report->mipLevels = (unsigned int)mips.size();
+		report->psnr = BlockCompression::MeasurePsnr(levels[0], format, mips[0].data());
+		report->megapixelsPerSecond = encodeSeconds > 0 ? pixelCount / encodeSeconds / 1e6 : 0;
+		report->uncompressedBytes = pixelCount * 4;
+		report->compressedBytes = 0;
+		for (const std::vector<unsigned char>& mip : mips)
+			report->compressedBytes += mip.size();
+	}
+}
+
+std::string TextureCompressor::GetPathFor(const char* sourcePath)
+{
+	return std::filesystem::path(sourcePath).replace_extension(".dds").string();
+}
+
+// --------------------------------------------------------
+// Compares modification times, so editing the source image
+// causes it to be compressed again. A .dds without a source
+// image is used as is
+// --------------------------------------------------------
+bool TextureCompressor::IsUpToDate(const char* sourcePath, const char* ddsFilePath)
+{
+	std::error_code error;
+	std::filesystem::file_time_type ddsTime = std::filesystem::last_write_time(ddsFilePath, error);
+	if (error)
+		return false;
+	std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(sourcePath, error);
+	return error || ddsTime >= sourceTime;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+#include "ImageData.h"
+
+// --------------------------------------------------------
+// What a texture holds, which decides its block format
+//
+// - Color: RGB(A) colors such as albedo, stored as BC7
+// - NormalMap: Tangent space normals, stored as BC5 (X and
+//   Y only - the pixel shader rebuilds Z)
+// - Mask: One channel, in red, stored as BC4
+// - PackedOrm: Occlusion, roughness and metalness in red,
+//   green and blue (see PackOrm()), stored as BC7. Its mips
+//   can take the material's normal map into account
+// --------------------------------------------------------
+enum class TextureUsage
+{
+	Color,
+	NormalMap,
+	Mask,
+	PackedOrm
+};
+
+// --------------------------------------------------------
+// Quality and speed of one compressed texture. PSNR is
+// measured on the full size level, over the channels the
+// format keeps; throughput counts every mip level's pixels
+// --------------------------------------------------------
+struct TextureCompressionReport
+{
+	BlockFormat format;
+	unsigned int mipLevels;
+	double psnr;
+	double megapixelsPerSecond;
+	size_t uncompressedBytes;	// As RGBA8, every level
+	size_t compressedBytes;
+};
+
+/*
+* Turns decoded images into block compressed .dds files, so textures are stored and sampled at
+* a quarter (BC7, BC5) or an eighth (BC4) of their RGBA8 size.
+*
+* The mip chain is built on the CPU by MipGenerator - colors are filtered as linear light,
+* normals are renormalized and roughness is widened where the normal map's detail averages
+* away - and every level is then encoded with BlockCompression (which spreads each level
+* across the thread pool). Baked into the file, the mips cost nothing at load time.
+*
+* PackOrm(): Combines a material's occlusion, roughness and metalness masks (each read from its
+*            red channel) into one texture, so the shader needs one fetch and one descriptor
+*            for all three. Any of them may be null, leaving that channel at its default: no
+*            occlusion (1), fully rough (1) or not metal (0). Masks of different sizes are
+*            scaled (nearest neighbor) to the largest
+* GetFormatFor(): The block format used for a kind of texture
+* GenerateMips(): Fills levels with the image's full mip chain, filtered to suit its usage.
+*                 normalMap is only used for PackedOrm, and may be null
+* Compress(): Encodes already generated levels, replacing the contents of mips
+* GetPathFor(): The .dds path used for a given source image
+* IsUpToDate(): Whether a .dds file exists and is newer than its source image
+*/
+namespace TextureCompressor
+{
+	void PackOrm(const ImageData* occlusion, const ImageData* roughness, const ImageData* metalness, ImageData& out);
+
+	BlockFormat GetFormatFor(TextureUsage usage);
+
+	void GenerateMips(const ImageData& image, TextureUsage usage, std::vector<ImageData>& levels, const ImageData* normalMap = 0);
+	void Compress(const std::vector<ImageData>& levels, TextureUsage usage, std::vector<std::vector<unsigned char>>& mips, TextureCompressionReport* report = 0);
+
+	std::string GetPathFor(const char* sourcePath);
+	bool IsUpToDate(const char* sourcePath, const char* ddsFilePath);
+}
@@ -0,0 +1,348 @@
+#include "TextureFile.h"
+#include "DdsFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Layout of a .ktx2 file (all that's needed of it):
+	//   Ktx2Identifier
+	//   Ktx2Header
+	//   Ktx2Level[max(levelCount, 1)]   (level 0 is the largest)
+	// Each level's data is wherever its byteOffset says
+	// --------------------------------------------------------
+	const unsigned char Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	// The 64-bit fields follow thirteen 32-bit ones, so pack to 4 to keep them where the file has them
+#pragma pack(push, 4)
+	struct Ktx2Header
+	{
+		unsigned int vkFormat;
+		unsigned int typeSize;
+		unsigned int pixelWidth;
+		unsigned int pixelHeight;
+		unsigned int pixelDepth;
+		unsigned int layerCount;
+		unsigned int faceCount;
+		unsigned int levelCount;
+		unsigned int supercompressionScheme;
+		unsigned int dfdByteOffset;
+		unsigned int dfdByteLength;
+		unsigned int kvdByteOffset;
+		unsigned int kvdByteLength;
+		unsigned long long sgdByteOffset;
+		unsigned long long sgdByteLength;
+	};
+#pragma pack(pop)
+
+	struct Ktx2Level
+	{
+		unsigned long long byteOffset;
+		unsigned long long byteLength;
+		unsigned long long uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 68, "KTX2 headers are 68 bytes");
+	static_assert(sizeof(Ktx2Level) == 24, "KTX2 level entries are 24 bytes");
+
+	// Vulkan formats KTX2 files name, and the DXGI formats they match
+	struct FormatPair
+	{
+		unsigned int vkFormat;
+		unsigned int dxgiFormat;
+	};
+
+	const FormatPair VulkanFormats[] = {
+		{ 9, 61 },		// R8_UNORM
+		{ 16, 49 },		// R8G8_UNORM
+		{ 37, 28 },		// R8G8B8A8_UNORM
+		{ 43, 29 },		// R8G8B8A8_SRGB
+		{ 44, 87 },		// B8G8R8A8_UNORM
+		{ 50, 91 },		// B8G8R8A8_SRGB
+		{ 131, 71 },	// BC1_RGB_UNORM
+		{ 132, 72 },	// BC1_RGB_SRGB
+		{ 133, 71 },	// BC1_RGBA_UNORM
+		{ 134, 72 },	// BC1_RGBA_SRGB
+		{ 135, 74 },	// BC2_UNORM
+		{ 136, 75 },	// BC2_SRGB
+		{ 137, 77 },	// BC3_UNORM
+		{ 138, 78 },	// BC3_SRGB
+		{ 139, 80 },	// BC4_UNORM
+		{ 140, 81 },	// BC4_SNORM
+		{ 141, 83 },	// BC5_UNORM
+		{ 142, 84 },	// BC5_SNORM
+		{ 143, 95 },	// BC6H_UFLOAT
+		{ 144, 96 },	// BC6H_SFLOAT
+		{ 145, 98 },	// BC7_UNORM
+		{ 146, 99 },	// BC7_SRGB
+	};
+
+	unsigned int GetMaxMipCount(unsigned int width, unsigned int height)
+	{
+		unsigned int count = 1;
+		for (unsigned int size = (std::max)(width, height); size > 1; size /= 2)
+			count++;
+		return count;
+	}
+
+	// The DXGI format of a DDS file without the DX10 extension, or 0 if it's not supported
+	unsigned int GetLegacyDdsFormat(const DdsPixelFormat& format)
+	{
+		if (format.flags & DdsFile::PixelFormatFourCC)
+		{
+			const struct { char code[5]; unsigned int dxgiFormat; } fourCCs[] = {
+				{ "DXT1", 71 }, { "DXT2", 74 }, { "DXT3", 74 }, { "DXT4", 77 }, { "DXT5", 77 },
+				{ "ATI1", 80 }, { "BC4U", 80 }, { "BC4S", 81 }, { "ATI2", 83 }, { "BC5U", 83 }, { "BC5S", 84 },
+			};
+			for (const auto& entry : fourCCs)
+				if (format.fourCC == DdsFile::MakeFourCC(entry.code[0], entry.code[1], entry.code[2], entry.code[3]))
+					return entry.dxgiFormat;
+			return 0;
+		}
+
+		if ((format.flags & DdsFile::PixelFormatRgb) && format.rgbBitCount == 32)
+		{
+			if (format.rBitMask == 0xFF && format.gBitMask == 0xFF00 && format.bBitMask == 0xFF0000)
+				return 28; // R8G8B8A8_UNORM
+			if (format.rBitMask == 0xFF0000 && format.gBitMask == 0xFF00 && format.bBitMask == 0xFF)
+				return 87; // B8G8R8A8_UNORM
+		}
+		if ((format.flags & DdsFile::PixelFormatLuminance) && format.rgbBitCount == 8)
+			return 61; // R8_UNORM
+		return 0;
+	}
+}
+
+TextureFile::TextureFile(const char* path) :
+	file(path),
+	width(0),
+	height(0),
+	dxgiFormat(0)
+{
+	if (!file.IsOpen())
+		throw std::runtime_error(std::string("Error reading texture: can't open ") + path);
+
+	if (file.GetSize() >= sizeof(DdsFile::Magic) && memcmp(file.GetData(), DdsFile::Magic, sizeof(DdsFile::Magic)) == 0)
+		ReadDds();
+	else if (file.GetSize() >= sizeof(Ktx2Identifier) && memcmp(file.GetData(), Ktx2Identifier, sizeof(Ktx2Identifier)) == 0)
+		ReadKtx2();
+	else
+		throw std::runtime_error(std::string("Error reading texture: not a DDS or KTX2 file: ") + path);
+}
+
+unsigned int TextureFile::GetWidth() { return width; }
+unsigned int TextureFile::GetHeight() { return height; }
+unsigned int TextureFile::GetDxgiFormat() { return dxgiFormat; }
+unsigned int TextureFile::GetMipCount() { return (unsigned int)levels.size(); }
+const std::vector<TextureLevel>& TextureFile::GetLevels() { return levels; }
+
+// --------------------------------------------------------
+// Checks the size, format and mip count read from a header,
+// and sizes up every level (leaving their data to the caller)
+// --------------------------------------------------------
+void TextureFile::CheckLayout(unsigned int mipCount, const char* error)
+{
+	unsigned int blockSize, bytesPerBlock;
+	if (!GetFormatLayout(dxgiFormat, &blockSize, &bytesPerBlock))
+		throw std::runtime_error(std::string(error) + "unsupported format " + std::to_string(dxgiFormat));
+	if (width == 0 || height == 0 || width > 16384 || height > 16384)
+		throw std::runtime_error(std::string(error) + "bad size");
+	if (mipCount == 0 || mipCount > GetMaxMipCount(width, height))
+		throw std::runtime_error(std::string(error) + "bad mip count");
+
+	levels.resize(mipCount);
+	for (unsigned int i = 0; i < mipCount; i++)
+	{
+		TextureLevel& level = levels[i];
+		level.width = (std::max)(width >> i, 1u);
+		level.height = (std::max)(height >> i, 1u);
+		level.rowBytes = (level.width + blockSize - 1) / blockSize * bytesPerBlock;
+		level.rowCount = (level.height + blockSize - 1) / blockSize;
+		level.data = 0;
+	}
+}
+
+void TextureFile::ReadDds()
+{
+	const char* error = "Error reading DDS: ";
+	const unsigned char* data = (const unsigned char*)file.GetData();
+	size_t size = file.GetSize();
+
+	size_t position = sizeof(DdsFile::Magic);
+	if (size < position + sizeof(DdsHeader))
+		throw std::runtime_error(std::string(error) + "truncated header");
+	DdsHeader header;
+	memcpy(&header, data + position, sizeof(header));
+	position += sizeof(header);
+	if (header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat))
+		throw std::runtime_error(std::string(error) + "bad header size");
+	if (header.caps2 & (DdsFile::Caps2CubeMap | DdsFile::Caps2Volume))
+		throw std::runtime_error(std::string(error) + "only 2D textures are supported");
+
+	if ((header.pixelFormat.flags & DdsFile::PixelFormatFourCC) && header.pixelFormat.fourCC == DdsFile::MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (size < position + sizeof(DdsHeaderDX10))
+			throw std::runtime_error(std::string(error) + "truncated DX10 header");
+		DdsHeaderDX10 extension;
+		memcpy(&extension, data + position, sizeof(extension));
+		position += sizeof(extension);
+		if (extension.resourceDimension != DdsFile::ResourceDimensionTexture2D || extension.arraySize > 1 || (extension.miscFlag & DdsFile::MiscTextureCube))
+			throw std::runtime_error(std::string(error) + "only 2D textures are supported");
+		dxgiFormat = extension.dxgiFormat;
+	}
+	else
+	{
+		dxgiFormat = GetLegacyDdsFormat(header.pixelFormat);
+	}
+
+	width = header.width;
+	height = header.height;
+	CheckLayout((std::max)(header.mipMapCount, 1u), error);
+
+	// The levels follow the headers, largest first
+	for (TextureLevel& level : levels)
+	{
+		size_t levelBytes = (size_t)level.rowBytes * level.rowCount;
+		if (size - position < levelBytes)
+			throw std::runtime_error(std::string(error) + "truncated data");
+		level.data = data + position;
+		position += levelBytes;
+	}
+}
+
+void TextureFile::ReadKtx2()
+{
+	const char* error = "Error reading KTX2: ";
+	const unsigned char* data = (const unsigned char*)file.GetData();
+	size_t size = file.GetSize();
+
+	size_t position = sizeof(Ktx2Identifier);
+	if (size < position + sizeof(Ktx2Header))
+		throw std::runtime_error(std::string(error) + "truncated header");
+	Ktx2Header header;
+	memcpy(&header, data + position, sizeof(header));
+	position += sizeof(header);
+
+	if (header.supercompressionScheme != 0)
+		throw std::runtime_error(std::string(error) + "supercompressed files aren't supported");
+	if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+		throw std::runtime_error(std::string(error) + "only 2D textures are supported");
+
+	dxgiFormat = 0;
+	for (const FormatPair& pair : VulkanFormats)
+		if (pair.vkFormat == header.vkFormat)
+			dxgiFormat = pair.dxgiFormat;
+
+	width = header.pixelWidth;
+	height = header.pixelHeight;
+	unsigned int mipCount = (std::max)(header.levelCount, 1u); // 0 asks for mips to be generated, which we don't
+	CheckLayout(mipCount, error);
+
+	if ((size - position) / sizeof(Ktx2Level) < mipCount)
+		throw std::runtime_error(std::string(error) + "truncated level index");
+	for (unsigned int i = 0; i < mipCount; i++)
+	{
+		Ktx2Level entry;
+		memcpy(&entry, data + position + i * sizeof(Ktx2Level), sizeof(entry));
+
+		TextureLevel& level = levels[i];
+		unsigned long long levelBytes = (unsigned long long)level.rowBytes * level.rowCount;
+		if (entry.byteLength != levelBytes || entry.byteOffset > size || size - entry.byteOffset < levelBytes)
+			throw std::runtime_error(std::string(error) + "level " + std::to_string(i) + " is the wrong size or out of bounds");
+		level.data = data + entry.byteOffset;
+	}
+}
+
+// --------------------------------------------------------
+// Footprints of this file's levels
+// --------------------------------------------------------
+unsigned long long TextureFile::ComputeFootprints(std::vector<TextureFootprint>& footprints)
+{
+	return ComputeFootprints(dxgiFormat, width, height, (unsigned int)levels.size(), footprints);
+}
+
+// --------------------------------------------------------
+// Copies each level row by row into its footprint, straight
+// from the mapped file. footprints must come from
+// ComputeFootprints() on this file
+// --------------------------------------------------------
+void TextureFile::CopyLevels(const std::vector<TextureFootprint>& footprints, unsigned char* staging)
+{
+	if (footprints.size() != levels.size())
+		throw std::invalid_argument("Footprints don't match the texture's levels");
+
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		const TextureLevel& level = levels[i];
+		const TextureFootprint& footprint = footprints[i];
+		unsigned char* destination = staging + footprint.offset;
+		if (footprint.rowPitch == level.rowBytes)
+		{
+			memcpy(destination, level.data, (size_t)level.rowBytes * level.rowCount);
+			continue;
+		}
+		for (unsigned int row = 0; row < level.rowCount; row++)
+			memcpy(destination + (size_t)row * footprint.rowPitch, level.data + (size_t)row * level.rowBytes, level.rowBytes);
+	}
+}
+
+bool TextureFile::GetFormatLayout(unsigned int dxgiFormat, unsigned int* blockSize, unsigned int* bytesPerBlock)
+{
+	*blockSize = 1;
+	if (dxgiFormat >= 70 && dxgiFormat <= 72) { *blockSize = 4; *bytesPerBlock = 8; }		// BC1
+	else if (dxgiFormat >= 73 && dxgiFormat <= 78) { *blockSize = 4; *bytesPerBlock = 16; }	// BC2, BC3
+	else if (dxgiFormat >= 79 && dxgiFormat <= 81) { *blockSize = 4; *bytesPerBlock = 8; }	// BC4
+	else if (dxgiFormat >= 82 && dxgiFormat <= 84) { *blockSize = 4; *bytesPerBlock = 16; }	// BC5
+	else if (dxgiFormat >= 94 && dxgiFormat <= 99) { *blockSize = 4; *bytesPerBlock = 16; }	// BC6H, BC7
+	else if (dxgiFormat >= 27 && dxgiFormat <= 32) *bytesPerBlock = 4;						// R8G8B8A8
+	else if (dxgiFormat >= 87 && dxgiFormat <= 88) *bytesPerBlock = 4;						// B8G8R8A8, B8G8R8X8
+	else if (dxgiFormat >= 90 && dxgiFormat <= 93) *bytesPerBlock = 4;						// B8G8R8A8, B8G8R8X8 (typeless/sRGB)
+	else if (dxgiFormat >= 48 && dxgiFormat <= 52) *bytesPerBlock = 2;						// R8G8
+	else if (dxgiFormat >= 60 && dxgiFormat <= 65) *bytesPerBlock = 1;						// R8, A8
+	else return false;
+	return true;
+}
+
+// --------------------------------------------------------
+// Works out where each of mipCount levels goes in staging
+// memory, matching GetCopyableFootprints(): rows padded to
+// PitchAlignment, levels starting on PlacementAlignment, the
+// last row of each level not padded, and block compressed
+// levels' sizes rounded up to whole blocks (which copies need,
+// even for 1x1 and 2x2 mips). Returns the total bytes (0 if
+// the format isn't supported)
+// --------------------------------------------------------
+unsigned long long TextureFile::ComputeFootprints(unsigned int dxgiFormat, unsigned int width, unsigned int height, unsigned int mipCount, std::vector<TextureFootprint>& footprints)
+{
+	footprints.clear();
+	unsigned int blockSize, bytesPerBlock;
+	if (!GetFormatLayout(dxgiFormat, &blockSize, &bytesPerBlock))
+		return 0;
+
+	unsigned long long total = 0;
+	for (unsigned int i = 0; i < mipCount; i++)
+	{
+		TextureFootprint footprint;
+		footprint.rowBytes = ((std::max)(width >> i, 1u) + blockSize - 1) / blockSize * bytesPerBlock;
+		footprint.rowCount = ((std::max)(height >> i, 1u) + blockSize - 1) / blockSize;
+		footprint.width = footprint.rowBytes / bytesPerBlock * blockSize;
+		footprint.height = footprint.rowCount * blockSize;
+		footprint.rowPitch = (footprint.rowBytes + PitchAlignment - 1) / PitchAlignment * PitchAlignment;
+		footprint.offset = (total + PlacementAlignment - 1) / PlacementAlignment * PlacementAlignment;
+		total = footprint.offset + (unsigned long long)footprint.rowPitch * (footprint.rowCount - 1) + footprint.rowBytes;
+		footprints.push_back(footprint);
+	}
+	return total;
+}
+
+size_t TextureFile::GetLevelSize(unsigned int dxgiFormat, unsigned int width, unsigned int height)
+{
+	unsigned int blockSize, bytesPerBlock;
+	if (!GetFormatLayout(dxgiFormat, &blockSize, &bytesPerBlock))
+		return 0;
+	return (size_t)((width + blockSize - 1) / blockSize) * ((height + blockSize - 1) / blockSize) * bytesPerBlock;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "MappedFile.h"
+
+// --------------------------------------------------------
+// One mip level as stored in a texture file: rows of pixels
+// (or of 4x4 blocks, for block compressed formats) back to
+// back, pointing into the file's mapping
+// --------------------------------------------------------
+struct TextureLevel
+{
+	unsigned int width;
+	unsigned int height;
+	unsigned int rowBytes;		// Bytes in one row of pixels or blocks
+	unsigned int rowCount;		// Rows of pixels or blocks
+	const unsigned char* data;	// rowBytes * rowCount bytes
+};
+
+// --------------------------------------------------------
+// Where one mip level goes in staging memory for a texture
+// copy - the layout ID3D12Device::GetCopyableFootprints()
+// gives, worked out without a device
+// --------------------------------------------------------
+struct TextureFootprint
+{
+	unsigned long long offset;	// From the start of the texture's staging space
+	unsigned int width;			// Rounded up to whole blocks
+	unsigned int height;		// Rounded up to whole blocks
+	unsigned int rowPitch;		// Bytes from one row to the next
+	unsigned int rowBytes;		// Bytes of data in each row
+	unsigned int rowCount;
+};
+
+/*
+* A pre-baked 2D texture (.dds or .ktx2), memory-mapped and ready to copy to the GPU as stored -
+* no decoding, and no copies of the data other than the one into staging memory.
+*
+* The constructor maps the file and reads its header, throwing if it isn't a 2D texture in a
+* supported format (the formats TextureCompressor writes, plus the other BC formats and plain
+* 8-bit ones) or is too short for the levels it claims. .ktx2 files must not use
+* supercompression. Formats are DXGI_FORMAT values, spelled out as plain numbers so all of this
+* works (and can be tested) without any Windows headers.
+*
+* Staging layout follows D3D12's rules: each level starts on a PlacementAlignment boundary and
+* each row on a PitchAlignment boundary (so rows are usually padded).
+*
+* GetLevels(): Every mip level, largest first
+* ComputeFootprints(): Fills in each level's staging layout, returning the total bytes needed
+* CopyLevels(): Copies every level from the file into staging memory laid out as footprints
+* GetFormatLayout(): Pixels per block side (1, or 4 for block compressed formats) and bytes per
+*                    block (or pixel) of a DXGI format - false if it isn't supported
+* GetLevelSize(): Bytes a level of the given size takes in a format when tightly packed
+*/
+class TextureFile
+{
+public:
+	static const unsigned int PitchAlignment = 256;		// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+	static const unsigned int PlacementAlignment = 512;	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+	TextureFile(const char* path);
+
+	unsigned int GetWidth();
+	unsigned int GetHeight();
+	unsigned int GetDxgiFormat();
+	unsigned int GetMipCount();
+	const std::vector<TextureLevel>& GetLevels();
+
+	unsigned long long ComputeFootprints(std::vector<TextureFootprint>& footprints);
+	void CopyLevels(const std::vector<TextureFootprint>& footprints, unsigned char* staging);
+
+	static bool GetFormatLayout(unsigned int dxgiFormat, unsigned int* blockSize, unsigned int* bytesPerBlock);
+	static unsigned long long ComputeFootprints(unsigned int dxgiFormat, unsigned int width, unsigned int height, unsigned int mipCount, std::vector<TextureFootprint>& footprints);
+	static size_t GetLevelSize(unsigned int dxgiFormat, unsigned int width, unsigned int height);
+
+private:
+	void ReadDds();
+	void ReadKtx2();
+	void CheckLayout(unsigned int mipCount, const char* error);
+
+	MappedFile file;
+	unsigned int width;
+	unsigned int height;
+	unsigned int dxgiFormat;
+	std::vector<TextureLevel> levels;
+};
@@ -0,0 +1,130 @@
+#include "ThreadPool.h"
+
+namespace
+{
+	// Set on pool worker threads, and on the calling thread while it runs jobs,
+	// so nested ParallelFor calls run serially instead of deadlocking on runMutex
+	thread_local bool insideWorker = false;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+	job(0),
+	jobCount(0),
+	generation(0),
+	busyWorkers(0),
+	quitting(false),
+	nextJob(0)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+
+	// The calling thread always helps out, so it counts as one of the threads
+	for (unsigned int i = 1; i < threadCount; i++)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quitting = true;
+	}
+	wake.notify_all();
+	for (std::thread& t : workers)
+		t.join();
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+unsigned int ThreadPool::GetThreadCount() { return (unsigned int)workers.size() + 1; }
+
+// --------------------------------------------------------
+// Runs job(i) for every i in [0, count) and waits for all of them
+// --------------------------------------------------------
+void ThreadPool::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& j)
+{
+	// Nothing to share, or we're already on a worker: just run it here
+	if (count <= 1 || workers.empty() || insideWorker)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			j(i);
+		return;
+	}
+
+	std::lock_guard<std::mutex> run(runMutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &j;
+		jobCount = count;
+		nextJob = 0;
+		firstError = 0;
+		busyWorkers = (unsigned int)workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	// The caller runs jobs too, and a job that calls ParallelFor
+	// again must not wait on runMutex, which this call holds
+	bool wasInsideWorker = insideWorker;
+	insideWorker = true;
+	RunJobs();
+	insideWorker = wasInsideWorker;
+
+	// Wait for every worker to check back in before the job goes out of scope
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&] { return busyWorkers == 0; });
+		job = 0;
+		error = firstError;
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+// --------------------------------------------------------
+// Grabs job indices until there are none left
+// --------------------------------------------------------
+void ThreadPool::RunJobs()
+{
+	unsigned int i;
+	while ((i = nextJob.fetch_add(1)) < jobCount)
+	{
+		try
+		{
+			(*job)(i);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!firstError)
+				firstError = std::current_exception();
+		}
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	insideWorker = true;
+	unsigned int seenGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quitting || generation != seenGeneration; });
+			if (quitting)
+				return;
+			seenGeneration = generation;
+		}
+
+		RunJobs();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busyWorkers == 0)
+			done.notify_one();
+	}
+}
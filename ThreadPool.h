@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* A fixed set of worker threads for splitting CPU work (asset loading, processing) into pieces.
+*
+* ParallelFor(): Runs job(0) ... job(count - 1) across the workers and the calling thread,
+*                returning once all of them are done. The first exception thrown by a job
+*                is re-thrown on the calling thread. Calls made from inside a job run serially.
+* GetThreadCount(): Number of threads that take part in a ParallelFor (workers + caller)
+* Shared(): A pool with one thread per hardware thread, created on first use
+*/
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int threadCount = 0); // 0 means one per hardware thread
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete; // Remove copy constructor
+	ThreadPool& operator=(const ThreadPool&) = delete; // Remove copy-assignment operator
+
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& job);
+	unsigned int GetThreadCount();
+
+	static ThreadPool& Shared();
+
+private:
+	void WorkerLoop();
+	void RunJobs();
+
+	std::vector<std::thread> workers;
+	std::mutex runMutex; // Only one ParallelFor at a time
+
+	// State of the current ParallelFor, guarded by mutex
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(unsigned int)>* job;
+	unsigned int jobCount;
+	unsigned int generation;
+	unsigned int busyWorkers;
+	bool quitting;
+	std::exception_ptr firstError;
+
+	std::atomic<unsigned int> nextJob;
+};
@@ -1,6 +1,6 @@
 #include "Transform.h"
 
-Transform::Transform()
+Transform::Transform() : version(0)
 {
 	SetPosition(0.0f, 0.0f, 0.0f);
 	SetScale(1.0f, 1.0f, 1.0f);
@@ -14,12 +14,12 @@ Transform::Transform()
 	edited = 0;
 }
 
-void Transform::SetPosition(float x, float y, float z) { position = DirectX::XMFLOAT3(x, y, z); edited++; };
-void Transform::SetPosition(DirectX::XMFLOAT3 pos) { position = pos; edited++; }
-void Transform::SetRotation(float pitch, float yaw, float roll) { rotation = DirectX::XMFLOAT3(pitch, yaw, roll); edited++; }
-void Transform::SetRotation(DirectX::XMFLOAT3 ro) { rotation = ro; edited++; } // XMFLOAT4 for quaternion
-void Transform::SetScale(float x, float y, float z) { scale = DirectX::XMFLOAT3(x, y, z); edited++; }
-void Transform::SetScale(DirectX::XMFLOAT3 s) { scale = s; edited++; }
+void Transform::SetPosition(float x, float y, float z) { position = DirectX::XMFLOAT3(x, y, z); edited++; version++; };
+void Transform::SetPosition(DirectX::XMFLOAT3 pos) { position = pos; edited++; version++; }
+void Transform::SetRotation(float pitch, float yaw, float roll) { rotation = DirectX::XMFLOAT3(pitch, yaw, roll); edited++; version++; }
+void Transform::SetRotation(DirectX::XMFLOAT3 ro) { rotation = ro; edited++; version++; } // XMFLOAT4 for quaternion
+void Transform::SetScale(float x, float y, float z) { scale = DirectX::XMFLOAT3(x, y, z); edited++; version++; }
+void Transform::SetScale(DirectX::XMFLOAT3 s) { scale = s; edited++; version++; }
 
 //Getters
 DirectX::XMFLOAT3 Transform::GetPosition() { return position; }
@@ -28,6 +28,7 @@ DirectX::XMFLOAT3 Transform::GetScale() { return scale; }
 DirectX::XMFLOAT3 Transform::GetForward() { return relForward; }
 DirectX::XMFLOAT3 Transform::GetRight() { return relRight; }
 DirectX::XMFLOAT3 Transform::GetUp() { return relUp; }
+unsigned int Transform::GetVersion() { return version; }
 
 
 //Movements - Simplified by performing Math and Load within the Store function
@@ -35,12 +36,14 @@ void Transform::MoveAbsolute(float x, float y, float z)
 {
 	DirectX::XMStoreFloat3(&position, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&position), DirectX::XMVectorSet(x, y, z, 1.0f)));
 	edited++;
+	version++;
 }
 
 void Transform::MoveAbsolute(DirectX::XMFLOAT3 offset)
 {
 	DirectX::XMStoreFloat3(&position, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&position), DirectX::XMVectorSet(offset.x, offset.y, offset.z, 1.0f)));
 	edited++;
+	version++;
 }
 
 void Transform::CalculateOrientation()
@@ -59,6 +62,7 @@ void Transform::Rotate(float pitch, float yaw, float roll)
 	DirectX::XMStoreFloat3(&rotation, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&rotation), DirectX::XMVectorSet(pitch, yaw, roll, 1.0f)));
 	CalculateOrientation();
 	edited++;
+	version++;
 }
 
 void Transform::Rotate(DirectX::XMFLOAT3 ro)
@@ -66,6 +70,7 @@ void Transform::Rotate(DirectX::XMFLOAT3 ro)
 	DirectX::XMStoreFloat3(&rotation, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&rotation), DirectX::XMVectorSet(ro.x, ro.y, ro.z, 1.0f)));
 	CalculateOrientation();
 	edited++;
+	version++;
 }
 
 // Scale needs to be multiplied!
@@ -73,12 +78,14 @@ void Transform::Scale(float x, float y, float z)
 {
 	DirectX::XMStoreFloat3(&rotation, DirectX::XMVectorMultiply(DirectX::XMLoadFloat3(&scale), DirectX::XMVectorSet(x, y, z, 1.0f)));
 	edited++;
+	version++;
 }
 
 void Transform::Scale(DirectX::XMFLOAT3 scale)
 {
 	DirectX::XMStoreFloat3(&rotation, DirectX::XMVectorMultiply(DirectX::XMLoadFloat3(&scale), DirectX::XMVectorSet(scale.x, scale.y, scale.z, 1.0f)));
 	edited++;
+	version++;
 }
 
 // Checks if any edits have been made using a counter. If there are edits it will recalculate, otherwise, it will return the float4x4 as is. 
@@ -113,6 +120,7 @@ void Transform::MoveRelative(DirectX::XMFLOAT3 offset)
 			DirectX::XMLoadFloat3(&iUp))
 	));
 	edited++;
+	version++;
 }
 
 void Transform::MoveRelative(float x, float y, float z)
@@ -128,4 +136,5 @@ void Transform::MoveRelative(float x, float y, float z)
 			DirectX::XMLoadFloat3(&iUp))
 	));
 	edited++;
+	version++;
 }
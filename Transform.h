@@ -20,6 +20,7 @@ public:
 	DirectX::XMFLOAT3 GetForward();
 	DirectX::XMFLOAT3 GetRight();
 	DirectX::XMFLOAT3 GetUp();
+	unsigned int GetVersion();  // Changes whenever the world matrix does, for caching things derived from it
 
 	//Movements
 	void MoveAbsolute(float x, float y, float z);
@@ -39,4 +40,5 @@ private:
 	DirectX::XMFLOAT3 relUp, relForward, relRight;
 	DirectX::XMFLOAT4X4 world, worldInverseT;
 	int edited;
+	unsigned int version;
 };
\ No newline at end of file
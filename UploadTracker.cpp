@@ -0,0 +1,74 @@
+#include "UploadTracker.h"
+#include <stdexcept>
+
+UploadTracker::UploadTracker(size_t stagingBytes) :
+	staging(stagingBytes),
+	lastSubmitted(0),
+	completed(0)
+{
+}
+
+UploadTicket UploadTracker::GetOpenTicket() { return lastSubmitted + 1; }
+UploadTicket UploadTracker::GetLastSubmitted() { return lastSubmitted; }
+UploadTicket UploadTracker::GetCompleted() { return completed; }
+
+size_t UploadTracker::AllocateStaging(size_t size, size_t alignment) { return staging.Allocate(size, alignment); }
+size_t UploadTracker::GetStagingCapacity() { return staging.GetCapacity(); }
+size_t UploadTracker::GetStagingUsed() { return staging.GetUsed(); }
+
+// --------------------------------------------------------
+// Picks the allocator that finished longest ago, so one
+// that was just submitted isn't reset while still in use
+// --------------------------------------------------------
+int UploadTracker::AcquireAllocator()
+{
+	int best = -1;
+	for (size_t a = 0; a < allocatorTickets.size(); a++)
+	{
+		if (allocatorInUse[a] || allocatorTickets[a] > completed)
+			continue;
+		if (best < 0 || allocatorTickets[a] < allocatorTickets[best])
+			best = (int)a;
+	}
+
+	if (best >= 0)
+		allocatorInUse[best] = true;
+	return best;
+}
+
+unsigned int UploadTracker::AddAllocator()
+{
+	allocatorTickets.push_back(0);
+	allocatorInUse.push_back(true);
+	return (unsigned int)allocatorTickets.size() - 1;
+}
+
+size_t UploadTracker::GetAllocatorCount() { return allocatorTickets.size(); }
+
+// --------------------------------------------------------
+// Closes the open batch, which was recorded with the given
+// allocator, and returns its ticket. The caller signals the
+// fence with that value once the batch is on the queue.
+// --------------------------------------------------------
+UploadTicket UploadTracker::Submit(unsigned int allocator)
+{
+	if (allocator >= allocatorTickets.size() || !allocatorInUse[allocator])
+		throw std::invalid_argument("Batches must be recorded with an acquired allocator");
+
+	lastSubmitted++;
+	staging.Submit(lastSubmitted);
+	allocatorTickets[allocator] = lastSubmitted;
+	allocatorInUse[allocator] = false;
+	return lastSubmitted;
+}
+
+void UploadTracker::Update(unsigned long long completedFenceValue)
+{
+	if (completedFenceValue <= completed)
+		return;
+
+	completed = completedFenceValue;
+	staging.Retire(completed);
+}
+
+bool UploadTracker::IsComplete(UploadTicket ticket) { return ticket <= completed; }
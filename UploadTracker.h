@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "StagingAllocator.h"
+
+// --------------------------------------------------------
+// Identifies a batch of uploads: the value the copy queue's
+// fence reaches once all of the batch's copies are done.
+// 0 is never handed out, so it always counts as complete.
+// --------------------------------------------------------
+typedef unsigned long long UploadTicket;
+
+/*
+* The CPU side of asynchronous uploads: which batch is being recorded, which have been submitted
+* and which the GPU has finished, plus everything that can only be reused once a batch is done.
+* It never touches the GPU - the caller reports the fence's completed value with Update(), so a
+* plain counter can stand in for the fence.
+*
+* Tickets are numbered in submission order, one per batch, and the open batch's ticket is
+* known before it's submitted, so each upload can be given the ticket it will complete with.
+*
+* GetOpenTicket(): The ticket the batch currently being recorded will get
+* AllocateStaging(): Space for an upload in the staging ring, or StagingAllocator::InvalidOffset
+* AcquireAllocator(): A command allocator (by index) that no unfinished batch is using, or -1
+*                     if there's none and AddAllocator() should be called for a new one
+* Submit(): Closes the open batch, tying its staging memory and allocator to its ticket
+* Update(): Records how far the fence has gotten, recycling whatever it has freed up
+* IsComplete(): Whether every copy with this ticket is done
+*/
+class UploadTracker
+{
+public:
+	UploadTracker(size_t stagingBytes);
+
+	UploadTicket GetOpenTicket();
+	UploadTicket GetLastSubmitted();
+	UploadTicket GetCompleted();
+
+	size_t AllocateStaging(size_t size, size_t alignment);
+	size_t GetStagingCapacity();
+	size_t GetStagingUsed();
+
+	int AcquireAllocator();
+	unsigned int AddAllocator();
+	size_t GetAllocatorCount();
+
+	UploadTicket Submit(unsigned int allocator);
+	void Update(unsigned long long completedFenceValue);
+	bool IsComplete(UploadTicket ticket);
+
+private:
+	StagingAllocator staging;
+	UploadTicket lastSubmitted;
+	UploadTicket completed;
+
+	// The ticket of the last batch each command allocator recorded (0 if none)
+	std::vector<UploadTicket> allocatorTickets;
+	std::vector<bool> allocatorInUse;
+};
@@ -15,3 +15,13 @@ struct Vertex
 	DirectX::XMFLOAT3 Tangent;
 };
 
+// --------------------------------------------------------
+// Everything in a Vertex but its position, for meshes that
+// keep positions in a separate, tightly packed stream
+// --------------------------------------------------------
+struct VertexAttributes
+{
+	DirectX::XMFLOAT2 UV;
+	DirectX::XMFLOAT3 Normal;
+	DirectX::XMFLOAT3 Tangent;
+};
@@ -0,0 +1,161 @@
+#include "VertexQuantization.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// Keeps flat meshes (like a quad) from dividing by zero
+	const float MinimumExtent = 1e-6f;
+
+	XMVECTOR XM_CALLCONV BoundsScale(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+	{
+		XMVECTOR extent = XMVectorSubtract(XMLoadFloat3(&boundsMax), XMLoadFloat3(&boundsMin));
+		return XMVectorMax(extent, XMVectorReplicate(MinimumExtent));
+	}
+
+	float AngleDegrees(FXMVECTOR a, FXMVECTOR b)
+	{
+		float cosine = XMVectorGetX(XMVector3Dot(XMVector3Normalize(a), XMVector3Normalize(b)));
+		return XMConvertToDegrees(std::acos(std::clamp(cosine, -1.0f, 1.0f)));
+	}
+}
+
+// --------------------------------------------------------
+// Octahedral mapping (Meyer et al., "On Floating-Point Normal Vectors")
+// - Projects onto the octahedron |x|+|y|+|z| = 1, then folds
+//   the lower half over the upper half
+// --------------------------------------------------------
+XMVECTOR XM_CALLCONV VertexQuantization::EncodeOctahedral(FXMVECTOR unitVector)
+{
+	XMVECTOR absolute = XMVectorAbs(unitVector);
+	XMVECTOR l1 = XMVector3Dot(absolute, XMVectorSplatOne());
+	XMVECTOR n = XMVectorDivide(unitVector, XMVectorMax(l1, XMVectorReplicate(1e-20f)));
+
+	// Lower hemisphere: (1 - |yx|) * sign(xy), where sign(0) is positive
+	XMVECTOR sign = XMVectorSelect(XMVectorSplatOne(), XMVectorNegate(XMVectorSplatOne()), XMVectorLess(n, XMVectorZero()));
+	XMVECTOR folded = XMVectorMultiply(XMVectorSubtract(XMVectorSplatOne(), XMVectorAbs(XMVectorSwizzle<1, 0, 2, 3>(n))), sign);
+
+	XMVECTOR lower = XMVectorLess(XMVectorSplatZ(n), XMVectorZero());
+	return XMVectorSelect(n, folded, lower);
+}
+
+XMVECTOR XM_CALLCONV VertexQuantization::DecodeOctahedral(FXMVECTOR octahedral)
+{
+	// z = 1 - |x| - |y|, then unfold x and y if z went negative
+	XMVECTOR absolute = XMVectorAbs(octahedral);
+	float z = 1.0f - XMVectorGetX(absolute) - XMVectorGetY(absolute);
+	XMVECTOR t = XMVectorReplicate(std::max(-z, 0.0f));
+	XMVECTOR xy = XMVectorSelect(XMVectorAdd(octahedral, t), XMVectorSubtract(octahedral, t), XMVectorGreaterOrEqual(octahedral, XMVectorZero()));
+
+	return XMVector3Normalize(XMVectorSetZ(xy, z));
+}
+
+// --------------------------------------------------------
+// Axis-aligned bounds of a set of positions
+// --------------------------------------------------------
+void VertexQuantization::ComputeBounds(const Vertex* vertices, size_t count, XMFLOAT3* boundsMin, XMFLOAT3* boundsMax)
+{
+	XMVECTOR minimum = XMVectorZero();
+	XMVECTOR maximum = XMVectorZero();
+	for (size_t i = 0; i < count; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&vertices[i].Position);
+		minimum = i == 0 ? p : XMVectorMin(minimum, p);
+		maximum = i == 0 ? p : XMVectorMax(maximum, p);
+	}
+
+	XMStoreFloat3(boundsMin, minimum);
+	XMStoreFloat3(boundsMax, maximum);
+}
+
+// --------------------------------------------------------
+// Quantizes vertices into the compact format
+// - Positions outside the bounds are clamped
+// - Normals and tangents are expected to be (roughly) unit length
+// --------------------------------------------------------
+void VertexQuantization::Encode(CompactVertex* destination, const Vertex* vertices, size_t count, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	XMVECTOR origin = XMLoadFloat3(&boundsMin);
+	XMVECTOR inverseScale = XMVectorReciprocal(BoundsScale(boundsMin, boundsMax));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& v = vertices[i];
+		CompactVertex& out = destination[i];
+
+		XMVECTOR position = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&v.Position), origin), inverseScale);
+		XMStoreUShortN4(&out.Position, XMVectorSaturate(position));
+
+		XMStoreHalf2(&out.UV, XMLoadFloat2(&v.UV));
+
+		XMStoreShortN2(&out.Normal, EncodeOctahedral(XMLoadFloat3(&v.Normal)));
+		XMStoreShortN2(&out.Tangent, EncodeOctahedral(XMLoadFloat3(&v.Tangent)));
+	}
+}
+
+// --------------------------------------------------------
+// CPU version of the decode in VertexShader.hlsl
+// --------------------------------------------------------
+Vertex VertexQuantization::Decode(const CompactVertex& vertex, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	Vertex v = {};
+
+	XMVECTOR position = XMLoadUShortN4(&vertex.Position);
+	position = XMVectorMultiplyAdd(position, BoundsScale(boundsMin, boundsMax), XMLoadFloat3(&boundsMin));
+	XMStoreFloat3(&v.Position, position);
+
+	XMStoreFloat2(&v.UV, XMLoadHalf2(&vertex.UV));
+	XMStoreFloat3(&v.Normal, DecodeOctahedral(XMLoadShortN2(&vertex.Normal)));
+	XMStoreFloat3(&v.Tangent, DecodeOctahedral(XMLoadShortN2(&vertex.Tangent)));
+	return v;
+}
+
+// --------------------------------------------------------
+// Round trips every vertex through the compact format and
+// reports the largest error of each attribute
+// --------------------------------------------------------
+QuantizationError VertexQuantization::MeasureError(const Vertex* vertices, size_t count)
+{
+	QuantizationError error = {};
+	if (count == 0)
+		return error;
+
+	XMFLOAT3 boundsMin, boundsMax;
+	ComputeBounds(vertices, count, &boundsMin, &boundsMax);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		CompactVertex compact;
+		Encode(&compact, &vertices[i], 1, boundsMin, boundsMax);
+		Vertex decoded = Decode(compact, boundsMin, boundsMax);
+
+		XMVECTOR positionDelta = XMVectorAbs(XMVectorSubtract(XMLoadFloat3(&vertices[i].Position), XMLoadFloat3(&decoded.Position)));
+		XMVECTOR uvDelta = XMVectorAbs(XMVectorSubtract(XMLoadFloat2(&vertices[i].UV), XMLoadFloat2(&decoded.UV)));
+		error.position = std::max(error.position, std::max({ XMVectorGetX(positionDelta), XMVectorGetY(positionDelta), XMVectorGetZ(positionDelta) }));
+		error.uv = std::max(error.uv, std::max(XMVectorGetX(uvDelta), XMVectorGetY(uvDelta)));
+
+		// Zero length vectors (e.g. missing normals) have no direction to lose
+		if (XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&vertices[i].Normal))) > 0.0f)
+			error.normalDegrees = std::max(error.normalDegrees, AngleDegrees(XMLoadFloat3(&vertices[i].Normal), XMLoadFloat3(&decoded.Normal)));
+		if (XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&vertices[i].Tangent))) > 0.0f)
+			error.tangentDegrees = std::max(error.tangentDegrees, AngleDegrees(XMLoadFloat3(&vertices[i].Tangent), XMLoadFloat3(&decoded.Tangent)));
+	}
+
+	return error;
+}
+
+// --------------------------------------------------------
+// Checks every UV against MaxHalfPrecisionUV
+// --------------------------------------------------------
+bool VertexQuantization::FitsHalfPrecisionUVs(const Vertex* vertices, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		if (std::abs(vertices[i].UV.x) > MaxHalfPrecisionUV || std::abs(vertices[i].UV.y) > MaxHalfPrecisionUV)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A 20 byte version of Vertex (vs 44 bytes):
+//  - Position: 16-bit unorm, relative to the mesh's bounds (w unused)
+//  - UV: half floats
+//  - Normal & Tangent: octahedral encoded, 16-bit snorm per component
+//
+// Must match CompactVertex in VertexShader.hlsl
+// --------------------------------------------------------
+struct CompactVertex
+{
+	DirectX::PackedVector::XMUSHORTN4 Position;
+	DirectX::PackedVector::XMHALF2 UV;
+	DirectX::PackedVector::XMSHORTN2 Normal;
+	DirectX::PackedVector::XMSHORTN2 Tangent;
+};
+
+// --------------------------------------------------------
+// CompactVertex without its position (12 bytes), for meshes
+// whose positions are stored in their own stream
+//
+// Must match CompactVertexAttributes in VertexShader.hlsl
+// --------------------------------------------------------
+struct CompactVertexAttributes
+{
+	DirectX::PackedVector::XMHALF2 UV;
+	DirectX::PackedVector::XMSHORTN2 Normal;
+	DirectX::PackedVector::XMSHORTN2 Tangent;
+};
+
+// --------------------------------------------------------
+// Largest |u| or |v| stored as half floats. Below 2, halves
+// are at most 1/2048 off (about a texel of a 2K texture),
+// but the error doubles with every power of two after that
+// --------------------------------------------------------
+const float MaxHalfPrecisionUV = 2.0f;
+
+// --------------------------------------------------------
+// Worst-case round trip error over a set of vertices
+// --------------------------------------------------------
+struct QuantizationError
+{
+	float position;			// Object space units
+	float uv;
+	float normalDegrees;
+	float tangentDegrees;
+};
+
+/*
+* Converts between Vertex and CompactVertex. Encoding uses DirectXMath's vector
+* functions (SSE on x86), and Decode() mirrors the vertex shader exactly so
+* MeasureError() reports what the GPU will actually see.
+*
+* ComputeBounds(): Axis-aligned bounds of the positions, which positions are quantized against
+* Encode(): Quantizes an array of vertices
+* Decode(): Expands a single vertex back to full precision
+* MeasureError(): Encodes and decodes every vertex, returning the largest errors
+* FitsHalfPrecisionUVs(): Whether every UV is within MaxHalfPrecisionUV - meshes with tiled
+*                         UVs outside it should keep full Vertex data instead
+* EncodeOctahedral() / DecodeOctahedral(): Unit vector <-> 2D octahedral map in [-1, 1]
+*/
+namespace VertexQuantization
+{
+	void ComputeBounds(const Vertex* vertices, size_t count, DirectX::XMFLOAT3* boundsMin, DirectX::XMFLOAT3* boundsMax);
+
+	void Encode(CompactVertex* destination, const Vertex* vertices, size_t count, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+	Vertex Decode(const CompactVertex& vertex, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+
+	QuantizationError MeasureError(const Vertex* vertices, size_t count);
+	bool FitsHalfPrecisionUVs(const Vertex* vertices, size_t count);
+
+	DirectX::XMVECTOR XM_CALLCONV EncodeOctahedral(DirectX::FXMVECTOR unitVector);
+	DirectX::XMVECTOR XM_CALLCONV DecodeOctahedral(DirectX::FXMVECTOR octahedral);
+}
@@ -7,6 +7,7 @@ cbuffer BindlessData : register(b0)
     uint vsConstEachIndex;
     uint psConstAllIndex;
     uint psConstEachIndex;
+    uint vsVertexByteOffset;
 }
 
 /* Struct representing a single vertex worth of data -- NOT IN BINDLESS
@@ -38,6 +39,14 @@ struct VSConstantsEach
 {
     float4x4 world;
     float4x4 worldInv;
+    
+    float3 boundsMin;
+    uint compactVertices;
+    float3 boundsSize;
+    uint splitPositions;
+    
+    uint attributeByteOffset;
+    float3 padding;
 };
 
 struct Vertex
@@ -48,6 +57,65 @@ struct Vertex
     float3 Tangent;
 };
 
+// Must match CompactVertex in VertexQuantization.h
+struct CompactVertex
+{
+    uint2 Position; // 16-bit unorm xyz (w unused), relative to the mesh bounds
+    uint UV; // 2 half floats
+    uint Normal; // Octahedral, 2 16-bit snorms
+    uint Tangent;
+};
+
+// Everything but the position, when positions are a separate stream
+struct VertexAttributes
+{
+    float2 UV;
+    float3 Normal;
+    float3 Tangent;
+};
+
+// Must match CompactVertexAttributes in VertexQuantization.h
+struct CompactVertexAttributes
+{
+    uint UV;
+    uint Normal;
+    uint Tangent;
+};
+
+// Sizes of the layouts in the vertex buffer
+static const uint VertexStride = 44;
+static const uint CompactVertexStride = 20;
+static const uint PositionStride = 12;
+static const uint CompactPositionStride = 8;
+static const uint AttributeStride = 32;
+static const uint CompactAttributeStride = 12;
+
+// Low and high 16-bit snorms of a uint, in [-1, 1]
+float2 UnpackSnorm16x2(uint packed)
+{
+    int2 values = int2((int) (packed << 16), (int) packed) >> 16;
+    return max(values / 32767.0f, -1.0f);
+}
+
+float3 DecodeOctahedral(float2 f)
+{
+    float3 n = float3(f, 1.0f - abs(f.x) - abs(f.y));
+    float t = saturate(-n.z);
+    n.xy += lerp(t.xx, -t.xx, step(0.0f, n.xy)); // -t where xy >= 0, +t otherwise
+    return normalize(n);
+}
+
+Vertex DecodeCompactVertex(CompactVertex c, float3 boundsMin, float3 boundsSize)
+{
+    Vertex v;
+    float3 unorm = float3(c.Position.x & 0xFFFF, c.Position.x >> 16, c.Position.y & 0xFFFF) / 65535.0f;
+    v.Position = boundsMin + unorm * boundsSize;
+    v.UV = float2(f16tof32(c.UV), f16tof32(c.UV >> 16));
+    v.Normal = DecodeOctahedral(UnpackSnorm16x2(c.Normal));
+    v.Tangent = DecodeOctahedral(UnpackSnorm16x2(c.Tangent));
+    return v;
+}
+
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
 // 
@@ -59,9 +127,40 @@ VertexToPixel main(uint vertexID : SV_VertexID )
 {
     ConstantBuffer<VSConstantsAll> vsAllData = ResourceDescriptorHeap[vsConstAllIndex];
     ConstantBuffer<VSConstantsEach> vsEachData = ResourceDescriptorHeap[vsConstEachIndex];
-    StructuredBuffer<Vertex> vbBuffer = ResourceDescriptorHeap[vsVertexBufferIndex];
     
-    Vertex v = vbBuffer[vertexID];
+    // Every mesh shares one raw buffer, holding either vertex layout,
+    // interleaved or with positions split into their own stream
+    ByteAddressBuffer vbBuffer = ResourceDescriptorHeap[vsVertexBufferIndex];
+    Vertex v;
+    if (vsEachData.compactVertices)
+    {
+        CompactVertex c;
+        if (vsEachData.splitPositions)
+        {
+            CompactVertexAttributes a = vbBuffer.Load<CompactVertexAttributes>(vsEachData.attributeByteOffset + vertexID * CompactAttributeStride);
+            c.Position = vbBuffer.Load2(vsVertexByteOffset + vertexID * CompactPositionStride);
+            c.UV = a.UV;
+            c.Normal = a.Normal;
+            c.Tangent = a.Tangent;
+        }
+        else
+        {
+            c = vbBuffer.Load<CompactVertex>(vsVertexByteOffset + vertexID * CompactVertexStride);
+        }
+        v = DecodeCompactVertex(c, vsEachData.boundsMin, vsEachData.boundsSize);
+    }
+    else if (vsEachData.splitPositions)
+    {
+        VertexAttributes a = vbBuffer.Load<VertexAttributes>(vsEachData.attributeByteOffset + vertexID * AttributeStride);
+        v.Position = vbBuffer.Load<float3>(vsVertexByteOffset + vertexID * PositionStride);
+        v.UV = a.UV;
+        v.Normal = a.Normal;
+        v.Tangent = a.Tangent;
+    }
+    else
+    {
+        v = vbBuffer.Load<Vertex>(vsVertexByteOffset + vertexID * VertexStride);
+    }
 	
 	// Set up output struct
     VertexToPixel output;